@@ -0,0 +1,45 @@
+// runtime/core/cli-utils.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+#ifndef SHERPA_DEPLOY_CORE_CLI_UTILS_H_
+#define SHERPA_DEPLOY_CORE_CLI_UTILS_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace SherpaDeploy {
+
+/* Take the option --name=value out of the command line arguments.
+ *
+ * The command line tools parse their positional arguments by index, so
+ * optional named arguments are removed before that.
+ *
+ * @param name  Name of the option without the leading --
+ * @param argc  It is updated to the number of remaining arguments.
+ * @param argv  The option is removed from it.
+ *
+ * @return Return the value of the option, or an empty string if it is
+ *         not given.
+ */
+inline std::string TakeOption(const char *name, int32_t *argc, char *argv[]) {
+  std::string prefix = std::string("--") + name + "=";
+
+  std::string ans;
+  int32_t n = 1;
+  for (int32_t i = 1; i != *argc; ++i) {
+    if (std::strncmp(argv[i], prefix.c_str(), prefix.size()) == 0) {
+      ans = argv[i] + prefix.size();
+    } else {
+      argv[n++] = argv[i];
+    }
+  }
+  argv[n] = nullptr;
+  *argc = n;
+
+  return ans;
+}
+
+}  // namespace SherpaDeploy
+
+#endif  // SHERPA_DEPLOY_CORE_CLI_UTILS_H_
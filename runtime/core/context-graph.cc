@@ -6,16 +6,115 @@
 
 #include <algorithm>
 #include <cassert>
-#include <queue>
+#include <cstring>
+#include <fstream>
+#include <map>
 #include <string>
 #include <tuple>
 #include <utility>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace SherpaDeploy {
+
+namespace {
+
+constexpr int32_t kMagic = 0x47434453;  // "SDCG"
+constexpr int32_t kVersion = 1;
+
+// The serialized graph is this header followed by, in order:
+//   ContextState nodes[num_nodes]        (BFS order, the root comes first)
+//   ContextArc arcs[num_arcs]
+//   int32_t root_next[num_root_next]
+//   int32_t phrase_offsets[num_phrases + 1]
+//   char phrase_data[phrase_offsets[num_phrases]]
+// Every section but the last is 4-byte aligned.
+struct Header {
+  int32_t magic;
+  int32_t version;
+  int32_t state_size;
+  int32_t arc_size;
+  int32_t num_nodes;
+  int32_t num_arcs;
+  int32_t num_root_next;
+  int32_t num_phrases;
+  float context_score;
+  float ac_threshold;
+};
+
+// Mutable trie used only while building.
+struct BuildState {
+  int32_t token;
+  float token_score;
+  float node_score;
+  float output_score;
+  int32_t level;
+  float ac_threshold;
+  bool is_end;
+  std::string phrase;
+  std::map<int32_t, int32_t> next;
+  int32_t fail = 0;
+  int32_t output = -1;
+};
+
+template <typename T>
+void Append(const T *p, size_t n, std::vector<char> *buffer) {
+  const char *b = reinterpret_cast<const char *>(p);
+  buffer->insert(buffer->end(), b, b + n * sizeof(T));
+}
+
+}  // namespace
+
+ContextGraph::~ContextGraph() { Release(); }
+
+ContextGraph::ContextGraph(ContextGraph &&other) noexcept {
+  *this = std::move(other);
+}
+
+ContextGraph &ContextGraph::operator=(ContextGraph &&other) noexcept {
+  if (this != &other) {
+    Release();
+    context_score_ = other.context_score_;
+    ac_threshold_ = other.ac_threshold_;
+    // Moving a vector keeps its storage, so the array pointers stay valid.
+    buffer_ = std::move(other.buffer_);
+    mapped_ = other.mapped_;
+    mapped_size_ = other.mapped_size_;
+    nodes_ = other.nodes_;
+    arcs_ = other.arcs_;
+    root_next_ = other.root_next_;
+    phrase_offsets_ = other.phrase_offsets_;
+    phrase_data_ = other.phrase_data_;
+    num_nodes_ = other.num_nodes_;
+    num_root_next_ = other.num_root_next_;
+
+    other.mapped_ = nullptr;
+    other.mapped_size_ = 0;
+    other.nodes_ = nullptr;
+    other.num_nodes_ = 0;
+  }
+  return *this;
+}
+
+void ContextGraph::Release() {
+#ifndef _WIN32
+  if (mapped_) {
+    munmap(mapped_, mapped_size_);
+  }
+#endif
+  mapped_ = nullptr;
+  mapped_size_ = 0;
+}
+
 void ContextGraph::Build(const std::vector<std::vector<int32_t>> &token_ids,
                          const std::vector<float> &scores,
                          const std::vector<std::string> &phrases,
-                         const std::vector<float> &ac_thresholds) const {
+                         const std::vector<float> &ac_thresholds) {
   if (!scores.empty()) {
     assert(token_ids.size() == scores.size());
   }
@@ -25,8 +124,12 @@ void ContextGraph::Build(const std::vector<std::vector<int32_t>> &token_ids,
   if (!ac_thresholds.empty()) {
     assert(token_ids.size() == ac_thresholds.size());
   }
+
+  std::vector<BuildState> trie;
+  trie.push_back({-1, 0, 0, 0, 0, 0.0f, false, std::string(), {}, 0, -1});
+
   for (int32_t i = 0; i < token_ids.size(); ++i) {
-    auto node = root_.get();
+    int32_t node = 0;
     float score = scores.empty() ? 0.0f : scores[i];
     score = score == 0.0f ? context_score_ : score;
     float ac_threshold = ac_thresholds.empty() ? 0.0f : ac_thresholds[i];
@@ -35,31 +138,275 @@ void ContextGraph::Build(const std::vector<std::vector<int32_t>> &token_ids,
 
     for (int32_t j = 0; j < token_ids[i].size(); ++j) {
       int32_t token = token_ids[i][j];
-      if (0 == node->next.count(token)) {
-        bool is_end = j == token_ids[i].size() - 1;
-        node->next[token] = std::make_unique<ContextState>(
-            token, score, node->node_score + score,
-            is_end ? node->node_score + score : 0, j + 1,
-            is_end ? ac_threshold : 0.0f, is_end,
-            is_end ? phrase : std::string());
+      bool is_last = j == token_ids[i].size() - 1;
+      auto it = trie[node].next.find(token);
+      if (it == trie[node].next.end()) {
+        float node_score = trie[node].node_score + score;
+        int32_t child = trie.size();
+        trie[node].next[token] = child;
+        trie.push_back({token, score, node_score, is_last ? node_score : 0,
+                        j + 1, is_last ? ac_threshold : 0.0f, is_last,
+                        is_last ? phrase : std::string(), {}, 0, -1});
+        node = child;
+      } else {
+        int32_t child = it->second;
+        BuildState &s = trie[child];
+        s.token_score = std::max(score, s.token_score);
+        s.node_score = trie[node].node_score + s.token_score;
+        s.is_end = is_last || s.is_end;
+        s.output_score = s.is_end ? s.node_score : 0.0f;
+        if (is_last) {
+          s.phrase = phrase;
+          s.ac_threshold = ac_threshold;
+        }
+        node = child;
+      }
+    }
+  }
+
+  // Fill fail and output arcs in BFS order; `order` is also the layout of
+  // the compiled node array.
+  std::vector<int32_t> order = {0};
+  for (size_t k = 0; k != order.size(); ++k) {
+    int32_t current = order[k];
+    for (const auto &kv : trie[current].next) {
+      int32_t child = kv.second;
+      if (current == 0) {
+        trie[child].fail = 0;
       } else {
-        float token_score = std::max(score, node->next[token]->token_score);
-        node->next[token]->token_score = token_score;
-        float node_score = node->node_score + token_score;
-        node->next[token]->node_score = node_score;
-        bool is_end =
-            (j == token_ids[i].size() - 1) || node->next[token]->is_end;
-        node->next[token]->output_score = is_end ? node_score : 0.0f;
-        node->next[token]->is_end = is_end;
-        if (j == token_ids[i].size() - 1) {
-          node->next[token]->phrase = phrase;
-          node->next[token]->ac_threshold = ac_threshold;
+        int32_t fail = trie[current].fail;
+        while (true) {
+          auto it = trie[fail].next.find(kv.first);
+          if (it != trie[fail].next.end()) {
+            fail = it->second;
+            break;
+          }
+          if (fail == 0) break;
+          fail = trie[fail].fail;
+        }
+        trie[child].fail = fail;
+      }
+
+      int32_t output = trie[child].fail;
+      while (!trie[output].is_end) {
+        if (output == 0) {
+          output = -1;
+          break;
         }
+        output = trie[output].fail;
       }
-      node = node->next[token].get();
+      trie[child].output = output;
+      trie[child].output_score +=
+          output == -1 ? 0 : trie[output].output_score;
+      order.push_back(child);
+    }
+  }
+
+  int32_t num_nodes = order.size();
+  std::vector<int32_t> new_id(num_nodes);
+  for (int32_t k = 0; k != num_nodes; ++k) {
+    new_id[order[k]] = k;
+  }
+
+  std::vector<std::string> phrase_list;
+  std::vector<ContextState> nodes(num_nodes);
+  for (int32_t k = 0; k != num_nodes; ++k) {
+    const BuildState &s = trie[order[k]];
+    ContextState &n = nodes[k];
+    n.token = s.token;
+    n.token_score = s.token_score;
+    n.node_score = s.node_score;
+    n.output_score = s.output_score;
+    n.level = s.level;
+    n.ac_threshold = s.ac_threshold;
+    n.is_end = s.is_end;
+    n.phrase = -1;
+    if (s.is_end && !s.phrase.empty()) {
+      n.phrase = phrase_list.size();
+      phrase_list.push_back(s.phrase);
+    }
+    n.fail = new_id[s.fail];
+    n.output = s.output == -1 ? -1 : new_id[s.output];
+  }
+
+  // Transitions from the root go through a dense table indexed by token.
+  int32_t num_root_next = trie[0].next.empty()
+                              ? 0
+                              : trie[0].next.rbegin()->first + 1;
+  std::vector<int32_t> root_next(num_root_next, 0);
+  for (const auto &kv : trie[0].next) {
+    root_next[kv.first] = new_id[kv.second];
+  }
+
+  // Every other node gets its own children plus whatever its fail state
+  // can reach, except the root's transitions which the table above covers.
+  // Fail states are shallower, so they are done before the nodes using them.
+  std::vector<ContextArc> arcs;
+  nodes[0].arc_begin = nodes[0].arc_end = 0;
+  for (int32_t k = 1; k != num_nodes; ++k) {
+    const BuildState &s = trie[order[k]];
+    ContextState &n = nodes[k];
+    const ContextState &fail = nodes[n.fail];
+
+    n.arc_begin = arcs.size();
+    auto own = s.next.begin();
+    int32_t inherited = fail.arc_begin;
+    while (own != s.next.end() || inherited != fail.arc_end) {
+      if (inherited == fail.arc_end ||
+          (own != s.next.end() && own->first <= arcs[inherited].token)) {
+        int32_t next = new_id[own->second];
+        if (inherited != fail.arc_end && own->first == arcs[inherited].token) {
+          ++inherited;
+        }
+        arcs.push_back({own->first, next, nodes[next].token_score});
+        ++own;
+      } else {
+        ContextArc arc = arcs[inherited++];
+        arc.score = nodes[arc.next].node_score - n.node_score;
+        arcs.push_back(arc);
+      }
+    }
+    n.arc_end = arcs.size();
+  }
+
+  std::vector<int32_t> phrase_offsets = {0};
+  std::string phrase_data;
+  for (const auto &p : phrase_list) {
+    phrase_data += p;
+    phrase_offsets.push_back(phrase_data.size());
+  }
+
+  Header header;
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.state_size = sizeof(ContextState);
+  header.arc_size = sizeof(ContextArc);
+  header.num_nodes = num_nodes;
+  header.num_arcs = arcs.size();
+  header.num_root_next = num_root_next;
+  header.num_phrases = phrase_list.size();
+  header.context_score = context_score_;
+  header.ac_threshold = ac_threshold_;
+
+  buffer_.clear();
+  Append(&header, 1, &buffer_);
+  Append(nodes.data(), nodes.size(), &buffer_);
+  Append(arcs.data(), arcs.size(), &buffer_);
+  Append(root_next.data(), root_next.size(), &buffer_);
+  Append(phrase_offsets.data(), phrase_offsets.size(), &buffer_);
+  Append(phrase_data.data(), phrase_data.size(), &buffer_);
+
+  bool ok = Attach(buffer_.data(), buffer_.size());
+  assert(ok);
+  (void)ok;
+}
+
+bool ContextGraph::Attach(const char *data, size_t size) {
+  if (size < sizeof(Header)) return false;
+
+  Header header;
+  std::memcpy(&header, data, sizeof(Header));
+  if (header.magic != kMagic || header.version != kVersion ||
+      header.state_size != sizeof(ContextState) ||
+      header.arc_size != sizeof(ContextArc) || header.num_nodes < 1 ||
+      header.num_arcs < 0 || header.num_root_next < 0 ||
+      header.num_phrases < 0) {
+    return false;
+  }
+
+  size_t offset = sizeof(Header);
+  size_t phrase_offsets_pos = offset +
+                              header.num_nodes * sizeof(ContextState) +
+                              header.num_arcs * sizeof(ContextArc) +
+                              header.num_root_next * sizeof(int32_t);
+  size_t phrase_data_pos =
+      phrase_offsets_pos + (header.num_phrases + 1) * sizeof(int32_t);
+  if (phrase_data_pos > size) return false;
+
+  context_score_ = header.context_score;
+  ac_threshold_ = header.ac_threshold;
+  num_nodes_ = header.num_nodes;
+  num_root_next_ = header.num_root_next;
+
+  nodes_ = reinterpret_cast<const ContextState *>(data + offset);
+  offset += header.num_nodes * sizeof(ContextState);
+  arcs_ = reinterpret_cast<const ContextArc *>(data + offset);
+  offset += header.num_arcs * sizeof(ContextArc);
+  root_next_ = reinterpret_cast<const int32_t *>(data + offset);
+  phrase_offsets_ = reinterpret_cast<const int32_t *>(data + phrase_offsets_pos);
+  phrase_data_ = data + phrase_data_pos;
+
+  // Decoding follows these indexes without checking them, so a file that
+  // was not written by Save() must not be able to point outside the arrays.
+  auto is_node = [&](int32_t i) { return i >= 0 && i < header.num_nodes; };
+
+  for (int32_t k = 0; k != header.num_nodes; ++k) {
+    const ContextState &n = nodes_[k];
+    if (!is_node(n.fail) || (n.output != -1 && !is_node(n.output)) ||
+        n.arc_begin < 0 || n.arc_begin > n.arc_end ||
+        n.arc_end > header.num_arcs || n.phrase < -1 ||
+        n.phrase >= header.num_phrases) {
+      return false;
     }
   }
-  FillFailOutput();
+
+  for (int32_t k = 0; k != header.num_arcs; ++k) {
+    if (!is_node(arcs_[k].next)) return false;
+  }
+
+  for (int32_t k = 0; k != header.num_root_next; ++k) {
+    if (!is_node(root_next_[k])) return false;
+  }
+
+  if (phrase_offsets_[0] != 0) return false;
+  for (int32_t k = 0; k != header.num_phrases; ++k) {
+    if (phrase_offsets_[k] > phrase_offsets_[k + 1]) return false;
+  }
+
+  return phrase_data_pos + phrase_offsets_[header.num_phrases] <= size;
+}
+
+ContextGraphPtr ContextGraph::Load(const std::string &filename) {
+  auto graph = std::make_shared<ContextGraph>();
+#ifndef _WIN32
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+    close(fd);
+    return nullptr;
+  }
+
+  void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return nullptr;
+
+  graph->mapped_ = p;
+  graph->mapped_size_ = st.st_size;
+  if (!graph->Attach(static_cast<const char *>(p), st.st_size)) {
+    return nullptr;
+  }
+#else
+  std::ifstream is(filename, std::ios::binary);
+  if (!is) return nullptr;
+  graph->buffer_.assign(std::istreambuf_iterator<char>(is), {});
+  if (!graph->Attach(graph->buffer_.data(), graph->buffer_.size())) {
+    return nullptr;
+  }
+#endif
+  return graph;
+}
+
+bool ContextGraph::Save(const std::string &filename) const {
+  const char *data = mapped_ ? static_cast<const char *>(mapped_)
+                             : buffer_.data();
+  size_t size = mapped_ ? mapped_size_ : buffer_.size();
+  if (size == 0) return false;
+
+  std::ofstream os(filename, std::ios::binary);
+  os.write(data, size);
+  return os.good();
 }
 
 std::tuple<float, const ContextState *, const ContextState *>
@@ -67,33 +414,30 @@ ContextGraph::ForwardOneStep(const ContextState *state, int32_t token,
                              bool strict_mode /*= true*/) const {
   const ContextState *node;
   float score;
-  if (1 == state->next.count(token)) {
-    node = state->next.at(token).get();
-    score = node->token_score;
+
+  const ContextArc *begin = arcs_ + state->arc_begin;
+  const ContextArc *end = arcs_ + state->arc_end;
+  const ContextArc *arc = std::lower_bound(
+      begin, end, token,
+      [](const ContextArc &a, int32_t t) { return a.token < t; });
+  if (arc != end && arc->token == token) {
+    node = nodes_ + arc->next;
+    score = arc->score;
   } else {
-    node = state->fail;
-    while (0 == node->next.count(token)) {
-      node = node->fail;
-      if (-1 == node->token) break;  // root
-    }
-    if (1 == node->next.count(token)) {
-      node = node->next.at(token).get();
-    }
+    int32_t next =
+        (token >= 0 && token < num_root_next_) ? root_next_[token] : 0;
+    node = nodes_ + next;
     score = node->node_score - state->node_score;
   }
 
-  assert(nullptr != node);
-
   const ContextState *matched_node =
-      node->is_end ? node : (node->output != nullptr ? node->output : nullptr);
+      node->is_end ? node
+                   : (node->output != -1 ? nodes_ + node->output : nullptr);
 
   if (!strict_mode && node->output_score != 0) {
     assert(nullptr != matched_node);
-    float output_score =
-        node->is_end ? node->node_score
-                     : (node->output != nullptr ? node->output->node_score
-                                                : node->node_score);
-    return std::make_tuple(score + output_score - node->node_score, root_.get(),
+    float output_score = matched_node->node_score;
+    return std::make_tuple(score + output_score - node->node_score, Root(),
                            matched_node);
   }
   return std::make_tuple(score + node->output_score, node, matched_node);
@@ -102,7 +446,7 @@ ContextGraph::ForwardOneStep(const ContextState *state, int32_t token,
 std::pair<float, const ContextState *> ContextGraph::Finalize(
     const ContextState *state) const {
   float score = -state->node_score;
-  return std::make_pair(score, root_.get());
+  return std::make_pair(score, Root());
 }
 
 std::pair<bool, const ContextState *> ContextGraph::IsMatched(
@@ -113,50 +457,18 @@ std::pair<bool, const ContextState *> ContextGraph::IsMatched(
     status = true;
     node = state;
   } else {
-    if (state->output != nullptr) {
+    if (state->output != -1) {
       status = true;
-      node = state->output;
+      node = nodes_ + state->output;
     }
   }
   return std::make_pair(status, node);
 }
 
-void ContextGraph::FillFailOutput() const {
-  std::queue<const ContextState *> node_queue;
-  for (auto &kv : root_->next) {
-    kv.second->fail = root_.get();
-    node_queue.push(kv.second.get());
-  }
-  while (!node_queue.empty()) {
-    auto current_node = node_queue.front();
-    node_queue.pop();
-    for (auto &kv : current_node->next) {
-      auto fail = current_node->fail;
-      if (1 == fail->next.count(kv.first)) {
-        fail = fail->next.at(kv.first).get();
-      } else {
-        fail = fail->fail;
-        while (0 == fail->next.count(kv.first)) {
-          fail = fail->fail;
-          if (-1 == fail->token) break;
-        }
-        if (1 == fail->next.count(kv.first))
-          fail = fail->next.at(kv.first).get();
-      }
-      kv.second->fail = fail;
-      // fill the output arc
-      auto output = fail;
-      while (!output->is_end) {
-        output = output->fail;
-        if (-1 == output->token) {
-          output = nullptr;
-          break;
-        }
-      }
-      kv.second->output = output;
-      kv.second->output_score += output == nullptr ? 0 : output->output_score;
-      node_queue.push(kv.second.get());
-    }
-  }
+std::string ContextGraph::Phrase(const ContextState *state) const {
+  if (state->phrase < 0) return {};
+  return std::string(phrase_data_ + phrase_offsets_[state->phrase],
+                     phrase_data_ + phrase_offsets_[state->phrase + 1]);
 }
+
 }  // namespace SherpaDeploy
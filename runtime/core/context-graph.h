@@ -5,10 +5,11 @@
 #ifndef SHERPA_DEPLOY_CORE_CONTEXT_GRAPH_H_
 #define SHERPA_DEPLOY_CORE_CONTEXT_GRAPH_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <tuple>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -17,6 +18,9 @@ namespace SherpaDeploy {
 class ContextGraph;
 using ContextGraphPtr = std::shared_ptr<ContextGraph>;
 
+// A node of the compiled graph. It is plain data so that the whole graph can
+// be written to disk and mapped back without any fix-up. Links to other nodes
+// are indexes into the node array of the owning graph.
 struct ContextState {
   int32_t token;
   float token_score;
@@ -24,24 +28,21 @@ struct ContextState {
   float output_score;
   int32_t level;
   float ac_threshold;
-  bool is_end;
-  std::string phrase;
-  std::unordered_map<int32_t, std::unique_ptr<ContextState>> next;
-  const ContextState *fail = nullptr;
-  const ContextState *output = nullptr;
-
-  ContextState() = default;
-  ContextState(int32_t token, float token_score, float node_score,
-               float output_score, int32_t level = 0, float ac_threshold = 0.0f,
-               bool is_end = false, const std::string &phrase = {})
-      : token(token),
-        token_score(token_score),
-        node_score(node_score),
-        output_score(output_score),
-        level(level),
-        ac_threshold(ac_threshold),
-        is_end(is_end),
-        phrase(phrase) {}
+  int32_t is_end;
+  int32_t phrase;  // index of the phrase, -1 if there is none
+  int32_t fail;
+  int32_t output;  // -1 if there is no output arc
+  // [arc_begin, arc_end) are the outgoing arcs of this node in the arc
+  // array, sorted by token. They include the transitions inherited along
+  // the fail chain so a step never walks fail links at decoding time.
+  int32_t arc_begin;
+  int32_t arc_end;
+};
+
+struct ContextArc {
+  int32_t token;
+  int32_t next;
+  float score;
 };
 
 class ContextGraph {
@@ -53,8 +54,6 @@ class ContextGraph {
                const std::vector<std::string> &phrases = {},
                const std::vector<float> &ac_thresholds = {})
       : context_score_(context_score), ac_threshold_(ac_threshold) {
-    root_ = std::make_unique<ContextState>(-1, 0, 0, 0);
-    root_->fail = root_.get();
     Build(token_ids, scores, phrases, ac_thresholds);
   }
 
@@ -64,6 +63,27 @@ class ContextGraph {
       : ContextGraph(token_ids, context_score, 0.0f, scores, phrases,
                      std::vector<float>()) {}
 
+  ~ContextGraph();
+
+  ContextGraph(const ContextGraph &) = delete;
+  ContextGraph &operator=(const ContextGraph &) = delete;
+
+  ContextGraph(ContextGraph &&other) noexcept;
+  ContextGraph &operator=(ContextGraph &&other) noexcept;
+
+  /** Load a graph written by Save(). The file is memory mapped where the
+   * platform supports it.
+   *
+   * @return Return nullptr if the file is not a serialized context graph.
+   */
+  static ContextGraphPtr Load(const std::string &filename);
+
+  /** Write the graph to `filename` so that Load() can map it later.
+   *
+   * @return Return false on I/O error.
+   */
+  bool Save(const std::string &filename) const;
+
   std::tuple<float, const ContextState *, const ContextState *> ForwardOneStep(
       const ContextState *state, int32_t token_id,
       bool strict_mode = true) const;
@@ -74,17 +94,41 @@ class ContextGraph {
   std::pair<float, const ContextState *> Finalize(
       const ContextState *state) const;
 
-  const ContextState *Root() const { return root_.get(); }
+  const ContextState *Root() const { return nodes_; }
+
+  // Return the phrase attached to an end state, or an empty string.
+  std::string Phrase(const ContextState *state) const;
+
+  int32_t NumStates() const { return num_nodes_; }
 
  private:
-  float context_score_;
-  float ac_threshold_;
-  std::unique_ptr<ContextState> root_;
+  float context_score_ = 0;
+  float ac_threshold_ = 0;
+
+  // All the arrays below point into `buffer_` or into `mapped_`, which have
+  // exactly the layout of the on-disk format.
+  std::vector<char> buffer_;
+  void *mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+
+  const ContextState *nodes_ = nullptr;
+  const ContextArc *arcs_ = nullptr;
+  // root_next_[token] is the child of the root for `token`, or 0 (the root)
+  const int32_t *root_next_ = nullptr;
+  const int32_t *phrase_offsets_ = nullptr;
+  const char *phrase_data_ = nullptr;
+  int32_t num_nodes_ = 0;
+  int32_t num_root_next_ = 0;
+
   void Build(const std::vector<std::vector<int32_t>> &token_ids,
              const std::vector<float> &scores,
              const std::vector<std::string> &phrases,
-             const std::vector<float> &ac_thresholds) const;
-  void FillFailOutput() const;
+             const std::vector<float> &ac_thresholds);
+
+  // Point the arrays at `data`; return false if it is not a valid graph.
+  bool Attach(const char *data, size_t size);
+
+  void Release();
 };
 
 }  // namespace SherpaDeploy
@@ -19,8 +19,8 @@
 #include "features.h"
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
-#include <mutex>  // NOLINT
 #include <vector>
 
 #include "kaldi-native-fbank/csrc/online-feature.h"
@@ -54,10 +54,13 @@ class FeatureExtractor::Impl {
     opts_.mel_opts.high_freq = -400;
 
     fbank_ = std::make_unique<knf::OnlineFbank>(opts_);
+    feature_dim_ = fbank_->Dim();
+
+    rings_.push_back(std::make_unique<FrameRing>(64, feature_dim_));
+    ring_.store(rings_.back().get());
   }
 
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n) {
-    std::lock_guard<std::mutex> lock(mutex_);
     if (resampler_) {
       if (sampling_rate != resampler_->GetInputSamplingRate()) {
         fprintf(stderr,
@@ -71,6 +74,7 @@ class FeatureExtractor::Impl {
       resampler_->Resample(waveform, n, false, &samples);
       fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples.data(),
                              samples.size());
+      MoveFramesToRing();
       return;
     }
 
@@ -94,65 +98,131 @@ class FeatureExtractor::Impl {
       resampler_->Resample(waveform, n, false, &samples);
       fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples.data(),
                              samples.size());
+      MoveFramesToRing();
       return;
     }
 
     fbank_->AcceptWaveform(sampling_rate, waveform, n);
+    MoveFramesToRing();
   }
 
   void InputFinished() {
-    std::lock_guard<std::mutex> lock(mutex_);
     fbank_->InputFinished();
+    MoveFramesToRing();
+    // Published after the flushed frames, see IsLastFrame()
+    input_finished_.store(true, std::memory_order_release);
   }
 
   int32_t NumFramesReady() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return fbank_->NumFramesReady();
+    return num_frames_.load(std::memory_order_acquire);
   }
 
   bool IsLastFrame(int32_t frame) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return fbank_->IsLastFrame(frame);
+    return input_finished_.load(std::memory_order_acquire) &&
+           frame == num_frames_.load(std::memory_order_acquire) - 1;
   }
 
-  std::tuple<std::vector<float>, int32_t> GetFrames(int32_t frame_index, int32_t n) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (frame_index + n > fbank_->NumFramesReady()) {
-      fprintf(stderr,"%d + %d > %d", frame_index, n, fbank_->NumFramesReady());
+  int32_t FeatureDim() const { return feature_dim_; }
+
+  void GetFrames(int32_t frame_index, int32_t n, float *out) {
+    int32_t num_frames = num_frames_.load(std::memory_order_acquire);
+    if (frame_index + n > num_frames) {
+      fprintf(stderr,"%d + %d > %d", frame_index, n, num_frames);
       exit(-1);
     }
 
-    int32_t discard_num = frame_index - last_frame_index_;
-    if (discard_num < 0) {
-      fprintf(stderr,"last_frame_index_: %d, frame_index_: %d", last_frame_index_,
-                frame_index);
+    int32_t first_frame = first_frame_.load(std::memory_order_relaxed);
+    if (frame_index < first_frame) {
+      fprintf(stderr,"first available frame: %d, frame_index_: %d",
+              first_frame, frame_index);
       exit(-1);
     }
 
-    fbank_->Pop(discard_num);
-
-    int32_t feature_dim = fbank_->Dim();
-    std::vector<float> features(feature_dim * n);
-
-    float *p = features.data();
+    // Frames before frame_index are never asked for again, so the producer
+    // may reuse their slots. The frames we read below stay untouched until
+    // the next call moves first_frame_ past them.
+    first_frame_.store(frame_index, std::memory_order_release);
+
+    // Loaded after num_frames_, so it holds at least the frames counted
+    // there even if the producer has just grown the ring.
+    const FrameRing *ring = ring_.load(std::memory_order_acquire);
+
+    // At most two copies: up to the end of the ring, then from its start
+    int32_t capacity = ring->capacity;
+    int32_t pos = frame_index & (capacity - 1);
+    int32_t n1 = std::min(n, capacity - pos);
+    std::copy_n(ring->data.data() + pos * feature_dim_, n1 * feature_dim_,
+                out);
+    std::copy_n(ring->data.data(), (n - n1) * feature_dim_,
+                out + n1 * feature_dim_);
+  }
 
-    for (int32_t i = 0; i != n; ++i) {
-      const float *f = fbank_->GetFrame(i + frame_index);
-      std::copy(f, f + feature_dim, p);
-      p += feature_dim;
+ private:
+  struct FrameRing {
+    FrameRing(int32_t capacity, int32_t feature_dim)
+        : capacity(capacity), data(capacity * feature_dim) {}
+
+    int32_t capacity;  // in frames, a power of two
+    std::vector<float> data;
+  };
+
+  // Move the frames computed by fbank_ into the ring so that a chunk is
+  // contiguous (modulo one wrap-around) and fbank_ does not keep them.
+  // Called only from the producer side.
+  void MoveFramesToRing() {
+    int32_t num_frames = fbank_->NumFramesReady();
+    int32_t end = num_frames_.load(std::memory_order_relaxed);
+    int32_t num_new = num_frames - end;
+    if (num_new <= 0) return;
+
+    FrameRing *ring = ring_.load(std::memory_order_relaxed);
+    int32_t capacity = ring->capacity;
+    int32_t begin = first_frame_.load(std::memory_order_acquire);
+    int32_t num_needed = num_frames - begin;
+    if (num_needed > capacity) {
+      int32_t new_capacity = capacity;
+      while (new_capacity < num_needed) new_capacity *= 2;
+
+      auto new_ring = std::make_unique<FrameRing>(new_capacity, feature_dim_);
+      for (int32_t i = begin; i != end; ++i) {
+        std::copy_n(ring->data.data() + (i & (capacity - 1)) * feature_dim_,
+                    feature_dim_,
+                    new_ring->data.data() +
+                        (i & (new_capacity - 1)) * feature_dim_);
+      }
+      ring = new_ring.get();
+      capacity = new_capacity;
+      // The consumer may still be reading the old ring, so it is kept
+      // until the extractor is destroyed. Rings only double, so this is at
+      // most the size of the largest one.
+      rings_.push_back(std::move(new_ring));
+      ring_.store(ring, std::memory_order_release);
     }
 
-    last_frame_index_ = frame_index;
-
-    return std::make_tuple(features, feature_dim);
+    for (int32_t i = end; i != num_frames; ++i) {
+      const float *f = fbank_->GetFrame(i);
+      std::copy_n(f, feature_dim_,
+                  ring->data.data() + (i & (capacity - 1)) * feature_dim_);
+    }
+    fbank_->Pop(num_new);
+    num_frames_.store(num_frames, std::memory_order_release);
   }
 
- private:
+  // Producer side: AcceptWaveform() and InputFinished()
   std::unique_ptr<knf::OnlineFbank> fbank_;
   knf::FbankOptions opts_;
-  mutable std::mutex mutex_;
   std::unique_ptr<SherpaDeploy::LinearResample> resampler_;
-  int32_t last_frame_index_ = 0;
+  std::vector<std::unique_ptr<FrameRing>> rings_;
+  int32_t feature_dim_;
+
+  // Shared between the producer and the consumer. Frames
+  // [first_frame_, num_frames_) live in ring_, frame i at row
+  // i % ring_->capacity. Only the producer writes num_frames_ and ring_;
+  // only the consumer writes first_frame_.
+  std::atomic<FrameRing *> ring_{nullptr};
+  std::atomic<int32_t> num_frames_{0};
+  std::atomic<int32_t> first_frame_{0};
+  std::atomic<bool> input_finished_{false};
 };
 
 FeatureExtractor::FeatureExtractor(const FeatureExtractorConfig &config)
@@ -175,8 +245,18 @@ bool FeatureExtractor::IsLastFrame(int32_t frame) const {
   return impl_->IsLastFrame(frame);
 }
 
+int32_t FeatureExtractor::FeatureDim() const { return impl_->FeatureDim(); }
+
+void FeatureExtractor::GetFrames(int32_t frame_index, int32_t n,
+                                 float *out) const {
+  impl_->GetFrames(frame_index, n, out);
+}
+
 std::tuple<std::vector<float>, int32_t> FeatureExtractor::GetFrames(int32_t frame_index, int32_t n) const {
-  return impl_->GetFrames(frame_index, n);
+  int32_t feature_dim = impl_->FeatureDim();
+  std::vector<float> features(feature_dim * n);
+  impl_->GetFrames(frame_index, n, features.data());
+  return std::make_tuple(std::move(features), feature_dim);
 }
 
 }  // namespace SherpaDeploy
@@ -33,6 +33,9 @@ struct FeatureExtractorConfig {
   std::string ToString() const;
 };
 
+// One thread may feed audio with AcceptWaveform()/InputFinished() while
+// another one reads with NumFramesReady()/IsLastFrame()/GetFrames().
+// Neither side takes a lock.
 class FeatureExtractor {
  public:
   explicit FeatureExtractor(const FeatureExtractorConfig &config);
@@ -61,6 +64,20 @@ class FeatureExtractor {
   // InputFinished() (and this frame is the last frame).
   bool IsLastFrame(int32_t frame) const;
 
+  int32_t FeatureDim() const;
+
+  /** Copy n frames starting from the given frame index into `out`.
+   *
+   * Frames before frame_index are released, so frame_index must not
+   * decrease across calls.
+   *
+   * @param frame_index  The starting frame index
+   * @param n  Number of frames to get.
+   * @param out  Caller buffer of at least n * FeatureDim() floats, e.g.
+   *             the host memory of an input tensor.
+   */
+  void GetFrames(int32_t frame_index, int32_t n, float *out) const;
+
   /** Get n frames starting from the given frame index.
    *
    * @param frame_index  The starting frame index
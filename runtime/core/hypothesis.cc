@@ -25,6 +25,40 @@
 
 namespace SherpaDeploy {
 
+TokenNode::~TokenNode() {
+  // Destroying the last owner of a long chain would otherwise recurse once
+  // per token. Unlink the parents that only we own one by one instead.
+  std::shared_ptr<TokenNode> p = std::move(parent);
+  while (p && p.use_count() == 1) {
+    std::shared_ptr<TokenNode> next = std::move(p->parent);
+    p = std::move(next);
+  }
+}
+
+void Hypothesis::LastTokens(int32_t n, int32_t *out) const {
+  const TokenNode *node = last.get();
+  for (int32_t i = n - 1; i >= 0; --i) {
+    out[i] = node->token;
+    node = node->parent.get();
+  }
+}
+
+std::vector<int32_t> Hypothesis::Ys() const {
+  std::vector<int32_t> ans(num_tokens);
+  LastTokens(num_tokens, ans.data());
+  return ans;
+}
+
+std::vector<int32_t> Hypothesis::Timestamps() const {
+  std::vector<int32_t> ans;
+  for (const TokenNode *node = last.get(); node && node->timestamp >= 0;
+       node = node->parent.get()) {
+    ans.push_back(node->timestamp);
+  }
+  std::reverse(ans.begin(), ans.end());
+  return ans;
+}
+
 void Hypotheses::Add(Hypothesis hyp) {
   auto key = hyp.Key();
   auto it = hyps_dict_.find(key);
@@ -35,46 +69,53 @@ void Hypotheses::Add(Hypothesis hyp) {
   }
 }
 
+static double Score(const Hypothesis &hyp, bool length_norm) {
+  return length_norm ? hyp.log_prob / hyp.NumTokens() : hyp.log_prob;
+}
+
 Hypothesis Hypotheses::GetMostProbable(bool length_norm) const {
-  if (length_norm == false) {
-    return std::max_element(hyps_dict_.begin(), hyps_dict_.end(),
-                            [](const auto &left, auto &right) -> bool {
-                              return left.second.log_prob <
-                                     right.second.log_prob;
-                            })
-        ->second;
-  } else {
-    // for length_norm is true
-    return std::max_element(
-               hyps_dict_.begin(), hyps_dict_.end(),
-               [](const auto &left, const auto &right) -> bool {
-                 return left.second.log_prob / left.second.ys.size() <
-                        right.second.log_prob / right.second.ys.size();
-               })
-        ->second;
-  }
+  return std::max_element(hyps_dict_.begin(), hyps_dict_.end(),
+                          [length_norm](const auto &left, const auto &right) {
+                            return Score(left.second, length_norm) <
+                                   Score(right.second, length_norm);
+                          })
+      ->second;
 }
 
 std::vector<Hypothesis> Hypotheses::GetTopK(int32_t k, bool length_norm) const {
   k = std::max(k, 1);
   k = std::min(k, Size());
 
-  std::vector<Hypothesis> all_hyps = Vec();
+  // A min-heap holding the best k hyps seen so far, so only k entries are
+  // ever moved around no matter how many hyps there are
+  using Entry = std::pair<double, const Hypothesis *>;
+  auto greater = [](const Entry &a, const Entry &b) {
+    return a.first > b.first;
+  };
 
-  if (length_norm == false) {
-    std::partial_sort(
-        all_hyps.begin(), all_hyps.begin() + k, all_hyps.end(),
-        [](const auto &a, const auto &b) { return a.log_prob > b.log_prob; });
-  } else {
-    // for length_norm is true
-    std::partial_sort(all_hyps.begin(), all_hyps.begin() + k, all_hyps.end(),
-                      [](const auto &a, const auto &b) {
-                        return a.log_prob / a.ys.size() >
-                               b.log_prob / b.ys.size();
-                      });
+  std::vector<Entry> heap;
+  heap.reserve(k);
+  for (const auto &p : hyps_dict_) {
+    double score = Score(p.second, length_norm);
+    if (static_cast<int32_t>(heap.size()) < k) {
+      heap.emplace_back(score, &p.second);
+      std::push_heap(heap.begin(), heap.end(), greater);
+    } else if (score > heap.front().first) {
+      std::pop_heap(heap.begin(), heap.end(), greater);
+      heap.back() = {score, &p.second};
+      std::push_heap(heap.begin(), heap.end(), greater);
+    }
   }
 
-  return {all_hyps.begin(), all_hyps.begin() + k};
+  // best first
+  std::sort_heap(heap.begin(), heap.end(), greater);
+
+  std::vector<Hypothesis> ans;
+  ans.reserve(k);
+  for (const auto &e : heap) {
+    ans.push_back(*e.second);
+  }
+  return ans;
 }
 
 }  // namespace SherpaDeploy
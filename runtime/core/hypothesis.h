@@ -19,6 +19,8 @@
 #ifndef SHERPA_DEPLOY_CORE_HYPOTHESIS_H_
 #define SHERPA_DEPLOY_CORE_HYPOTHESIS_H_
 
+#include <cstdint>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -29,42 +31,94 @@
 
 namespace SherpaDeploy {
 
+// A node of the token prefix tree shared by the hypotheses of a stream.
+// A hypothesis points to the node of its last token, so appending a token
+// adds one node and never copies the history.
+struct TokenNode {
+  TokenNode(int32_t token, int32_t timestamp, std::shared_ptr<TokenNode> parent)
+      : token(token), timestamp(timestamp), parent(std::move(parent)) {}
+
+  // Releases long chains without recursion
+  ~TokenNode();
+
+  TokenNode(const TokenNode &) = delete;
+  TokenNode &operator=(const TokenNode &) = delete;
+
+  int32_t token;
+  // Frame number after subsampling on which the token is decoded.
+  // -1 for the tokens given to the constructor of Hypothesis.
+  int32_t timestamp;
+  std::shared_ptr<TokenNode> parent;
+};
+
 struct Hypothesis {
-  // The predicted tokens so far. Newly predicated tokens are appended.
-  std::vector<int32_t> ys;
+  // The node of the last predicted token, nullptr if there are no tokens
+  std::shared_ptr<TokenNode> last;
+
+  // Number of tokens in the path from the root to `last`
+  int32_t num_tokens = 0;
 
-  // timestamps[i] contains the frame number after subsampling
-  // on which ys[i] is decoded.
-  std::vector<int32_t> timestamps;
+  // Hash of the token sequence, updated as tokens are appended
+  uint64_t key = 0;
 
-  // The total score of ys in log space.
+  // The total score of the tokens in log space.
   double log_prob = 0;
-  const ContextState *context_state;
+  const ContextState *context_state = nullptr;
   int32_t num_trailing_blanks = 0;
 
   Hypothesis() = default;
   Hypothesis(const std::vector<int32_t> &ys, double log_prob,
              const ContextState *context_state = nullptr)
-      : ys(ys), log_prob(log_prob), context_state(context_state) {}
+      : log_prob(log_prob), context_state(context_state) {
+    for (auto y : ys) {
+      Append(y, -1);
+    }
+  }
+
+  // Append a token decoded on frame `timestamp` (after subsampling)
+  void Append(int32_t token, int32_t timestamp) {
+    last = std::make_shared<TokenNode>(token, timestamp, std::move(last));
+    ++num_tokens;
+    key = HashCombine(key, token);
+  }
+
+  int32_t NumTokens() const { return num_tokens; }
+
+  // Write the last n tokens into out[0..n), oldest first.
+  // n must not exceed NumTokens().
+  void LastTokens(int32_t n, int32_t *out) const;
+
+  // The predicted tokens so far. It walks the whole path, so call it only
+  // when the full sequence is needed.
+  std::vector<int32_t> Ys() const;
+
+  // Timestamps of the tokens added with Append() after construction
+  std::vector<int32_t> Timestamps() const;
 
   // If two Hypotheses have the same `Key`, then they contain
   // the same token sequence.
-  std::string Key() const {
-    // TODO(fangjun): Use a hash function?
+  uint64_t Key() const { return key; }
+
+  // For debugging
+  std::string ToString() const {
     std::ostringstream os;
-    std::string sep = "-";
-    for (auto i : ys) {
-      os << i << sep;
+    os << "(";
+    std::string sep;
+    for (auto i : Ys()) {
+      os << sep << i;
       sep = "-";
     }
+    os << ", " << log_prob << ")";
     return os.str();
   }
 
-  // For debugging
-  std::string ToString() const {
-    std::ostringstream os;
-    os << "(" << Key() << ", " << log_prob << ")";
-    return os.str();
+ private:
+  static uint64_t HashCombine(uint64_t h, int32_t token) {
+    // splitmix64 finalizer over the previous hash and the token
+    uint64_t x = h * 0x9e3779b97f4a7c15ULL + static_cast<uint32_t>(token) + 1;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
   }
 };
 
@@ -78,21 +132,18 @@ class Hypotheses {
     }
   }
 
-  explicit Hypotheses(std::unordered_map<std::string, Hypothesis> hyps_dict)
-      : hyps_dict_(std::move(hyps_dict)) {}
-
   // Add hyp to this object. If it already exists, its log_prob
   // is updated with the given hyp using log-sum-exp.
   void Add(Hypothesis hyp);
 
   // Get the hyp that has the largest log_prob.
   // If length_norm is true, hyp's log_prob is divided by
-  // len(hyp.ys) before comparison.
+  // hyp.NumTokens() before comparison.
   Hypothesis GetMostProbable(bool length_norm) const;
 
-  // Get the k hyps that have the largest log_prob.
+  // Get the k hyps that have the largest log_prob, best first.
   // If length_norm is true, hyp's log_prob is divided by
-  // len(hyp.ys) before comparison.
+  // hyp.NumTokens() before comparison.
   std::vector<Hypothesis> GetTopK(int32_t k, bool length_norm) const;
 
   int32_t Size() const { return hyps_dict_.size(); }
@@ -113,18 +164,7 @@ class Hypotheses {
   void Clear() { hyps_dict_.clear(); }
 
  private:
-  // Return a list of hyps contained in this object.
-  std::vector<Hypothesis> Vec() const {
-    std::vector<Hypothesis> ans;
-    ans.reserve(hyps_dict_.size());
-    for (const auto &p : hyps_dict_) {
-      ans.push_back(p.second);
-    }
-    return ans;
-  }
-
- private:
-  using Map = std ::unordered_map<std::string, Hypothesis>;
+  using Map = std::unordered_map<uint64_t, Hypothesis>;
   Map hyps_dict_;
 };
 
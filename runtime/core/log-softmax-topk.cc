@@ -0,0 +1,487 @@
+// runtime/core/log-softmax-topk.cc
+
+#include "log-softmax-topk.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+#include <immintrin.h>
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(_MSC_VER)
+// Build every x86 kernel and pick one at run time
+#define SHERPA_DEPLOY_TARGET(isa) __attribute__((target(isa)))
+#define SHERPA_DEPLOY_RUNTIME_DISPATCH 1
+#define SHERPA_DEPLOY_HAVE_AVX2 1
+#define SHERPA_DEPLOY_HAVE_AVX512 1
+#else
+#define SHERPA_DEPLOY_TARGET(isa)
+#if defined(__AVX2__)
+#define SHERPA_DEPLOY_HAVE_AVX2 1
+#endif
+#if defined(__AVX512F__)
+#define SHERPA_DEPLOY_HAVE_AVX512 1
+#endif
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SHERPA_DEPLOY_HAVE_NEON 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace SherpaDeploy {
+
+namespace {
+
+constexpr float kNegInf = -std::numeric_limits<float>::infinity();
+
+// Constants of the polynomial approximation of exp() from Cephes. Inputs
+// are clamped to kExpLo so that 2^n stays a normal float; exp(x - max) is
+// below FLT_EPSILON long before that and does not change the sum.
+constexpr float kExpLo = -87.3f;
+constexpr float kLog2e = 1.44269504088896341f;
+constexpr float kExpC1 = 0.693359375f;
+constexpr float kExpC2 = -2.12194440e-4f;
+constexpr float kExpP0 = 1.9875691500e-4f;
+constexpr float kExpP1 = 1.3981999507e-3f;
+constexpr float kExpP2 = 8.3334519073e-3f;
+constexpr float kExpP3 = 4.1665795894e-2f;
+constexpr float kExpP4 = 1.6666665459e-1f;
+constexpr float kExpP5 = 5.0000001201e-1f;
+
+inline int32_t CountTrailingZeros(uint32_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long i;  // NOLINT
+  _BitScanForward(&i, x);
+  return static_cast<int32_t>(i);
+#else
+  return __builtin_ctz(x);
+#endif
+}
+
+// A min-heap on the score, stored in the output arrays of the caller.
+// The root is the worst entry kept so far, so most candidates are
+// rejected with a single comparison.
+class TopKHeap {
+ public:
+  TopKHeap(int32_t capacity, int32_t *index, float *score)
+      : capacity_(capacity), index_(index), score_(score) {}
+
+  // A candidate has to be larger than this to enter the heap
+  float Threshold() const { return size_ < capacity_ ? kNegInf : score_[0]; }
+
+  // The caller has checked that score > Threshold()
+  void Push(int32_t index, float score) {
+    if (size_ < capacity_) {
+      int32_t i = size_++;
+      while (i > 0) {
+        int32_t parent = (i - 1) / 2;
+        if (score_[parent] <= score) break;
+        score_[i] = score_[parent];
+        index_[i] = index_[parent];
+        i = parent;
+      }
+      score_[i] = score;
+      index_[i] = index;
+    } else {
+      score_[0] = score;
+      index_[0] = index;
+      SiftDown(size_);
+    }
+  }
+
+  // Sort the kept entries from best to worst and return their number
+  int32_t Finish() {
+    for (int32_t n = size_; n > 1; --n) {
+      std::swap(score_[0], score_[n - 1]);
+      std::swap(index_[0], index_[n - 1]);
+      SiftDown(n - 1);
+    }
+    return size_;
+  }
+
+ private:
+  void SiftDown(int32_t n) {
+    float score = score_[0];
+    int32_t index = index_[0];
+    int32_t i = 0;
+    while (true) {
+      int32_t child = 2 * i + 1;
+      if (child >= n) break;
+      if (child + 1 < n && score_[child + 1] < score_[child]) ++child;
+      if (score <= score_[child]) break;
+      score_[i] = score_[child];
+      index_[i] = index_[child];
+      i = child;
+    }
+    score_[i] = score;
+    index_[i] = index;
+  }
+
+  int32_t capacity_;
+  int32_t size_ = 0;
+  int32_t *index_;  // not owned
+  float *score_;    // not owned
+};
+
+// Offer entry i of a row to the heap. `offset` is subtracted from the
+// logit to get its score and `base` is the flattened index of the row.
+inline void Offer(const float *x, int32_t i, float offset, int32_t base,
+                  TopKHeap *heap) {
+  float score = x[i] - offset;
+  if (score > heap->Threshold()) {
+    heap->Push(base + i, score);
+  }
+}
+
+// Every implementation provides the max of a row, the sum of
+// exp(x - max) over a row and the selection of a row into the heap.
+struct Kernels {
+  float (*row_max)(const float *x, int32_t n);
+  float (*sum_exp)(const float *x, int32_t n, float max);
+  void (*select_row)(const float *x, int32_t n, float offset, int32_t base,
+                     TopKHeap *heap);
+};
+
+float RowMaxScalar(const float *x, int32_t n) {
+  return *std::max_element(x, x + n);
+}
+
+float SumExpScalar(const float *x, int32_t n, float max) {
+  float sum = 0;
+  for (int32_t i = 0; i != n; ++i) {
+    sum += std::exp(x[i] - max);
+  }
+  return sum;
+}
+
+void SelectRowScalar(const float *x, int32_t n, float offset, int32_t base,
+                     TopKHeap *heap) {
+  for (int32_t i = 0; i != n; ++i) {
+    Offer(x, i, offset, base, heap);
+  }
+}
+
+#if SHERPA_DEPLOY_HAVE_AVX2
+SHERPA_DEPLOY_TARGET("avx2,fma")
+inline __m256 Exp256(__m256 x) {
+  x = _mm256_max_ps(x, _mm256_set1_ps(kExpLo));
+  __m256 fx = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(kLog2e)),
+                              _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(kExpC1), x);
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(kExpC2), x);
+
+  __m256 y = _mm256_set1_ps(kExpP0);
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP1));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP2));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP3));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP4));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP5));
+  y = _mm256_fmadd_ps(y, _mm256_mul_ps(x, x),
+                      _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+
+  __m256i e = _mm256_cvtps_epi32(fx);
+  e = _mm256_slli_epi32(_mm256_add_epi32(e, _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(y, _mm256_castsi256_ps(e));
+}
+
+SHERPA_DEPLOY_TARGET("avx2,fma")
+float RowMaxAvx2(const float *x, int32_t n) {
+  __m256 acc = _mm256_set1_ps(kNegInf);
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc = _mm256_max_ps(acc, _mm256_loadu_ps(x + i));
+  }
+  __m128 m = _mm_max_ps(_mm256_castps256_ps128(acc),
+                        _mm256_extractf128_ps(acc, 1));
+  m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+  m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+  float max = _mm_cvtss_f32(m);
+  for (; i != n; ++i) {
+    max = std::max(max, x[i]);
+  }
+  return max;
+}
+
+SHERPA_DEPLOY_TARGET("avx2,fma")
+float SumExpAvx2(const float *x, int32_t n, float max) {
+  __m256 acc = _mm256_setzero_ps();
+  __m256 m = _mm256_set1_ps(max);
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc = _mm256_add_ps(acc, Exp256(_mm256_sub_ps(_mm256_loadu_ps(x + i), m)));
+  }
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc),
+                        _mm256_extractf128_ps(acc, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  float sum = _mm_cvtss_f32(s);
+  for (; i != n; ++i) {
+    sum += std::exp(x[i] - max);
+  }
+  return sum;
+}
+
+SHERPA_DEPLOY_TARGET("avx2,fma")
+void SelectRowAvx2(const float *x, int32_t n, float offset, int32_t base,
+                   TopKHeap *heap) {
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    // Skip the block unless one of its logits beats the current threshold
+    __m256 t = _mm256_set1_ps(heap->Threshold() + offset);
+    uint32_t mask = _mm256_movemask_ps(
+        _mm256_cmp_ps(_mm256_loadu_ps(x + i), t, _CMP_GT_OQ));
+    while (mask) {
+      Offer(x, i + CountTrailingZeros(mask), offset, base, heap);
+      mask &= mask - 1;
+    }
+  }
+  for (; i != n; ++i) {
+    Offer(x, i, offset, base, heap);
+  }
+}
+#endif
+
+#if SHERPA_DEPLOY_HAVE_AVX512
+SHERPA_DEPLOY_TARGET("avx512f")
+inline __m512 Exp512(__m512 x) {
+  x = _mm512_max_ps(x, _mm512_set1_ps(kExpLo));
+  __m512 fx = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(kLog2e)),
+                                   _MM_FROUND_TO_NEAREST_INT |
+                                       _MM_FROUND_NO_EXC);
+  x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(kExpC1), x);
+  x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(kExpC2), x);
+
+  __m512 y = _mm512_set1_ps(kExpP0);
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(kExpP1));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(kExpP2));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(kExpP3));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(kExpP4));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(kExpP5));
+  y = _mm512_fmadd_ps(y, _mm512_mul_ps(x, x),
+                      _mm512_add_ps(x, _mm512_set1_ps(1.0f)));
+
+  __m512i e = _mm512_cvtps_epi32(fx);
+  e = _mm512_slli_epi32(_mm512_add_epi32(e, _mm512_set1_epi32(127)), 23);
+  return _mm512_mul_ps(y, _mm512_castsi512_ps(e));
+}
+
+SHERPA_DEPLOY_TARGET("avx512f")
+float RowMaxAvx512(const float *x, int32_t n) {
+  __m512 acc = _mm512_set1_ps(kNegInf);
+  int32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    acc = _mm512_max_ps(acc, _mm512_loadu_ps(x + i));
+  }
+  if (i != n) {
+    __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+    acc = _mm512_max_ps(acc, _mm512_mask_loadu_ps(acc, tail, x + i));
+  }
+  return _mm512_reduce_max_ps(acc);
+}
+
+SHERPA_DEPLOY_TARGET("avx512f")
+float SumExpAvx512(const float *x, int32_t n, float max) {
+  __m512 acc = _mm512_setzero_ps();
+  __m512 m = _mm512_set1_ps(max);
+  int32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    acc = _mm512_add_ps(acc, Exp512(_mm512_sub_ps(_mm512_loadu_ps(x + i), m)));
+  }
+  if (i != n) {
+    __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+    __m512 v = _mm512_mask_loadu_ps(m, tail, x + i);
+    acc = _mm512_mask_add_ps(acc, tail, acc, Exp512(_mm512_sub_ps(v, m)));
+  }
+  return _mm512_reduce_add_ps(acc);
+}
+
+SHERPA_DEPLOY_TARGET("avx512f")
+void SelectRowAvx512(const float *x, int32_t n, float offset, int32_t base,
+                     TopKHeap *heap) {
+  for (int32_t i = 0; i < n; i += 16) {
+    __mmask16 valid = n - i >= 16
+                          ? static_cast<__mmask16>(0xffff)
+                          : static_cast<__mmask16>((1u << (n - i)) - 1);
+    __m512 v = _mm512_maskz_loadu_ps(valid, x + i);
+    __m512 t = _mm512_set1_ps(heap->Threshold() + offset);
+    uint32_t mask = _mm512_mask_cmp_ps_mask(valid, v, t, _CMP_GT_OQ);
+    while (mask) {
+      Offer(x, i + CountTrailingZeros(mask), offset, base, heap);
+      mask &= mask - 1;
+    }
+  }
+}
+#endif
+
+#if SHERPA_DEPLOY_HAVE_NEON
+inline float32x4_t Exp128(float32x4_t x) {
+  x = vmaxq_f32(x, vdupq_n_f32(kExpLo));
+
+  // fx = floor(x * log2(e) + 0.5)
+  float32x4_t fx = vmlaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(kLog2e));
+  int32x4_t n = vcvtq_s32_f32(fx);
+  uint32x4_t too_large = vcgtq_f32(vcvtq_f32_s32(n), fx);
+  n = vaddq_s32(n, vreinterpretq_s32_u32(too_large));
+  fx = vcvtq_f32_s32(n);
+
+  x = vmlsq_f32(x, fx, vdupq_n_f32(kExpC1));
+  x = vmlsq_f32(x, fx, vdupq_n_f32(kExpC2));
+
+  float32x4_t y = vdupq_n_f32(kExpP0);
+  y = vmlaq_f32(vdupq_n_f32(kExpP1), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP2), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP3), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP4), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP5), y, x);
+  y = vmlaq_f32(vaddq_f32(x, vdupq_n_f32(1.0f)), y, vmulq_f32(x, x));
+
+  int32x4_t e = vshlq_n_s32(vaddq_s32(n, vdupq_n_s32(127)), 23);
+  return vmulq_f32(y, vreinterpretq_f32_s32(e));
+}
+
+inline float HorizontalMax(float32x4_t v) {
+#if defined(__aarch64__)
+  return vmaxvq_f32(v);
+#else
+  float32x2_t m = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+  return vget_lane_f32(vpmax_f32(m, m), 0);
+#endif
+}
+
+inline float HorizontalSum(float32x4_t v) {
+#if defined(__aarch64__)
+  return vaddvq_f32(v);
+#else
+  float32x2_t s = vpadd_f32(vget_low_f32(v), vget_high_f32(v));
+  return vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+}
+
+// Bit i of the result is set if lane i of `v` is set
+inline uint32_t MoveMask(uint32x4_t v) {
+  static const uint32_t kBits[4] = {1, 2, 4, 8};
+  uint32x4_t b = vandq_u32(v, vld1q_u32(kBits));
+#if defined(__aarch64__)
+  return vaddvq_u32(b);
+#else
+  uint32x2_t s = vpadd_u32(vget_low_u32(b), vget_high_u32(b));
+  return vget_lane_u32(vpadd_u32(s, s), 0);
+#endif
+}
+
+float RowMaxNeon(const float *x, int32_t n) {
+  float32x4_t acc = vdupq_n_f32(kNegInf);
+  int32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc = vmaxq_f32(acc, vld1q_f32(x + i));
+  }
+  float max = HorizontalMax(acc);
+  for (; i != n; ++i) {
+    max = std::max(max, x[i]);
+  }
+  return max;
+}
+
+float SumExpNeon(const float *x, int32_t n, float max) {
+  float32x4_t acc = vdupq_n_f32(0);
+  float32x4_t m = vdupq_n_f32(max);
+  int32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc = vaddq_f32(acc, Exp128(vsubq_f32(vld1q_f32(x + i), m)));
+  }
+  float sum = HorizontalSum(acc);
+  for (; i != n; ++i) {
+    sum += std::exp(x[i] - max);
+  }
+  return sum;
+}
+
+void SelectRowNeon(const float *x, int32_t n, float offset, int32_t base,
+                   TopKHeap *heap) {
+  int32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t t = vdupq_n_f32(heap->Threshold() + offset);
+    uint32_t mask = MoveMask(vcgtq_f32(vld1q_f32(x + i), t));
+    while (mask) {
+      Offer(x, i + CountTrailingZeros(mask), offset, base, heap);
+      mask &= mask - 1;
+    }
+  }
+  for (; i != n; ++i) {
+    Offer(x, i, offset, base, heap);
+  }
+}
+#endif
+
+Kernels SelectKernels() {
+#if SHERPA_DEPLOY_HAVE_AVX512
+#if SHERPA_DEPLOY_RUNTIME_DISPATCH
+  if (__builtin_cpu_supports("avx512f"))
+#endif
+    return {RowMaxAvx512, SumExpAvx512, SelectRowAvx512};
+#endif
+
+#if SHERPA_DEPLOY_HAVE_AVX2
+#if SHERPA_DEPLOY_RUNTIME_DISPATCH
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+#endif
+    return {RowMaxAvx2, SumExpAvx2, SelectRowAvx2};
+#endif
+
+#if SHERPA_DEPLOY_HAVE_NEON
+  return {RowMaxNeon, SumExpNeon, SelectRowNeon};
+#endif
+
+  return {RowMaxScalar, SumExpScalar, SelectRowScalar};
+}
+
+const Kernels &GetKernels() {
+  static const Kernels kernels = SelectKernels();
+  return kernels;
+}
+
+}  // namespace
+
+int32_t LogSoftmaxTopK(const float *logits, int32_t num_rows,
+                       int32_t vocab_size, const float *row_scores, int32_t k,
+                       int32_t *topk_index, float *topk_score) {
+  assert(logits);
+  assert(topk_index);
+  assert(topk_score);
+
+  k = std::min(k, num_rows * vocab_size);
+  if (k <= 0) {
+    return 0;
+  }
+
+  const Kernels &kernels = GetKernels();
+  TopKHeap heap(k, topk_index, topk_score);
+
+  for (int32_t r = 0; r != num_rows; ++r) {
+    const float *x = logits + r * vocab_size;
+    float row_score = row_scores ? row_scores[r] : 0;
+
+    float max = kernels.row_max(x, vocab_size);
+    float log_sum = std::log(kernels.sum_exp(x, vocab_size, max));
+
+    // score = x - (max + log_sum) + row_score. The best entry of this row
+    // scores row_score - log_sum; skip the row if it cannot enter the heap.
+    if (row_score - log_sum <= heap.Threshold()) {
+      continue;
+    }
+
+    float offset = max + log_sum - row_score;
+    kernels.select_row(x, vocab_size, offset, r * vocab_size, &heap);
+  }
+
+  return heap.Finish();
+}
+
+}  // namespace SherpaDeploy
@@ -0,0 +1,40 @@
+// runtime/core/log-softmax-topk.h
+
+#ifndef SHERPA_DEPLOY_CORE_LOG_SOFTMAX_TOPK_H_
+#define SHERPA_DEPLOY_CORE_LOG_SOFTMAX_TOPK_H_
+
+#include <cstdint>
+
+namespace SherpaDeploy {
+
+/* Select the k best entries of log_softmax(logits) plus per-row scores.
+ *
+ * It gives the same result as calling LogSoftmax() on every row, adding
+ * row_scores[r] to row r and calling TopkIndex() on the whole matrix, but
+ * it does not modify `logits` and does not allocate memory. The kernel is
+ * vectorized with AVX-512, AVX2 or NEON when the CPU supports it.
+ *
+ * @param logits A row-major matrix of shape (num_rows, vocab_size).
+ * @param num_rows Number of rows in `logits`.
+ * @param vocab_size Number of columns in `logits`.
+ * @param row_scores Score added to each row, e.g., the log_prob of the
+ *                   hypothesis that produced the row. If it is nullptr,
+ *                   nothing is added.
+ * @param k Number of entries to select.
+ * @param topk_index On return, it contains the flattened index
+ *                   r * vocab_size + c of the selected entries, best first.
+ *                   It must have room for k entries.
+ * @param topk_score On return, it contains the scores of the selected
+ *                   entries. It must have room for k entries.
+ *
+ * @return Return the number of selected entries, i.e.,
+ *         min(k, num_rows * vocab_size) unless some scores are -inf,
+ *         which are never selected.
+ */
+int32_t LogSoftmaxTopK(const float *logits, int32_t num_rows,
+                       int32_t vocab_size, const float *row_scores, int32_t k,
+                       int32_t *topk_index, float *topk_score);
+
+}  // namespace SherpaDeploy
+
+#endif  // SHERPA_DEPLOY_CORE_LOG_SOFTMAX_TOPK_H_
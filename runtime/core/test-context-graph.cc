@@ -5,6 +5,11 @@
 #include <cassert>
 #include <chrono>  // NOLINT
 #include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <map>
 #include <random>
 #include <string>
@@ -70,6 +75,118 @@ static void TestCustomizeNonStrict() {
   TestHelper(queries, 5, false);
 }
 
+static void TestSaveLoad() {
+  std::vector<std::string> contexts_str(
+      {"S", "HE", "SHE", "SHELL", "HIS", "HERS", "HELLO", "THIS", "THEM"});
+  std::vector<std::vector<int32_t>> contexts;
+  for (const auto &s : contexts_str) {
+    contexts.emplace_back(s.begin(), s.end());
+  }
+  SherpaDeploy::ContextGraph context_graph(contexts, 1, {}, contexts_str);
+
+  std::string filename = "test-context-graph.bin";
+  bool ok = context_graph.Save(filename);
+  assert(ok);
+  auto loaded = SherpaDeploy::ContextGraph::Load(filename);
+  assert(loaded != nullptr);
+  assert(loaded->NumStates() == context_graph.NumStates());
+
+  std::vector<std::string> queries = {"HEHERSHE", "DHRHISQ", "SHELF", "THEN"};
+  for (const auto &q : queries) {
+    auto s1 = context_graph.Root();
+    auto s2 = loaded->Root();
+    for (auto c : q) {
+      auto r1 = context_graph.ForwardOneStep(s1, c);
+      auto r2 = loaded->ForwardOneStep(s2, c);
+      assert(std::get<0>(r1) == std::get<0>(r2));
+      s1 = std::get<1>(r1);
+      s2 = std::get<1>(r2);
+      assert(s1 - context_graph.Root() == s2 - loaded->Root());
+      if (std::get<2>(r2) != nullptr) {
+        assert(context_graph.Phrase(std::get<2>(r1)) ==
+               loaded->Phrase(std::get<2>(r2)));
+      }
+    }
+  }
+  assert(loaded->Phrase(std::get<1>(loaded->ForwardOneStep(
+             std::get<1>(loaded->ForwardOneStep(loaded->Root(), 'H')), 'E'))) ==
+         "HE");
+
+  std::remove(filename.c_str());
+}
+
+// Return true if the graph saved in data still loads after the int32 at
+// the given byte offset is set to value
+static bool LoadPatched(const std::string &data, size_t offset,
+                        int32_t value) {
+  std::string patched = data;
+  std::memcpy(&patched[offset], &value, sizeof(value));
+
+  std::string filename = "test-context-graph-patched.bin";
+  {
+    std::ofstream os(filename, std::ios::binary);
+    os.write(patched.data(), patched.size());
+  }
+  bool ok = SherpaDeploy::ContextGraph::Load(filename) != nullptr;
+  std::remove(filename.c_str());
+  return ok;
+}
+
+static void TestLoadCorrupted() {
+  std::vector<std::string> contexts_str({"S", "HE", "SHE", "HERS"});
+  std::vector<std::vector<int32_t>> contexts;
+  for (const auto &s : contexts_str) {
+    contexts.emplace_back(s.begin(), s.end());
+  }
+  SherpaDeploy::ContextGraph context_graph(contexts, 1, {}, contexts_str);
+
+  std::string filename = "test-context-graph.bin";
+  bool ok = context_graph.Save(filename);
+  assert(ok);
+  std::ifstream is(filename, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(is)),
+                   std::istreambuf_iterator<char>());
+  is.close();
+  std::remove(filename.c_str());
+
+  // See Header and ContextState in context-graph.{h,cc}
+  const size_t header_size = 10 * sizeof(int32_t);
+  const size_t state_size = sizeof(SherpaDeploy::ContextState);
+  const size_t arc_size = sizeof(SherpaDeploy::ContextArc);
+  int32_t num_nodes = context_graph.NumStates();
+  int32_t num_arcs = 0;
+  int32_t num_root_next = 0;
+  std::memcpy(&num_arcs, &data[5 * sizeof(int32_t)], sizeof(int32_t));
+  std::memcpy(&num_root_next, &data[6 * sizeof(int32_t)], sizeof(int32_t));
+  assert(num_arcs > 0);
+
+  size_t node1 = header_size + state_size;
+  size_t arcs = header_size + num_nodes * state_size;
+  size_t root_next = arcs + num_arcs * arc_size;
+  size_t phrase_offsets = root_next + num_root_next * sizeof(int32_t);
+
+  assert(LoadPatched(data, node1 + offsetof(SherpaDeploy::ContextState, fail),
+                     0));
+
+  assert(!LoadPatched(
+      data, node1 + offsetof(SherpaDeploy::ContextState, arc_end),
+      num_arcs + 1));
+
+  for (int32_t bad : {-2, num_nodes, 1 << 30}) {
+    using SherpaDeploy::ContextState;
+    assert(!LoadPatched(data, node1 + offsetof(ContextState, fail), bad));
+    assert(!LoadPatched(data, node1 + offsetof(ContextState, output), bad));
+    assert(!LoadPatched(data, node1 + offsetof(ContextState, phrase), bad));
+    assert(!LoadPatched(data, node1 + offsetof(ContextState, arc_begin),
+                        bad));
+    assert(!LoadPatched(
+        data, arcs + offsetof(SherpaDeploy::ContextArc, next), bad));
+    assert(!LoadPatched(data, root_next + 'H' * sizeof(int32_t), bad));
+    assert(!LoadPatched(data, phrase_offsets + sizeof(int32_t),
+                        bad - num_nodes - 1));
+  }
+}
+
 static void Benchmark() {
   std::random_device rd;
   std::mt19937 mt(rd());
@@ -100,6 +217,8 @@ int32_t main() {
   TestBasicNonStrict();
   TestCustomize();
   TestCustomizeNonStrict();
+  TestSaveLoad();
+  TestLoadCorrupted();
   Benchmark();
   return 0;
 }
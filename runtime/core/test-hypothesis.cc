@@ -0,0 +1,94 @@
+// runtime/core/test-hypothesis.cc
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "hypothesis.h"
+
+static void TestAppend() {
+  SherpaDeploy::Hypothesis hyp({0, 0}, 0);
+  hyp.Append(5, 3);
+  hyp.Append(7, 9);
+
+  assert(hyp.NumTokens() == 4);
+  assert((hyp.Ys() == std::vector<int32_t>{0, 0, 5, 7}));
+  assert((hyp.Timestamps() == std::vector<int32_t>{3, 9}));
+
+  int32_t context[2];
+  hyp.LastTokens(2, context);
+  assert(context[0] == 5 && context[1] == 7);
+
+  // Extending a copy shares the prefix and leaves the original untouched
+  SherpaDeploy::Hypothesis other = hyp;
+  other.Append(8, 10);
+  assert(other.last->parent == hyp.last);
+  assert((hyp.Ys() == std::vector<int32_t>{0, 0, 5, 7}));
+  assert(other.Key() != hyp.Key());
+}
+
+static void TestKey() {
+  // Same tokens reached through different paths
+  SherpaDeploy::Hypothesis a({0, 0}, 0);
+  a.Append(1, 0);
+  a.Append(2, 1);
+
+  SherpaDeploy::Hypothesis b({0, 0, 1}, 0);
+  b.Append(2, 5);
+  assert(a.Key() == b.Key());
+
+  SherpaDeploy::Hypotheses hyps;
+  hyps.Add(a);
+  hyps.Add(b);
+  assert(hyps.Size() == 1);
+
+  SherpaDeploy::Hypothesis c({0, 0, 2, 1}, 0);
+  hyps.Add(c);
+  assert(hyps.Size() == 2);
+}
+
+static void TestTopK() {
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> dist(-50, 0);
+
+  SherpaDeploy::Hypotheses hyps;
+  std::vector<double> scores;
+  for (int32_t i = 0; i != 100; ++i) {
+    SherpaDeploy::Hypothesis hyp({0, 0}, dist(gen));
+    for (int32_t k = 0; k != i % 7; ++k) {
+      hyp.Append(i * 10 + k + 1, k);
+    }
+    scores.push_back(hyp.log_prob / hyp.NumTokens());
+    hyps.Add(std::move(hyp));
+  }
+  std::sort(scores.begin(), scores.end(), std::greater<double>());
+
+  auto topk = hyps.GetTopK(4, true);
+  assert(topk.size() == 4);
+  for (int32_t i = 0; i != 4; ++i) {
+    assert(topk[i].log_prob / topk[i].NumTokens() == scores[i]);
+  }
+
+  auto best = hyps.GetMostProbable(true);
+  assert(best.Key() == topk[0].Key());
+}
+
+static void TestLongChain() {
+  // Must not overflow the stack when the last owner goes away
+  SherpaDeploy::Hypothesis hyp({0, 0}, 0);
+  for (int32_t i = 0; i != 1000000; ++i) {
+    hyp.Append(i % 500 + 1, i);
+  }
+  assert(hyp.NumTokens() == 1000002);
+}
+
+int32_t main() {
+  TestAppend();
+  TestKey();
+  TestTopK();
+  TestLongChain();
+  return 0;
+}
@@ -0,0 +1,173 @@
+// runtime/core/test-log-softmax-topk.cc
+//
+// Check that LogSoftmaxTopK() selects the same entries as LogSoftmax()
+// followed by TopkIndex(), and compare the time both need for the
+// shapes seen in modified beam search.
+
+#include <cassert>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "log-softmax-topk.h"
+#include "runtime/core/math.h"
+
+// The reference implementation used by the decoders before
+static std::vector<int32_t> Reference(std::vector<float> logits,
+                                      int32_t num_rows, int32_t vocab_size,
+                                      const std::vector<float> &row_scores,
+                                      int32_t k, std::vector<float> *scores) {
+  for (int32_t r = 0; r != num_rows; ++r) {
+    float *p = logits.data() + r * vocab_size;
+    SherpaDeploy::LogSoftmax(p, vocab_size);
+    for (int32_t i = 0; i != vocab_size; ++i) {
+      p[i] += row_scores[r];
+    }
+  }
+
+  std::vector<int32_t> topk =
+      SherpaDeploy::TopkIndex(logits.data(), num_rows * vocab_size, k);
+
+  scores->clear();
+  for (auto i : topk) {
+    scores->push_back(logits[i]);
+  }
+  return topk;
+}
+
+static void TestParity(std::mt19937 *gen) {
+  std::normal_distribution<float> normal(0, 4);
+
+  for (int32_t num_rows : {1, 2, 4, 8}) {
+    for (int32_t vocab_size : {1, 7, 16, 19, 500, 5001}) {
+      for (int32_t k : {1, 4, 8, 100}) {
+        std::vector<float> logits(num_rows * vocab_size);
+        for (auto &x : logits) x = normal(*gen);
+
+        std::vector<float> row_scores(num_rows);
+        for (auto &x : row_scores) x = normal(*gen);
+
+        std::vector<float> expected_scores;
+        std::vector<int32_t> expected =
+            Reference(logits, num_rows, vocab_size, row_scores,
+                      std::min(k, num_rows * vocab_size), &expected_scores);
+
+        std::vector<int32_t> index(k);
+        std::vector<float> scores(k);
+        int32_t n = SherpaDeploy::LogSoftmaxTopK(
+            logits.data(), num_rows, vocab_size, row_scores.data(), k,
+            index.data(), scores.data());
+
+        assert(n == static_cast<int32_t>(expected.size()));
+        for (int32_t i = 0; i != n; ++i) {
+          assert(std::abs(scores[i] - expected_scores[i]) < 1e-4);
+          // Entries whose scores differ by less than the rounding error
+          // may swap places
+          assert(index[i] == expected[i] ||
+                 (i > 0 && index[i] == expected[i - 1]) ||
+                 (i + 1 < n && index[i] == expected[i + 1]));
+          if (i > 0) {
+            assert(scores[i - 1] >= scores[i]);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Logits far from 0 and with -inf entries, e.g., from a masked vocabulary
+static void TestExtremeValues() {
+  std::vector<float> logits = {1000, 999, -INFINITY, 998, -1000, -1e30f};
+  std::vector<float> row_scores = {-3};
+
+  int32_t index[3];
+  float scores[3];
+  int32_t n = SherpaDeploy::LogSoftmaxTopK(logits.data(), 1, logits.size(),
+                                           row_scores.data(), 3, index,
+                                           scores);
+  assert(n == 3);
+  assert(index[0] == 0 && index[1] == 1 && index[2] == 3);
+
+  float log_sum = 1000 + std::log(1 + std::exp(-1.0f) + std::exp(-2.0f));
+  assert(std::abs(scores[0] - (1000 - log_sum - 3)) < 1e-4);
+  assert(std::abs(scores[2] - (998 - log_sum - 3)) < 1e-4);
+
+  // Without row scores
+  n = SherpaDeploy::LogSoftmaxTopK(logits.data(), 1, logits.size(), nullptr,
+                                   1, index, scores);
+  assert(n == 1 && index[0] == 0);
+}
+
+static void Benchmark(std::mt19937 *gen) {
+  std::normal_distribution<float> normal(0, 4);
+  const int32_t kNumIterations = 2000;
+
+  for (int32_t vocab_size : {500, 2000, 5000}) {
+    for (int32_t num_rows : {4, 8}) {
+      int32_t k = num_rows;
+      std::vector<float> logits(num_rows * vocab_size);
+      for (auto &x : logits) x = normal(*gen);
+      std::vector<float> row_scores(num_rows);
+      for (auto &x : row_scores) x = normal(*gen);
+
+      std::vector<float> work(logits.size());
+      float checksum = 0;
+
+      auto start = std::chrono::steady_clock::now();
+      for (int32_t it = 0; it != kNumIterations; ++it) {
+        work = logits;
+        for (int32_t r = 0; r != num_rows; ++r) {
+          float *p = work.data() + r * vocab_size;
+          SherpaDeploy::LogSoftmax(p, vocab_size);
+          for (int32_t i = 0; i != vocab_size; ++i) {
+            p[i] += row_scores[r];
+          }
+        }
+        auto topk = SherpaDeploy::TopkIndex(work.data(), num_rows * vocab_size,
+                                            k);
+        checksum += work[topk[0]];
+      }
+      auto end = std::chrono::steady_clock::now();
+      float reference_us =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+              .count() /
+          1000.0f / kNumIterations;
+
+      std::vector<int32_t> index(k);
+      std::vector<float> scores(k);
+
+      start = std::chrono::steady_clock::now();
+      for (int32_t it = 0; it != kNumIterations; ++it) {
+        SherpaDeploy::LogSoftmaxTopK(logits.data(), num_rows, vocab_size,
+                                     row_scores.data(), k, index.data(),
+                                     scores.data());
+        checksum -= scores[0];
+      }
+      end = std::chrono::steady_clock::now();
+      float fused_us =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+              .count() /
+          1000.0f / kNumIterations;
+
+      fprintf(stderr,
+              "num_paths=%d vocab_size=%d: LogSoftmax+TopkIndex %.2f us, "
+              "LogSoftmaxTopK %.2f us (%.1fx)\n",
+              num_rows, vocab_size, reference_us, fused_us,
+              reference_us / fused_us);
+
+      assert(std::abs(checksum) < 1e-2 * kNumIterations);
+    }
+  }
+}
+
+int32_t main() {
+  std::mt19937 gen(20231015);
+
+  TestParity(&gen);
+  TestExtremeValues();
+  Benchmark(&gen);
+
+  return 0;
+}
@@ -0,0 +1,57 @@
+// runtime/core/thread-pool.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "runtime/core/thread-pool.h"
+
+#include <utility>
+
+namespace SherpaDeploy {
+
+ThreadPool::ThreadPool(int32_t num_threads) {
+  threads_.reserve(num_threads);
+  for (int32_t i = 0; i != num_threads; ++i) {
+    threads_.emplace_back([this]() { Run(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+
+  for (auto &t : threads_) {
+    t.join();
+  }
+}
+
+void ThreadPool::Push(std::packaged_task<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push(std::move(task));
+  }
+  cond_.notify_one();
+}
+
+void ThreadPool::Run() {
+  while (true) {
+    std::packaged_task<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+
+    // Exceptions are stored in the future of the task
+    task();
+  }
+}
+
+}  // namespace SherpaDeploy
@@ -0,0 +1,62 @@
+// runtime/core/thread-pool.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+#ifndef SHERPA_DEPLOY_CORE_THREAD_POOL_H_
+#define SHERPA_DEPLOY_CORE_THREAD_POOL_H_
+
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <future>  // NOLINT
+#include <mutex>   // NOLINT
+#include <queue>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+namespace SherpaDeploy {
+
+// A fixed number of worker threads that run submitted tasks in order.
+// The threads are created once, so submitting a task does not create a
+// thread.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int32_t num_threads);
+
+  // Run the tasks that are still queued and join the threads
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /* Queue a task to run on one of the worker threads.
+   *
+   * @param f A callable taking no arguments. It may be move-only.
+   *
+   * @return A future that becomes ready when f returns. If f throws, the
+   *         exception is rethrown by its get().
+   */
+  template <typename F>
+  std::future<void> Submit(F &&f) {
+    std::packaged_task<void()> task(std::forward<F>(f));
+    std::future<void> ans = task.get_future();
+    Push(std::move(task));
+    return ans;
+  }
+
+  int32_t Size() const { return threads_.size(); }
+
+ private:
+  void Push(std::packaged_task<void()> task);
+
+  void Run();
+
+  std::vector<std::thread> threads_;
+  std::queue<std::packaged_task<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stop_ = false;
+};
+
+}  // namespace SherpaDeploy
+
+#endif  // SHERPA_DEPLOY_CORE_THREAD_POOL_H_
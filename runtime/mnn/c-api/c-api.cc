@@ -23,6 +23,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "runtime/core/display.h"
 #include "runtime/mnn/model.h"
@@ -49,6 +50,10 @@ SherpaDeployMnnRecognizer *CreateRecognizer(
   config.model_config.encoder_mnn = in_config->model_config.encoder_mnn;
   config.model_config.decoder_mnn = in_config->model_config.decoder_mnn;
   config.model_config.joiner_mnn = in_config->model_config.joiner_mnn;
+  config.model_config.joiner_encoder_proj_mnn =
+      SHERPA_DEPLOY_OR(in_config->model_config.joiner_encoder_proj_mnn, "");
+  config.model_config.joiner_decoder_proj_mnn =
+      SHERPA_DEPLOY_OR(in_config->model_config.joiner_decoder_proj_mnn, "");
 
   config.model_config.tokens = in_config->model_config.tokens;
 
@@ -66,6 +71,9 @@ SherpaDeployMnnRecognizer *CreateRecognizer(
   backendConfig.memory = (MNN::BackendConfig::MemoryMode) in_config->model_config.backend_memory_mode;
   config.model_config.schedule_config.backendConfig = &backendConfig;
 
+  config.model_config.session_cache_dir =
+      SHERPA_DEPLOY_OR(in_config->model_config.session_cache_dir, "");
+
   // decoder_config
   config.decoder_config.method = SHERPA_DEPLOY_OR(in_config->decoder_config.decoding_method, "greedy_search");
   config.decoder_config.num_active_paths = SHERPA_DEPLOY_OR(in_config->decoder_config.num_active_paths, 4);
@@ -106,6 +114,10 @@ SherpaDeployMnnRecognizer *CreateRecognizer(
 
 void DestroyRecognizer(SherpaDeployMnnRecognizer *p) { delete p; }
 
+int32_t SaveHotwords(SherpaDeployMnnRecognizer *p, const char *filename) {
+  return p->recognizer->SaveHotwords(filename);
+}
+
 SherpaDeployMnnStream *CreateStream(SherpaDeployMnnRecognizer *p) {
   auto ans = new SherpaDeployMnnStream;
   ans->stream = p->recognizer->CreateStream();
@@ -127,6 +139,15 @@ void Decode(SherpaDeployMnnRecognizer *p, SherpaDeployMnnStream *s) {
   p->recognizer->DecodeStream(s->stream.get());
 }
 
+void DecodeMultipleStreams(SherpaDeployMnnRecognizer *p,
+                           SherpaDeployMnnStream **ss, int32_t n) {
+  std::vector<SherpaDeploy::Stream *> streams(n);
+  for (int32_t i = 0; i != n; ++i) {
+    streams[i] = ss[i]->stream.get();
+  }
+  p->recognizer->DecodeStreams(streams.data(), n);
+}
+
 SherpaDeployMnnResult *GetResult(SherpaDeployMnnRecognizer *p, SherpaDeployMnnStream *s) {
   std::string text = p->recognizer->GetResult(s->stream.get()).text;
   auto res = p->recognizer->GetResult(s->stream.get());
@@ -76,6 +76,16 @@ SHERPA_DEPLOY_API typedef struct SherpaDeployMnnModelConfig {
 
   int32_t backend_memory_mode;
 
+  /// Optional. Directory in which tuned sessions and model info are cached
+  /// to speed up later starts. It must exist. Empty or NULL disables it.
+  const char *session_cache_dir;
+
+  /// Optional. If the joiner is exported as two projections and an output
+  /// layer, paths to the encoder and decoder projections. joiner_mnn is
+  /// then the output layer. Both must be set to use them.
+  const char *joiner_encoder_proj_mnn;
+  const char *joiner_decoder_proj_mnn;
+
 } SherpaDeployMnnModelConfig;
 
 SHERPA_DEPLOY_API typedef struct SherpaDeployMnnDecoderConfig {
@@ -164,6 +174,16 @@ SHERPA_DEPLOY_API SherpaDeployMnnRecognizer *CreateRecognizer(
 /// @param p A pointer returned by CreateRecognizer()
 SHERPA_DEPLOY_API void DestroyRecognizer(SherpaDeployMnnRecognizer *p);
 
+/// Write the hotwords of the recognizer, compiled into a context graph, to
+/// a file. Passing that file as hotwords_file to a later recognizer maps
+/// the graph instead of encoding and compiling the hotwords again.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param filename Path of the file to write.
+/// @return Return 1 on success. Return 0 if there are no hotwords or the
+///         file cannot be written.
+SHERPA_DEPLOY_API int32_t SaveHotwords(SherpaDeployMnnRecognizer *p, const char *filename);
+
 /// Create a stream for accepting audio samples
 ///
 /// @param p A pointer returned by CreateRecognizer
@@ -205,6 +225,17 @@ SHERPA_DEPLOY_API int32_t IsReady(SherpaDeployMnnRecognizer *p, SherpaDeployMnnS
 /// @param s A pointer returned by CreateStream()
 SHERPA_DEPLOY_API void Decode(SherpaDeployMnnRecognizer *p, SherpaDeployMnnStream *s);
 
+/// Decode multiple streams in parallel
+///
+/// Pre-condition for this function:
+///   You must ensure that IsReady(p, ss[i]) return 1 for all i.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param ss A pointer array containing pointers returned by CreateStream()
+/// @param n Number of elements in the given pointer array.
+SHERPA_DEPLOY_API void DecodeMultipleStreams(SherpaDeployMnnRecognizer *p,
+                                           SherpaDeployMnnStream **ss, int32_t n);
+
 /// Get the decoding results so far.
 ///
 /// @param p A pointer returned by CreateRecognizer().
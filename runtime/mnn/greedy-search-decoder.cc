@@ -59,43 +59,59 @@ void GreedySearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
 }
 
 void GreedySearchDecoder::Decode(TensorPtr encoder_out, DecoderResult *result) {
+  // Project all frames of this chunk at once. result->decoder_out is kept
+  // projected so that it is computed only once per new token.
+  encoder_out = model_->ProjectEncoderOut(encoder_out);
 
   auto encoder_out_shape = encoder_out->shape();
-  int32_t batch_size = encoder_out_shape[0];
   int32_t num_frames = encoder_out_shape[1];
 
-  // TODO(fangjun): Cache the result of decoder_out
   TensorPtr decoder_out = result->decoder_out;
   if (nullptr == decoder_out) {
     TensorPtr decoder_input = BuildDecoderInput(*result);
-    decoder_out = model_->RunDecoder(decoder_input);
+    decoder_out = model_->ProjectDecoderOut(model_->RunDecoder(decoder_input));
   }
 
   int32_t frame_offset = result->frame_offset;
-  for (int32_t t = 0; t != num_frames; ++t) {
-    TensorPtr encoder_out_t = GetEncoderOutFrame(encoder_out, t);
-    TensorPtr joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+  int32_t t = 0;
+  while (t != num_frames) {
+    // decoder_out changes only after a non-blank token, so the joiner
+    // outputs of the remaining frames are valid up to and including the
+    // first non-blank one. Rows after it are thrown away.
+    int32_t n = speculative_joiner_ ? num_frames - t : 1;
+
+    TensorPtr encoder_out_t = GetEncoderOutFrames(encoder_out, t, n);
+    TensorPtr joiner_out =
+        model_->RunJoiner(encoder_out_t, Repeat(decoder_out, n));
     auto joiner_out_shape = joiner_out->shape();
     int32_t vocab_size = joiner_out_shape[1];
 
     const float* joiner_out_ptr = joiner_out->host<float>();
 
-    auto new_token = static_cast<int32_t>(std::distance(
-        joiner_out_ptr,
-        std::max_element(joiner_out_ptr, joiner_out_ptr + vocab_size)));
+    int32_t k = 0;
+    while (k != n) {
+      auto new_token = static_cast<int32_t>(std::distance(
+          joiner_out_ptr,
+          std::max_element(joiner_out_ptr, joiner_out_ptr + vocab_size)));
+      joiner_out_ptr += vocab_size;
+      ++k;
+
+      // the blank ID is fixed to 0
+      if (new_token != 0 && new_token != 2) {
+        result->tokens.push_back(new_token);
+        TensorPtr decoder_input = BuildDecoderInput(*result);
+        decoder_out =
+            model_->ProjectDecoderOut(model_->RunDecoder(decoder_input));
+
+        result->num_trailing_blanks = 0;
+        result->timestamps.push_back(t + k - 1 + frame_offset);
+        break;
+      }
 
-    // the blank ID is fixed to 0
-    if (new_token != 0 && new_token != 2) {
-      result->tokens.push_back(new_token);
-      TensorPtr decoder_input = BuildDecoderInput(*result);
-      decoder_out = model_->RunDecoder(decoder_input);
-
-      result->num_trailing_blanks = 0;
-      result->timestamps.push_back(t + frame_offset);
-    } else {
       ++result->num_trailing_blanks;
     }
 
+    t += k;
   }
 
   result->frame_offset += num_frames;
@@ -32,7 +32,8 @@ namespace SherpaDeploy {
 
 class GreedySearchDecoder : public Decoder {
  public:
-  explicit GreedySearchDecoder(Model *model) : model_(model) {}
+  explicit GreedySearchDecoder(Model *model, bool speculative_joiner = false)
+      : model_(model), speculative_joiner_(speculative_joiner) {}
 
   DecoderResult GetEmptyResult() const override;
 
@@ -45,6 +46,7 @@ class GreedySearchDecoder : public Decoder {
 
  private:
   Model *model_;  // not owned
+  bool speculative_joiner_;
 };
 
 }  // namespace SherpaDeploy
@@ -5,6 +5,7 @@
 #include "mnn-utils.h"
 
 #include <algorithm>
+#include <cassert>
 #include <fstream>
 #include <functional>
 #include <memory>
@@ -127,8 +128,7 @@ TensorPtr GetEncoderOutFrame(TensorPtr encoder_out, int32_t t) {
 
   auto batch_size = encoder_out_shape[0];
   auto num_frames = encoder_out_shape[1];
-  // TODO: add assert()
-  // assert(t < num_frames);
+  assert(t >= 0 && t < num_frames);
 
   auto encoder_out_dim = encoder_out_shape[2];
 
@@ -147,4 +147,107 @@ TensorPtr GetEncoderOutFrame(TensorPtr encoder_out, int32_t t) {
   return ans;
 }
 
+TensorPtr GetEncoderOutFrames(TensorPtr encoder_out, int32_t t, int32_t n) {
+  auto encoder_out_shape = encoder_out->shape();
+  assert(t >= 0 && n >= 0 && t + n <= encoder_out_shape[1]);
+
+  auto encoder_out_dim = encoder_out_shape[2];
+
+  TensorPtr ans = TensorPtr(MNN::Tensor::create<float>({n, encoder_out_dim}, NULL, MNN::Tensor::CAFFE));
+
+  const float* src = encoder_out->host<float>() + t * encoder_out_dim;
+  std::copy(src, src + n * encoder_out_dim, ans->host<float>());
+
+  return ans;
+}
+
+TensorPtr Repeat(TensorPtr tensor, int32_t n) {
+  if (n == 1) {
+    return tensor;
+  }
+
+  int32_t dim = tensor->shape()[1];
+
+  TensorPtr ans = TensorPtr(MNN::Tensor::create<float>({n, dim}, NULL, MNN::Tensor::CAFFE));
+
+  const float* src = tensor->host<float>();
+  float* p_dst = ans->host<float>();
+  for (int32_t i = 0; i != n; ++i) {
+    std::copy(src, src + dim, p_dst);
+    p_dst += dim;
+  }
+
+  return ans;
+}
+
+TensorPtr Cat(const std::vector<TensorPtr> &tensors, int32_t dim) {
+  if (tensors.size() == 1) {
+    return tensors[0];
+  }
+
+  std::vector<int> shape = tensors[0]->shape();
+  int32_t bytes = tensors[0]->getType().bytes();
+
+  int32_t leading_size = std::accumulate(shape.begin(), shape.begin() + dim, 1,
+                                         std::multiplies<int32_t>());
+  int32_t trailing_size = std::accumulate(shape.begin() + dim + 1, shape.end(),
+                                          1, std::multiplies<int32_t>());
+
+  int32_t total_dim = 0;
+  for (const auto &t : tensors) {
+    total_dim += t->shape()[dim];
+  }
+  shape[dim] = total_dim;
+
+  TensorPtr ans = TensorPtr(MNN::Tensor::create(
+      shape, tensors[0]->getType(), nullptr, MNN::Tensor::CAFFE));
+
+  uint8_t *p_dst = ans->host<uint8_t>();
+  for (int32_t i = 0; i != leading_size; ++i) {
+    for (const auto &t : tensors) {
+      int32_t n = t->shape()[dim] * trailing_size * bytes;
+      const uint8_t *p_src = t->host<uint8_t>() + i * n;
+      std::copy(p_src, p_src + n, p_dst);
+      p_dst += n;
+    }
+  }
+
+  return ans;
+}
+
+std::vector<TensorPtr> Unbind(TensorPtr tensor, int32_t dim) {
+  std::vector<int> shape = tensor->shape();
+  int32_t n = shape[dim];
+  if (n == 1) {
+    return {tensor};
+  }
+
+  int32_t bytes = tensor->getType().bytes();
+
+  int32_t leading_size = std::accumulate(shape.begin(), shape.begin() + dim, 1,
+                                         std::multiplies<int32_t>());
+  int32_t trailing_size = std::accumulate(shape.begin() + dim + 1, shape.end(),
+                                          1, std::multiplies<int32_t>());
+  int32_t m = trailing_size * bytes;
+
+  shape[dim] = 1;
+
+  std::vector<TensorPtr> ans(n);
+  for (auto &t : ans) {
+    t = TensorPtr(MNN::Tensor::create(shape, tensor->getType(), nullptr,
+                                      MNN::Tensor::CAFFE));
+  }
+
+  const uint8_t *p_src = tensor->host<uint8_t>();
+  for (int32_t i = 0; i != leading_size; ++i) {
+    for (int32_t k = 0; k != n; ++k) {
+      uint8_t *p_dst = ans[k]->host<uint8_t>() + i * m;
+      std::copy(p_src, p_src + m, p_dst);
+      p_src += m;
+    }
+  }
+
+  return ans;
+}
+
 }  // namespace SherpaDeploy
@@ -48,6 +48,47 @@ void GetOutputNames(const std::shared_ptr<MNN::Express::Module>& module, std::ve
  */
 TensorPtr GetEncoderOutFrame(TensorPtr encoder_out, int32_t t);
 
+/**
+ * Get frames [t, t + n) of the first utterance of the encoder output.
+ *
+ * @param encoder_out  A tensor of shape (N, T, encoder_dim)
+ *
+ * @return Return a tensor of shape (n, encoder_dim)
+ */
+TensorPtr GetEncoderOutFrames(TensorPtr encoder_out, int32_t t, int32_t n);
+
+/**
+ * Stack n copies of a (1, dim) host tensor.
+ *
+ * @return Return a tensor of shape (n, dim). If n is 1, the input tensor
+ *         is returned as is without copying.
+ */
+TensorPtr Repeat(TensorPtr tensor, int32_t n);
+
+/**
+ * Cat a list of host tensors along the given dim.
+ *
+ * @param tensors  The shape of the tensors must be the same except on
+ *                 the dim to be concatenated.
+ * @param dim  The dim along which to concatenate the input tensors
+ *
+ * @return Return the concatenated tensor. If there is only one input
+ *         tensor, it is returned as is without copying.
+ */
+TensorPtr Cat(const std::vector<TensorPtr> &tensors, int32_t dim);
+
+/**
+ * It is the inverse operation of Cat(). The returned tensors keep
+ * the given dim with size 1.
+ *
+ * @param tensor  The tensor to split.
+ * @param dim  The dim along which to split the input tensor
+ *
+ * @return Return a list of tensor.shape()[dim] tensors. If the size of
+ *         the given dim is 1, the input tensor is returned as is.
+ */
+std::vector<TensorPtr> Unbind(TensorPtr tensor, int32_t dim);
+
 
 template <typename T = float>
 void Fill(TensorPtr tensor, T value) {
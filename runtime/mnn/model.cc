@@ -19,7 +19,18 @@
 #include "model.h"
 #include "zipformer-model.h"
 
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
 #include <sstream>
+#include <tuple>
+#include <vector>
+
+#include "MNN/expr/Module.hpp"  // NOLINT
+#include "mnn-utils.h"
+#include "runtime/core/file-utils.h"
+#include "state-arena.h"
 
 namespace SherpaDeploy {
 
@@ -29,26 +40,197 @@ std::string ModelConfig::ToString() const {
   os << "encoder_mnn=\"" << encoder_mnn << "\", ";
   os << "decoder_mnn=\"" << decoder_mnn << "\", ";
   os << "joiner_mnn=\"" << joiner_mnn << "\", ";
+  if (!joiner_encoder_proj_mnn.empty()) {
+    os << "joiner_encoder_proj_mnn=\"" << joiner_encoder_proj_mnn << "\", ";
+    os << "joiner_decoder_proj_mnn=\"" << joiner_decoder_proj_mnn << "\", ";
+  }
   os << "tokens=\"" << tokens << "\", ";
   os << "modeling_unit=\"" << modeling_unit << "\", ";
   os << "bpe_vocab=\"" << bpe_vocab << "\", ";
-  os << "num_threads=" << schedule_config.numThread << ")";
+  os << "num_threads=" << schedule_config.numThread << ", ";
+  os << "session_cache_dir=\"" << session_cache_dir << "\")";
 
   return os.str();
 }
 
+namespace {
+
+// 64-bit FNV-1a, continued from h. Unlike std::hash, the value is the same
+// for every standard library, so cache files stay valid across builds.
+uint64_t Fnv1a(const char *p, size_t n, uint64_t h = 0xcbf29ce484222325ULL) {
+  for (size_t i = 0; i != n; ++i) {
+    h ^= static_cast<uint8_t>(p[i]);
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// The session cache depends on the model and on everything in the schedule
+// config that changes how the session is built, so both go into its name.
+std::string CacheFilename(const std::string &cache_dir, const char *model_path,
+                          const std::vector<char> &model,
+                          const MNN::ScheduleConfig &schedule_config) {
+  std::ostringstream config;
+  config << model.size() << "-" << schedule_config.type << "-"
+         << schedule_config.numThread;
+  if (schedule_config.backendConfig) {
+    config << "-" << schedule_config.backendConfig->precision << "-"
+           << schedule_config.backendConfig->power << "-"
+           << schedule_config.backendConfig->memory;
+  }
+  std::string config_str = config.str();
+
+  uint64_t h = Fnv1a(model.data(), model.size());
+  h = Fnv1a(config_str.data(), config_str.size(), h);
+
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(h));
+
+  std::string name = model_path;
+  auto pos = name.find_last_of("/\\");
+  if (pos != std::string::npos) {
+    name = name.substr(pos + 1);
+  }
+
+  return cache_dir + "/" + name + "-" + hex + ".cache";
+}
+
+// The model info is kept next to the session cache so that a warm start
+// does not need to load the model a second time through
+// MNN::Express::Module only to read it.
+//
+// Format, one item per line:
+//   number of inputs, then the input names
+//   number of outputs, then the output names
+//   number of metadata entries, then key<TAB>value
+bool ReadModelInfo(const std::string &filename, ModelInfo *info) {
+  std::ifstream is(filename);
+  if (!is) {
+    return false;
+  }
+
+  auto read_names = [&is](std::vector<std::string> *names) {
+    int32_t n = 0;
+    if (!(is >> n) || n < 0) return false;
+    is.ignore(1);
+    names->resize(n);
+    for (auto &name : *names) {
+      if (!std::getline(is, name)) return false;
+    }
+    return true;
+  };
+
+  if (!read_names(&info->input_names) || !read_names(&info->output_names)) {
+    return false;
+  }
+
+  std::vector<std::string> meta_data;
+  if (!read_names(&meta_data)) {
+    return false;
+  }
+
+  info->meta_data.clear();
+  for (const auto &line : meta_data) {
+    auto pos = line.find('\t');
+    if (pos == std::string::npos) {
+      return false;
+    }
+    info->meta_data[line.substr(0, pos)] = line.substr(pos + 1);
+  }
+
+  return true;
+}
+
+void WriteModelInfo(const std::string &filename, const ModelInfo &info) {
+  std::ofstream os(filename);
+
+  os << info.input_names.size() << "\n";
+  for (const auto &name : info.input_names) os << name << "\n";
+
+  os << info.output_names.size() << "\n";
+  for (const auto &name : info.output_names) os << name << "\n";
+
+  os << info.meta_data.size() << "\n";
+  for (const auto &p : info.meta_data) {
+    os << p.first << "\t" << p.second << "\n";
+  }
+
+  if (!os) {
+    fprintf(stderr, "Failed to write %s\n", filename.c_str());
+  }
+}
+
+void GetModelInfo(const std::vector<char> &model, const char *model_path,
+                  ModelInfo *info) {
+  std::vector<std::string> empty;
+  std::shared_ptr<MNN::Express::Module> module(MNN::Express::Module::load(
+      empty, empty, reinterpret_cast<const uint8_t *>(model.data()),
+      model.size()));
+  if (nullptr == module.get()) {
+    fprintf(stderr, "Load MNN from %s Failed\n", model_path);
+    exit(-1);
+  }
+
+  GetInputNames(module, info->input_names);
+  GetOutputNames(module, info->output_names);
+  info->meta_data = module->getInfo()->metaData;
+}
+
+}  // namespace
+
 void Model::InitNet(std::unique_ptr<MNN::Interpreter>& net, 
                       MNN::Session*& session, 
                       const char* model_path, 
-                      const MNN::ScheduleConfig& schedule_config) {
-  net = std::unique_ptr<MNN::Interpreter>(MNN::Interpreter::createFromFile(model_path));
+                      const MNN::ScheduleConfig& schedule_config,
+                      bool release_model /*= true*/,
+                      ModelInfo *info /*= nullptr*/,
+                      const std::string &cache_dir /*= ""*/) {
+  // Read the file once; both the info and the interpreter are built from
+  // this buffer.
+  std::vector<char> model = ReadFile(model_path);
+
+  std::string cache_file;
+  if (!cache_dir.empty()) {
+    cache_file = CacheFilename(cache_dir, model_path, model, schedule_config);
+  }
+
+  if (info && (cache_file.empty() ||
+               !ReadModelInfo(cache_file + ".info", info))) {
+    // The module is destroyed before the interpreter is created so that
+    // only one copy of the weights is alive at a time.
+    GetModelInfo(model, model_path, info);
+    if (!cache_file.empty()) {
+      WriteModelInfo(cache_file + ".info", *info);
+    }
+  }
+
+  net = std::unique_ptr<MNN::Interpreter>(
+      MNN::Interpreter::createFromBuffer(model.data(), model.size()));
+  if (!net) {
+    fprintf(stderr, "Failed to create an interpreter from %s\n", model_path);
+    exit(-1);
+  }
+
+  // The interpreter keeps its own copy
+  std::vector<char>().swap(model);
+
+  if (!cache_file.empty()) {
+    // MNN checks that the cache matches the model and rebuilds it if not
+    net->setCacheFile(cache_file.c_str());
+  }
 
   session = net->createSession(schedule_config);
 
-  // for using dynamic axes when export ONNX, must comment below line, because we need to resize tensor during inference
+  if (!cache_file.empty()) {
+    net->updateCacheFile(session);
+  }
+
+  // for using dynamic axes when export ONNX, must not release the model, because we need to resize tensor during inference
   // see below for details:
   // https://mnn-docs.readthedocs.io/en/latest/cpp/Interpreter.html#releasemodel
-  net->releaseModel();
+  if (release_model) {
+    net->releaseModel();
+  }
 }
 
 // #if __ANDROID_API__ >= 9
@@ -60,6 +242,20 @@ void Model::InitNet(std::unique_ptr<MNN::Interpreter>& net,
 // #endif
 
 
+TensorPtr Model::RunEncoder(TensorPtr features, StateArena *arena) {
+  if (arena->Empty()) {
+    arena->Assign(GetEncoderInitStates());
+  }
+
+  TensorPtr encoder_out;
+  std::vector<TensorPtr> next_states;
+  std::tie(encoder_out, next_states) = RunEncoder(features, arena->Current());
+
+  arena->Advance(next_states);
+
+  return encoder_out;
+}
+
 std::unique_ptr<Model> Model::Create(const ModelConfig &config) {
   return std::make_unique<ZipformerModel>(config);
 }
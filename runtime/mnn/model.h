@@ -22,6 +22,7 @@
 
 #include "MNN/Interpreter.hpp" // NOLINT
 
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
@@ -30,12 +31,21 @@
 
 namespace SherpaDeploy {
 
+class StateArena;
+
 using TensorPtr = std::shared_ptr<MNN::Tensor>;
 
 struct ModelConfig {
   std::string encoder_mnn;  // path to encoder.mnn
   std::string decoder_mnn;  // path to decoder.mnn
   std::string joiner_mnn;   // path to joiner.mnn
+
+  // Optional. If the joiner is exported as an encoder projection, a decoder
+  // projection and an output layer, set the paths of the two projections
+  // here and let joiner_mnn point to the output layer.
+  std::string joiner_encoder_proj_mnn;
+  std::string joiner_decoder_proj_mnn;
+
   std::string tokens;         // path to tokens.txt
 
   std::string modeling_unit = "bpe"; // default "bpe"
@@ -43,9 +53,21 @@ struct ModelConfig {
 
   MNN::ScheduleConfig schedule_config;
 
+  // If not empty, the tuned sessions and the model info are cached in this
+  // directory, which must exist, so that later starts skip the work.
+  // Cache files are named after the model and the schedule config.
+  std::string session_cache_dir;
+
   std::string ToString() const;
 };
 
+// Input/output names and metadata of a model, in the order of the model
+struct ModelInfo {
+  std::vector<std::string> input_names;
+  std::vector<std::string> output_names;
+  std::map<std::string, std::string> meta_data;
+};
+
 class Model {
  public:
   virtual ~Model() = default;
@@ -60,21 +82,53 @@ class Model {
 
   virtual std::vector<TensorPtr> GetEncoderInitStates() const = 0;
 
+  /** Stack a list of individual states into a batch.
+   *
+   * It is the inverse operation of `UnStackStates`.
+   *
+   * @param states states[i] contains the state for the i-th utterance.
+   * @return Return a single value representing the batched state.
+   */
+  virtual std::vector<TensorPtr> StackStates(
+      const std::vector<std::vector<TensorPtr>> &states) const = 0;
+
+  /** Unstack a batch state into a list of individual states.
+   *
+   * It is the inverse operation of `StackStates`.
+   *
+   * @param states A batched state.
+   * @return ans[i] contains the state for the i-th utterance.
+   */
+  virtual std::vector<std::vector<TensorPtr>> UnStackStates(
+      const std::vector<TensorPtr> &states) const = 0;
+
   /** Run the encoder network.
    *
-   * @param features  A 2-d Tensor of shape (num_frames, feature_dim).
-   *                  Note: features shape[0] = num_frames.
-   *                        features shape[1] = feature_dim.
+   * @param features  A 3-d Tensor of shape (N, num_frames, feature_dim).
+   *                  A 2-d Tensor of shape (num_frames, feature_dim) is
+   *                  also accepted and treated as N == 1.
    * @param states It contains the states for the encoder network. Its exact
-   *               content is determined by the underlying network.
+   *               content is determined by the underlying network. For N > 1,
+   *               it is the return value of `StackStates`.
    *
    * @return Return a pair containing:
-   *   - encoder_out
-   *   - next_states
-  //  */
+   *   - encoder_out, of shape (N, T, encoder_dim)
+   *   - next_states, which can be split with `UnStackStates`
+   */
   virtual std::pair<TensorPtr, std::vector<TensorPtr>> RunEncoder(
       TensorPtr features, const std::vector<TensorPtr>& states) = 0;
 
+  /** Run the encoder network for a single stream whose states live in
+   * `arena`. The next states are written into arena->Next(), which then
+   * becomes current, so no state tensor is allocated per chunk.
+   *
+   * @param features  A 3-d Tensor of shape (1, num_frames, feature_dim)
+   * @param arena  If it is empty, it is initialized with the initial states.
+   *
+   * @return Return encoder_out, of shape (1, T, encoder_dim)
+   */
+  virtual TensorPtr RunEncoder(TensorPtr features, StateArena *arena);
+
   /** Run the decoder network.
    *
    * @param  decoder_input A Tensor of shape (num_paths, context_size). Note: Its underlying
@@ -85,7 +139,37 @@ class Model {
    */
   virtual TensorPtr RunDecoder(TensorPtr decoder_input) = 0;
 
+  /** Run the encoder projection of the joiner.
+   *
+   * If the model has no separate joiner projections, encoder_out is
+   * returned unchanged.
+   *
+   * @param encoder_out  A Tensor of shape (N, T, encoder_dim)
+   *
+   * @return Return a Tensor of shape (N, T, joiner_dim)
+   */
+  virtual TensorPtr ProjectEncoderOut(TensorPtr encoder_out) {
+    return encoder_out;
+  }
+
+  /** Run the decoder projection of the joiner.
+   *
+   * If the model has no separate joiner projections, decoder_out is
+   * returned unchanged.
+   *
+   * @param decoder_out  A Tensor of shape (num_paths, decoder_dim)
+   *
+   * @return Return a Tensor of shape (num_paths, joiner_dim)
+   */
+  virtual TensorPtr ProjectDecoderOut(TensorPtr decoder_out) {
+    return decoder_out;
+  }
+
   /** Run the joiner network.
+   *
+   * The inputs are the outputs of ProjectEncoderOut() and
+   * ProjectDecoderOut(), so that the projections can be computed once
+   * and reused across joiner calls.
    *
    * @param encoder_out  A Tensor of shape (num_frames, encoder_dim)
    * @param decoder_out  A Tensor of shape (num_paths, decoder_dim)
@@ -106,10 +190,23 @@ class Model {
   // running the encoder network
   virtual int32_t Offset() const = 0;
 
+  /** Read a model file once and create its interpreter and first session.
+   *
+   * @param release_model If true, the model buffer is released after the
+   *                      session is created. Set it to false if more
+   *                      sessions or resizing are needed later.
+   * @param info  If not null, on return it contains the names and the
+   *              metadata of the model.
+   * @param cache_dir  If not empty, the session cache and the model info
+   *                   are read from, or written to, this directory.
+   */
   static void InitNet(std::unique_ptr<MNN::Interpreter>& net, 
                       MNN::Session*& session, 
                       const char* model_path,
-                      const MNN::ScheduleConfig& schedule_config);
+                      const MNN::ScheduleConfig& schedule_config,
+                      bool release_model = true,
+                      ModelInfo *info = nullptr,
+                      const std::string &cache_dir = "");
 
 // #if __ANDROID_API__ >= 9
 //   static void InitNet(AAssetManager *mgr, std::unique_ptr<MNN::Interpreter>& net, 
@@ -21,10 +21,11 @@
 #include "modified-beam-search-decoder.h"
 
 #include <algorithm>
+#include <string>
 #include <utility>
 #include <vector>
 
-#include "runtime/core/math.h"
+#include "runtime/core/log-softmax-topk.h"
 #include "MNN/Tensor.hpp"   // NOLINT
 
 namespace SherpaDeploy {
@@ -47,86 +48,97 @@ void ModifiedBeamSearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
   int32_t context_size = model_->ContextSize();
   auto hyp = r->hyps.GetMostProbable(true);
 
-  auto start = hyp.ys.begin() + context_size;
-  auto end = hyp.ys.end();
+  std::vector<int32_t> ys = hyp.Ys();
 
-  r->tokens = std::vector<int32_t>(start, end);
-  r->timestamps = std::move(hyp.timestamps);
+  r->tokens = std::vector<int32_t>(ys.begin() + context_size, ys.end());
+  r->timestamps = hyp.Timestamps();
   r->num_trailing_blanks = hyp.num_trailing_blanks;
 }
 
-// Compute log_softmax in-place.
-//
-// The log_softmax of each row is computed.
-//
-// @param in_out A 2-D tensor
-static void LogSoftmax(TensorPtr in_out) {
-  auto in_out_shape = in_out->shape();
-  int32_t h = in_out_shape[0];
-  int32_t w = in_out_shape[1];
-  float* p_src = in_out->host<float>();
-  for (int32_t y = 0; y != h; ++y) {
-    float* p = p_src + y * w;
-    SherpaDeploy::LogSoftmax(p, w);
-  }
-}
-
-// The decoder model contains an embedding layer, which only supports
-// 1-D output.
-// This is a wrapper to support 2-D decoder output.
-//
-// @param model_ The NN model.
-// @param decoder_input A 2-D tensor of shape (num_active_paths, context_size)
-// @return Return a 2-D tensor of shape (num_active_paths, decoder_dim)
-//
-// TODO(fangjun): Change Embed in ncnn to output 2-d tensors
-static TensorPtr RunDecoder2D(Model *model_, TensorPtr decoder_input) {
-  TensorPtr decoder_out;
-  auto decoder_input_shape = decoder_input->shape();
-  int32_t h = decoder_input_shape[0];
-  int32_t w = decoder_input_shape[1];
-  int32_t* p_src = decoder_input->host<int32_t>();
-
-  for (int32_t y = 0; y != h; ++y) {
-    TensorPtr decoder_input_t = TensorPtr(MNN::Tensor::create<int32_t>({1, w}, NULL, MNN::Tensor::CAFFE));
-    int32_t* p_dst = decoder_input_t->host<int32_t>();
-    std::copy(p_src, p_src + w, p_dst);
-    p_src += w;
-
-    TensorPtr tmp = model_->RunDecoder(decoder_input_t);
-    auto decoder_out_shape = tmp->shape();
-    int32_t decoder_out_dim = decoder_out_shape[1];
-
-    if (y == 0) {
-      decoder_out = TensorPtr(MNN::Tensor::create<float>({h, decoder_out_dim}, NULL, MNN::Tensor::CAFFE));
-    }
-
-    const float *ptr = tmp->host<float>();
-    float* out_ptr = decoder_out->host<float>() + y * decoder_out_dim;
-    std::copy(ptr, ptr + decoder_out_dim, out_ptr);
-
-  }
-
-  return decoder_out;
-}
+// The decoder output cache is cleared once it holds this number of entries
+static constexpr int32_t kMaxDecoderOutCacheSize = 4096;
 
 TensorPtr ModifiedBeamSearchDecoder::BuildDecoderInput(
-    const std::vector<SherpaDeploy::Hypothesis> &hyps) const {
+    const std::vector<const SherpaDeploy::Hypothesis *> &hyps) const {
   int32_t num_hyps = static_cast<int32_t>(hyps.size());
   int32_t context_size = model_->ContextSize();
 
   TensorPtr decoder_input = TensorPtr(MNN::Tensor::create<int32_t>({num_hyps, context_size}, NULL, MNN::Tensor::CAFFE));
   int32_t* p = decoder_input->host<int32_t>();
 
-  for (const auto &hyp : hyps) {
-    const auto &ys = hyp.ys;
-    std::copy(ys.end() - context_size, ys.end(), p);
+  for (const auto *hyp : hyps) {
+    hyp->LastTokens(context_size, p);
     p += context_size;
   }
 
   return decoder_input;
 }
 
+std::string ModifiedBeamSearchDecoder::DecoderOutCacheKey(
+    const SherpaDeploy::Hypothesis &hyp) const {
+  int32_t context_size = model_->ContextSize();
+  std::string key(context_size * sizeof(int32_t), '\0');
+  hyp.LastTokens(context_size, reinterpret_cast<int32_t *>(&key[0]));
+  return key;
+}
+
+TensorPtr ModifiedBeamSearchDecoder::RunDecoder(
+    const std::vector<SherpaDeploy::Hypothesis> &hyps) {
+  int32_t num_hyps = static_cast<int32_t>(hyps.size());
+
+  if (decoder_out_cache_.size() + num_hyps > kMaxDecoderOutCacheSize) {
+    decoder_out_cache_.clear();
+  }
+
+  std::vector<std::string> keys(num_hyps);
+  std::vector<int32_t> miss_index;
+  for (int32_t i = 0; i != num_hyps; ++i) {
+    keys[i] = DecoderOutCacheKey(hyps[i]);
+    if (decoder_out_cache_.count(keys[i])) {
+      continue;
+    }
+
+    bool pending = std::any_of(miss_index.begin(), miss_index.end(),
+                               [&](int32_t k) { return keys[k] == keys[i]; });
+    if (!pending) {
+      miss_index.push_back(i);
+    }
+  }
+
+  if (!miss_index.empty()) {
+    std::vector<const SherpaDeploy::Hypothesis *> miss_hyps;
+    miss_hyps.reserve(miss_index.size());
+    for (auto i : miss_index) {
+      miss_hyps.push_back(&hyps[i]);
+    }
+
+    // (num_misses, context_size) -> (num_misses, decoder_dim). The cache
+    // keeps the decoder projection of the joiner, if any, so it is also
+    // computed once per context.
+    TensorPtr decoder_out = model_->RunDecoder(BuildDecoderInput(miss_hyps));
+    decoder_out = model_->ProjectDecoderOut(decoder_out);
+    int32_t decoder_out_dim = decoder_out->shape()[1];
+
+    const float *p = decoder_out->host<float>();
+    for (auto i : miss_index) {
+      decoder_out_cache_[keys[i]] = std::vector<float>(p, p + decoder_out_dim);
+      p += decoder_out_dim;
+    }
+  }
+
+  int32_t decoder_out_dim = static_cast<int32_t>(decoder_out_cache_.at(keys[0]).size());
+  TensorPtr ans = TensorPtr(MNN::Tensor::create<float>({num_hyps, decoder_out_dim}, NULL, MNN::Tensor::CAFFE));
+
+  float *p_dst = ans->host<float>();
+  for (const auto &key : keys) {
+    const auto &v = decoder_out_cache_.at(key);
+    std::copy(v.begin(), v.end(), p_dst);
+    p_dst += decoder_out_dim;
+  }
+
+  return ans;
+}
+
 void ModifiedBeamSearchDecoder::Decode(TensorPtr encoder_out,
                                        DecoderResult *result) {
   Decode(encoder_out, nullptr, result);
@@ -134,6 +146,9 @@ void ModifiedBeamSearchDecoder::Decode(TensorPtr encoder_out,
 
 void ModifiedBeamSearchDecoder::Decode(TensorPtr encoder_out, Stream *s,
                                        DecoderResult *result) {
+  // Project all frames of this chunk at once
+  encoder_out = model_->ProjectEncoderOut(encoder_out);
+
   auto encoder_out_shape = encoder_out->shape();
   int32_t batch_size = encoder_out_shape[0];
   int32_t num_frames = encoder_out_shape[1];
@@ -144,14 +159,18 @@ void ModifiedBeamSearchDecoder::Decode(TensorPtr encoder_out, Stream *s,
 
   const float* p_src = encoder_out->host<float>();
 
+  // Reused across frames so that selecting the best paths does not allocate
+  std::vector<float> prev_log_probs;
+  std::vector<int32_t> topk_index(num_active_paths_);
+  std::vector<float> topk_score(num_active_paths_);
+
   /* encoder_out.w == encoder_out_dim, encoder_out.h == num_frames. */
   for (int32_t t = 0; t != num_frames; ++t) {
     std::vector<SherpaDeploy::Hypothesis> prev = cur.GetTopK(num_active_paths_, true);
     cur.Clear();
 
-    TensorPtr decoder_input = BuildDecoderInput(prev);
     TensorPtr decoder_out;
-    if (t == 0 && prev.size() == 1 && prev[0].ys.size() == context_size &&
+    if (t == 0 && prev.size() == 1 && prev[0].NumTokens() == context_size &&
         result->decoder_out != nullptr) {
       // When an endpoint is detected, we keep the decoder_out
       decoder_out = result->decoder_out;
@@ -159,7 +178,7 @@ void ModifiedBeamSearchDecoder::Decode(TensorPtr encoder_out, Stream *s,
       // transfer the ownership so that result->decoder_out will not be released twice
       result->decoder_out = nullptr;
     } else {
-      decoder_out = RunDecoder2D(model_, decoder_input);
+      decoder_out = RunDecoder(prev);
     }
 
     // decoder_out.w == decoder_dim
@@ -176,27 +195,21 @@ void ModifiedBeamSearchDecoder::Decode(TensorPtr encoder_out, Stream *s,
     int32_t num_active_paths = joiner_out_shape[0];
     int32_t vocab_size = joiner_out_shape[1];
 
-    LogSoftmax(joiner_out);
-
-    float* p_joiner_out = joiner_out->host<float>();
-
+    prev_log_probs.resize(num_active_paths);
     for (int32_t i = 0; i != num_active_paths; ++i) {
-      float prev_log_prob = prev[i].log_prob;
-      for (int32_t k = 0; k != vocab_size; ++k, ++p_joiner_out) {
-        *p_joiner_out += prev_log_prob;
-      }
+      prev_log_probs[i] = prev[i].log_prob;
     }
 
-    p_joiner_out = joiner_out->host<float>();
-    auto topk = SherpaDeploy::TopkIndex(p_joiner_out,
-                          num_active_paths * vocab_size, num_active_paths_);
+    // log_softmax of each row plus the log_prob of its path
+    const float* p_joiner_out = joiner_out->host<float>();
+    int32_t num_topk = SherpaDeploy::LogSoftmaxTopK(
+        p_joiner_out, num_active_paths, vocab_size, prev_log_probs.data(),
+        num_active_paths_, topk_index.data(), topk_score.data());
 
     int32_t frame_offset = result->frame_offset;
-    for (auto i : topk) {
-      int32_t hyp_index = i / vocab_size;
-      int32_t new_token = i % vocab_size;
-
-      const float* p = p_joiner_out + hyp_index * vocab_size;
+    for (int32_t j = 0; j != num_topk; ++j) {
+      int32_t hyp_index = topk_index[j] / vocab_size;
+      int32_t new_token = topk_index[j] % vocab_size;
 
       SherpaDeploy::Hypothesis new_hyp = prev[hyp_index];
       // const float prev_lm_log_prob = new_hyp.lm_log_prob;
@@ -204,9 +217,8 @@ void ModifiedBeamSearchDecoder::Decode(TensorPtr encoder_out, Stream *s,
       auto context_state = new_hyp.context_state;
       // blank id is fixed to 0
       if (new_token != 0 && new_token != 2) {
-        new_hyp.ys.push_back(new_token);
+        new_hyp.Append(new_token, t + frame_offset);
         new_hyp.num_trailing_blanks = 0;
-        new_hyp.timestamps.push_back(t + frame_offset);
         if (s && s->GetContextGraph()) {
           auto context_res = s->GetContextGraph()->ForwardOneStep(
               context_state, new_token, false /*strict_mode*/);
@@ -216,8 +228,8 @@ void ModifiedBeamSearchDecoder::Decode(TensorPtr encoder_out, Stream *s,
       } else {
         ++new_hyp.num_trailing_blanks;
       }
-      // We have already added prev[hyp_index].log_prob to p[new_token]
-      new_hyp.log_prob = p[new_token] + context_score;
+      // topk_score[j] already includes prev[hyp_index].log_prob
+      new_hyp.log_prob = topk_score[j] + context_score;
 
       cur.Add(std::move(new_hyp));
     }
@@ -229,11 +241,9 @@ void ModifiedBeamSearchDecoder::Decode(TensorPtr encoder_out, Stream *s,
   auto hyp = result->hyps.GetMostProbable(true);
 
   // set decoder_out in case of endpointing
-  TensorPtr decoder_input = BuildDecoderInput({hyp});
-
-  result->decoder_out = model_->RunDecoder(decoder_input);
+  result->decoder_out = RunDecoder({hyp});
 
-  result->tokens = std::move(hyp.ys);
+  result->tokens = hyp.Ys();
   result->num_trailing_blanks = hyp.num_trailing_blanks;
 }
 
@@ -21,6 +21,8 @@
 #ifndef SHERPA_DEPLOY_MNN_MODIFIED_BEAM_SEARCH_DECODER_H_
 #define SHERPA_DEPLOY_MNN_MODIFIED_BEAM_SEARCH_DECODER_H_
 
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "decoder.h"
@@ -47,11 +49,25 @@ class ModifiedBeamSearchDecoder : public Decoder {
   void Decode(TensorPtr encoder_out, Stream *s, DecoderResult *result) override;
 
  private:
-  TensorPtr BuildDecoderInput(const std::vector<SherpaDeploy::Hypothesis> &hyps) const;
+  TensorPtr BuildDecoderInput(const std::vector<const SherpaDeploy::Hypothesis *> &hyps) const;
+
+  // Run the decoder for all hyps in a single call.
+  //
+  // Decoder outputs are cached by the last context_size tokens, so hyps
+  // sharing the same context are computed only once.
+  //
+  // @return Return a 2-D tensor of shape (hyps.size(), decoder_dim)
+  TensorPtr RunDecoder(const std::vector<SherpaDeploy::Hypothesis> &hyps);
+
+  // Return the last context_size tokens of hyp as a cache key
+  std::string DecoderOutCacheKey(const SherpaDeploy::Hypothesis &hyp) const;
 
  private:
   Model *model_;  // not owned
   int32_t num_active_paths_;
+
+  // key: see DecoderOutCacheKey(); value: decoder output of that context
+  std::unordered_map<std::string, std::vector<float>> decoder_out_cache_;
 };
 
 }  // namespace SherpaDeploy
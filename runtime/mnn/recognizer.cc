@@ -20,8 +20,10 @@
 
 #include "recognizer.h"
 
+#include <atomic>
 #include <fstream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -106,7 +108,8 @@ class Recognizer::Impl {
         endpoint_(config.endpoint_config),
         sym_(config.model_config.tokens) {
     if (config.decoder_config.method == "greedy_search") {
-      decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
+      decoder_ = std::make_unique<GreedySearchDecoder>(
+          model_.get(), config.decoder_config.speculative_joiner);
     } else if (config.decoder_config.method == "modified_beam_search") {
       decoder_ = std::make_unique<ModifiedBeamSearchDecoder>(
           model_.get(), config.decoder_config.num_active_paths);
@@ -132,7 +135,8 @@ class Recognizer::Impl {
         endpoint_(config.endpoint_config),
         sym_(mgr, config.model_config.tokens) {
     if (config.decoder_config.method == "greedy_search") {
-      decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
+      decoder_ = std::make_unique<GreedySearchDecoder>(
+          model_.get(), config.decoder_config.speculative_joiner);
     } else if (config.decoder_config.method == "modified_beam_search") {
       decoder_ = std::make_unique<ModifiedBeamSearchDecoder>(
           model_.get(), config.decoder_config.num_active_paths);
@@ -153,7 +157,12 @@ class Recognizer::Impl {
 #endif
 
   std::unique_ptr<Stream> CreateStream() const {
-    if (hotwords_.empty()) {
+    // Streams share the graph and keep it alive even if SetHotwords()
+    // swaps in a new one while they are running.
+    SherpaDeploy::ContextGraphPtr context_graph =
+        std::atomic_load(&context_graph_);
+
+    if (!context_graph) {
       auto stream = std::make_unique<Stream>(config_.feat_config);
       stream->SetResult(decoder_->GetEmptyResult());
       stream->SetStates(model_->GetEncoderInitStates());
@@ -161,17 +170,12 @@ class Recognizer::Impl {
     } else {
       auto r = decoder_->GetEmptyResult();
 
-      auto context_graph =
-          std::make_shared<SherpaDeploy::ContextGraph>(hotwords_, config_.hotwords_score, boost_scores_);
-
       auto stream =
           std::make_unique<Stream>(config_.feat_config, context_graph);
 
-      if (stream->GetContextGraph()) {
-        // r.hyps has only one element.
-        for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
-          it->second.context_state = stream->GetContextGraph()->Root();
-        }
+      // r.hyps has only one element.
+      for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
+        it->second.context_state = context_graph->Root();
       }
 
       stream->SetResult(r);
@@ -181,42 +185,106 @@ class Recognizer::Impl {
     }
   }
 
+  bool SetHotwords(const std::string &hotwords) {
+    if (config_.decoder_config.method != "modified_beam_search") {
+      fprintf(stderr, "Hotwords are only supported by modified_beam_search, "
+              "current method is %s\n", config_.decoder_config.method.c_str());
+      return false;
+    }
+
+    if (!bpe_encoder_) {
+      fprintf(stderr, "bpe encoder is null, can not encode hot words!\n");
+      return false;
+    }
+
+    std::istringstream is(hotwords);
+    std::vector<std::vector<int32_t>> hotwords_ids;
+    std::vector<float> boost_scores;
+    if (!EncodeHotwords(is, config_.model_config.modeling_unit, sym_,
+                        bpe_encoder_.get(), &hotwords_ids, &boost_scores)) {
+      fprintf(stderr, "Failed to encode some hotwords, keep the old ones.\n");
+      return false;
+    }
+
+    // Streams created before this call keep decoding with the old graph.
+    std::atomic_store(&context_graph_,
+                      BuildContextGraph(hotwords_ids, boost_scores));
+    return true;
+  }
+
+  bool SaveHotwords(const std::string &filename) const {
+    SherpaDeploy::ContextGraphPtr context_graph =
+        std::atomic_load(&context_graph_);
+    if (!context_graph) {
+      fprintf(stderr, "There are no hotwords to save\n");
+      return false;
+    }
+
+    if (!context_graph->Save(filename)) {
+      fprintf(stderr, "Failed to write hotwords to %s\n", filename.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
   bool IsReady(Stream *s) const {
     return s->GetNumProcessedFrames() + model_->Segment() < s->NumFramesReady();
   }
 
-  void DecodeStream(Stream *s) const {
+  void DecodeStream(Stream *s) const { DecodeStreams(&s, 1); }
+
+  void DecodeStreams(Stream **ss, int32_t n) const {
     int32_t segment = model_->Segment();
     int32_t offset = model_->Offset();
+    int32_t feature_dim = config_.feat_config.feature_dim;
 
-    auto frames_out = s->GetFrames(s->GetNumProcessedFrames(), segment);
-    std::vector<float> features_vec = std::get<0>(frames_out);
-    int32_t feature_dim = std::get<1>(frames_out);
-
-    TensorPtr features = TensorPtr(MNN::Tensor::create<float>({segment, feature_dim}, NULL, MNN::Tensor::CAFFE));
+    TensorPtr features = TensorPtr(MNN::Tensor::create<float>({n, segment, feature_dim}, NULL, MNN::Tensor::CAFFE));
     float* p_dst = features->host<float>();
-    float* p_src = features_vec.data();
 
-    for (int32_t i = 0; i != segment; ++i) {
-      std::copy(p_src, p_src + feature_dim, p_dst);
-      p_src += feature_dim;
-      p_dst += feature_dim;
+    for (int32_t i = 0; i != n; ++i) {
+      ss[i]->GetFrames(ss[i]->GetNumProcessedFrames(), segment, p_dst);
+      p_dst += segment * feature_dim;
+
+      ss[i]->GetNumProcessedFrames() += offset;
+    }
+
+    if (n == 1) {
+      // The states stay in the stream's arena
+      TensorPtr encoder_out =
+          model_->RunEncoder(features, &ss[0]->GetStateArena());
+      Decode(encoder_out, ss[0]);
+      return;
+    }
+
+    std::vector<std::vector<TensorPtr>> states_vec(n);
+    for (int32_t i = 0; i != n; ++i) {
+      states_vec[i] = ss[i]->GetStates();
     }
 
-    s->GetNumProcessedFrames() += offset;
-    std::vector<TensorPtr> pre_states = s->GetStates();
-    std::vector<TensorPtr> cur_states;
+    std::vector<TensorPtr> states = model_->StackStates(states_vec);
 
     TensorPtr encoder_out;
-    std::tie(encoder_out, cur_states) = model_->RunEncoder(features, pre_states);
+    std::vector<TensorPtr> next_states;
+    std::tie(encoder_out, next_states) = model_->RunEncoder(features, states);
+
+    // (N, T, encoder_dim) -> N x (1, T, encoder_dim)
+    std::vector<TensorPtr> encoder_out_vec = Unbind(encoder_out, 0);
+    std::vector<std::vector<TensorPtr>> next_states_vec =
+        model_->UnStackStates(next_states);
+
+    for (int32_t i = 0; i != n; ++i) {
+      Decode(encoder_out_vec[i], ss[i]);
+      ss[i]->GetStateArena().Advance(next_states_vec[i]);
+    }
+  }
 
+  void Decode(TensorPtr encoder_out, Stream *s) const {
     if (s->GetContextGraph()) {
       decoder_->Decode(encoder_out, s, &s->GetResult());
     } else {
       decoder_->Decode(encoder_out, &s->GetResult());
     }
-    s->SetStates(cur_states);
-
   }
 
   bool IsEndpoint(Stream *s) const {
@@ -287,18 +355,26 @@ class Recognizer::Impl {
     size_t asset_length = AAsset_getLength(asset);
     std::istrstream is(p, asset_length);
 
+    std::vector<std::vector<int32_t>> hotwords;
+    std::vector<float> boost_scores;
     if (!EncodeHotwords(is, config_.model_config.modeling_unit, sym_,
-                        bpe_encoder_.get(), &hotwords_, &boost_scores_)) {
+                        bpe_encoder_.get(), &hotwords, &boost_scores)) {
       fprintf(stderr,
           "Failed to encode some hotwords, skip them already, see logs above "
           "for details.\n");
     }
+    context_graph_ = BuildContextGraph(hotwords, boost_scores);
 
     AAsset_close(asset);
   }
 #endif
 
   void InitHotwords() {
+    // A graph written by ContextGraph::Save() is mapped as is; its scores
+    // were fixed when it was saved.
+    context_graph_ = SherpaDeploy::ContextGraph::Load(config_.hotwords_file);
+    if (context_graph_) return;
+
     // each line in hotwords_file contains space-separated words
 
     std::ifstream is(config_.hotwords_file);
@@ -312,12 +388,24 @@ class Recognizer::Impl {
       exit(-1);
     }
     
+    std::vector<std::vector<int32_t>> hotwords;
+    std::vector<float> boost_scores;
     if (!EncodeHotwords(is, config_.model_config.modeling_unit, sym_,
-                        bpe_encoder_.get(), &hotwords_, &boost_scores_)) {
+                        bpe_encoder_.get(), &hotwords, &boost_scores)) {
       fprintf(stderr,
           "Failed to encode some hotwords, skip them already, see logs above "
           "for details.\n");
     }
+    context_graph_ = BuildContextGraph(hotwords, boost_scores);
+  }
+
+  // Returns nullptr for an empty list so that streams skip context biasing.
+  SherpaDeploy::ContextGraphPtr BuildContextGraph(
+      const std::vector<std::vector<int32_t>> &hotwords,
+      const std::vector<float> &boost_scores) const {
+    if (hotwords.empty()) return nullptr;
+    return std::make_shared<SherpaDeploy::ContextGraph>(
+        hotwords, config_.hotwords_score, boost_scores);
   }
 
  private:
@@ -327,8 +415,9 @@ class Recognizer::Impl {
   SherpaDeploy::Endpoint endpoint_;
   SherpaDeploy::SymbolTable sym_;
   std::unique_ptr<ssentencepiece::Ssentencepiece> bpe_encoder_;
-  std::vector<std::vector<int32_t>> hotwords_;
-  std::vector<float> boost_scores_;
+  // Built once and shared by all streams, replaced atomically by
+  // SetHotwords().
+  SherpaDeploy::ContextGraphPtr context_graph_;
 };
 
 Recognizer::Recognizer(const RecognizerConfig &config)
@@ -345,10 +434,22 @@ std::unique_ptr<Stream> Recognizer::CreateStream() const {
   return impl_->CreateStream();
 }
 
+bool Recognizer::SetHotwords(const std::string &hotwords) {
+  return impl_->SetHotwords(hotwords);
+}
+
+bool Recognizer::SaveHotwords(const std::string &filename) const {
+  return impl_->SaveHotwords(filename);
+}
+
 bool Recognizer::IsReady(Stream *s) const { return impl_->IsReady(s); }
 
 void Recognizer::DecodeStream(Stream *s) const { impl_->DecodeStream(s); }
 
+void Recognizer::DecodeStreams(Stream **ss, int32_t n) const {
+  impl_->DecodeStreams(ss, n);
+}
+
 bool Recognizer::IsEndpoint(Stream *s) const { return impl_->IsEndpoint(s); }
 
 void Recognizer::Reset(Stream *s) const { impl_->Reset(s); }
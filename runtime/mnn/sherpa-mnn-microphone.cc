@@ -25,6 +25,7 @@
 #include <algorithm>
 
 #include "portaudio.h"  // NOLINT
+#include "runtime/core/cli-utils.h"
 #include "runtime/core/display.h"
 #include "runtime/core/microphone.h"
 
@@ -52,6 +53,11 @@ static void Handler(int32_t sig) {
 };
 
 int32_t main(int32_t argc, char *argv[]) {
+  std::string joiner_encoder_proj =
+      SherpaDeploy::TakeOption("joiner-encoder-proj", &argc, argv);
+  std::string joiner_decoder_proj =
+      SherpaDeploy::TakeOption("joiner-decoder-proj", &argc, argv);
+
   if (argc < 5 || argc > 10) {
     const char *usage = R"usage(
 Usage:
@@ -66,6 +72,11 @@ Usage:
     [hotwords_score] \
     [bpe_vocab]
 
+Optional, if the joiner is exported as two projections and an output layer.
+joiner.mnn is then the output layer:
+  --joiner-encoder-proj=/path/to/joiner_encoder_proj.mnn
+  --joiner-decoder-proj=/path/to/joiner_decoder_proj.mnn
+
 )usage";
     fprintf(stderr, "%s\n", usage);
     fprintf(stderr, "argc, %d\n", argc);
@@ -79,6 +90,8 @@ Usage:
   config.model_config.encoder_mnn = argv[1];
   config.model_config.decoder_mnn = argv[2];
   config.model_config.joiner_mnn = argv[3];
+  config.model_config.joiner_encoder_proj_mnn = joiner_encoder_proj.c_str();
+  config.model_config.joiner_decoder_proj_mnn = joiner_decoder_proj.c_str();
   config.model_config.tokens = argv[4];
   int32_t num_threads = 4;
   if (argc >= 6 && atoi(argv[5]) > 0) {
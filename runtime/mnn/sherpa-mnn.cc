@@ -26,10 +26,16 @@
 #include <iostream>
 
 #include "recognizer.h"
+#include "runtime/core/cli-utils.h"
 #include "runtime/core/wave-reader.h"
 #include "model.h"
 
 int32_t main(int32_t argc, char *argv[]) {
+  std::string joiner_encoder_proj =
+      SherpaDeploy::TakeOption("joiner-encoder-proj", &argc, argv);
+  std::string joiner_decoder_proj =
+      SherpaDeploy::TakeOption("joiner-decoder-proj", &argc, argv);
+
   if (argc < 6 || argc > 10) {
     const char *usage = R"usage(
 Usage:
@@ -40,6 +46,11 @@ Usage:
     /path/to/tokens.txt \
     /path/to/foo.wav [num_threads] [decode_method, can be greedy_search/modified_beam_search] [hotwords_file] [hotwords_score]
 
+Optional, if the joiner is exported as two projections and an output layer.
+joiner.mnn is then the output layer:
+  --joiner-encoder-proj=/path/to/joiner_encoder_proj.mnn
+  --joiner-decoder-proj=/path/to/joiner_decoder_proj.mnn
+
 )usage";
     std::cerr << usage << "\n";
 
@@ -51,6 +62,8 @@ Usage:
   config.model_config.encoder_mnn = argv[1];
   config.model_config.decoder_mnn = argv[2];
   config.model_config.joiner_mnn = argv[3];
+  config.model_config.joiner_encoder_proj_mnn = joiner_encoder_proj;
+  config.model_config.joiner_decoder_proj_mnn = joiner_decoder_proj;
   config.model_config.tokens = argv[4];
   int32_t num_threads = 4;
   if (argc >= 7 && atoi(argv[6]) > 0) {
@@ -0,0 +1,70 @@
+// runtime/mnn/state-arena.cc
+
+#include "state-arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace SherpaDeploy {
+
+// Each tensor starts on a 64-byte boundary relative to the buffer
+static constexpr size_t kAlignFloats = 16;
+
+static size_t AlignedFloats(const TensorPtr &t) {
+  size_t n = (t->size() + sizeof(float) - 1) / sizeof(float);
+  return (n + kAlignFloats - 1) / kAlignFloats * kAlignFloats;
+}
+
+bool StateArena::SameLayout(const std::vector<TensorPtr> &states) const {
+  const auto &views = views_[0];
+  if (views.size() != states.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i != states.size(); ++i) {
+    if (views[i]->shape() != states[i]->shape() ||
+        views[i]->getType() != states[i]->getType() ||
+        views[i]->getDimensionType() != states[i]->getDimensionType()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void StateArena::Assign(const std::vector<TensorPtr> &states) {
+  if (!SameLayout(states)) {
+    size_t total = 0;
+    for (const auto &s : states) {
+      total += AlignedFloats(s);
+    }
+
+    buffer_.assign(2 * total, 0);
+    float *p = buffer_.data();
+    for (auto &views : views_) {
+      views.clear();
+      views.reserve(states.size());
+      for (const auto &s : states) {
+        views.push_back(TensorPtr(MNN::Tensor::create(
+            s->shape(), s->getType(), p, s->getDimensionType())));
+        p += AlignedFloats(s);
+      }
+    }
+    cur_ = 0;
+  }
+
+  Copy(states, Current());
+}
+
+void StateArena::Advance(const std::vector<TensorPtr> &states) {
+  Copy(states, Next());
+  Swap();
+}
+
+void StateArena::Copy(const std::vector<TensorPtr> &src,
+                      const std::vector<TensorPtr> &dst) {
+  for (size_t i = 0; i != src.size(); ++i) {
+    std::memcpy(dst[i]->host<void>(), src[i]->host<void>(), src[i]->size());
+  }
+}
+
+}  // namespace SherpaDeploy
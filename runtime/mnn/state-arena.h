@@ -0,0 +1,56 @@
+// runtime/mnn/state-arena.h
+
+#ifndef SHERPA_DEPLOY_MNN_STATE_ARENA_H_
+#define SHERPA_DEPLOY_MNN_STATE_ARENA_H_
+
+#include <vector>
+
+#include "mnn-utils.h"
+
+namespace SherpaDeploy {
+
+// Two preallocated host copies of the encoder states of one stream. The
+// encoder copies Current() into its session inputs and its state outputs
+// into Next(), then Swap() flips them, so no state tensor is created or
+// freed per chunk.
+//
+// This is a host-side arena. The tensors of both copies are host tensors
+// that view one buffer and keep the shapes, types and dimension types of
+// the states given to Assign(). Moving them in and out of the session
+// still goes through copyFromHostTensor() and copyToHostTensor(), which
+// convert the layout if the session tensors use a different one, e.g.,
+// NC4HW4 on some backends. Only Assign() and Advance() are plain memcpy.
+class StateArena {
+ public:
+  StateArena() = default;
+  StateArena(const StateArena &) = delete;
+  StateArena &operator=(const StateArena &) = delete;
+
+  // Copy `states` into Current(). The buffer is only reallocated if the
+  // layout differs from the one of the previous call.
+  void Assign(const std::vector<TensorPtr> &states);
+
+  // Copy `states` into Next() and make it current
+  void Advance(const std::vector<TensorPtr> &states);
+
+  bool Empty() const { return views_[0].empty(); }
+
+  const std::vector<TensorPtr> &Current() const { return views_[cur_]; }
+  const std::vector<TensorPtr> &Next() const { return views_[1 - cur_]; }
+
+  void Swap() { cur_ = 1 - cur_; }
+
+ private:
+  bool SameLayout(const std::vector<TensorPtr> &states) const;
+
+  static void Copy(const std::vector<TensorPtr> &src,
+                   const std::vector<TensorPtr> &dst);
+
+  std::vector<float> buffer_;
+  std::vector<TensorPtr> views_[2];
+  int32_t cur_ = 0;
+};
+
+}  // namespace SherpaDeploy
+
+#endif  // SHERPA_DEPLOY_MNN_STATE_ARENA_H_
@@ -48,6 +48,10 @@ class Stream::Impl {
     return feat_extractor_.GetFrames(frame_index + start_frame_index_, n);
   }
 
+  void GetFrames(int32_t frame_index, int32_t n, float *out) const {
+    feat_extractor_.GetFrames(frame_index + start_frame_index_, n, out);
+  }
+
   void Reset() {
     start_frame_index_ += num_processed_frames_;
     num_processed_frames_ = 0;
@@ -62,7 +66,7 @@ class Stream::Impl {
       iter->second.context_state = context_res.second;
     }
     auto hyp = result_.hyps.GetMostProbable(true);
-    result_.tokens = std::move(hyp.ys);
+    result_.tokens = hyp.Ys();
   }
 
   int32_t &GetNumProcessedFrames() { return num_processed_frames_; }
@@ -75,9 +79,15 @@ class Stream::Impl {
 
   DecoderResult &GetResult() { return result_; }
 
-  void SetStates(const std::vector<TensorPtr> &states) { states_ = states; }
+  void SetStates(const std::vector<TensorPtr> &states) {
+    state_arena_.Assign(states);
+  }
+
+  const std::vector<TensorPtr> &GetStates() const {
+    return state_arena_.Current();
+  }
 
-  std::vector<TensorPtr> &GetStates() { return states_; }
+  StateArena &GetStateArena() { return state_arena_; }
 
   const SherpaDeploy::ContextGraphPtr &GetContextGraph() const { return context_graph_; }
 
@@ -87,7 +97,7 @@ class Stream::Impl {
   int32_t num_processed_frames_ = 0;  // before subsampling
   int32_t start_frame_index_ = 0;
   DecoderResult result_;
-  std::vector<TensorPtr> states_;
+  StateArena state_arena_;
 };
 
 Stream::Stream(const SherpaDeploy::FeatureExtractorConfig &config,
@@ -113,6 +123,10 @@ std::tuple<std::vector<float>, int32_t> Stream::GetFrames(int32_t frame_index, i
   return impl_->GetFrames(frame_index, n);
 }
 
+void Stream::GetFrames(int32_t frame_index, int32_t n, float *out) const {
+  impl_->GetFrames(frame_index, n, out);
+}
+
 void Stream::Reset() { impl_->Reset(); }
 
 void Stream::Finalize() { impl_->Finalize(); }
@@ -129,7 +143,11 @@ void Stream::SetStates(const std::vector<TensorPtr> &states) {
   impl_->SetStates(states);
 }
 
-std::vector<TensorPtr> &Stream::GetStates() { return impl_->GetStates(); }
+const std::vector<TensorPtr> &Stream::GetStates() const {
+  return impl_->GetStates();
+}
+
+StateArena &Stream::GetStateArena() { return impl_->GetStateArena(); }
 
 const SherpaDeploy::ContextGraphPtr &Stream::GetContextGraph() const {
   return impl_->GetContextGraph();
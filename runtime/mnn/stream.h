@@ -26,6 +26,7 @@
 
 #include "runtime/core/context-graph.h"
 #include "decoder.h"
+#include "state-arena.h"
 #include "runtime/core/features.h"
 
 namespace MNN {
@@ -74,6 +75,12 @@ class Stream {
    */
   std::tuple<std::vector<float>, int32_t> GetFrames(int32_t frame_index, int32_t n) const;
 
+  /**
+   * Like the above, but write the frames into `out`, which must hold at
+   * least n * feature_dim floats. Use it to fill an input tensor directly.
+   */
+  void GetFrames(int32_t frame_index, int32_t n, float *out) const;
+
   void Reset();
 
   /**
@@ -95,8 +102,13 @@ class Stream {
   void SetResult(const DecoderResult &r);
   DecoderResult &GetResult();
 
+  // The states are copied into the stream's StateArena
   void SetStates(const std::vector<TensorPtr> &states);
-  std::vector<TensorPtr> &GetStates();
+  const std::vector<TensorPtr> &GetStates() const;
+
+  // Encoder states of this stream, updated in place by
+  // Model::RunEncoder(features, arena)
+  StateArena &GetStateArena();
   /**
    * Get the context graph corresponding to this stream.
    *
@@ -5,7 +5,9 @@
 
 #include "zipformer-model.h"
 #include "mnn-utils.h"
+#include "state-arena.h"
 
+#include <algorithm>
 #include <regex>  // NOLINT
 #include <string>
 #include <utility>
@@ -13,7 +15,6 @@
 #include <sstream>
 #include <numeric>
 
-#include "MNN/expr/Module.hpp"       // NOLINT
 #include "MNN/Interpreter.hpp"  // NOLINT
 
 // #define PRINT_MODEL_METADATA
@@ -32,21 +33,38 @@ static std::vector<int> convertStringToVector(const std::string& input) {
 
 namespace SherpaDeploy {
 
-ZipformerModel::ZipformerModel(const ModelConfig &config) {
-
-  InitEncoder(config.encoder_mnn.c_str(), config.schedule_config);
-  InitDecoder(config.decoder_mnn.c_str(), config.schedule_config);
-  InitJoiner(config.joiner_mnn.c_str(), config.schedule_config);
+// Maximum number of sessions in a ZipformerModel::SessionCache
+static constexpr int32_t kMaxCachedSessions = 8;
+
+ZipformerModel::ZipformerModel(const ModelConfig &config)
+    : schedule_config_(config.schedule_config),
+      session_cache_dir_(config.session_cache_dir) {
+  // schedule_config_ is used again for sessions created after the caller's
+  // BackendConfig may be gone, so keep a copy of it
+  if (schedule_config_.backendConfig) {
+    backend_config_ = *schedule_config_.backendConfig;
+    schedule_config_.backendConfig = &backend_config_;
+  }
 
+  InitEncoder(config.encoder_mnn.c_str(), schedule_config_);
+  InitDecoder(config.decoder_mnn.c_str(), schedule_config_);
+  InitJoiner(config.joiner_mnn.c_str(), schedule_config_);
+  InitJoinerProjections(config);
 }
 
 #if __ANDROID_API__ >= 9
-ZipformerModel::ZipformerModel(AAssetManager *mgr, const ModelConfig &config) {
-
-  InitEncoder(mgr, config.encoder_mnn.c_str(), config.schedule_config);
-  InitDecoder(mgr, config.decoder_mnn.c_str(), config.schedule_config);
-  InitJoiner(mgr, config.joiner_mnn.c_str(), config.schedule_config);
+ZipformerModel::ZipformerModel(AAssetManager *mgr, const ModelConfig &config)
+    : schedule_config_(config.schedule_config),
+      session_cache_dir_(config.session_cache_dir) {
+  if (schedule_config_.backendConfig) {
+    backend_config_ = *schedule_config_.backendConfig;
+    schedule_config_.backendConfig = &backend_config_;
+  }
 
+  InitEncoder(mgr, config.encoder_mnn.c_str(), schedule_config_);
+  InitDecoder(mgr, config.decoder_mnn.c_str(), schedule_config_);
+  InitJoiner(mgr, config.joiner_mnn.c_str(), schedule_config_);
+  InitJoinerProjections(config);
 }
 #endif
 
@@ -60,10 +78,15 @@ std::pair<TensorPtr, std::vector<TensorPtr>> ZipformerModel::RunEncoder(
     _states = states;
   }
 
-  auto featuresTensor = encoder_net_->getSessionInput(encoder_sess_, encoder_input_names_[0].c_str());
+  MNN::Session *sess = encoder_sess_;
+  if (features->dimensions() == 3 && features->shape()[0] > 1) {
+    sess = GetEncoderSession(features, _states);
+  }
+
+  auto featuresTensor = encoder_net_->getSessionInput(sess, encoder_input_names_[0].c_str());
   featuresTensor->copyFromHostTensor(features.get()); 
   for (size_t i = 1; i < encoder_input_names_.size(); ++i) {
-    auto inputTensor = encoder_net_->getSessionInput(encoder_sess_, encoder_input_names_[i].c_str());
+    auto inputTensor = encoder_net_->getSessionInput(sess, encoder_input_names_[i].c_str());
 
     // for using dynamic axes when export ONNX
     // auto shape = inputTensor->shape();
@@ -75,9 +98,9 @@ std::pair<TensorPtr, std::vector<TensorPtr>> ZipformerModel::RunEncoder(
   } 
 
   // run network
-  encoder_net_->runSession(encoder_sess_);
+  encoder_net_->runSession(sess);
 
-  auto encoderOutTensor = encoder_net_->getSessionOutput(encoder_sess_, encoder_output_names_[0].c_str());
+  auto encoderOutTensor = encoder_net_->getSessionOutput(sess, encoder_output_names_[0].c_str());
   TensorPtr encoderOutTensor_host = TensorPtr(
                                         MNN::Tensor::create(
                                         encoderOutTensor->shape(), 
@@ -89,7 +112,7 @@ std::pair<TensorPtr, std::vector<TensorPtr>> ZipformerModel::RunEncoder(
 
   std::vector<TensorPtr> nextStatesTensor_host(_states.size());
   for (size_t i = 1; i < encoder_output_names_.size(); ++i) {
-    auto nextStateTensor = encoder_net_->getSessionOutput(encoder_sess_, encoder_output_names_[i].c_str());
+    auto nextStateTensor = encoder_net_->getSessionOutput(sess, encoder_output_names_[i].c_str());
     nextStatesTensor_host[i-1] = TensorPtr(MNN::Tensor::create(
                                   nextStateTensor->shape(), 
                                   nextStateTensor->getType(), 
@@ -101,14 +124,102 @@ std::pair<TensorPtr, std::vector<TensorPtr>> ZipformerModel::RunEncoder(
   return {encoderOutTensor_host, nextStatesTensor_host};
 }
 
+TensorPtr ZipformerModel::RunEncoder(TensorPtr features, StateArena *arena) {
+  if (arena->Empty()) {
+    arena->Assign(GetEncoderInitStates());
+  }
+
+  // A single stream always uses the batch size 1 session
+  MNN::Session *sess = encoder_sess_;
+
+  const std::vector<TensorPtr> &states = arena->Current();
+
+  auto featuresTensor = encoder_net_->getSessionInput(sess, encoder_input_names_[0].c_str());
+  featuresTensor->copyFromHostTensor(features.get());
+  for (size_t i = 1; i < encoder_input_names_.size(); ++i) {
+    auto inputTensor = encoder_net_->getSessionInput(sess, encoder_input_names_[i].c_str());
+    inputTensor->copyFromHostTensor(states[i-1].get());
+  }
+
+  encoder_net_->runSession(sess);
+
+  auto encoderOutTensor = encoder_net_->getSessionOutput(sess, encoder_output_names_[0].c_str());
+  TensorPtr encoderOutTensor_host = TensorPtr(
+                                        MNN::Tensor::create(
+                                        encoderOutTensor->shape(),
+                                        encoderOutTensor->getType(),
+                                        nullptr,
+                                        encoderOutTensor->getDimensionType())
+                                        );
+  encoderOutTensor->copyToHostTensor(encoderOutTensor_host.get());
+
+  // The next states are copied from the session into the other half of the
+  // arena without creating a temporary host tensor
+  const std::vector<TensorPtr> &next_states = arena->Next();
+  for (size_t i = 1; i < encoder_output_names_.size(); ++i) {
+    auto nextStateTensor = encoder_net_->getSessionOutput(sess, encoder_output_names_[i].c_str());
+    nextStateTensor->copyToHostTensor(next_states[i-1].get());
+  }
+  arena->Swap();
+
+  return encoderOutTensor_host;
+}
+
+MNN::Session *ZipformerModel::GetEncoderSession(
+    TensorPtr features, const std::vector<TensorPtr> &states) {
+  int32_t batch_size = features->shape()[0];
+  auto it = batch_encoder_sess_.find(batch_size);
+  if (it != batch_encoder_sess_.end()) {
+    return it->second;
+  }
+
+  // Keep one session per batch size so that alternating batch sizes don't
+  // trigger resizeSession() on every call
+  MNN::Session *sess = encoder_net_->createSession(schedule_config_);
+
+  auto featuresTensor = encoder_net_->getSessionInput(sess, encoder_input_names_[0].c_str());
+  encoder_net_->resizeTensor(featuresTensor, features->shape());
+  for (size_t i = 1; i < encoder_input_names_.size(); ++i) {
+    auto inputTensor = encoder_net_->getSessionInput(sess, encoder_input_names_[i].c_str());
+    encoder_net_->resizeTensor(inputTensor, states[i-1]->shape());
+  }
+  encoder_net_->resizeSession(sess);
+
+  batch_encoder_sess_[batch_size] = sess;
+
+  return sess;
+}
+
+MNN::Session *ZipformerModel::GetDecoderSession(int32_t batch_size) {
+  if (batch_size == 1) {
+    return decoder_sess_;
+  }
+
+  auto it = batch_decoder_sess_.find(batch_size);
+  if (it != batch_decoder_sess_.end()) {
+    return it->second;
+  }
+
+  MNN::Session *sess = decoder_net_->createSession(schedule_config_);
+
+  auto decoderInputTensor = decoder_net_->getSessionInput(sess, decoder_input_names_[0].c_str());
+  decoder_net_->resizeTensor(decoderInputTensor, {batch_size, context_size_});
+  decoder_net_->resizeSession(sess);
+
+  batch_decoder_sess_[batch_size] = sess;
+
+  return sess;
+}
+
 TensorPtr ZipformerModel::RunDecoder(TensorPtr decoder_input) {
+  MNN::Session *sess = GetDecoderSession(decoder_input->shape()[0]);
 
-  auto decoderInputTensor = decoder_net_->getSessionInput(decoder_sess_, decoder_input_names_[0].c_str());
+  auto decoderInputTensor = decoder_net_->getSessionInput(sess, decoder_input_names_[0].c_str());
   decoderInputTensor->copyFromHostTensor(decoder_input.get()); 
 
-  decoder_net_->runSession(decoder_sess_);
+  decoder_net_->runSession(sess);
 
-  auto decoderOutTensor = decoder_net_->getSessionOutput(decoder_sess_, decoder_output_names_[0].c_str());
+  auto decoderOutTensor = decoder_net_->getSessionOutput(sess, decoder_output_names_[0].c_str());
   TensorPtr decoderOutTensor_host = TensorPtr(MNN::Tensor::create(
                                         decoderOutTensor->shape(), 
                                         decoderOutTensor->getType(), 
@@ -120,16 +231,135 @@ TensorPtr ZipformerModel::RunDecoder(TensorPtr decoder_input) {
   return decoderOutTensor_host;
 }
 
+MNN::Session *ZipformerModel::SessionCache::Get(int64_t key) {
+  auto it = std::find_if(
+      sessions_.begin(), sessions_.end(),
+      [key](const std::pair<int64_t, MNN::Session *> &p) {
+        return p.first == key;
+      });
+  if (it == sessions_.end()) {
+    return nullptr;
+  }
+
+  // Move it to the end as the most recently used one
+  std::rotate(it, it + 1, sessions_.end());
+  return sessions_.back().second;
+}
+
+void ZipformerModel::SessionCache::Put(MNN::Interpreter *net, int64_t key,
+                                       MNN::Session *sess) {
+  if (static_cast<int32_t>(sessions_.size()) == kMaxCachedSessions) {
+    net->releaseSession(sessions_.front().second);
+    sessions_.erase(sessions_.begin());
+  }
+
+  sessions_.emplace_back(key, sess);
+}
+
+MNN::Session *ZipformerModel::GetJoinerSession(TensorPtr encoder_out,
+                                               TensorPtr decoder_out) {
+  int32_t encoder_rows = encoder_out->shape()[0];
+  int32_t decoder_rows = decoder_out->shape()[0];
+  if (encoder_rows == 1 && decoder_rows == 1) {
+    return joiner_sess_;
+  }
+
+  int64_t key = (static_cast<int64_t>(encoder_rows) << 32) | decoder_rows;
+  if (MNN::Session *sess = batch_joiner_sess_.Get(key)) {
+    return sess;
+  }
+
+  MNN::Session *sess = joiner_net_->createSession(schedule_config_);
+
+  auto encoderOutTensor = joiner_net_->getSessionInput(sess, joiner_input_names_[0].c_str());
+  auto decoderOutTensor = joiner_net_->getSessionInput(sess, joiner_input_names_[1].c_str());
+  joiner_net_->resizeTensor(encoderOutTensor, encoder_out->shape());
+  joiner_net_->resizeTensor(decoderOutTensor, decoder_out->shape());
+  joiner_net_->resizeSession(sess);
+
+  batch_joiner_sess_.Put(joiner_net_.get(), key, sess);
+
+  return sess;
+}
+
+TensorPtr ZipformerModel::RunProjection(Projection *proj, const float *p,
+                                        int32_t num_rows, int32_t dim) {
+  MNN::Session *sess = proj->sess;
+  if (num_rows != 1) {
+    sess = proj->batch_sess.Get(num_rows);
+    if (!sess) {
+      sess = proj->net->createSession(schedule_config_);
+
+      auto inputTensor =
+          proj->net->getSessionInput(sess, proj->input_name.c_str());
+      proj->net->resizeTensor(inputTensor, {num_rows, dim});
+      proj->net->resizeSession(sess);
+
+      proj->batch_sess.Put(proj->net.get(), num_rows, sess);
+    }
+  }
+
+  // Wrap the caller's memory; nothing is copied here
+  TensorPtr input = TensorPtr(MNN::Tensor::create<float>(
+      {num_rows, dim}, const_cast<float *>(p), MNN::Tensor::CAFFE));
+
+  auto inputTensor = proj->net->getSessionInput(sess, proj->input_name.c_str());
+  inputTensor->copyFromHostTensor(input.get());
+
+  proj->net->runSession(sess);
+
+  auto outputTensor =
+      proj->net->getSessionOutput(sess, proj->output_name.c_str());
+  TensorPtr ans = TensorPtr(MNN::Tensor::create(
+      outputTensor->shape(), outputTensor->getType(), nullptr,
+      outputTensor->getDimensionType()));
+  outputTensor->copyToHostTensor(ans.get());
+
+  return ans;
+}
+
+TensorPtr ZipformerModel::ProjectEncoderOut(TensorPtr encoder_out) {
+  if (!has_joiner_projections_) {
+    return encoder_out;
+  }
+
+  // (N, T, encoder_dim) -> (N * T, joiner_dim) -> (N, T, joiner_dim)
+  auto shape = encoder_out->shape();
+  TensorPtr out = RunProjection(&joiner_encoder_proj_,
+                                encoder_out->host<float>(),
+                                shape[0] * shape[1], shape[2]);
+
+  int32_t joiner_dim = out->shape()[1];
+  TensorPtr ans = TensorPtr(MNN::Tensor::create<float>(
+      {shape[0], shape[1], joiner_dim}, NULL, MNN::Tensor::CAFFE));
+
+  const float *src = out->host<float>();
+  std::copy(src, src + out->elementSize(), ans->host<float>());
+
+  return ans;
+}
+
+TensorPtr ZipformerModel::ProjectDecoderOut(TensorPtr decoder_out) {
+  if (!has_joiner_projections_) {
+    return decoder_out;
+  }
+
+  auto shape = decoder_out->shape();
+  return RunProjection(&joiner_decoder_proj_, decoder_out->host<float>(),
+                       shape[0], shape[1]);
+}
+
 TensorPtr ZipformerModel::RunJoiner(TensorPtr encoder_out, TensorPtr decoder_out) {
+  MNN::Session *sess = GetJoinerSession(encoder_out, decoder_out);
 
-  auto encoderOutTensor = joiner_net_->getSessionInput(joiner_sess_, joiner_input_names_[0].c_str());
-  auto decoderOutTensor = joiner_net_->getSessionInput(joiner_sess_, joiner_input_names_[1].c_str());
+  auto encoderOutTensor = joiner_net_->getSessionInput(sess, joiner_input_names_[0].c_str());
+  auto decoderOutTensor = joiner_net_->getSessionInput(sess, joiner_input_names_[1].c_str());
   encoderOutTensor->copyFromHostTensor(encoder_out.get());
   decoderOutTensor->copyFromHostTensor(decoder_out.get());
 
-  joiner_net_->runSession(joiner_sess_);
+  joiner_net_->runSession(sess);
 
-  auto joinerOutTensor = joiner_net_->getSessionOutput(joiner_sess_, joiner_output_names_[0].c_str());
+  auto joinerOutTensor = joiner_net_->getSessionOutput(sess, joiner_output_names_[0].c_str());
   TensorPtr joinerOutTensor_host = TensorPtr(MNN::Tensor::create(
                                         joinerOutTensor->shape(), 
                                         joinerOutTensor->getType(), 
@@ -142,26 +372,19 @@ TensorPtr ZipformerModel::RunJoiner(TensorPtr encoder_out, TensorPtr decoder_out
 
 void ZipformerModel::InitEncoder(const char* model_path, const MNN::ScheduleConfig& schedule_config) {
 
-  InitNet(encoder_net_, encoder_sess_, model_path, schedule_config);
+  // Keep the model so that sessions for batch size > 1 can be created later
+  ModelInfo info;
+  InitNet(encoder_net_, encoder_sess_, model_path, schedule_config, false,
+          &info, session_cache_dir_);
 
-  std::vector<std::string> empty;
-  std::shared_ptr<MNN::Express::Module> module(MNN::Express::Module::load(empty, empty, model_path));
-  if (nullptr == module.get()) {
-    fprintf(stderr, "Load MNN from %s Failed\n", model_path);
-    return;
-  }
-
-  GetInputNames(module, encoder_input_names_);
-  GetOutputNames(module, encoder_output_names_);
+  encoder_input_names_ = std::move(info.input_names);
+  encoder_output_names_ = std::move(info.output_names);
 
-  auto info = module->getInfo();
-  // MNN_ASSERT(info->inputNames.size() == info->inputs.size());
-
-  if (!info->metaData.empty()) {
+  if (!info.meta_data.empty()) {
 #ifdef PRINT_MODEL_METADATA
     fprintf(stderr, "\n------------ Encoder MetaData: Begin ------------\n");
 #endif
-    for (auto& iter : info->metaData) {
+    for (auto& iter : info.meta_data) {
 #ifdef PRINT_MODEL_METADATA
       fprintf(stderr, "[Meta] %s : %s\n", iter.first.c_str(), iter.second.c_str());
 #endif
@@ -207,25 +430,18 @@ void ZipformerModel::InitEncoder(const char* model_path, const MNN::ScheduleConf
 }
 
 void ZipformerModel::InitDecoder(const char* model_path, const MNN::ScheduleConfig& schedule_config) {
-  InitNet(decoder_net_, decoder_sess_, model_path, schedule_config);
-
-  std::vector<std::string> empty;
-  std::shared_ptr<MNN::Express::Module> module(MNN::Express::Module::load(empty, empty, model_path));
-  if (nullptr == module.get()) {
-    fprintf(stderr, "Load MNN from %s Failed\n", model_path);
-    return;
-  }
-
-  GetInputNames(module, decoder_input_names_);
-  GetOutputNames(module, decoder_output_names_);
-
-  auto info = module->getInfo();
-  // MNN_ASSERT(info->inputNames.size() == info->inputs.size());
-  if (!info->metaData.empty()) {
+  // Keep the model so that sessions for batch size > 1 can be created later
+  ModelInfo info;
+  InitNet(decoder_net_, decoder_sess_, model_path, schedule_config, false,
+          &info, session_cache_dir_);
+
+  decoder_input_names_ = std::move(info.input_names);
+  decoder_output_names_ = std::move(info.output_names);
+  if (!info.meta_data.empty()) {
 #ifdef PRINT_MODEL_METADATA
     fprintf(stderr, "\n------------ Decoder MetaData: Begin ------------\n");
 #endif
-    for (auto& iter : info->metaData) {
+    for (auto& iter : info.meta_data) {
 #ifdef PRINT_MODEL_METADATA
       fprintf(stderr, "[Meta] %s : %s\n", iter.first.c_str(), iter.second.c_str());
 #endif
@@ -242,25 +458,49 @@ void ZipformerModel::InitDecoder(const char* model_path, const MNN::ScheduleConf
   }
 }
 
-void ZipformerModel::InitJoiner(const char* model_path, const MNN::ScheduleConfig& schedule_config) {
-  InitNet(joiner_net_, joiner_sess_, model_path, schedule_config);
+void ZipformerModel::InitProjection(const std::string &model_path,
+                                    Projection *proj) {
+  // Keep the model so that sessions for more than one row can be created
+  ModelInfo info;
+  InitNet(proj->net, proj->sess, model_path.c_str(), schedule_config_, false,
+          &info, session_cache_dir_);
+
+  proj->input_name = info.input_names[0];
+  proj->output_name = info.output_names[0];
+}
 
-  std::vector<std::string> empty;
-  std::shared_ptr<MNN::Express::Module> module(MNN::Express::Module::load(empty, empty, model_path));
-  if (nullptr == module.get()) {
-    fprintf(stderr, "Load MNN from %s Failed\n", model_path);
+void ZipformerModel::InitJoinerProjections(const ModelConfig &config) {
+  if (config.joiner_encoder_proj_mnn.empty() !=
+      config.joiner_decoder_proj_mnn.empty()) {
+    fprintf(stderr,
+            "Please provide both the joiner encoder and decoder projections "
+            "or neither of them\n");
+    exit(-1);
+  }
+
+  if (config.joiner_encoder_proj_mnn.empty()) {
     return;
   }
 
-  GetInputNames(module, joiner_input_names_);
-  GetOutputNames(module, joiner_output_names_);
+  InitProjection(config.joiner_encoder_proj_mnn, &joiner_encoder_proj_);
+  InitProjection(config.joiner_decoder_proj_mnn, &joiner_decoder_proj_);
+
+  has_joiner_projections_ = true;
+}
 
-  auto info = module->getInfo();
-  // MNN_ASSERT(info->inputNames.size() == info->inputs.size());
+void ZipformerModel::InitJoiner(const char* model_path, const MNN::ScheduleConfig& schedule_config) {
+  // Keep the model so that sessions for more than one row can be created
+  // later, e.g., for the speculative joiner of greedy search
+  ModelInfo info;
+  InitNet(joiner_net_, joiner_sess_, model_path, schedule_config, false,
+          &info, session_cache_dir_);
+
+  joiner_input_names_ = std::move(info.input_names);
+  joiner_output_names_ = std::move(info.output_names);
 #ifdef PRINT_MODEL_METADATA
-  if (!info->metaData.empty()) {
+  if (!info.meta_data.empty()) {
     fprintf(stderr, "\n------------ Decoder MetaData: Begin ------------\n");
-    for (auto& iter : info->metaData) {
+    for (auto& iter : info.meta_data) {
       fprintf(stderr, "[Meta] %s : %s\n", iter.first.c_str(), iter.second.c_str());
     }
     fprintf(stderr, "------------ Decoder MetaData: End ------------\n");
@@ -301,6 +541,70 @@ std::vector<TensorPtr> ZipformerModel::GetEncoderInitStates() const {
   }
 }
 
+std::vector<int32_t> ZipformerModel::GetEncoderStatesBatchDim() const {
+  std::vector<int32_t> ans;
+  if (model_type_ == "zipformer") {
+    // cached_len, cached_avg, cached_key, cached_val, cached_val2,
+    // cached_conv1, cached_conv2. See GetEncoderInitStates1()
+    int32_t n = static_cast<int32_t>(num_encoder_layers_.size());
+    for (int32_t dim : {1, 1, 2, 2, 2, 1, 1}) {
+      ans.insert(ans.end(), n, dim);
+    }
+  } else if (model_type_ == "zipformer2") {
+    // cached_key, cached_nonlin_attn, cached_val1, cached_val2,
+    // cached_conv1, cached_conv2 for each layer, followed by embed_states
+    // and processed_lens. See GetEncoderInitStates2()
+    int32_t m = std::accumulate(num_encoder_layers_.begin(), num_encoder_layers_.end(), 0);
+    for (int32_t i = 0; i != m; ++i) {
+      ans.insert(ans.end(), {1, 1, 1, 1, 0, 0});
+    }
+    ans.push_back(0);
+    ans.push_back(0);
+  }
+  return ans;
+}
+
+std::vector<TensorPtr> ZipformerModel::StackStates(
+    const std::vector<std::vector<TensorPtr>> &states) const {
+  if (states.size() == 1) {
+    return states[0];
+  }
+
+  std::vector<int32_t> batch_dim = GetEncoderStatesBatchDim();
+  int32_t batch_size = static_cast<int32_t>(states.size());
+  int32_t num_states = static_cast<int32_t>(states[0].size());
+
+  std::vector<TensorPtr> ans(num_states);
+  std::vector<TensorPtr> buf(batch_size);
+  for (int32_t i = 0; i != num_states; ++i) {
+    for (int32_t n = 0; n != batch_size; ++n) {
+      buf[n] = states[n][i];
+    }
+    ans[i] = Cat(buf, batch_dim[i]);
+  }
+
+  return ans;
+}
+
+std::vector<std::vector<TensorPtr>> ZipformerModel::UnStackStates(
+    const std::vector<TensorPtr> &states) const {
+  std::vector<int32_t> batch_dim = GetEncoderStatesBatchDim();
+  int32_t batch_size = states[0]->shape()[batch_dim[0]];
+  if (batch_size == 1) {
+    return {states};
+  }
+
+  std::vector<std::vector<TensorPtr>> ans(batch_size);
+  for (size_t i = 0; i != states.size(); ++i) {
+    std::vector<TensorPtr> v = Unbind(states[i], batch_dim[i]);
+    for (int32_t n = 0; n != batch_size; ++n) {
+      ans[n].push_back(std::move(v[n]));
+    }
+  }
+
+  return ans;
+}
+
 // see
 // https://github.com/k2-fsa/icefall/blob/master/egs/librispeech/ASR/pruned_transducer_stateless7_streaming/zipformer.py#L673
 std::vector<TensorPtr> ZipformerModel::GetEncoderInitStates1() const {
@@ -6,6 +6,7 @@
 #ifndef SHERPA_DEPLOY_MNN_ZIPFORMER_MODEL_H_
 #define SHERPA_DEPLOY_MNN_ZIPFORMER_MODEL_H_
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -31,11 +32,23 @@ class ZipformerModel : public Model {
 
   std::vector<TensorPtr> GetEncoderInitStates() const override;
 
+  std::vector<TensorPtr> StackStates(
+      const std::vector<std::vector<TensorPtr>> &states) const override;
+
+  std::vector<std::vector<TensorPtr>> UnStackStates(
+      const std::vector<TensorPtr> &states) const override;
+
   std::pair<TensorPtr, std::vector<TensorPtr>> RunEncoder(
       TensorPtr features, const std::vector<TensorPtr>& states) override;
 
+  TensorPtr RunEncoder(TensorPtr features, StateArena *arena) override;
+
   TensorPtr RunDecoder(TensorPtr decoder_input) override;
 
+  TensorPtr ProjectEncoderOut(TensorPtr encoder_out) override;
+
+  TensorPtr ProjectDecoderOut(TensorPtr decoder_out) override;
+
   TensorPtr RunJoiner(TensorPtr encoder_out, TensorPtr decoder_out) override;
 
   int32_t Segment() const override {
@@ -53,6 +66,7 @@ class ZipformerModel : public Model {
   void InitEncoder(const char* model_path, const MNN::ScheduleConfig& schedule_config);
   void InitDecoder(const char* model_path, const MNN::ScheduleConfig& schedule_config);
   void InitJoiner(const char* model_path, const MNN::ScheduleConfig& schedule_config);
+  void InitJoinerProjections(const ModelConfig &config);
 
 #if __ANDROID_API__ >= 9
   void InitEncoder(AAssetManager *mgr, const std::string &encoder_param,
@@ -66,14 +80,80 @@ class ZipformerModel : public Model {
   std::vector<TensorPtr> GetEncoderInitStates1() const;
   std::vector<TensorPtr> GetEncoderInitStates2() const;
 
+  // Return the batch dim of each encoder state
+  std::vector<int32_t> GetEncoderStatesBatchDim() const;
+
+  // Return an encoder session whose inputs are resized to match the given
+  // batched features and states. Sessions are cached per batch size.
+  MNN::Session *GetEncoderSession(TensorPtr features,
+                                  const std::vector<TensorPtr> &states);
+
+  // Return a decoder session whose input is resized to
+  // (batch_size, context_size). Sessions are cached per batch size.
+  MNN::Session *GetDecoderSession(int32_t batch_size);
+
+  // Return a joiner session whose inputs are resized to the shapes of
+  // encoder_out and decoder_out. Sessions are cached per pair of row counts
+  // in a SessionCache.
+  MNN::Session *GetJoinerSession(TensorPtr encoder_out, TensorPtr decoder_out);
+
+  // Sessions of one interpreter for inputs of different shapes. Only the
+  // most recently used ones are kept, so that inputs with many different
+  // numbers of rows do not create sessions without bound.
+  class SessionCache {
+   public:
+    // Return the session for key, or nullptr if it is not cached
+    MNN::Session *Get(int64_t key);
+
+    // Add the session of net for key. If the cache is full, the least
+    // recently used session is released.
+    void Put(MNN::Interpreter *net, int64_t key, MNN::Session *sess);
+
+   private:
+    // The most recently used one is at the end
+    std::vector<std::pair<int64_t, MNN::Session *>> sessions_;
+  };
+
+  // A joiner projection, i.e., a linear layer with a single input and a
+  // single output
+  struct Projection {
+    std::unique_ptr<MNN::Interpreter> net;
+    MNN::Session *sess = nullptr;  // one row
+    SessionCache batch_sess;  // more rows, keyed by num_rows
+    std::string input_name;
+    std::string output_name;
+  };
+
+  void InitProjection(const std::string &model_path, Projection *proj);
+
+  // Run proj on num_rows rows of dim floats starting at p and return a
+  // Tensor of shape (num_rows, out_dim). Sessions are cached per num_rows
+  // in a SessionCache.
+  TensorPtr RunProjection(Projection *proj, const float *p, int32_t num_rows,
+                          int32_t dim);
+
  private:
   std::unique_ptr<MNN::Interpreter> encoder_net_;
   std::unique_ptr<MNN::Interpreter> decoder_net_;
   std::unique_ptr<MNN::Interpreter> joiner_net_;
 
-  MNN::Session* encoder_sess_ = nullptr;
-  MNN::Session* decoder_sess_ = nullptr;
-  MNN::Session* joiner_sess_ = nullptr;
+  MNN::Session* encoder_sess_ = nullptr;  // batch size 1
+  std::unordered_map<int32_t, MNN::Session*> batch_encoder_sess_;  // batch size > 1
+  MNN::Session* decoder_sess_ = nullptr;  // batch size 1
+  std::unordered_map<int32_t, MNN::Session*> batch_decoder_sess_;  // batch size > 1
+  MNN::Session* joiner_sess_ = nullptr;  // one row each
+  // keyed by (encoder rows << 32 | decoder rows)
+  SessionCache batch_joiner_sess_;
+
+  // Used only if has_joiner_projections_ is true. joiner_net_ is then the
+  // output layer of the joiner, i.e., tanh followed by a linear layer.
+  Projection joiner_encoder_proj_;
+  Projection joiner_decoder_proj_;
+  bool has_joiner_projections_ = false;
+
+  MNN::ScheduleConfig schedule_config_;
+  MNN::BackendConfig backend_config_;  // schedule_config_ points to it
+  std::string session_cache_dir_;
 
   std::string model_type_ = "zipformer"; 
 
@@ -33,6 +33,14 @@ struct DecoderConfig {
 
   int32_t num_active_paths = 4;  // only used by modified beam search
 
+  // only used by greedy search. If true, the joiner is run on all the
+  // remaining frames of a chunk at once, assuming the decoder output does
+  // not change, and only re-run after a non-blank token is emitted.
+  // The result is the same as running it frame by frame. It is off by
+  // default since a chunk of T frames with many non-blank tokens costs up
+  // to T * (T + 1) / 2 joiner rows instead of T.
+  bool speculative_joiner = false;
+
   DecoderConfig() = default;
 
   DecoderConfig(const std::string &method, int32_t num_active_paths)
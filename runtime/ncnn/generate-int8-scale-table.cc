@@ -599,6 +599,7 @@ int QuantNet::quantize_KL(const std::vector<std::string> &wave_filenames) {
     }
 
     ncnn::Mat decoder_out = model->RunDecoder(decoder_input);
+    decoder_out = model->ProjectDecoderOut(decoder_out);
 
     std::vector<ncnn::Mat> states;
     ncnn::Mat encoder_out;
@@ -620,6 +621,10 @@ int QuantNet::quantize_KL(const std::vector<std::string> &wave_filenames) {
       std::tie(encoder_out, states) =
           model->RunEncoder(features, states, &encoder_ex);
 
+      // The joiner takes the projected outputs if the model has separate
+      // joiner projections. Otherwise they are returned unchanged.
+      encoder_out = model->ProjectEncoderOut(encoder_out);
+
       for (int j = 0; j < encoder_conv_bottom_blob_count; j++) {
         ncnn::Mat out;
         encoder_ex.extract(encoder_conv_bottom_blobs[j], out);
@@ -682,6 +687,7 @@ int QuantNet::quantize_KL(const std::vector<std::string> &wave_filenames) {
           hyp.push_back(y);
 
           decoder_out = model->RunDecoder(decoder_input);
+          decoder_out = model->ProjectDecoderOut(decoder_out);
         }
       }  // for (int32_t t = 0; t != encoder_out.h; ++t)
 
@@ -734,6 +740,7 @@ int QuantNet::quantize_KL(const std::vector<std::string> &wave_filenames) {
     }
 
     ncnn::Mat decoder_out = model->RunDecoder(decoder_input);
+    decoder_out = model->ProjectDecoderOut(decoder_out);
 
     std::vector<ncnn::Mat> states;
     ncnn::Mat encoder_out;
@@ -755,6 +762,10 @@ int QuantNet::quantize_KL(const std::vector<std::string> &wave_filenames) {
       std::tie(encoder_out, states) =
           model->RunEncoder(features, states, &encoder_ex);
 
+      // The joiner takes the projected outputs if the model has separate
+      // joiner projections. Otherwise they are returned unchanged.
+      encoder_out = model->ProjectEncoderOut(encoder_out);
+
       for (int j = 0; j < encoder_conv_bottom_blob_count; j++) {
         ncnn::Mat out;
         encoder_ex.extract(encoder_conv_bottom_blobs[j], out);
@@ -839,6 +850,7 @@ int QuantNet::quantize_KL(const std::vector<std::string> &wave_filenames) {
           hyp.push_back(y);
 
           decoder_out = model->RunDecoder(decoder_input);
+          decoder_out = model->ProjectDecoderOut(decoder_out);
         }
       }  // for (int32_t t = 0; t != encoder_out.h; ++t)
 
@@ -989,12 +1001,18 @@ static void ShowUsage() {
       "encoder.bin decoder.param decoder.bin joiner.param joiner.bin "
       "encoder-scale-table.txt joiner-scale-table.txt wave_filenames.txt\n\n"
       "Each line in wave_filenames.txt is a path to some 16k Hz mono wave "
-      "file.\n");
+      "file.\n\n"
+      "If the joiner is exported as two projections and an output layer, "
+      "pass the output layer as joiner.param/joiner.bin and append\n"
+      "joiner-encoder-proj.param joiner-encoder-proj.bin "
+      "joiner-decoder-proj.param joiner-decoder-proj.bin\n"
+      "The joiner scale table is computed for the output layer.\n");
 }
 
 int main(int argc, char **argv) {
-  if (argc != 10) {
-    fprintf(stderr, "Please provide 10 arg. Currently given: %d\n", argc);
+  if (argc != 10 && argc != 14) {
+    fprintf(stderr, "Please provide 10 or 14 args. Currently given: %d\n",
+            argc);
 
     ShowUsage();
     return 1;
@@ -1010,6 +1028,13 @@ int main(int argc, char **argv) {
   config.joiner_param = argv[5];
   config.joiner_bin = argv[6];
 
+  if (argc == 14) {
+    config.joiner_encoder_proj_param = argv[10];
+    config.joiner_encoder_proj_bin = argv[11];
+    config.joiner_decoder_proj_param = argv[12];
+    config.joiner_decoder_proj_bin = argv[13];
+  }
+
   const char *encoder_scale_table = argv[7];
   const char *joiner_scale_table = argv[8];
   std::vector<std::string> wave_filenames = ReadWaveFilenames(argv[9]);
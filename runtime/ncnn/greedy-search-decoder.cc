@@ -18,6 +18,7 @@
  */
 #include "greedy-search-decoder.h"
 
+#include <algorithm>
 #include <vector>
 
 namespace sherpa_ncnn {
@@ -52,34 +53,62 @@ void GreedySearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
 }
 
 void GreedySearchDecoder::Decode(ncnn::Mat encoder_out, DecoderResult *result) {
-  // TODO(fangjun): Cache the result of decoder_out
+  // Project all frames of this chunk at once. result->decoder_out is kept
+  // projected so that it is computed only once per new token.
+  encoder_out = model_->ProjectEncoderOut(encoder_out);
+
   ncnn::Mat decoder_out = result->decoder_out;
   if (decoder_out.empty()) {
     ncnn::Mat decoder_input = BuildDecoderInput(*result);
     decoder_out = model_->RunDecoder(decoder_input);
+    decoder_out = model_->ProjectDecoderOut(decoder_out);
   }
 
   int32_t frame_offset = result->frame_offset;
-  for (int32_t t = 0; t != encoder_out.h; ++t) {
-    ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
-    ncnn::Mat joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
-
-    const float *joiner_out_ptr = joiner_out.row(0);
-
-    auto new_token = static_cast<int32_t>(std::distance(
-        joiner_out_ptr,
-        std::max_element(joiner_out_ptr, joiner_out_ptr + joiner_out.w)));
-
-    // the blank ID is fixed to 0
-    if (new_token != 0 && new_token != 2) {
-      result->tokens.push_back(new_token);
-      ncnn::Mat decoder_input = BuildDecoderInput(*result);
-      decoder_out = model_->RunDecoder(decoder_input);
-      result->num_trailing_blanks = 0;
-      result->timestamps.push_back(t + frame_offset);
+  int32_t t = 0;
+  while (t != encoder_out.h) {
+    // decoder_out changes only after a non-blank token, so the joiner
+    // outputs of the remaining frames are valid up to and including the
+    // first non-blank one. Rows after it are thrown away.
+    int32_t n = speculative_joiner_ ? encoder_out.h - t : 1;
+
+    ncnn::Mat joiner_out;
+    if (n == 1) {
+      ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
+      joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
     } else {
+      // Rows [t, t + n) share the memory of encoder_out. The joiner
+      // broadcasts the single decoder_out row to all of them, as it does
+      // for the single encoder_out row in modified beam search.
+      ncnn::Mat encoder_out_t(encoder_out.w, n, encoder_out.row(t));
+      ncnn::Mat decoder_out_t(decoder_out.w, 1, decoder_out.data);
+      joiner_out = model_->RunJoiner(encoder_out_t, decoder_out_t);
+    }
+
+    int32_t k = 0;
+    while (k != n) {
+      const float *joiner_out_ptr = joiner_out.row(k);
+      ++k;
+
+      auto new_token = static_cast<int32_t>(std::distance(
+          joiner_out_ptr,
+          std::max_element(joiner_out_ptr, joiner_out_ptr + joiner_out.w)));
+
+      // the blank ID is fixed to 0
+      if (new_token != 0 && new_token != 2) {
+        result->tokens.push_back(new_token);
+        ncnn::Mat decoder_input = BuildDecoderInput(*result);
+        decoder_out = model_->RunDecoder(decoder_input);
+        decoder_out = model_->ProjectDecoderOut(decoder_out);
+        result->num_trailing_blanks = 0;
+        result->timestamps.push_back(t + k - 1 + frame_offset);
+        break;
+      }
+
       ++result->num_trailing_blanks;
     }
+
+    t += k;
   }
 
   result->frame_offset += encoder_out.h;
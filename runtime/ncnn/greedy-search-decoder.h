@@ -27,7 +27,8 @@ namespace sherpa_ncnn {
 
 class GreedySearchDecoder : public Decoder {
  public:
-  explicit GreedySearchDecoder(Model *model) : model_(model) {}
+  explicit GreedySearchDecoder(Model *model, bool speculative_joiner = false)
+      : model_(model), speculative_joiner_(speculative_joiner) {}
 
   DecoderResult GetEmptyResult() const override;
 
@@ -40,6 +41,7 @@ class GreedySearchDecoder : public Decoder {
 
  private:
   Model *model_;  // not owned
+  bool speculative_joiner_;
 };
 
 }  // namespace sherpa_ncnn
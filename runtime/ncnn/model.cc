@@ -39,6 +39,14 @@ std::string ModelConfig::ToString() const {
   os << "decoder_bin=\"" << decoder_bin << "\", ";
   os << "joiner_param=\"" << joiner_param << "\", ";
   os << "joiner_bin=\"" << joiner_bin << "\", ";
+  if (!joiner_encoder_proj_param.empty()) {
+    os << "joiner_encoder_proj_param=\"" << joiner_encoder_proj_param
+       << "\", ";
+    os << "joiner_encoder_proj_bin=\"" << joiner_encoder_proj_bin << "\", ";
+    os << "joiner_decoder_proj_param=\"" << joiner_decoder_proj_param
+       << "\", ";
+    os << "joiner_decoder_proj_bin=\"" << joiner_decoder_proj_bin << "\", ";
+  }
   os << "tokens=\"" << tokens << "\", ";
   os << "encoder num_threads=" << encoder_opt.num_threads << ", ";
   os << "decoder num_threads=" << decoder_opt.num_threads << ", ";
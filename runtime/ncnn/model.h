@@ -35,7 +35,16 @@ struct ModelConfig {
   std::string decoder_bin;    // path to decoder.ncnn.bin
   std::string joiner_param;   // path to joiner.ncnn.param
   std::string joiner_bin;     // path to joiner.ncnn.bin
-  std::string tokens;         // path to tokens.txt
+
+  // Optional. If the joiner is exported as an encoder projection, a decoder
+  // projection and an output layer, set the paths of the two projections
+  // here and let joiner_param/joiner_bin point to the output layer.
+  std::string joiner_encoder_proj_param;
+  std::string joiner_encoder_proj_bin;
+  std::string joiner_decoder_proj_param;
+  std::string joiner_decoder_proj_bin;
+
+  std::string tokens;  // path to tokens.txt
   bool use_vulkan_compute = true;
 
   ncnn::Option encoder_opt;
@@ -106,12 +115,46 @@ class Model {
   virtual ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
                                ncnn::Extractor *extractor) = 0;
 
-  /** Run the joiner network.
+  /** Run the encoder projection of the joiner.
+   *
+   * If the model has no separate joiner projections, encoder_out is
+   * returned unchanged.
+   *
+   * @param encoder_out  A mat of shape (num_frames, encoder_dim)
+   *
+   * @return Return a mat of shape (num_frames, joiner_dim)
+   */
+  virtual ncnn::Mat ProjectEncoderOut(ncnn::Mat &encoder_out) {
+    return encoder_out;
+  }
+
+  /** Run the decoder projection of the joiner.
+   *
+   * If the model has no separate joiner projections, decoder_out is
+   * returned unchanged.
    *
-   * @param encoder_out  A mat of shape (encoder_dim,)
    * @param decoder_out  A mat of shape (decoder_dim,)
    *
-   * @return Return the joiner output which is of shape (vocab_size,)
+   * @return Return a mat of shape (joiner_dim,)
+   */
+  virtual ncnn::Mat ProjectDecoderOut(ncnn::Mat &decoder_out) {
+    return decoder_out;
+  }
+
+  /** Run the joiner network.
+   *
+   * The inputs are the outputs of ProjectEncoderOut() and
+   * ProjectDecoderOut(), so that the projections can be computed once
+   * and reused across joiner calls.
+   *
+   * @param encoder_out  A mat of shape (encoder_dim,), or
+   *                     (num_frames, encoder_dim) to run several frames
+   *                     against the same decoder_out
+   * @param decoder_out  A mat of shape (decoder_dim,), or (1, decoder_dim)
+   *                     if encoder_out is 2-D
+   *
+   * @return Return the joiner output which is of shape (vocab_size,), or
+   *         (num_frames, vocab_size) if encoder_out has num_frames rows
    */
   virtual ncnn::Mat RunJoiner(ncnn::Mat &encoder_out,
                               ncnn::Mat &decoder_out) = 0;
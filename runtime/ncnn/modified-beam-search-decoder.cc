@@ -23,7 +23,7 @@
 #include <utility>
 #include <vector>
 
-#include "runtime/core/math.h"
+#include "runtime/core/log-softmax-topk.h"
 
 namespace sherpa_ncnn {
 
@@ -45,35 +45,24 @@ void ModifiedBeamSearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
   int32_t context_size = model_->ContextSize();
   auto hyp = r->hyps.GetMostProbable(true);
 
-  auto start = hyp.ys.begin() + context_size;
-  auto end = hyp.ys.end();
+  std::vector<int32_t> ys = hyp.Ys();
 
-  r->tokens = std::vector<int32_t>(start, end);
-  r->timestamps = std::move(hyp.timestamps);
+  r->tokens = std::vector<int32_t>(ys.begin() + context_size, ys.end());
+  r->timestamps = hyp.Timestamps();
   r->num_trailing_blanks = hyp.num_trailing_blanks;
 }
 
-// Compute log_softmax in-place.
-//
-// The log_softmax of each row is computed.
-//
-// @param in_out A 2-D tensor
-static void LogSoftmax(ncnn::Mat *in_out) {
-  int32_t h = in_out->h;
-  int32_t w = in_out->w;
-  for (int32_t y = 0; y != h; ++y) {
-    float *p = in_out->row(y);
-    SherpaDeploy::LogSoftmax(p, w);
-  }
-}
-
 // The decoder model contains an embedding layer, which only supports
 // 1-D output.
 // This is a wrapper to support 2-D decoder output.
 //
+// The output of each row is passed through the decoder projection of the
+// joiner, if any.
+//
 // @param model_ The NN model.
 // @param decoder_input A 2-D tensor of shape (num_active_paths, context_size)
-// @return Return a 2-D tensor of shape (num_active_paths, decoder_dim)
+// @return Return a 2-D tensor of shape (num_active_paths, decoder_dim), or
+//         (num_active_paths, joiner_dim) if the joiner has projections
 //
 // TODO(fangjun): Change Embed in ncnn to output 2-d tensors
 static ncnn::Mat RunDecoder2D(Model *model_, ncnn::Mat decoder_input) {
@@ -85,6 +74,7 @@ static ncnn::Mat RunDecoder2D(Model *model_, ncnn::Mat decoder_input) {
         ncnn::Mat(decoder_input.w, decoder_input.row(y));
 
     ncnn::Mat tmp = model_->RunDecoder(decoder_input_t);
+    tmp = model_->ProjectDecoderOut(tmp);
 
     if (y == 0) {
       decoder_out = ncnn::Mat(tmp.w, h);
@@ -107,8 +97,7 @@ ncnn::Mat ModifiedBeamSearchDecoder::BuildDecoderInput(
   auto p = static_cast<int32_t *>(decoder_input);
 
   for (const auto &hyp : hyps) {
-    const auto &ys = hyp.ys;
-    std::copy(ys.end() - context_size, ys.end(), p);
+    hyp.LastTokens(context_size, p);
     p += context_size;
   }
 
@@ -124,6 +113,15 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
                                        DecoderResult *result) {
   int32_t context_size = model_->ContextSize();
   SherpaDeploy::Hypotheses cur = std::move(result->hyps);
+
+  // Project all frames of this chunk at once
+  encoder_out = model_->ProjectEncoderOut(encoder_out);
+
+  // Reused across frames so that selecting the best paths does not allocate
+  std::vector<float> prev_log_probs;
+  std::vector<int32_t> topk_index(num_active_paths_);
+  std::vector<float> topk_score(num_active_paths_);
+
   /* encoder_out.w == encoder_out_dim, encoder_out.h == num_frames. */
   for (int32_t t = 0; t != encoder_out.h; ++t) {
     std::vector<SherpaDeploy::Hypothesis> prev = cur.GetTopK(num_active_paths_, true);
@@ -131,7 +129,7 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
 
     ncnn::Mat decoder_input = BuildDecoderInput(prev);
     ncnn::Mat decoder_out;
-    if (t == 0 && prev.size() == 1 && prev[0].ys.size() == context_size &&
+    if (t == 0 && prev.size() == 1 && prev[0].NumTokens() == context_size &&
         !result->decoder_out.empty()) {
       // When an endpoint is detected, we keep the decoder_out
       decoder_out = result->decoder_out;
@@ -146,26 +144,21 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
     ncnn::Mat joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
     // joiner_out.w == vocab_size
     // joiner_out.h == num_active_paths
-    LogSoftmax(&joiner_out);
-
-    float *p_joiner_out = joiner_out;
-
-    for (int32_t i = 0; i != joiner_out.h; ++i) {
-      float prev_log_prob = prev[i].log_prob;
-      for (int32_t k = 0; k != joiner_out.w; ++k, ++p_joiner_out) {
-        *p_joiner_out += prev_log_prob;
-      }
+    prev_log_probs.resize(prev.size());
+    for (size_t i = 0; i != prev.size(); ++i) {
+      prev_log_probs[i] = prev[i].log_prob;
     }
 
-    auto topk = SherpaDeploy::TopkIndex(static_cast<float *>(joiner_out),
-                          joiner_out.w * joiner_out.h, num_active_paths_);
+    // log_softmax of each row plus the log_prob of its path
+    int32_t num_topk = SherpaDeploy::LogSoftmaxTopK(
+        static_cast<const float *>(joiner_out), joiner_out.h, joiner_out.w,
+        prev_log_probs.data(),
+        num_active_paths_, topk_index.data(), topk_score.data());
 
     int32_t frame_offset = result->frame_offset;
-    for (auto i : topk) {
-      int32_t hyp_index = i / joiner_out.w;
-      int32_t new_token = i % joiner_out.w;
-
-      const float *p = joiner_out.row(hyp_index);
+    for (int32_t j = 0; j != num_topk; ++j) {
+      int32_t hyp_index = topk_index[j] / joiner_out.w;
+      int32_t new_token = topk_index[j] % joiner_out.w;
 
       SherpaDeploy::Hypothesis new_hyp = prev[hyp_index];
       // const float prev_lm_log_prob = new_hyp.lm_log_prob;
@@ -173,9 +166,8 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
       auto context_state = new_hyp.context_state;
       // blank id is fixed to 0
       if (new_token != 0 && new_token != 2) {
-        new_hyp.ys.push_back(new_token);
+        new_hyp.Append(new_token, t + frame_offset);
         new_hyp.num_trailing_blanks = 0;
-        new_hyp.timestamps.push_back(t + frame_offset);
         if (s && s->GetContextGraph()) {
           auto context_res = s->GetContextGraph()->ForwardOneStep(
               context_state, new_token, false /*strict_mode*/);
@@ -185,8 +177,8 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
       } else {
         ++new_hyp.num_trailing_blanks;
       }
-      // We have already added prev[hyp_index].log_prob to p[new_token]
-      new_hyp.log_prob = p[new_token] + context_score;
+      // topk_score[j] already includes prev[hyp_index].log_prob
+      new_hyp.log_prob = topk_score[j] + context_score;
 
       cur.Add(std::move(new_hyp));
     }
@@ -198,9 +190,10 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
 
   // set decoder_out in case of endpointing
   ncnn::Mat decoder_input = BuildDecoderInput({hyp});
-  result->decoder_out = model_->RunDecoder(decoder_input);
+  ncnn::Mat decoder_out = model_->RunDecoder(decoder_input);
+  result->decoder_out = model_->ProjectDecoderOut(decoder_out);
 
-  result->tokens = std::move(hyp.ys);
+  result->tokens = hyp.Ys();
   result->num_trailing_blanks = hyp.num_trailing_blanks;
 }
 
@@ -19,8 +19,10 @@
 
 #include "recognizer.h"
 
+#include <atomic>
 #include <fstream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -101,7 +103,8 @@ class Recognizer::Impl {
         endpoint_(config.endpoint_config),
         sym_(config.model_config.tokens) {
     if (config.decoder_config.method == "greedy_search") {
-      decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
+      decoder_ = std::make_unique<GreedySearchDecoder>(
+          model_.get(), config.decoder_config.speculative_joiner);
     } else if (config.decoder_config.method == "modified_beam_search") {
       decoder_ = std::make_unique<ModifiedBeamSearchDecoder>(
           model_.get(), config.decoder_config.num_active_paths);
@@ -122,7 +125,8 @@ class Recognizer::Impl {
         endpoint_(config.endpoint_config),
         sym_(mgr, config.model_config.tokens) {
     if (config.decoder_config.method == "greedy_search") {
-      decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
+      decoder_ = std::make_unique<GreedySearchDecoder>(
+          model_.get(), config.decoder_config.speculative_joiner);
     } else if (config.decoder_config.method == "modified_beam_search") {
       decoder_ = std::make_unique<ModifiedBeamSearchDecoder>(
           model_.get(), config.decoder_config.num_active_paths);
@@ -138,7 +142,12 @@ class Recognizer::Impl {
 #endif
 
   std::unique_ptr<Stream> CreateStream() const {
-    if (hotwords_.empty()) {
+    // Streams share the graph and keep it alive even if SetHotwords()
+    // swaps in a new one while they are running.
+    SherpaDeploy::ContextGraphPtr context_graph =
+        std::atomic_load(&context_graph_);
+
+    if (!context_graph) {
       auto stream = std::make_unique<Stream>(config_.feat_config);
       stream->SetResult(decoder_->GetEmptyResult());
       stream->SetStates(model_->GetEncoderInitStates());
@@ -146,17 +155,12 @@ class Recognizer::Impl {
     } else {
       auto r = decoder_->GetEmptyResult();
 
-      auto context_graph =
-          std::make_shared<SherpaDeploy::ContextGraph>(hotwords_, config_.hotwords_score);
-
       auto stream =
           std::make_unique<Stream>(config_.feat_config, context_graph);
 
-      if (stream->GetContextGraph()) {
-        // r.hyps has only one element.
-        for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
-          it->second.context_state = stream->GetContextGraph()->Root();
-        }
+      // r.hyps has only one element.
+      for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
+        it->second.context_state = context_graph->Root();
       }
 
       stream->SetResult(r);
@@ -166,6 +170,42 @@ class Recognizer::Impl {
     }
   }
 
+  bool SetHotwords(const std::string &hotwords) {
+    if (config_.decoder_config.method != "modified_beam_search") {
+      NCNN_LOGE("Hotwords are only supported by modified_beam_search, "
+                "current method is %s", config_.decoder_config.method.c_str());
+      return false;
+    }
+
+    std::istringstream is(hotwords);
+    std::vector<std::vector<int32_t>> hotwords_ids;
+    std::vector<float> boost_scores;
+    if (!EncodeHotwords(is, &hotwords_ids, &boost_scores)) {
+      return false;
+    }
+
+    // Streams created before this call keep decoding with the old graph.
+    std::atomic_store(&context_graph_,
+                      BuildContextGraph(hotwords_ids, boost_scores));
+    return true;
+  }
+
+  bool SaveHotwords(const std::string &filename) const {
+    SherpaDeploy::ContextGraphPtr context_graph =
+        std::atomic_load(&context_graph_);
+    if (!context_graph) {
+      fprintf(stderr, "There are no hotwords to save\n");
+      return false;
+    }
+
+    if (!context_graph->Save(filename)) {
+      fprintf(stderr, "Failed to write hotwords to %s\n", filename.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
   bool IsReady(Stream *s) const {
     return s->GetNumProcessedFrames() + model_->Segment() < s->NumFramesReady();
   }
@@ -174,18 +214,13 @@ class Recognizer::Impl {
     int32_t segment = model_->Segment();
     int32_t offset = model_->Offset();
 
-    auto frames_out = s->GetFrames(s->GetNumProcessedFrames(), segment);
-    std::vector<float> features_vec = std::get<0>(frames_out);
-    int32_t feature_dim = std::get<1>(frames_out);
+    int32_t feature_dim = config_.feat_config.feature_dim;
 
+    // A 2-D ncnn::Mat is contiguous, row i at features.row(i)
     ncnn::Mat features;
     features.create(feature_dim, segment);
-    float* p = features_vec.data();
-
-    for (int32_t i = 0; i != segment; ++i) {
-      std::copy(p, p + feature_dim, features.row(i));
-      p += feature_dim;
-    }
+    s->GetFrames(s->GetNumProcessedFrames(), segment,
+                 static_cast<float *>(features.data));
 
     s->GetNumProcessedFrames() += offset;
     std::vector<ncnn::Mat> states = s->GetStates();
@@ -274,6 +309,11 @@ class Recognizer::Impl {
 #endif
 
   void InitHotwords() {
+    // A graph written by ContextGraph::Save() is mapped as is; its scores
+    // were fixed when it was saved.
+    context_graph_ = SherpaDeploy::ContextGraph::Load(config_.hotwords_file);
+    if (context_graph_) return;
+
     // each line in hotwords_file contains space-separated words
 
     std::ifstream is(config_.hotwords_file);
@@ -286,6 +326,18 @@ class Recognizer::Impl {
   }
 
   void InitHotwords(std::istream &is) {
+    std::vector<std::vector<int32_t>> hotwords;
+    std::vector<float> boost_scores;
+    if (!EncodeHotwords(is, &hotwords, &boost_scores)) {
+      exit(-1);
+    }
+    context_graph_ = BuildContextGraph(hotwords, boost_scores);
+  }
+
+  // Return false if some word in `is` is not in the symbol table.
+  bool EncodeHotwords(std::istream &is,
+                      std::vector<std::vector<int32_t>> *hotwords,
+                      std::vector<float> *boost_scores) const {
     std::vector<int32_t> tmp;
     std::string line;
     std::string word;
@@ -312,13 +364,23 @@ class Recognizer::Impl {
                 "the "
                 "same line are separated by spaces)",
                 word.c_str(), line.c_str());
-            exit(-1);
+            return false;
           }
         }
       }
-      hotwords_.push_back(std::move(tmp));
-      boost_scores_.push_back(tmp_score);
+      hotwords->push_back(std::move(tmp));
+      boost_scores->push_back(tmp_score);
     }
+    return true;
+  }
+
+  // Returns nullptr for an empty list so that streams skip context biasing.
+  SherpaDeploy::ContextGraphPtr BuildContextGraph(
+      const std::vector<std::vector<int32_t>> &hotwords,
+      const std::vector<float> &boost_scores) const {
+    if (hotwords.empty()) return nullptr;
+    return std::make_shared<SherpaDeploy::ContextGraph>(
+        hotwords, config_.hotwords_score, boost_scores);
   }
 
  private:
@@ -327,8 +389,9 @@ class Recognizer::Impl {
   std::unique_ptr<Decoder> decoder_;
   SherpaDeploy::Endpoint endpoint_;
   SherpaDeploy::SymbolTable sym_;
-  std::vector<std::vector<int32_t>> hotwords_;
-  std::vector<float> boost_scores_;
+  // Built once and shared by all streams, replaced atomically by
+  // SetHotwords().
+  SherpaDeploy::ContextGraphPtr context_graph_;
 };
 
 Recognizer::Recognizer(const RecognizerConfig &config)
@@ -345,6 +408,14 @@ std::unique_ptr<Stream> Recognizer::CreateStream() const {
   return impl_->CreateStream();
 }
 
+bool Recognizer::SetHotwords(const std::string &hotwords) {
+  return impl_->SetHotwords(hotwords);
+}
+
+bool Recognizer::SaveHotwords(const std::string &filename) const {
+  return impl_->SaveHotwords(filename);
+}
+
 bool Recognizer::IsReady(Stream *s) const { return impl_->IsReady(s); }
 
 void Recognizer::DecodeStream(Stream *s) const { impl_->DecodeStream(s); }
@@ -26,6 +26,7 @@
 #include "alsa.h"
 #include "display.h"
 #include "recognizer.h"
+#include "runtime/core/cli-utils.h"
 
 bool stop = false;
 
@@ -35,6 +36,15 @@ static void Handler(int sig) {
 };
 
 int main(int32_t argc, char *argv[]) {
+  std::string joiner_encoder_proj_param =
+      SherpaDeploy::TakeOption("joiner-encoder-proj-param", &argc, argv);
+  std::string joiner_encoder_proj_bin =
+      SherpaDeploy::TakeOption("joiner-encoder-proj-bin", &argc, argv);
+  std::string joiner_decoder_proj_param =
+      SherpaDeploy::TakeOption("joiner-decoder-proj-param", &argc, argv);
+  std::string joiner_decoder_proj_bin =
+      SherpaDeploy::TakeOption("joiner-decoder-proj-bin", &argc, argv);
+
   if (argc < 9 || argc > 11) {
     const char *usage = R"usage(
 Usage:
@@ -49,6 +59,13 @@ Usage:
     device_name \
     [num_threads] [decode_method, can be greedy_search/modified_beam_search] [hotwords_file] [hotwords_score]
 
+Optional, if the joiner is exported as two projections and an output layer.
+joiner.ncnn.{param,bin} is then the output layer:
+  --joiner-encoder-proj-param=/path/to/joiner_encoder_proj.ncnn.param
+  --joiner-encoder-proj-bin=/path/to/joiner_encoder_proj.ncnn.bin
+  --joiner-decoder-proj-param=/path/to/joiner_decoder_proj.ncnn.param
+  --joiner-decoder-proj-bin=/path/to/joiner_decoder_proj.ncnn.bin
+
 Please refer to
 https://k2-fsa.github.io/sherpa/ncnn/pretrained_models/index.html
 for a list of pre-trained models to download.
@@ -88,6 +105,10 @@ as the device_name.
   config.model_config.decoder_bin = argv[5];
   config.model_config.joiner_param = argv[6];
   config.model_config.joiner_bin = argv[7];
+  config.model_config.joiner_encoder_proj_param = joiner_encoder_proj_param;
+  config.model_config.joiner_encoder_proj_bin = joiner_encoder_proj_bin;
+  config.model_config.joiner_decoder_proj_param = joiner_decoder_proj_param;
+  config.model_config.joiner_decoder_proj_bin = joiner_decoder_proj_bin;
 
   const char *device_name = argv[8];
 
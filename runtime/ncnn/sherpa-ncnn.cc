@@ -26,9 +26,19 @@
 
 #include "net.h"  // NOLINT
 #include "recognizer.h"
+#include "runtime/core/cli-utils.h"
 #include "runtime/core/wave-reader.h"
 
 int32_t main(int32_t argc, char *argv[]) {
+  std::string joiner_encoder_proj_param =
+      SherpaDeploy::TakeOption("joiner-encoder-proj-param", &argc, argv);
+  std::string joiner_encoder_proj_bin =
+      SherpaDeploy::TakeOption("joiner-encoder-proj-bin", &argc, argv);
+  std::string joiner_decoder_proj_param =
+      SherpaDeploy::TakeOption("joiner-decoder-proj-param", &argc, argv);
+  std::string joiner_decoder_proj_bin =
+      SherpaDeploy::TakeOption("joiner-decoder-proj-bin", &argc, argv);
+
   if (argc < 9 || argc > 13) {
     const char *usage = R"usage(
 Usage:
@@ -42,6 +52,13 @@ Usage:
     /path/to/joiner.ncnn.bin \
     /path/to/foo.wav [num_threads] [decode_method, can be greedy_search/modified_beam_search] [hotwords_file] [hotwords_score]
 
+Optional, if the joiner is exported as two projections and an output layer.
+joiner.ncnn.{param,bin} is then the output layer:
+  --joiner-encoder-proj-param=/path/to/joiner_encoder_proj.ncnn.param
+  --joiner-encoder-proj-bin=/path/to/joiner_encoder_proj.ncnn.bin
+  --joiner-decoder-proj-param=/path/to/joiner_decoder_proj.ncnn.param
+  --joiner-decoder-proj-bin=/path/to/joiner_decoder_proj.ncnn.bin
+
 Please refer to
 https://k2-fsa.github.io/sherpa/ncnn/pretrained_models/index.html
 for a list of pre-trained models to download.
@@ -58,6 +75,10 @@ for a list of pre-trained models to download.
   config.model_config.decoder_bin = argv[5];
   config.model_config.joiner_param = argv[6];
   config.model_config.joiner_bin = argv[7];
+  config.model_config.joiner_encoder_proj_param = joiner_encoder_proj_param;
+  config.model_config.joiner_encoder_proj_bin = joiner_encoder_proj_bin;
+  config.model_config.joiner_decoder_proj_param = joiner_decoder_proj_param;
+  config.model_config.joiner_decoder_proj_bin = joiner_decoder_proj_bin;
   int32_t num_threads = 4;
   if (argc >= 10 && atoi(argv[9]) > 0) {
     num_threads = atoi(argv[9]);
@@ -83,6 +83,34 @@ class SileroVadModel::Impl {
 
     float prob = Run(samples, n);
 
+    return IsSpeech(prob);
+  }
+
+  void IsSpeechBatch(Impl **impls, const float **samples, int32_t batch_size,
+                     int32_t n, bool *is_speech) {
+    if (n != WindowSize()) {
+      NCNN_LOGE("n: %d != window_size: %d", n, WindowSize());
+      exit(-1);
+    }
+
+    // ncnn has no batch axis, so the windows of a batch share this net but
+    // run in separate extractors, each with the states of its model. The
+    // threads are spent across the windows, so each extractor uses a
+    // single thread instead of opt.num_threads nested threads.
+    std::vector<float> probs(batch_size);
+
+#pragma omp parallel for num_threads(model_.opt.num_threads)
+    for (int32_t i = 0; i < batch_size; ++i) {
+      probs[i] = RunV4(samples[i], n, &impls[i]->h_, &impls[i]->c_, 1);
+    }
+
+    for (int32_t i = 0; i != batch_size; ++i) {
+      is_speech[i] = impls[i]->IsSpeech(probs[i]);
+    }
+  }
+
+  // Update the speech state with the probability of the next window
+  bool IsSpeech(float prob) {
     float threshold = config_.threshold;
 
     current_sample_ += config_.window_size;
@@ -204,22 +232,26 @@ class SileroVadModel::Impl {
 
   float Run(const float *samples, int32_t n) {
     // TODO(fangjun): Support V5
-    return RunV4(samples, n);
+    return RunV4(samples, n, &h_, &c_, model_.opt.num_threads);
   }
 
-  float RunV4(const float *samples, int32_t n) {
+  // @param h, c The LSTM states. They are updated in-place.
+  // @param num_threads Number of threads of the extractor
+  float RunV4(const float *samples, int32_t n, ncnn::Mat *h, ncnn::Mat *c,
+              int32_t num_threads) const {
     ncnn::Mat x(n, 1, 1, const_cast<float *>(samples));
 
     ncnn::Extractor ex = model_.create_extractor();
+    ex.set_num_threads(num_threads);
 
     ex.input(input_indexes_[0], x);
-    ex.input(input_indexes_[1], h_);
-    ex.input(input_indexes_[2], c_);
+    ex.input(input_indexes_[1], *h);
+    ex.input(input_indexes_[2], *c);
 
     ncnn::Mat out;
     ex.extract(output_indexes_[0], out);
-    ex.extract(output_indexes_[1], h_);
-    ex.extract(output_indexes_[2], c_);
+    ex.extract(output_indexes_[1], *h);
+    ex.extract(output_indexes_[2], *c);
 
     float prob = out[0];
     return prob;
@@ -261,6 +293,17 @@ bool SileroVadModel::IsSpeech(const float *samples, int32_t n) {
   return impl_->IsSpeech(samples, n);
 }
 
+void SileroVadModel::IsSpeechBatch(SileroVadModel **models,
+                                   const float **samples, int32_t batch_size,
+                                   int32_t n, bool *is_speech) {
+  std::vector<Impl *> impls(batch_size);
+  for (int32_t i = 0; i != batch_size; ++i) {
+    impls[i] = models[i]->impl_.get();
+  }
+
+  impl_->IsSpeechBatch(impls.data(), samples, batch_size, n, is_speech);
+}
+
 int32_t SileroVadModel::WindowSize() const { return impl_->WindowSize(); }
 
 int32_t SileroVadModel::WindowShift() const { return impl_->WindowShift(); }
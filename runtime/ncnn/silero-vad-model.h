@@ -52,6 +52,22 @@ class SileroVadModel {
    */
   bool IsSpeech(const float *samples, int32_t n);
 
+  /**
+   * Run IsSpeech() on the next window of several models.
+   *
+   * It is equivalent to calling models[i]->IsSpeech(samples[i], n) for
+   * each i, but all windows are run with the network of this model.
+   * All models must be created from the same config as this model.
+   *
+   * @param models The models to update. It may contain this model.
+   * @param samples samples[i] is the window of models[i].
+   * @param batch_size Number of models.
+   * @param n Number of samples of each window.
+   * @param is_speech On return, is_speech[i] is the result of models[i].
+   */
+  void IsSpeechBatch(SileroVadModel **models, const float **samples,
+                     int32_t batch_size, int32_t n, bool *is_speech);
+
   // For silero vad V4, it is WindowShift().
   // For silero vad V5, it is WindowShift()+64 for 16kHz and
   //                          WindowShift()+32 for 8kHz
@@ -0,0 +1,166 @@
+// runtime/ncnn/test-greedy-search.cc
+//
+// Check that the speculative joiner of greedy search gives the same result
+// as running the joiner frame by frame, and report how many joiner calls
+// each mode needs per encoder chunk.
+//
+// It uses a fake model so no model files are needed.
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "runtime/ncnn/greedy-search-decoder.h"
+
+namespace sherpa_ncnn {
+
+// The joiner output of a frame is its encoder_out plus decoder_out, so the
+// encoder output directly holds the logits. The decoder penalizes the last
+// emitted token, which makes the result depend on decoder_out.
+class FakeModel : public Model {
+ public:
+  explicit FakeModel(int32_t vocab_size) : vocab_size_(vocab_size) {}
+
+  ncnn::Net &GetEncoder() override { return net_; }
+  ncnn::Net &GetDecoder() override { return net_; }
+  ncnn::Net &GetJoiner() override { return net_; }
+
+  std::vector<ncnn::Mat> GetEncoderInitStates() const override { return {}; }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states) override {
+    return {features, states};
+  }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
+      ncnn::Extractor * /*extractor*/) override {
+    return {features, states};
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input) override {
+    ncnn::Mat decoder_out(vocab_size_);
+    std::fill(decoder_out.row(0), decoder_out.row(0) + vocab_size_, 0.0f);
+
+    int32_t last = static_cast<int32_t *>(decoder_input)[decoder_input.w - 1];
+    if (last != 0) {
+      decoder_out.row(0)[last] = -10;
+    }
+    return decoder_out;
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
+                       ncnn::Extractor * /*extractor*/) override {
+    return RunDecoder(decoder_input);
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out,
+                      ncnn::Mat &decoder_out) override {
+    ++num_joiner_calls_;
+
+    int32_t num_rows = encoder_out.dims == 1 ? 1 : encoder_out.h;
+    ncnn::Mat joiner_out = encoder_out.dims == 1
+                               ? ncnn::Mat(vocab_size_)
+                               : ncnn::Mat(vocab_size_, num_rows);
+
+    const float *d = decoder_out.row(0);
+    for (int32_t r = 0; r != num_rows; ++r) {
+      const float *e = encoder_out.row(r);
+      float *out = joiner_out.row(r);
+      for (int32_t i = 0; i != vocab_size_; ++i) {
+        out[i] = e[i] + d[i];
+      }
+    }
+    return joiner_out;
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+                      ncnn::Extractor * /*extractor*/) override {
+    return RunJoiner(encoder_out, decoder_out);
+  }
+
+  int32_t Segment() const override { return 0; }
+  int32_t Offset() const override { return 0; }
+
+  int32_t num_joiner_calls_ = 0;
+
+ private:
+  ncnn::Net net_;
+  int32_t vocab_size_;
+};
+
+}  // namespace sherpa_ncnn
+
+int32_t main() {
+  const int32_t kVocabSize = 500;
+  const int32_t kNumChunks = 200;
+  const int32_t kFramesPerChunk = 16;
+  // Roughly the ratio of non-blank frames seen with real speech
+  const float kTokenProb = 0.15;
+
+  std::mt19937 gen(20231015);
+  std::uniform_real_distribution<float> uniform(0, 1);
+  std::uniform_int_distribution<int32_t> token(3, kVocabSize - 1);
+
+  std::vector<ncnn::Mat> chunks;
+  for (int32_t c = 0; c != kNumChunks; ++c) {
+    ncnn::Mat chunk(kVocabSize, kFramesPerChunk);
+    for (int32_t t = 0; t != kFramesPerChunk; ++t) {
+      float *p = chunk.row(t);
+      for (int32_t i = 0; i != kVocabSize; ++i) {
+        p[i] = uniform(gen);
+      }
+      p[0] = 2;
+      if (uniform(gen) < kTokenProb) {
+        p[token(gen)] = 5;
+      }
+    }
+    chunks.push_back(chunk);
+  }
+
+  std::vector<sherpa_ncnn::DecoderResult> results;
+  std::vector<int32_t> num_calls;
+  for (bool speculative : {false, true}) {
+    sherpa_ncnn::FakeModel model(kVocabSize);
+    sherpa_ncnn::GreedySearchDecoder decoder(&model, speculative);
+
+    sherpa_ncnn::DecoderResult r = decoder.GetEmptyResult();
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto &chunk : chunks) {
+      decoder.Decode(chunk, &r);
+    }
+    auto end = std::chrono::steady_clock::now();
+    float elapsed_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+            .count();
+
+    decoder.StripLeadingBlanks(&r);
+
+    fprintf(stderr,
+            "speculative_joiner=%d: %d tokens, %.2f joiner calls per chunk, "
+            "%.1f us per chunk\n",
+            speculative, static_cast<int32_t>(r.tokens.size()),
+            static_cast<float>(model.num_joiner_calls_) / kNumChunks,
+            elapsed_us / kNumChunks);
+
+    results.push_back(std::move(r));
+    num_calls.push_back(model.num_joiner_calls_);
+  }
+
+  assert(results[0].tokens == results[1].tokens);
+  assert(results[0].timestamps == results[1].timestamps);
+  assert(results[0].num_trailing_blanks == results[1].num_trailing_blanks);
+  assert(num_calls[0] == kNumChunks * kFramesPerChunk);
+  // One call per chunk plus one after each emitted token that is not the
+  // last frame of its chunk
+  assert(num_calls[1] <=
+         kNumChunks + static_cast<int32_t>(results[1].tokens.size()));
+
+  return 0;
+}
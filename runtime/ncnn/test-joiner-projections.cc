@@ -0,0 +1,250 @@
+// runtime/ncnn/test-joiner-projections.cc
+//
+// Check that greedy search and modified beam search give the same result
+// with a joiner exported as a whole and with a joiner exported as two
+// projections plus an output layer, i.e., that ProjectEncoderOut() and
+// ProjectDecoderOut() followed by the output layer equal the full joiner.
+//
+// It uses fake models so no model files are needed.
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "runtime/ncnn/greedy-search-decoder.h"
+#include "runtime/ncnn/modified-beam-search-decoder.h"
+
+namespace sherpa_ncnn {
+
+// Weights of the joiner
+//   linear(tanh(encoder_proj(e) + decoder_proj(d)))
+// and of the decoder, which embeds the last token.
+struct FakeWeights {
+  FakeWeights(int32_t encoder_dim, int32_t decoder_dim, int32_t joiner_dim,
+              int32_t vocab_size, std::mt19937 *gen)
+      : encoder_dim(encoder_dim),
+        decoder_dim(decoder_dim),
+        joiner_dim(joiner_dim),
+        vocab_size(vocab_size) {
+    std::normal_distribution<float> normal(0, 1);
+    auto init = [&](std::vector<float> *w, int32_t n) {
+      w->resize(n);
+      for (auto &x : *w) {
+        x = normal(*gen);
+      }
+    };
+
+    init(&encoder_proj, joiner_dim * encoder_dim);
+    init(&decoder_proj, joiner_dim * decoder_dim);
+    init(&output, vocab_size * joiner_dim);
+    init(&embedding, vocab_size * decoder_dim);
+  }
+
+  int32_t encoder_dim;
+  int32_t decoder_dim;
+  int32_t joiner_dim;
+  int32_t vocab_size;
+
+  std::vector<float> encoder_proj;  // (joiner_dim, encoder_dim)
+  std::vector<float> decoder_proj;  // (joiner_dim, decoder_dim)
+  std::vector<float> output;        // (vocab_size, joiner_dim)
+  std::vector<float> embedding;     // (vocab_size, decoder_dim)
+};
+
+// y[i] = sum_j w[i][j] * x[j]
+static void Linear(const std::vector<float> &w, const float *x, int32_t in_dim,
+                   int32_t out_dim, float *y) {
+  for (int32_t i = 0; i != out_dim; ++i) {
+    float sum = 0;
+    for (int32_t j = 0; j != in_dim; ++j) {
+      sum += w[i * in_dim + j] * x[j];
+    }
+    y[i] = sum;
+  }
+}
+
+// Apply linear to each row of a 1-D or 2-D mat
+static ncnn::Mat LinearRows(const std::vector<float> &w, ncnn::Mat &in,
+                            int32_t out_dim) {
+  ncnn::Mat out = in.dims == 1 ? ncnn::Mat(out_dim) : ncnn::Mat(out_dim, in.h);
+  for (int32_t r = 0; r != (in.dims == 1 ? 1 : in.h); ++r) {
+    Linear(w, in.row(r), in.w, out_dim, out.row(r));
+  }
+  return out;
+}
+
+class FakeModel : public Model {
+ public:
+  // If projected is true, the joiner is exported as two projections and an
+  // output layer. Otherwise, the joiner computes the projections itself.
+  FakeModel(const FakeWeights &weights, bool projected)
+      : w_(weights), projected_(projected) {}
+
+  ncnn::Net &GetEncoder() override { return net_; }
+  ncnn::Net &GetDecoder() override { return net_; }
+  ncnn::Net &GetJoiner() override { return net_; }
+
+  std::vector<ncnn::Mat> GetEncoderInitStates() const override { return {}; }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states) override {
+    return {features, states};
+  }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
+      ncnn::Extractor * /*extractor*/) override {
+    return {features, states};
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input) override {
+    int32_t last = static_cast<int32_t *>(decoder_input)[decoder_input.w - 1];
+
+    ncnn::Mat decoder_out(w_.decoder_dim);
+    const float *p = w_.embedding.data() + last * w_.decoder_dim;
+    std::copy(p, p + w_.decoder_dim, static_cast<float *>(decoder_out));
+    return decoder_out;
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
+                       ncnn::Extractor * /*extractor*/) override {
+    return RunDecoder(decoder_input);
+  }
+
+  ncnn::Mat ProjectEncoderOut(ncnn::Mat &encoder_out) override {
+    if (!projected_) {
+      return encoder_out;
+    }
+
+    ++num_projection_calls_;
+    return LinearRows(w_.encoder_proj, encoder_out, w_.joiner_dim);
+  }
+
+  ncnn::Mat ProjectDecoderOut(ncnn::Mat &decoder_out) override {
+    if (!projected_) {
+      return decoder_out;
+    }
+
+    ++num_projection_calls_;
+    return LinearRows(w_.decoder_proj, decoder_out, w_.joiner_dim);
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out,
+                      ncnn::Mat &decoder_out) override {
+    ncnn::Mat e = encoder_out;
+    ncnn::Mat d = decoder_out;
+    if (!projected_) {
+      e = LinearRows(w_.encoder_proj, encoder_out, w_.joiner_dim);
+      d = LinearRows(w_.decoder_proj, decoder_out, w_.joiner_dim);
+    }
+
+    // Either side may have a single row, which is broadcast to the other
+    int32_t e_rows = e.dims == 1 ? 1 : e.h;
+    int32_t d_rows = d.dims == 1 ? 1 : d.h;
+    int32_t num_rows = std::max(e_rows, d_rows);
+
+    ncnn::Mat joiner_out = encoder_out.dims == 1
+                               ? ncnn::Mat(w_.vocab_size)
+                               : ncnn::Mat(w_.vocab_size, num_rows);
+
+    std::vector<float> hidden(w_.joiner_dim);
+    for (int32_t r = 0; r != num_rows; ++r) {
+      const float *pe = e.row(e_rows == 1 ? 0 : r);
+      const float *pd = d.row(d_rows == 1 ? 0 : r);
+      for (int32_t i = 0; i != w_.joiner_dim; ++i) {
+        hidden[i] = tanhf(pe[i] + pd[i]);
+      }
+      Linear(w_.output, hidden.data(), w_.joiner_dim, w_.vocab_size,
+             joiner_out.row(r));
+    }
+
+    return joiner_out;
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+                      ncnn::Extractor * /*extractor*/) override {
+    return RunJoiner(encoder_out, decoder_out);
+  }
+
+  int32_t Segment() const override { return 0; }
+  int32_t Offset() const override { return 0; }
+
+  int32_t num_projection_calls_ = 0;
+
+ private:
+  ncnn::Net net_;
+  const FakeWeights &w_;
+  bool projected_;
+};
+
+}  // namespace sherpa_ncnn
+
+int32_t main() {
+  const int32_t kEncoderDim = 16;
+  const int32_t kDecoderDim = 12;
+  const int32_t kJoinerDim = 20;
+  const int32_t kVocabSize = 30;
+  const int32_t kNumChunks = 20;
+  const int32_t kFramesPerChunk = 16;
+
+  std::mt19937 gen(20250101);
+  sherpa_ncnn::FakeWeights weights(kEncoderDim, kDecoderDim, kJoinerDim,
+                                   kVocabSize, &gen);
+
+  std::normal_distribution<float> normal(0, 1);
+  std::vector<ncnn::Mat> chunks;
+  for (int32_t c = 0; c != kNumChunks; ++c) {
+    ncnn::Mat chunk(kEncoderDim, kFramesPerChunk);
+    for (int32_t t = 0; t != kFramesPerChunk; ++t) {
+      float *p = chunk.row(t);
+      for (int32_t i = 0; i != kEncoderDim; ++i) {
+        p[i] = normal(gen);
+      }
+    }
+    chunks.push_back(chunk);
+  }
+
+  for (const char *method : {"greedy_search", "modified_beam_search"}) {
+    std::vector<sherpa_ncnn::DecoderResult> results;
+    for (bool projected : {false, true}) {
+      sherpa_ncnn::FakeModel model(weights, projected);
+
+      std::unique_ptr<sherpa_ncnn::Decoder> decoder;
+      if (std::string(method) == "greedy_search") {
+        decoder = std::make_unique<sherpa_ncnn::GreedySearchDecoder>(&model);
+      } else {
+        decoder = std::make_unique<sherpa_ncnn::ModifiedBeamSearchDecoder>(
+            &model, 4);
+      }
+
+      sherpa_ncnn::DecoderResult r = decoder->GetEmptyResult();
+      for (auto &chunk : chunks) {
+        decoder->Decode(chunk, &r);
+      }
+      decoder->StripLeadingBlanks(&r);
+
+      fprintf(stderr, "%s, projected=%d: %d tokens, %d projection calls\n",
+              method, projected, static_cast<int32_t>(r.tokens.size()),
+              model.num_projection_calls_);
+
+      if (projected) {
+        assert(model.num_projection_calls_ > 0);
+      }
+
+      results.push_back(std::move(r));
+    }
+
+    assert(!results[0].tokens.empty());
+    assert(results[0].tokens == results[1].tokens);
+    assert(results[0].timestamps == results[1].timestamps);
+  }
+
+  return 0;
+}
@@ -0,0 +1,54 @@
+// runtime/ncnn/vad-batcher.h
+
+#ifndef SHERPA_NCNN_CSRC_VAD_BATCHER_H_
+#define SHERPA_NCNN_CSRC_VAD_BATCHER_H_
+
+#include <unordered_set>
+#include <vector>
+
+#include "voice-activity-detector.h"
+
+namespace sherpa_ncnn {
+
+// Run the VAD model of many VoiceActivityDetectors in one batch.
+//
+// Calling AcceptWaveform() on the batcher and then Run() gives every
+// detector the same segments as calling
+// VoiceActivityDetector::AcceptWaveform() on it directly, but the windows
+// at the same position of all detectors are run together with one net.
+//
+// All detectors must be created from the same SileroVadModelConfig. The
+// batcher does not own them.
+class VadBatcher {
+ public:
+  /* Queue samples for a detector. The samples are copied, but the model
+   * does not run until Run() is called.
+   *
+   * If samples of this detector are already queued, Run() is called first
+   * so that each call is processed as a separate
+   * VoiceActivityDetector::AcceptWaveform().
+   */
+  void AcceptWaveform(VoiceActivityDetector *vad, const float *samples,
+                      int32_t n);
+
+  // Run the model on all queued windows and update the speech segments
+  // of the detectors.
+  void Run();
+
+  // Number of detectors with queued windows
+  int32_t NumPending() const { return static_cast<int32_t>(pending_.size()); }
+
+ private:
+  struct Pending {
+    VoiceActivityDetector *vad;
+    int32_t num_windows;
+    bool is_speech;
+  };
+
+  std::vector<Pending> pending_;
+  std::unordered_set<VoiceActivityDetector *> pending_set_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_VAD_BATCHER_H_
@@ -43,6 +43,27 @@ class VoiceActivityDetector::Impl {
 #endif
 
   void AcceptWaveform(const float *samples, int32_t n) {
+    int32_t k = AddSamples(samples, n);
+    if (k == 0) {
+      return;
+    }
+
+    int32_t window_size = model_->WindowSize();
+    bool is_speech = false;
+
+    for (int32_t i = 0; i < k; ++i) {
+      // NOTE(fangjun): Please don't use a very large n.
+      bool this_window_is_speech = model_->IsSpeech(Window(i), window_size);
+      is_speech = is_speech || this_window_is_speech;
+    }
+
+    ConsumeWindows(k, is_speech);
+  }
+
+  // Append samples to the pending ones without running the model.
+  //
+  // @return Return the number of complete windows that can be run.
+  int32_t AddSamples(const float *samples, int32_t n) {
     if (buffer_.Size() > max_utterance_length_) {
       model_->SetMinSilenceDuration(new_min_silence_duration_s_);
       model_->SetThreshold(new_threshold_);
@@ -59,20 +80,30 @@ class VoiceActivityDetector::Impl {
     last_.insert(last_.end(), samples, samples + n);
 
     if (last_.size() < window_size) {
-      return;
+      return 0;
     }
 
     // Note: For v4, window_shift == window_size
-    int32_t k =
-        (static_cast<int32_t>(last_.size()) - window_size) / window_shift + 1;
-    const float *p = last_.data();
-    bool is_speech = false;
+    return (static_cast<int32_t>(last_.size()) - window_size) / window_shift +
+           1;
+  }
 
+  // The i-th pending window. It has model_->WindowSize() samples.
+  const float *Window(int32_t i) const {
+    return last_.data() + i * model_->WindowShift();
+  }
+
+  SileroVadModel *GetModel() const { return model_.get(); }
+
+  // Drop the first k pending windows after the model has been run on them
+  // and update the speech segments.
+  //
+  // @param is_speech True if the model detected speech in any of them.
+  void ConsumeWindows(int32_t k, bool is_speech) {
+    int32_t window_shift = model_->WindowShift();
+    const float *p = last_.data();
     for (int32_t i = 0; i < k; ++i, p += window_shift) {
       buffer_.Push(p, window_shift);
-      // NOTE(fangjun): Please don't use a very large n.
-      bool this_window_is_speech = model_->IsSpeech(p, window_size);
-      is_speech = is_speech || this_window_is_speech;
     }
 
     last_ = std::vector<float>(
@@ -213,4 +244,20 @@ const SileroVadModelConfig &VoiceActivityDetector::GetConfig() const {
   return impl_->GetConfig();
 }
 
+int32_t VoiceActivityDetector::AddSamples(const float *samples, int32_t n) {
+  return impl_->AddSamples(samples, n);
+}
+
+const float *VoiceActivityDetector::Window(int32_t i) const {
+  return impl_->Window(i);
+}
+
+SileroVadModel *VoiceActivityDetector::GetModel() const {
+  return impl_->GetModel();
+}
+
+void VoiceActivityDetector::ConsumeWindows(int32_t k, bool is_speech) {
+  impl_->ConsumeWindows(k, is_speech);
+}
+
 }  // namespace sherpa_ncnn
@@ -30,6 +30,8 @@
 
 namespace sherpa_ncnn {
 
+class SileroVadModel;
+
 struct SpeechSegment {
   int32_t start;  // in samples
   std::vector<float> samples;
@@ -64,6 +66,15 @@ class VoiceActivityDetector {
   const SileroVadModelConfig &GetConfig() const;
 
  private:
+  friend class VadBatcher;
+
+  // AcceptWaveform() split into steps so that VadBatcher can run the model
+  // of many detectors at once. See VoiceActivityDetector::Impl.
+  int32_t AddSamples(const float *samples, int32_t n);
+  const float *Window(int32_t i) const;
+  SileroVadModel *GetModel() const;
+  void ConsumeWindows(int32_t k, bool is_speech);
+
   class Impl;
   std::unique_ptr<Impl> impl_;
 };
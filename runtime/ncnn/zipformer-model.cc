@@ -39,6 +39,7 @@ ZipformerModel::ZipformerModel(const ModelConfig &config) {
   InitEncoder(config.encoder_param, config.encoder_bin);
   InitDecoder(config.decoder_param, config.decoder_bin);
   InitJoiner(config.joiner_param, config.joiner_bin);
+  InitJoinerProjections(config);
 
   InitEncoderInputOutputIndexes();
   InitDecoderInputOutputIndexes();
@@ -70,6 +71,7 @@ ZipformerModel::ZipformerModel(AAssetManager *mgr, const ModelConfig &config) {
   InitEncoder(mgr, config.encoder_param, config.encoder_bin);
   InitDecoder(mgr, config.decoder_param, config.decoder_bin);
   InitJoiner(mgr, config.joiner_param, config.joiner_bin);
+  InitJoinerProjections(mgr, config);
 
   InitEncoderInputOutputIndexes();
   InitDecoderInputOutputIndexes();
@@ -139,6 +141,32 @@ ncnn::Mat ZipformerModel::RunDecoder(ncnn::Mat &decoder_input,
   return decoder_out;
 }
 
+ncnn::Mat ZipformerModel::RunProjection(ncnn::Net &net, ncnn::Mat &in) {
+  ncnn::Extractor ex = net.create_extractor();
+  ex.input("in0", in);
+
+  ncnn::Mat out;
+  ex.extract("out0", out);
+  return out;
+}
+
+ncnn::Mat ZipformerModel::ProjectEncoderOut(ncnn::Mat &encoder_out) {
+  if (!has_joiner_projections_) {
+    return encoder_out;
+  }
+
+  return RunProjection(joiner_encoder_proj_, encoder_out);
+}
+
+ncnn::Mat ZipformerModel::ProjectDecoderOut(ncnn::Mat &decoder_out) {
+  if (!has_joiner_projections_) {
+    return decoder_out;
+  }
+
+  ncnn::Mat ans = RunProjection(joiner_decoder_proj_, decoder_out);
+  return ans.reshape(ans.w);
+}
+
 ncnn::Mat ZipformerModel::RunJoiner(ncnn::Mat &encoder_out,
                                     ncnn::Mat &decoder_out) {
   auto joiner_ex = joiner_.create_extractor();
@@ -211,6 +239,30 @@ void ZipformerModel::InitJoiner(const std::string &joiner_param,
   InitNet(joiner_, joiner_param, joiner_bin);
 }
 
+void ZipformerModel::InitJoinerProjections(const ModelConfig &config) {
+  if (config.joiner_encoder_proj_param.empty() !=
+      config.joiner_decoder_proj_param.empty()) {
+    NCNN_LOGE(
+        "Please provide both the joiner encoder and decoder projections or "
+        "neither of them");
+    exit(-1);
+  }
+
+  if (config.joiner_encoder_proj_param.empty()) {
+    return;
+  }
+
+  joiner_encoder_proj_.opt = joiner_.opt;
+  joiner_decoder_proj_.opt = joiner_.opt;
+
+  InitNet(joiner_encoder_proj_, config.joiner_encoder_proj_param,
+          config.joiner_encoder_proj_bin);
+  InitNet(joiner_decoder_proj_, config.joiner_decoder_proj_param,
+          config.joiner_decoder_proj_bin);
+
+  has_joiner_projections_ = true;
+}
+
 #if __ANDROID_API__ >= 9
 void ZipformerModel::InitEncoder(AAssetManager *mgr,
                                  const std::string &encoder_param,
@@ -231,6 +283,31 @@ void ZipformerModel::InitJoiner(AAssetManager *mgr,
                                 const std::string &joiner_bin) {
   InitNet(mgr, joiner_, joiner_param, joiner_bin);
 }
+
+void ZipformerModel::InitJoinerProjections(AAssetManager *mgr,
+                                           const ModelConfig &config) {
+  if (config.joiner_encoder_proj_param.empty() !=
+      config.joiner_decoder_proj_param.empty()) {
+    NCNN_LOGE(
+        "Please provide both the joiner encoder and decoder projections or "
+        "neither of them");
+    exit(-1);
+  }
+
+  if (config.joiner_encoder_proj_param.empty()) {
+    return;
+  }
+
+  joiner_encoder_proj_.opt = joiner_.opt;
+  joiner_decoder_proj_.opt = joiner_.opt;
+
+  InitNet(mgr, joiner_encoder_proj_, config.joiner_encoder_proj_param,
+          config.joiner_encoder_proj_bin);
+  InitNet(mgr, joiner_decoder_proj_, config.joiner_decoder_proj_param,
+          config.joiner_decoder_proj_bin);
+
+  has_joiner_projections_ = true;
+}
 #endif
 
 // see
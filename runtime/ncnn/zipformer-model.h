@@ -39,6 +39,10 @@ class ZipformerModel : public Model {
   ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
                        ncnn::Extractor *extractor) override;
 
+  ncnn::Mat ProjectEncoderOut(ncnn::Mat &encoder_out) override;
+
+  ncnn::Mat ProjectDecoderOut(ncnn::Mat &decoder_out) override;
+
   ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out) override;
 
   ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
@@ -66,6 +70,8 @@ class ZipformerModel : public Model {
   void InitJoiner(const std::string &joiner_param,
                   const std::string &joiner_bin);
 
+  void InitJoinerProjections(const ModelConfig &config);
+
   void InitEncoderPostProcessing();
 
 #if __ANDROID_API__ >= 9
@@ -75,17 +81,28 @@ class ZipformerModel : public Model {
                    const std::string &decoder_bin);
   void InitJoiner(AAssetManager *mgr, const std::string &joiner_param,
                   const std::string &joiner_bin);
+  void InitJoinerProjections(AAssetManager *mgr, const ModelConfig &config);
 #endif
 
   void InitEncoderInputOutputIndexes();
   void InitDecoderInputOutputIndexes();
   void InitJoinerInputOutputIndexes();
 
+  // Run a joiner projection network, which has a single input in0 and a
+  // single output out0
+  static ncnn::Mat RunProjection(ncnn::Net &net, ncnn::Mat &in);
+
  private:
   ncnn::Net encoder_;
   ncnn::Net decoder_;
   ncnn::Net joiner_;
 
+  // Used only if has_joiner_projections_ is true. joiner_ is then the
+  // output layer of the joiner, i.e., tanh followed by a linear layer.
+  ncnn::Net joiner_encoder_proj_;
+  ncnn::Net joiner_decoder_proj_;
+  bool has_joiner_projections_ = false;
+
   int32_t decode_chunk_length_ = 32;  // arg1, before subsampling
   int32_t num_left_chunks_ = 4;       // arg2
   int32_t pad_length_ = 7;            // arg3
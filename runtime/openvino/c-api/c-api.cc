@@ -23,6 +23,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "runtime/core/display.h"
 #include "runtime/openvino/model.h"
@@ -49,11 +50,19 @@ SherpaOVRecognizer *CreateRecognizer(
   config.model_config.encoder_xml = in_config->model_config.encoder_xml;
   config.model_config.decoder_xml = in_config->model_config.decoder_xml;
   config.model_config.joiner_xml = in_config->model_config.joiner_xml;
+  config.model_config.joiner_encoder_proj_xml =
+      SHERPA_DEPLOY_OR(in_config->model_config.joiner_encoder_proj_xml, "");
+  config.model_config.joiner_decoder_proj_xml =
+      SHERPA_DEPLOY_OR(in_config->model_config.joiner_decoder_proj_xml, "");
   config.model_config.tokens = in_config->model_config.tokens;
 
   config.model_config.device = in_config->model_config.device;
-  int32_t num_threads = SHERPA_DEPLOY_OR(in_config->model_config.num_threads, 1);
-  config.model_config.num_threads = num_threads;
+  // 0 is passed through. In THROUGHPUT mode it lets OpenVINO choose the
+  // number of threads.
+  config.model_config.num_threads = in_config->model_config.num_threads;
+  config.model_config.performance_mode =
+      SHERPA_DEPLOY_OR(in_config->model_config.performance_mode, "LATENCY");
+  config.model_config.num_requests = in_config->model_config.num_requests;
 
   // decoder_config
   config.decoder_config.method = in_config->decoder_config.decoding_method;
@@ -96,6 +105,10 @@ SherpaOVRecognizer *CreateRecognizer(
 
 void DestroyRecognizer(SherpaOVRecognizer *p) { delete p; }
 
+int32_t SaveHotwords(SherpaOVRecognizer *p, const char *filename) {
+  return p->recognizer->SaveHotwords(filename);
+}
+
 SherpaOVStream *CreateStream(SherpaOVRecognizer *p) {
   auto ans = new SherpaOVStream;
   ans->stream = p->recognizer->CreateStream();
@@ -117,6 +130,15 @@ void Decode(SherpaOVRecognizer *p, SherpaOVStream *s) {
   p->recognizer->DecodeStream(s->stream.get());
 }
 
+void DecodeMultipleStreams(SherpaOVRecognizer *p, SherpaOVStream **ss,
+                           int32_t n) {
+  std::vector<SherpaDeploy::Stream *> streams(n);
+  for (int32_t i = 0; i != n; ++i) {
+    streams[i] = ss[i]->stream.get();
+  }
+  p->recognizer->DecodeStreams(streams.data(), n);
+}
+
 SherpaOVResult *GetResult(SherpaOVRecognizer *p, SherpaOVStream *s) {
   std::string text = p->recognizer->GetResult(s->stream.get()).text;
   auto res = p->recognizer->GetResult(s->stream.get());
@@ -61,9 +61,24 @@ SHERPA_DEPLOY_API typedef struct SherpaOVModelConfig {
   /// device used to infer
   const char *device;
 
-  /// Number of threads for neural network computation.
+  /// Number of threads for neural network computation. 0 means 1 in
+  /// LATENCY mode and lets OpenVINO decide in THROUGHPUT mode.
   int32_t num_threads;
 
+  /// LATENCY (default) or THROUGHPUT. Use THROUGHPUT with
+  /// DecodeMultipleStreams() to decode many streams at the same time.
+  const char *performance_mode;
+
+  /// Number of infer requests per network in THROUGHPUT mode.
+  /// 0 to let the device decide.
+  int32_t num_requests;
+
+  /// Optional. If the joiner is exported as two projections and an output
+  /// layer, paths to the encoder and decoder projections. joiner_xml is
+  /// then the output layer. Both must be set to use them.
+  const char *joiner_encoder_proj_xml;
+  const char *joiner_decoder_proj_xml;
+
 } SherpaOVModelConfig;
 
 SHERPA_DEPLOY_API typedef struct SherpaOVDecoderConfig {
@@ -152,6 +167,16 @@ SHERPA_DEPLOY_API SherpaOVRecognizer *CreateRecognizer(
 /// @param p A pointer returned by CreateRecognizer()
 SHERPA_DEPLOY_API void DestroyRecognizer(SherpaOVRecognizer *p);
 
+/// Write the hotwords of the recognizer, compiled into a context graph, to
+/// a file. Passing that file as hotwords_file to a later recognizer maps
+/// the graph instead of encoding and compiling the hotwords again.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param filename Path of the file to write.
+/// @return Return 1 on success. Return 0 if there are no hotwords or the
+///         file cannot be written.
+SHERPA_DEPLOY_API int32_t SaveHotwords(SherpaOVRecognizer *p, const char *filename);
+
 /// Create a stream for accepting audio samples
 ///
 /// @param p A pointer returned by CreateRecognizer
@@ -193,6 +218,17 @@ SHERPA_DEPLOY_API int32_t IsReady(SherpaOVRecognizer *p, SherpaOVStream *s);
 /// @param s A pointer returned by CreateStream()
 SHERPA_DEPLOY_API void Decode(SherpaOVRecognizer *p, SherpaOVStream *s);
 
+/// Decode multiple streams in parallel
+///
+/// Pre-condition for this function:
+///   You must ensure that IsReady(p, ss[i]) return 1 for all i.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param ss A pointer array containing pointers returned by CreateStream()
+/// @param n Number of elements in the given pointer array.
+SHERPA_DEPLOY_API void DecodeMultipleStreams(SherpaOVRecognizer *p,
+                                           SherpaOVStream **ss, int32_t n);
+
 /// Get the decoding results so far.
 ///
 /// @param p A pointer returned by CreateRecognizer().
@@ -30,7 +30,9 @@ std::string DecoderConfig::ToString() const {
 
   os << "DecoderConfig(";
   os << "method=\"" << method << "\", ";
-  os << "num_active_paths=" << num_active_paths << ")";
+  os << "num_active_paths=" << num_active_paths << ", ";
+  os << "speculative_joiner=" << (speculative_joiner ? "True" : "False")
+     << ")";
 
   return os.str();
 }
@@ -25,27 +25,36 @@
 
 namespace SherpaDeploy {
 
-ov::Tensor GreedySearchDecoder::GetEncoderOutFrame(ov::Tensor encoder_out, int32_t t) const {
+ov::Tensor GreedySearchDecoder::GetEncoderOutFrames(ov::Tensor encoder_out,
+                                                     int32_t t,
+                                                     int32_t n) const {
   auto encoder_out_shape = encoder_out.get_shape();
-
-  auto batch_size = encoder_out_shape[0];
-  auto num_frames = encoder_out_shape[1];
   // TODO: add assert()
-  // assert(t < num_frames);
+  // assert(encoder_out_shape[0] == 1 && t + n <= encoder_out_shape[1]);
 
   auto encoder_out_dim = encoder_out_shape[2];
 
-  auto offset = num_frames * encoder_out_dim;
+  ov::Tensor ans = ov::Tensor(ov::element::f32,
+                              {static_cast<size_t>(n), encoder_out_dim});
 
-  ov::Tensor ans = ov::Tensor(ov::element::f32, {batch_size, encoder_out_dim});
+  const float* src = encoder_out.data<float>() + t * encoder_out_dim;
+  std::copy(src, src + n * encoder_out_dim, ans.data<float>());
 
-  float* p_dst = ans.data<float>();
-  const float* src = encoder_out.data<float>();
+  return ans;
+}
+
+ov::Tensor GreedySearchDecoder::RepeatDecoderOut(ov::Tensor decoder_out,
+                                                 int32_t n) const {
+  auto decoder_out_dim = decoder_out.get_shape()[1];
 
-  for (int32_t i = 0; i != batch_size; ++i) {
-    std::copy(src + t * encoder_out_dim, src + (t + 1) * encoder_out_dim, p_dst);
-    src += offset;
-    p_dst += encoder_out_dim;
+  ov::Tensor ans = ov::Tensor(ov::element::f32,
+                              {static_cast<size_t>(n), decoder_out_dim});
+
+  const float* src = decoder_out.data<float>();
+  float* p_dst = ans.data<float>();
+  for (int32_t i = 0; i != n; ++i) {
+    std::copy(src, src + decoder_out_dim, p_dst);
+    p_dst += decoder_out_dim;
   }
   return ans;
 }
@@ -83,41 +92,61 @@ void GreedySearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
 }
 
 void GreedySearchDecoder::Decode(ov::Tensor encoder_out, DecoderResult *result) {
+  // Project all frames of this chunk at once. result->decoder_out is kept
+  // projected so that it is computed only once per new token.
+  encoder_out = model_->ProjectEncoderOut(encoder_out);
 
-  int32_t batch_size = encoder_out.get_shape()[0];
   int32_t num_frames = encoder_out.get_shape()[1];
 
-  // TODO(fangjun): Cache the result of decoder_out
   ov::Tensor decoder_out = result->decoder_out;
   if (!decoder_out) {
     ov::Tensor decoder_input = BuildDecoderInput(*result);
-    decoder_out = model_->RunDecoder(decoder_input);
+    decoder_out = model_->ProjectDecoderOut(model_->RunDecoder(decoder_input));
   }
 
+  bool speculative = speculative_joiner_ && model_->SupportsBatchJoiner();
+
   int32_t frame_offset = result->frame_offset;
-  for (int32_t t = 0; t != num_frames; ++t) {
-    ov::Tensor encoder_out_t = GetEncoderOutFrame(encoder_out, t);
-    ov::Tensor joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+  int32_t t = 0;
+  while (t != num_frames) {
+    // decoder_out changes only after a non-blank token, so the joiner
+    // outputs of the remaining frames are valid up to and including the
+    // first non-blank one. Rows after it are thrown away.
+    int32_t n = speculative ? num_frames - t : 1;
+
+    ov::Tensor encoder_out_t = GetEncoderOutFrames(encoder_out, t, n);
+    ov::Tensor decoder_out_t =
+        n == 1 ? decoder_out : RepeatDecoderOut(decoder_out, n);
+    ov::Tensor joiner_out = model_->RunJoiner(encoder_out_t, decoder_out_t);
 
     int32_t vocab_size = joiner_out.get_shape()[1];
 
     const float* joiner_out_ptr = joiner_out.data<float>();
 
-    auto new_token = static_cast<int32_t>(std::distance(
-        joiner_out_ptr,
-        std::max_element(joiner_out_ptr, joiner_out_ptr + vocab_size)));
+    int32_t k = 0;
+    while (k != n) {
+      auto new_token = static_cast<int32_t>(std::distance(
+          joiner_out_ptr,
+          std::max_element(joiner_out_ptr, joiner_out_ptr + vocab_size)));
+      joiner_out_ptr += vocab_size;
+      ++k;
+
+      // the blank ID is fixed to 0
+      if (new_token != 0 && new_token != 2) {
+        result->tokens.push_back(new_token);
+        ov::Tensor decoder_input = BuildDecoderInput(*result);
+        decoder_out =
+            model_->ProjectDecoderOut(model_->RunDecoder(decoder_input));
+
+        result->num_trailing_blanks = 0;
+        result->timestamps.push_back(t + k - 1 + frame_offset);
+        break;
+      }
 
-    // the blank ID is fixed to 0
-    if (new_token != 0 && new_token != 2) {
-      result->tokens.push_back(new_token);
-      ov::Tensor decoder_input = BuildDecoderInput(*result);
-      decoder_out = model_->RunDecoder(decoder_input);
-
-      result->num_trailing_blanks = 0;
-      result->timestamps.push_back(t + frame_offset);
-    } else {
       ++result->num_trailing_blanks;
     }
+
+    t += k;
   }
 
   result->frame_offset += num_frames;
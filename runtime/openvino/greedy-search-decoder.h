@@ -28,7 +28,8 @@ namespace SherpaDeploy {
 
 class GreedySearchDecoder : public Decoder {
  public:
-  explicit GreedySearchDecoder(Model *model) : model_(model) {}
+  explicit GreedySearchDecoder(Model *model, bool speculative_joiner = false)
+      : model_(model), speculative_joiner_(speculative_joiner) {}
 
   DecoderResult GetEmptyResult() const override;
 
@@ -38,10 +39,15 @@ class GreedySearchDecoder : public Decoder {
 
  private:
   ov::Tensor BuildDecoderInput(const DecoderResult &result) const;
-  ov::Tensor GetEncoderOutFrame(ov::Tensor encoder_out, int32_t t) const;
+  // Return frames [t, t + n) of the first utterance, of shape (n, dim)
+  ov::Tensor GetEncoderOutFrames(ov::Tensor encoder_out, int32_t t,
+                                 int32_t n) const;
+  // Stack n copies of the (1, dim) decoder_out into (n, dim)
+  ov::Tensor RepeatDecoderOut(ov::Tensor decoder_out, int32_t n) const;
 
  private:
   Model *model_;  // not owned
+  bool speculative_joiner_;
 };
 
 }  // namespace SherpaDeploy
@@ -0,0 +1,44 @@
+// runtime/openvino/infer-request-pool.cc
+
+#include "infer-request-pool.h"
+
+#include <utility>
+
+namespace SherpaDeploy {
+
+InferRequestPool::InferRequestPool(ov::CompiledModel *model,
+                                   int32_t num_requests)
+    : model_(model) {
+  requests_.reserve(num_requests);
+  for (int32_t i = 0; i != num_requests; ++i) {
+    requests_.push_back(model_->create_infer_request());
+    free_.push_back(i);
+  }
+}
+
+InferRequestPool::Handle InferRequestPool::Acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [this] { return !free_.empty(); });
+
+  int32_t index = free_.back();
+  free_.pop_back();
+  return Handle(this, index);
+}
+
+void InferRequestPool::Release(int32_t index) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(index);
+  }
+  cond_.notify_one();
+}
+
+void InferRequestPool::AllocateOutputs(ov::InferRequest *request) const {
+  const auto &outputs = model_->outputs();
+  for (size_t i = 0; i != outputs.size(); ++i) {
+    request->set_output_tensor(
+        i, ov::Tensor(outputs[i].get_element_type(), outputs[i].get_shape()));
+  }
+}
+
+}  // namespace SherpaDeploy
@@ -0,0 +1,67 @@
+// runtime/openvino/infer-request-pool.h
+
+#ifndef SHERPA_DEPLOY_OPENVINO_INFER_REQUEST_POOL_H_
+#define SHERPA_DEPLOY_OPENVINO_INFER_REQUEST_POOL_H_
+
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+#include <vector>
+
+#include "openvino/openvino.hpp"
+
+namespace SherpaDeploy {
+
+// A fixed set of infer requests created from one compiled model. Every
+// request shares the weights of the compiled model, so threads can run
+// the same network at the same time without copying the model.
+class InferRequestPool {
+ public:
+  // Gives back the request to the pool when destroyed.
+  class Handle {
+   public:
+    Handle(InferRequestPool *pool, int32_t index)
+        : pool_(pool), index_(index) {}
+    Handle(Handle &&other) noexcept
+        : pool_(other.pool_), index_(other.index_) {
+      other.pool_ = nullptr;
+    }
+    Handle(const Handle &) = delete;
+    Handle &operator=(const Handle &) = delete;
+    Handle &operator=(Handle &&) = delete;
+
+    ~Handle() {
+      if (pool_) pool_->Release(index_);
+    }
+
+    ov::InferRequest &operator*() const { return pool_->requests_[index_]; }
+    ov::InferRequest *operator->() const { return &pool_->requests_[index_]; }
+
+   private:
+    InferRequestPool *pool_;
+    int32_t index_;
+  };
+
+  InferRequestPool(ov::CompiledModel *model, int32_t num_requests);
+
+  // Block until a request is free.
+  Handle Acquire();
+
+  int32_t Size() const { return requests_.size(); }
+
+  // Set new tensors for every output of `request` so that the outputs of
+  // a run stay valid after the request is reused.
+  void AllocateOutputs(ov::InferRequest *request) const;
+
+ private:
+  void Release(int32_t index);
+
+  ov::CompiledModel *model_;  // not owned
+  std::vector<ov::InferRequest> requests_;
+  std::vector<int32_t> free_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};
+
+}  // namespace SherpaDeploy
+
+#endif  // SHERPA_DEPLOY_OPENVINO_INFER_REQUEST_POOL_H_
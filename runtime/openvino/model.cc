@@ -20,6 +20,7 @@
 #include "zipformer-model.h"
 
 #include <sstream>
+#include <utility>
 
 namespace SherpaDeploy {
 
@@ -29,9 +30,15 @@ std::string ModelConfig::ToString() const {
   os << "encoder_xml=\"" << encoder_xml << "\", ";
   os << "decoder_xml=\"" << decoder_xml << "\", ";
   os << "joiner_xml=\"" << joiner_xml << "\", ";
+  if (!joiner_encoder_proj_xml.empty()) {
+    os << "joiner_encoder_proj_xml=\"" << joiner_encoder_proj_xml << "\", ";
+    os << "joiner_decoder_proj_xml=\"" << joiner_decoder_proj_xml << "\", ";
+  }
   os << "tokens=\"" << tokens << "\", ";
   os << "device=\"" << device << "\", ";
-  os << "num_threads=\"" << num_threads << "\")";
+  os << "num_threads=\"" << num_threads << "\", ";
+  os << "performance_mode=\"" << performance_mode << "\", ";
+  os << "num_requests=" << num_requests << ")";
 
   return os.str();
 }
@@ -40,4 +47,27 @@ std::unique_ptr<Model> Model::Create(const ModelConfig &config) {
   return std::make_unique<ZipformerModel>(config);
 }
 
+namespace {
+
+class FinishedEncoderJob : public Model::EncoderJob {
+ public:
+  explicit FinishedEncoderJob(
+      std::pair<ov::Tensor, std::vector<ov::Tensor>> result)
+      : result_(std::move(result)) {}
+
+  std::pair<ov::Tensor, std::vector<ov::Tensor>> Wait() override {
+    return std::move(result_);
+  }
+
+ private:
+  std::pair<ov::Tensor, std::vector<ov::Tensor>> result_;
+};
+
+}  // namespace
+
+std::unique_ptr<Model::EncoderJob> Model::StartEncoder(
+    ov::Tensor features, const std::vector<ov::Tensor> &states) {
+  return std::make_unique<FinishedEncoderJob>(RunEncoder(features, states));
+}
+
 }  // namespace SherpaDeploy
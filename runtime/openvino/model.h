@@ -34,16 +34,45 @@ struct ModelConfig {
   std::string encoder_xml;  // path to encoder.xml
   std::string decoder_xml;  // path to decoder.xml
   std::string joiner_xml;   // path to joiner.xml
+
+  // Optional. If the joiner is exported as an encoder projection, a decoder
+  // projection and an output layer, set the paths of the two projections
+  // here and let joiner_xml point to the output layer.
+  std::string joiner_encoder_proj_xml;
+  std::string joiner_decoder_proj_xml;
+
   std::string tokens;         // path to tokens.txt
 
   std::string device = "CPU"; // default: CPU
-  int32_t num_threads = 1;
+
+  // Number of CPU threads. 0 means 1 in LATENCY mode and lets OpenVINO
+  // decide in THROUGHPUT mode, where the threads are split among the
+  // infer requests.
+  int32_t num_threads = 0;
+
+  // LATENCY: a single infer request per network, for one stream at a time.
+  // THROUGHPUT: a pool of infer requests over the same compiled network so
+  // that many streams can be decoded at the same time.
+  std::string performance_mode = "LATENCY";
+
+  // Number of infer requests per network in THROUGHPUT mode. 0 means
+  // using the number suggested by the device.
+  int32_t num_requests = 0;
 
   std::string ToString() const;
 };
 
 class Model {
  public:
+  // An encoder run started by StartEncoder()
+  class EncoderJob {
+   public:
+    virtual ~EncoderJob() = default;
+
+    // Block until the run finishes and return what RunEncoder() returns.
+    virtual std::pair<ov::Tensor, std::vector<ov::Tensor>> Wait() = 0;
+  };
+
   virtual ~Model() = default;
 
   /** Create a model from a config. */
@@ -71,6 +100,13 @@ class Model {
   virtual std::pair<ov::Tensor, std::vector<ov::Tensor>> RunEncoder(
       ov::Tensor features, const std::vector<ov::Tensor>& states) = 0;
 
+  /** Start the encoder network without waiting for it.
+   *
+   * The default implementation runs RunEncoder() at once.
+   */
+  virtual std::unique_ptr<EncoderJob> StartEncoder(
+      ov::Tensor features, const std::vector<ov::Tensor>& states);
+
   /** Run the decoder network.
    *
    * @param  decoder_input A Tensor of shape (num_paths, context_size). Note: Its underlying
@@ -81,7 +117,37 @@ class Model {
    */
   virtual ov::Tensor RunDecoder(ov::Tensor decoder_input) = 0;
 
+  /** Run the encoder projection of the joiner.
+   *
+   * If the model has no separate joiner projections, encoder_out is
+   * returned unchanged.
+   *
+   * @param encoder_out  A Tensor of shape (N, T, encoder_dim)
+   *
+   * @return Return a Tensor of shape (N, T, joiner_dim)
+   */
+  virtual ov::Tensor ProjectEncoderOut(ov::Tensor encoder_out) {
+    return encoder_out;
+  }
+
+  /** Run the decoder projection of the joiner.
+   *
+   * If the model has no separate joiner projections, decoder_out is
+   * returned unchanged.
+   *
+   * @param decoder_out  A Tensor of shape (num_paths, decoder_dim)
+   *
+   * @return Return a Tensor of shape (num_paths, joiner_dim)
+   */
+  virtual ov::Tensor ProjectDecoderOut(ov::Tensor decoder_out) {
+    return decoder_out;
+  }
+
   /** Run the joiner network.
+   *
+   * The inputs are the outputs of ProjectEncoderOut() and
+   * ProjectDecoderOut(), so that the projections can be computed once
+   * and reused across joiner calls.
    *
    * @param encoder_out  A Tensor of shape (num_frames, encoder_dim)
    * @param decoder_out  A Tensor of shape (num_paths, decoder_dim)
@@ -95,6 +161,15 @@ class Model {
 
   virtual int32_t BlankId() const { return 0; }
 
+  // True if RunJoiner() accepts more than one encoder frame, each paired
+  // with the decoder_out row of the same index
+  virtual bool SupportsBatchJoiner() const { return false; }
+
+  // Number of encoder runs that may be in flight at the same time.
+  // RunEncoder(), RunDecoder() and RunJoiner() are safe to call from that
+  // many threads at once.
+  virtual int32_t NumRequests() const { return 1; }
+
   // The encoder takes this number of frames as input
   virtual int32_t Segment() const = 0;
 
@@ -24,7 +24,7 @@
 #include <utility>
 #include <vector>
 
-#include "runtime/core/math.h"
+#include "runtime/core/log-softmax-topk.h"
 
 namespace SherpaDeploy {
 
@@ -46,36 +46,24 @@ void ModifiedBeamSearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
   int32_t context_size = model_->ContextSize();
   auto hyp = r->hyps.GetMostProbable(true);
 
-  auto start = hyp.ys.begin() + context_size;
-  auto end = hyp.ys.end();
+  std::vector<int32_t> ys = hyp.Ys();
 
-  r->tokens = std::vector<int32_t>(start, end);
-  r->timestamps = std::move(hyp.timestamps);
+  r->tokens = std::vector<int32_t>(ys.begin() + context_size, ys.end());
+  r->timestamps = hyp.Timestamps();
   r->num_trailing_blanks = hyp.num_trailing_blanks;
 }
 
-// Compute log_softmax in-place.
-//
-// The log_softmax of each row is computed.
-//
-// @param in_out A 2-D tensor
-static void LogSoftmax(ov::Tensor in_out) {
-  int32_t h = in_out.get_shape()[0];
-  int32_t w = in_out.get_shape()[1];
-  float* p_src = in_out.data<float>();
-  for (int32_t y = 0; y != h; ++y) {
-    float* p = p_src + y * w;
-    SherpaDeploy::LogSoftmax(p, w);
-  }
-}
-
 // The decoder model contains an embedding layer, which only supports
 // 1-D output.
 // This is a wrapper to support 2-D decoder output.
 //
+// The output of each row is passed through the decoder projection of the
+// joiner, if any.
+//
 // @param model_ The NN model.
 // @param decoder_input A 2-D tensor of shape (num_active_paths, context_size)
-// @return Return a 2-D tensor of shape (num_active_paths, decoder_dim)
+// @return Return a 2-D tensor of shape (num_active_paths, decoder_dim), or
+//         (num_active_paths, joiner_dim) if the joiner has projections
 //
 // TODO(fangjun): Change Embed in ncnn to output 2-d tensors
 static ov::Tensor RunDecoder2D(Model *model_, ov::Tensor decoder_input) {
@@ -90,7 +78,7 @@ static ov::Tensor RunDecoder2D(Model *model_, ov::Tensor decoder_input) {
     std::copy(p_src, p_src + w, p_dst);
     p_src += w;
 
-    ov::Tensor tmp = model_->RunDecoder(decoder_input_t);
+    ov::Tensor tmp = model_->ProjectDecoderOut(model_->RunDecoder(decoder_input_t));
     size_t decoder_out_dim = tmp.get_shape()[1];
 
     if (y == 0) {
@@ -114,10 +102,11 @@ ov::Tensor ModifiedBeamSearchDecoder::BuildDecoderInput(
   ov::Tensor decoder_input = ov::Tensor(ov::element::i64, {num_hyps, context_size});
   int64_t* p = decoder_input.data<int64_t>();
 
+  std::vector<int32_t> context(context_size);
   for (const auto &hyp : hyps) {
-    const auto &ys = hyp.ys;
+    hyp.LastTokens(context_size, context.data());
     // transform and copy
-    std::transform(ys.end() - context_size, ys.end(), p,                  
+    std::transform(context.begin(), context.end(), p,
                      [](int32_t val) {  
                          return static_cast<int64_t>(val);
                      });
@@ -134,6 +123,9 @@ void ModifiedBeamSearchDecoder::Decode(ov::Tensor encoder_out,
 
 void ModifiedBeamSearchDecoder::Decode(ov::Tensor encoder_out, Stream *s,
                                        DecoderResult *result) {
+  // Project all frames of this chunk at once
+  encoder_out = model_->ProjectEncoderOut(encoder_out);
+
   size_t batch_size = encoder_out.get_shape()[0];
   size_t num_frames = encoder_out.get_shape()[1];
   size_t encoder_out_dim = encoder_out.get_shape()[2];
@@ -143,6 +135,11 @@ void ModifiedBeamSearchDecoder::Decode(ov::Tensor encoder_out, Stream *s,
 
   const float* p_src = encoder_out.data<float>();
 
+  // Reused across frames so that selecting the best paths does not allocate
+  std::vector<float> prev_log_probs;
+  std::vector<int32_t> topk_index(num_active_paths_);
+  std::vector<float> topk_score(num_active_paths_);
+
   /* encoder_out.w == encoder_out_dim, encoder_out.h == num_frames. */
   for (size_t t = 0; t != num_frames; ++t) {
     std::vector<SherpaDeploy::Hypothesis> prev = cur.GetTopK(num_active_paths_, true);
@@ -150,7 +147,7 @@ void ModifiedBeamSearchDecoder::Decode(ov::Tensor encoder_out, Stream *s,
 
     ov::Tensor decoder_input = BuildDecoderInput(prev);
     ov::Tensor decoder_out;
-    if (t == 0 && prev.size() == 1 && prev[0].ys.size() == context_size &&
+    if (t == 0 && prev.size() == 1 && prev[0].NumTokens() == context_size &&
         result->decoder_out) {
       // When an endpoint is detected, we keep the decoder_out
       decoder_out = result->decoder_out;
@@ -171,27 +168,21 @@ void ModifiedBeamSearchDecoder::Decode(ov::Tensor encoder_out, Stream *s,
     int32_t num_active_paths = joiner_out.get_shape()[0];
     int32_t vocab_size = joiner_out.get_shape()[1];
 
-    LogSoftmax(joiner_out);
-
-    float* p_joiner_out = joiner_out.data<float>();
-
+    prev_log_probs.resize(num_active_paths);
     for (int32_t i = 0; i != num_active_paths; ++i) {
-      float prev_log_prob = prev[i].log_prob;
-      for (int32_t k = 0; k != vocab_size; ++k, ++p_joiner_out) {
-        *p_joiner_out += prev_log_prob;
-      }
+      prev_log_probs[i] = prev[i].log_prob;
     }
 
-    p_joiner_out = joiner_out.data<float>();
-    auto topk = SherpaDeploy::TopkIndex(p_joiner_out,
-                          num_active_paths * vocab_size, num_active_paths_);
+    // log_softmax of each row plus the log_prob of its path
+    const float* p_joiner_out = joiner_out.data<float>();
+    int32_t num_topk = SherpaDeploy::LogSoftmaxTopK(
+        p_joiner_out, num_active_paths, vocab_size, prev_log_probs.data(),
+        num_active_paths_, topk_index.data(), topk_score.data());
 
     int32_t frame_offset = result->frame_offset;
-    for (auto i : topk) {
-      int32_t hyp_index = i / vocab_size;
-      int32_t new_token = i % vocab_size;
-
-      const float* p = p_joiner_out + hyp_index * vocab_size;
+    for (int32_t j = 0; j != num_topk; ++j) {
+      int32_t hyp_index = topk_index[j] / vocab_size;
+      int32_t new_token = topk_index[j] % vocab_size;
 
       SherpaDeploy::Hypothesis new_hyp = prev[hyp_index];
       // const float prev_lm_log_prob = new_hyp.lm_log_prob;
@@ -199,9 +190,8 @@ void ModifiedBeamSearchDecoder::Decode(ov::Tensor encoder_out, Stream *s,
       auto context_state = new_hyp.context_state;
       // blank id is fixed to 0
       if (new_token != 0 && new_token != 2) {
-        new_hyp.ys.push_back(new_token);
+        new_hyp.Append(new_token, t + frame_offset);
         new_hyp.num_trailing_blanks = 0;
-        new_hyp.timestamps.push_back(t + frame_offset);
         if (s && s->GetContextGraph()) {
           auto context_res = s->GetContextGraph()->ForwardOneStep(
               context_state, new_token, false /*strict_mode*/);
@@ -211,8 +201,8 @@ void ModifiedBeamSearchDecoder::Decode(ov::Tensor encoder_out, Stream *s,
       } else {
         ++new_hyp.num_trailing_blanks;
       }
-      // We have already added prev[hyp_index].log_prob to p[new_token]
-      new_hyp.log_prob = p[new_token] + context_score;
+      // topk_score[j] already includes prev[hyp_index].log_prob
+      new_hyp.log_prob = topk_score[j] + context_score;
 
       cur.Add(std::move(new_hyp));
     }
@@ -225,9 +215,10 @@ void ModifiedBeamSearchDecoder::Decode(ov::Tensor encoder_out, Stream *s,
   // set decoder_out in case of endpointing
   ov::Tensor decoder_input = BuildDecoderInput({hyp});
 
-  result->decoder_out = model_->RunDecoder(decoder_input);
+  result->decoder_out =
+      model_->ProjectDecoderOut(model_->RunDecoder(decoder_input));
 
-  result->tokens = std::move(hyp.ys);
+  result->tokens = hyp.Ys();
   result->num_trailing_blanks = hyp.num_trailing_blanks;
 }
 
@@ -20,8 +20,11 @@
 
 #include "recognizer.h"
 
+#include <atomic>
 #include <fstream>
+#include <future>  // NOLINT
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -29,6 +32,7 @@
 #include <iostream>
 
 #include "runtime/core/context-graph.h"
+#include "runtime/core/thread-pool.h"
 #include "decoder.h"
 #include "greedy-search-decoder.h"
 #include "modified-beam-search-decoder.h"
@@ -108,7 +112,8 @@ class Recognizer::Impl {
         endpoint_(config.endpoint_config),
         sym_(config.model_config.tokens) {
     if (config.decoder_config.method == "greedy_search") {
-      decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
+      decoder_ = std::make_unique<GreedySearchDecoder>(
+          model_.get(), config.decoder_config.speculative_joiner);
     } else if (config.decoder_config.method == "modified_beam_search") {
       decoder_ = std::make_unique<ModifiedBeamSearchDecoder>(
           model_.get(), config.decoder_config.num_active_paths);
@@ -120,6 +125,8 @@ class Recognizer::Impl {
       fprintf(stderr, "Unsupported method: %s", config.decoder_config.method.c_str());
       exit(-1);
     }
+
+    InitSearchPool();
   }
 
 #if __ANDROID_API__ >= 9
@@ -129,7 +136,8 @@ class Recognizer::Impl {
         endpoint_(config.endpoint_config),
         sym_(mgr, config.model_config.tokens) {
     if (config.decoder_config.method == "greedy_search") {
-      decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
+      decoder_ = std::make_unique<GreedySearchDecoder>(
+          model_.get(), config.decoder_config.speculative_joiner);
     } else if (config.decoder_config.method == "modified_beam_search") {
       decoder_ = std::make_unique<ModifiedBeamSearchDecoder>(
           model_.get(), config.decoder_config.num_active_paths);
@@ -141,11 +149,18 @@ class Recognizer::Impl {
       fprintf(stderr, "Unsupported method: %s", config.decoder_config.method.c_str());
       exit(-1);
     }
+
+    InitSearchPool();
   }
 #endif
 
   std::unique_ptr<Stream> CreateStream() const {
-    if (hotwords_.empty()) {
+    // Streams share the graph and keep it alive even if SetHotwords()
+    // swaps in a new one while they are running.
+    SherpaDeploy::ContextGraphPtr context_graph =
+        std::atomic_load(&context_graph_);
+
+    if (!context_graph) {
       auto stream = std::make_unique<Stream>(config_.feat_config);
       stream->SetResult(decoder_->GetEmptyResult());
       stream->SetStates(model_->GetEncoderInitStates());
@@ -153,17 +168,12 @@ class Recognizer::Impl {
     } else {
       auto r = decoder_->GetEmptyResult();
 
-      auto context_graph =
-          std::make_shared<SherpaDeploy::ContextGraph>(hotwords_, config_.hotwords_score);
-
       auto stream =
           std::make_unique<Stream>(config_.feat_config, context_graph);
 
-      if (stream->GetContextGraph()) {
-        // r.hyps has only one element.
-        for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
-          it->second.context_state = stream->GetContextGraph()->Root();
-        }
+      // r.hyps has only one element.
+      for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
+        it->second.context_state = context_graph->Root();
       }
 
       stream->SetResult(r);
@@ -173,42 +183,84 @@ class Recognizer::Impl {
     }
   }
 
-  bool IsReady(Stream *s) const {
-    return s->GetNumProcessedFrames() + model_->Segment() < s->NumFramesReady();
+  bool SetHotwords(const std::string &hotwords) {
+    if (config_.decoder_config.method != "modified_beam_search") {
+      fprintf(stderr, "Hotwords are only supported by modified_beam_search, "
+              "current method is %s\n", config_.decoder_config.method.c_str());
+      return false;
+    }
+
+    std::istringstream is(hotwords);
+    std::vector<std::vector<int32_t>> hotwords_ids;
+    std::vector<float> boost_scores;
+    if (!EncodeHotwords(is, &hotwords_ids, &boost_scores)) {
+      return false;
+    }
+
+    // Streams created before this call keep decoding with the old graph.
+    std::atomic_store(&context_graph_,
+                      BuildContextGraph(hotwords_ids, boost_scores));
+    return true;
   }
 
-  void DecodeStream(Stream *s) const {
-    int32_t segment = model_->Segment();
-    int32_t offset = model_->Offset();
+  bool SaveHotwords(const std::string &filename) const {
+    SherpaDeploy::ContextGraphPtr context_graph =
+        std::atomic_load(&context_graph_);
+    if (!context_graph) {
+      fprintf(stderr, "There are no hotwords to save\n");
+      return false;
+    }
 
-    auto frames_out = s->GetFrames(s->GetNumProcessedFrames(), segment);
-    std::vector<float> features_vec = std::get<0>(frames_out);
-    size_t feature_dim = std::get<1>(frames_out);
+    if (!context_graph->Save(filename)) {
+      fprintf(stderr, "Failed to write hotwords to %s\n", filename.c_str());
+      return false;
+    }
 
-    ov::Tensor features = ov::Tensor(ov::element::f32, {1, static_cast<size_t>(segment), static_cast<size_t>(feature_dim)});
+    return true;
+  }
 
-    float* p_dst = features.data<float>();
-    float* p_src = features_vec.data();
+  bool IsReady(Stream *s) const {
+    return s->GetNumProcessedFrames() + model_->Segment() < s->NumFramesReady();
+  }
+
+  void DecodeStream(Stream *s) const {
+    FinishDecoding(s, StartEncoder(s).get());
+  }
 
-    for (int32_t i = 0; i != segment; ++i) {
-      std::copy(p_src, p_src + feature_dim, p_dst);
-      p_src += feature_dim;
-      p_dst += feature_dim;
+  void DecodeStreams(Stream **ss, int32_t n) const {
+    int32_t num_requests = model_->NumRequests();
+    if (num_requests == 1) {
+      for (int32_t i = 0; i != n; ++i) {
+        DecodeStream(ss[i]);
+      }
+      return;
     }
 
-    s->GetNumProcessedFrames() += offset;
-    std::vector<ov::Tensor> pre_states = s->GetStates();
-    std::vector<ov::Tensor> cur_states;
+    // Keep up to num_requests encoders running. Once the encoder of a
+    // stream is done, its search is handed to search_pool_, sharing the
+    // decoder and joiner requests of the model with the other streams.
+    std::vector<std::unique_ptr<Model::EncoderJob>> jobs(n);
+    std::vector<std::future<void>> searches;
+    searches.reserve(n);
+
+    for (int32_t i = 0; i != n + num_requests; ++i) {
+      int32_t k = i - num_requests;
+      if (k >= 0 && k < n) {
+        Stream *s = ss[k];
+        searches.push_back(search_pool_->Submit(
+            [this, s, job = std::move(jobs[k])]() {
+              FinishDecoding(s, job.get());
+            }));
+      }
 
-    ov::Tensor encoder_out;
-    std::tie(encoder_out, cur_states) = model_->RunEncoder(features, pre_states);
+      if (i < n) {
+        jobs[i] = StartEncoder(ss[i]);
+      }
+    }
 
-    if (s->GetContextGraph()) {
-      decoder_->Decode(encoder_out, s, &s->GetResult());
-    } else {
-      decoder_->Decode(encoder_out, &s->GetResult());
+    for (auto &f : searches) {
+      f.get();
     }
-    s->SetStates(cur_states);
   }
 
   bool IsEndpoint(Stream *s) const {
@@ -264,6 +316,34 @@ class Recognizer::Impl {
   const Model *GetModel() const { return model_.get(); }
 
  private:
+  std::unique_ptr<Model::EncoderJob> StartEncoder(Stream *s) const {
+    int32_t segment = model_->Segment();
+    int32_t offset = model_->Offset();
+
+    size_t feature_dim = config_.feat_config.feature_dim;
+
+    ov::Tensor features = ov::Tensor(ov::element::f32, {1, static_cast<size_t>(segment), static_cast<size_t>(feature_dim)});
+    s->GetFrames(s->GetNumProcessedFrames(), segment, features.data<float>());
+
+    s->GetNumProcessedFrames() += offset;
+
+    return model_->StartEncoder(features, s->GetStates());
+  }
+
+  void FinishDecoding(Stream *s, Model::EncoderJob *job) const {
+    std::vector<ov::Tensor> cur_states;
+
+    ov::Tensor encoder_out;
+    std::tie(encoder_out, cur_states) = job->Wait();
+
+    if (s->GetContextGraph()) {
+      decoder_->Decode(encoder_out, s, &s->GetResult());
+    } else {
+      decoder_->Decode(encoder_out, &s->GetResult());
+    }
+    s->SetStates(cur_states);
+  }
+
 #if __ANDROID_API__ >= 9
   void InitHotwords(AAssetManager *mgr) {
     AAsset *asset = AAssetManager_open(mgr, config_.hotwords_file.c_str(),
@@ -283,7 +363,21 @@ class Recognizer::Impl {
   }
 #endif
 
+  // One search thread per infer request. DecodeStreams() keeps at most
+  // NumRequests() encoders running, so more threads would not help.
+  void InitSearchPool() {
+    int32_t num_requests = model_->NumRequests();
+    if (num_requests > 1) {
+      search_pool_ = std::make_unique<SherpaDeploy::ThreadPool>(num_requests);
+    }
+  }
+
   void InitHotwords() {
+    // A graph written by ContextGraph::Save() is mapped as is; its scores
+    // were fixed when it was saved.
+    context_graph_ = SherpaDeploy::ContextGraph::Load(config_.hotwords_file);
+    if (context_graph_) return;
+
     // each line in hotwords_file contains space-separated words
 
     std::ifstream is(config_.hotwords_file);
@@ -296,6 +390,18 @@ class Recognizer::Impl {
   }
 
   void InitHotwords(std::istream &is) {
+    std::vector<std::vector<int32_t>> hotwords;
+    std::vector<float> boost_scores;
+    if (!EncodeHotwords(is, &hotwords, &boost_scores)) {
+      exit(-1);
+    }
+    context_graph_ = BuildContextGraph(hotwords, boost_scores);
+  }
+
+  // Return false if some word in `is` is not in the symbol table.
+  bool EncodeHotwords(std::istream &is,
+                      std::vector<std::vector<int32_t>> *hotwords,
+                      std::vector<float> *boost_scores) const {
     std::vector<int32_t> tmp;
     std::string line;
     std::string word;
@@ -317,18 +423,28 @@ class Recognizer::Impl {
           if (word[0] == ':') {
             tmp_score = std::stof(word.substr(1));
           } else {
-            fprintf(stderr, 
+            fprintf(stderr,
                 "Cannot find ID for hotword %s at line: %s. (Hint: words on "
                 "the "
                 "same line are separated by spaces)",
                 word.c_str(), line.c_str());
-            exit(-1);
+            return false;
           }
         }
       }
-      hotwords_.push_back(std::move(tmp));
-      boost_scores_.push_back(tmp_score);
+      hotwords->push_back(std::move(tmp));
+      boost_scores->push_back(tmp_score);
     }
+    return true;
+  }
+
+  // Returns nullptr for an empty list so that streams skip context biasing.
+  SherpaDeploy::ContextGraphPtr BuildContextGraph(
+      const std::vector<std::vector<int32_t>> &hotwords,
+      const std::vector<float> &boost_scores) const {
+    if (hotwords.empty()) return nullptr;
+    return std::make_shared<SherpaDeploy::ContextGraph>(
+        hotwords, config_.hotwords_score, boost_scores);
   }
 
  private:
@@ -337,8 +453,12 @@ class Recognizer::Impl {
   std::unique_ptr<Decoder> decoder_;
   SherpaDeploy::Endpoint endpoint_;
   SherpaDeploy::SymbolTable sym_;
-  std::vector<std::vector<int32_t>> hotwords_;
-  std::vector<float> boost_scores_;
+  // Built once and shared by all streams, replaced atomically by
+  // SetHotwords().
+  SherpaDeploy::ContextGraphPtr context_graph_;
+  // Runs the searches of DecodeStreams(). Used only if the model has more
+  // than one infer request.
+  std::unique_ptr<SherpaDeploy::ThreadPool> search_pool_;
 };
 
 Recognizer::Recognizer(const RecognizerConfig &config)
@@ -355,10 +475,22 @@ std::unique_ptr<Stream> Recognizer::CreateStream() const {
   return impl_->CreateStream();
 }
 
+bool Recognizer::SetHotwords(const std::string &hotwords) {
+  return impl_->SetHotwords(hotwords);
+}
+
+bool Recognizer::SaveHotwords(const std::string &filename) const {
+  return impl_->SaveHotwords(filename);
+}
+
 bool Recognizer::IsReady(Stream *s) const { return impl_->IsReady(s); }
 
 void Recognizer::DecodeStream(Stream *s) const { impl_->DecodeStream(s); }
 
+void Recognizer::DecodeStreams(Stream **ss, int32_t n) const {
+  impl_->DecodeStreams(ss, n);
+}
+
 bool Recognizer::IsEndpoint(Stream *s) const { return impl_->IsEndpoint(s); }
 
 void Recognizer::Reset(Stream *s) const { impl_->Reset(s); }
@@ -57,6 +57,8 @@ struct RecognizerConfig {
   SherpaDeploy::EndpointConfig endpoint_config;
   bool enable_endpoint = false;
 
+  /// A text file with one hotword per line, or a graph written by
+  /// SherpaDeploy::ContextGraph::Save()
   std::string hotwords_file;
 
   /// used only for modified_beam_search
@@ -93,6 +95,27 @@ class Recognizer {
   /// Create a stream for decoding.
   std::unique_ptr<Stream> CreateStream() const;
 
+  /**
+   * Replace the hotwords used by streams created after this call. The
+   * format is the same as a text hotwords_file, one hotword per line.
+   * Existing streams keep the hotwords they were created with. An empty
+   * string disables hotwords.
+   *
+   * Return false and keep the current hotwords if any of them cannot be
+   * encoded or the decoding method is not modified_beam_search.
+   */
+  bool SetHotwords(const std::string &hotwords);
+
+  /**
+   * Write the current hotwords, compiled into a context graph, to
+   * `filename`. Passing that file as hotwords_file later maps the graph
+   * as is instead of encoding and compiling the hotwords again. The
+   * scores are fixed to those of this recognizer.
+   *
+   * Return false if there are no hotwords or the file cannot be written.
+   */
+  bool SaveHotwords(const std::string &filename) const;
+
   /**
    * Return true if the given stream has enough frames for decoding.
    * Return false otherwise
@@ -101,6 +124,18 @@ class Recognizer {
 
   void DecodeStream(Stream *s) const;
 
+  /** Decode multiple streams in parallel
+   *
+   * In THROUGHPUT mode the encoders of the streams run asynchronously on
+   * the infer requests of the model, and the searches run concurrently. In
+   * LATENCY mode the streams are decoded one after another.
+   *
+   * @param ss Pointer array containing streams to be decoded.
+   *           IsReady(ss[i]) must be true for all i.
+   * @param n Number of streams in `ss`.
+   */
+  void DecodeStreams(Stream **ss, int32_t n) const;
+
   // Return true if we detect an endpoint for this stream.
   // Note: If this function returns true, you usually want to
   // invoke Reset(s).
@@ -20,11 +20,13 @@
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <cctype>  // std::tolower
 #include <algorithm>
 
 #include "portaudio.h"  // NOLINT
+#include "runtime/core/cli-utils.h"
 #include "runtime/core/display.h"
 #include "runtime/core/microphone.h"
 
@@ -52,6 +54,11 @@ static void Handler(int32_t sig) {
 };
 
 int32_t main(int32_t argc, char *argv[]) {
+  std::string joiner_encoder_proj =
+      SherpaDeploy::TakeOption("joiner-encoder-proj", &argc, argv);
+  std::string joiner_decoder_proj =
+      SherpaDeploy::TakeOption("joiner-decoder-proj", &argc, argv);
+
   if (argc < 5 || argc > 9) {
     const char *usage = R"usage(
 Usage:
@@ -62,6 +69,11 @@ Usage:
     /path/to/tokens.txt \
     [device] [num_threads] [decode_method, can be greedy_search/modified_beam_search] [hotwords_file] [hotwords_score]
 
+Optional, if the joiner is exported as two projections and an output layer.
+joiner.xml is then the output layer:
+  --joiner-encoder-proj=/path/to/joiner_encoder_proj.xml
+  --joiner-decoder-proj=/path/to/joiner_decoder_proj.xml
+
 )usage";
     fprintf(stderr, "%s\n", usage);
     fprintf(stderr, "argc, %d\n", argc);
@@ -71,9 +83,12 @@ Usage:
   signal(SIGINT, Handler);
 
   SherpaOVRecognizerConfig config;
+  memset(&config, 0, sizeof(config));
   config.model_config.encoder_xml = argv[1];
   config.model_config.decoder_xml = argv[2];
   config.model_config.joiner_xml = argv[3];
+  config.model_config.joiner_encoder_proj_xml = joiner_encoder_proj.c_str();
+  config.model_config.joiner_decoder_proj_xml = joiner_decoder_proj.c_str();
   config.model_config.tokens = argv[4];
 
   config.model_config.device = "CPU";
@@ -26,11 +26,17 @@
 #include <iostream>
 
 #include "recognizer.h"
+#include "runtime/core/cli-utils.h"
 #include "runtime/core/wave-reader.h"
 #include "model.h"
 #include "zipformer-model.h"
 
 int32_t main(int32_t argc, char *argv[]) {
+  std::string joiner_encoder_proj =
+      SherpaDeploy::TakeOption("joiner-encoder-proj", &argc, argv);
+  std::string joiner_decoder_proj =
+      SherpaDeploy::TakeOption("joiner-decoder-proj", &argc, argv);
+
   if (argc < 6 || argc > 10) {
     const char *usage = R"usage(
 Usage:
@@ -41,6 +47,11 @@ Usage:
     /path/to/tokens.txt \
     /path/to/foo.wav [num_threads] [decode_method, can be greedy_search/modified_beam_search] [hotwords_file] [hotwords_score]
 
+Optional, if the joiner is exported as two projections and an output layer.
+joiner.xml is then the output layer:
+  --joiner-encoder-proj=/path/to/joiner_encoder_proj.xml
+  --joiner-decoder-proj=/path/to/joiner_decoder_proj.xml
+
 )usage";
     std::cerr << usage << "\n";
 
@@ -52,6 +63,8 @@ Usage:
   config.model_config.encoder_xml = argv[1];
   config.model_config.decoder_xml = argv[2];
   config.model_config.joiner_xml = argv[3];
+  config.model_config.joiner_encoder_proj_xml = joiner_encoder_proj;
+  config.model_config.joiner_decoder_proj_xml = joiner_decoder_proj;
   config.model_config.tokens = argv[4];
   int32_t num_threads = 4;
   if (argc >= 7 && atoi(argv[6]) > 0) {
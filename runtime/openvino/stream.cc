@@ -48,6 +48,10 @@ class Stream::Impl {
     return feat_extractor_.GetFrames(frame_index + start_frame_index_, n);
   }
 
+  void GetFrames(int32_t frame_index, int32_t n, float *out) const {
+    feat_extractor_.GetFrames(frame_index + start_frame_index_, n, out);
+  }
+
   void Reset() {
     start_frame_index_ += num_processed_frames_;
     num_processed_frames_ = 0;
@@ -62,7 +66,7 @@ class Stream::Impl {
       iter->second.context_state = context_res.second;
     }
     auto hyp = result_.hyps.GetMostProbable(true);
-    result_.tokens = std::move(hyp.ys);
+    result_.tokens = hyp.Ys();
   }
 
   int32_t &GetNumProcessedFrames() { return num_processed_frames_; }
@@ -113,6 +117,10 @@ std::tuple<std::vector<float>, int32_t> Stream::GetFrames(int32_t frame_index, i
   return impl_->GetFrames(frame_index, n);
 }
 
+void Stream::GetFrames(int32_t frame_index, int32_t n, float *out) const {
+  impl_->GetFrames(frame_index, n, out);
+}
+
 void Stream::Reset() { impl_->Reset(); }
 
 void Stream::Finalize() { impl_->Finalize(); }
@@ -70,6 +70,12 @@ class Stream {
    */
   std::tuple<std::vector<float>, int32_t> GetFrames(int32_t frame_index, int32_t n) const;
 
+  /**
+   * Like the above, but write the frames into `out`, which must hold at
+   * least n * feature_dim floats. Use it to fill an input tensor directly.
+   */
+  void GetFrames(int32_t frame_index, int32_t n, float *out) const;
+
   void Reset();
 
   /**
@@ -6,6 +6,8 @@
 #include "zipformer-model.h"
 #include "openvino/openvino.hpp"
 
+#include <algorithm>
+#include <memory>
 #include <regex>  // NOLINT
 #include <string>
 #include <utility>
@@ -60,26 +62,90 @@ ZipformerModel::ZipformerModel(const ModelConfig &config) {
 
   device_ = config.device;
 
-  // There is a single infer request and we want it infer as qucikly as possible, therefore use LATENCY
-  core_->set_property(device_, ov::hint::performance_mode(ov::hint::PerformanceMode::LATENCY)); // LATENCY | THROUGHPUT
-  if (device_ == "CPU") {
-    // Refer to below link for properties in latency hint:
-    // https://docs.openvino.ai/2025/openvino-workflow/running-inference/inference-devices-and-modes/cpu-device/performance-hint-and-thread-scheduling.html#latency-hint
-    core_->set_property(device_, ov::num_streams(1)); // only one infer request at any time, so set to 1
-    core_->set_property(device_, ov::inference_num_threads(config.num_threads));
-    core_->set_property(device_, ov::hint::scheduling_core_type(ov::hint::SchedulingCoreType::ANY_CORE));
-    core_->set_property(device_, ov::hint::enable_hyper_threading(false));
-    core_->set_property(device_, ov::hint::enable_cpu_pinning(false));
+  throughput_ = config.performance_mode == "THROUGHPUT";
+  num_requests_ = config.num_requests;
+
+  if (throughput_) {
+    // Several infer requests run at the same time, one per stream in
+    // flight, and OpenVINO splits the cores among them. The total number
+    // of threads is capped only if the user asks for it.
+    core_->set_property(device_, ov::hint::performance_mode(ov::hint::PerformanceMode::THROUGHPUT));
+    if (device_ == "CPU") {
+      if (num_requests_ > 0) {
+        // One CPU stream per infer request, so that no request waits for
+        // another one to finish
+        core_->set_property(device_, ov::num_streams(num_requests_));
+      }
+      if (config.num_threads > 0) {
+        core_->set_property(device_, ov::inference_num_threads(config.num_threads));
+      }
+    }
+  } else {
+    // There is a single infer request and we want it infer as qucikly as possible, therefore use LATENCY
+    core_->set_property(device_, ov::hint::performance_mode(ov::hint::PerformanceMode::LATENCY)); // LATENCY | THROUGHPUT
+    if (device_ == "CPU") {
+      // Refer to below link for properties in latency hint:
+      // https://docs.openvino.ai/2025/openvino-workflow/running-inference/inference-devices-and-modes/cpu-device/performance-hint-and-thread-scheduling.html#latency-hint
+      core_->set_property(device_, ov::num_streams(1)); // only one infer request at any time, so set to 1
+      core_->set_property(device_, ov::inference_num_threads(std::max(config.num_threads, 1)));
+      core_->set_property(device_, ov::hint::scheduling_core_type(ov::hint::SchedulingCoreType::ANY_CORE));
+      core_->set_property(device_, ov::hint::enable_hyper_threading(false));
+      core_->set_property(device_, ov::hint::enable_cpu_pinning(false));
+    }
   }
 
   InitEncoder(config.encoder_xml);
   InitDecoder(config.decoder_xml);
   InitJoiner(config.joiner_xml);
-
+  InitJoinerProjections(config);
 }
 
+namespace {
+
+class ZipformerEncoderJob : public Model::EncoderJob {
+ public:
+  ZipformerEncoderJob(InferRequestPool::Handle request,
+                      const std::vector<std::string> *output_names)
+      : request_(std::make_unique<InferRequestPool::Handle>(std::move(request))),
+        output_names_(output_names) {}
+
+  ~ZipformerEncoderJob() override {
+    // Never hand a running request back to the pool
+    if (request_) (*request_)->wait();
+  }
+
+  std::pair<ov::Tensor, std::vector<ov::Tensor>> Wait() override {
+    InferRequestPool::Handle &request = *request_;
+    request->wait();
+
+    ov::Tensor encoder_out = request->get_tensor((*output_names_)[0]);
+
+    std::vector<ov::Tensor> next_states(output_names_->size() - 1);
+    for (size_t i=1; i<output_names_->size(); ++i) {
+      next_states[i-1] = request->get_tensor((*output_names_)[i]);
+    }
+
+    // The outputs were allocated for this run only, so the request can
+    // serve the next stream right away.
+    request_.reset();
+
+    return {encoder_out, next_states};
+  }
+
+ private:
+  std::unique_ptr<InferRequestPool::Handle> request_;
+  const std::vector<std::string> *output_names_;  // not owned
+};
+
+}  // namespace
+
 std::pair<ov::Tensor, std::vector<ov::Tensor>> ZipformerModel::RunEncoder(
     ov::Tensor features, const std::vector<ov::Tensor>& states) {
+  return StartEncoder(features, states)->Wait();
+}
+
+std::unique_ptr<Model::EncoderJob> ZipformerModel::StartEncoder(
+    ov::Tensor features, const std::vector<ov::Tensor>& states) {
   std::vector<ov::Tensor> _states;
 
   if (states.empty()) {
@@ -88,50 +154,116 @@ std::pair<ov::Tensor, std::vector<ov::Tensor>> ZipformerModel::RunEncoder(
     _states = states;
   }
 
-  encoder_infer_->set_tensor(encoder_input_names_[0], features);
-  // encoder_infer_->set_input_tensor(0, features);
+  InferRequestPool::Handle encoder_infer = encoder_pool_->Acquire();
 
-  for (size_t i = 1; i < encoder_input_names_.size(); ++i) {
-    encoder_infer_->set_tensor(encoder_input_names_[i], _states[i-1]);
-    // encoder_infer_->set_input_tensor(i, p[i-1]);
-  } 
+  encoder_infer->set_tensor(encoder_input_names_[0], features);
 
-  encoder_infer_->infer();
+  for (size_t i = 1; i < encoder_input_names_.size(); ++i) {
+    encoder_infer->set_tensor(encoder_input_names_[i], _states[i-1]);
+  }
 
-  // ov::Tensor encoder_out = encoder_infer_->get_output_tensor(0);
-  ov::Tensor encoder_out = encoder_infer_->get_tensor(encoder_output_names_[0]);
+  // The outputs become the states of the stream, so they must not be
+  // overwritten when the request is reused.
+  encoder_pool_->AllocateOutputs(&*encoder_infer);
 
-  std::vector<ov::Tensor> next_states(_states.size());
-  for (size_t i=1; i<encoder_output_names_.size(); ++i) {
-    next_states[i-1] = encoder_infer_->get_tensor(encoder_output_names_[i]);
-  }
+  encoder_infer->start_async();
 
-  return {encoder_out, next_states};
+  return std::make_unique<ZipformerEncoderJob>(std::move(encoder_infer),
+                                               &encoder_output_names_);
 }
 
 ov::Tensor ZipformerModel::RunDecoder(ov::Tensor decoder_input) {
+  InferRequestPool::Handle decoder_infer = decoder_pool_->Acquire();
 
-  decoder_infer_->set_tensor(decoder_input_names_[0], decoder_input);
+  decoder_infer->set_tensor(decoder_input_names_[0], decoder_input);
+  decoder_pool_->AllocateOutputs(&*decoder_infer);
 
-  decoder_infer_->infer();
+  decoder_infer->infer();
 
-  ov::Tensor decoder_out = decoder_infer_->get_output_tensor();
+  ov::Tensor decoder_out = decoder_infer->get_output_tensor();
 
   return decoder_out;
 }
 
 ov::Tensor ZipformerModel::RunJoiner(ov::Tensor encoder_out, ov::Tensor decoder_out) {
+  if (encoder_out.get_shape()[0] != 1 && joiner_batch_pool_) {
+    return RunBatchJoiner(encoder_out, decoder_out);
+  }
+
+  InferRequestPool::Handle joiner_infer = joiner_pool_->Acquire();
 
-  joiner_infer_->set_tensor(joiner_input_names_[0], encoder_out);
-  joiner_infer_->set_tensor(joiner_input_names_[1], decoder_out);
+  joiner_infer->set_tensor(joiner_input_names_[0], encoder_out);
+  joiner_infer->set_tensor(joiner_input_names_[1], decoder_out);
+  joiner_pool_->AllocateOutputs(&*joiner_infer);
 
-  joiner_infer_->infer();
+  joiner_infer->infer();
 
-  ov::Tensor joiner_out = joiner_infer_->get_output_tensor();
+  ov::Tensor joiner_out = joiner_infer->get_output_tensor();
 
   return joiner_out;
 }
 
+ov::Tensor ZipformerModel::RunBatchJoiner(ov::Tensor encoder_out,
+                                          ov::Tensor decoder_out) {
+  InferRequestPool::Handle joiner_infer = joiner_batch_pool_->Acquire();
+
+  joiner_infer->set_tensor(joiner_input_names_[0], encoder_out);
+  joiner_infer->set_tensor(joiner_input_names_[1], decoder_out);
+
+  joiner_infer->infer();
+
+  // The output shape is only known after the run, so the plugin owns the
+  // tensor. Copy it out before the request goes back to the pool.
+  ov::Tensor out = joiner_infer->get_output_tensor();
+  ov::Tensor joiner_out(out.get_element_type(), out.get_shape());
+  out.copy_to(joiner_out);
+
+  return joiner_out;
+}
+
+ov::Tensor ZipformerModel::RunProjection(InferRequestPool *pool,
+                                         ov::Tensor in) {
+  InferRequestPool::Handle infer = pool->Acquire();
+
+  infer->set_input_tensor(in);
+
+  infer->infer();
+
+  // As for the batch joiner, the plugin owns the output tensor
+  ov::Tensor out = infer->get_output_tensor();
+  ov::Tensor ans(out.get_element_type(), out.get_shape());
+  out.copy_to(ans);
+
+  return ans;
+}
+
+ov::Tensor ZipformerModel::ProjectEncoderOut(ov::Tensor encoder_out) {
+  if (!joiner_encoder_proj_pool_) {
+    return encoder_out;
+  }
+
+  return RunProjection(joiner_encoder_proj_pool_.get(), encoder_out);
+}
+
+ov::Tensor ZipformerModel::ProjectDecoderOut(ov::Tensor decoder_out) {
+  if (!joiner_decoder_proj_pool_) {
+    return decoder_out;
+  }
+
+  return RunProjection(joiner_decoder_proj_pool_.get(), decoder_out);
+}
+
+std::unique_ptr<InferRequestPool> ZipformerModel::CreatePool(
+    ov::CompiledModel *model) const {
+  int32_t num_requests = 1;
+  if (throughput_) {
+    num_requests = num_requests_ > 0
+                       ? num_requests_
+                       : model->get_property(ov::optimal_number_of_infer_requests);
+  }
+  return std::make_unique<InferRequestPool>(model, num_requests);
+}
+
 void ZipformerModel::InitEncoder(const std::string& ir_path) {
   std::shared_ptr<ov::Model> encoder_model = core_->read_model(ir_path);
 
@@ -157,8 +289,7 @@ void ZipformerModel::InitEncoder(const std::string& ir_path) {
   encoder_compile_model_ = std::make_shared<ov::CompiledModel>(
     std::move(core_->compile_model(encoder_model, device_)));
 
-  encoder_infer_ = std::make_shared<ov::InferRequest>(
-    std::move(encoder_compile_model_->create_infer_request()));
+  encoder_pool_ = CreatePool(encoder_compile_model_.get());
 
   auto inputs = encoder_model->inputs();
 #ifdef PRINT_MODEL_METADATA
@@ -254,8 +385,7 @@ void ZipformerModel::InitDecoder(const std::string& ir_path) {
   decoder_compile_model_ = std::make_shared<ov::CompiledModel>(
     std::move(core_->compile_model(decoder_model, device_)));
 
-  decoder_infer_ = std::make_shared<ov::InferRequest>(
-    std::move(decoder_compile_model_->create_infer_request()));
+  decoder_pool_ = CreatePool(decoder_compile_model_.get());
 
   auto inputs = decoder_compile_model_->inputs();
 #ifdef PRINT_MODEL_METADATA
@@ -300,6 +430,8 @@ void ZipformerModel::InitJoiner(const std::string& ir_path) {
 
   // contains dynamic shape, needs to reshape to fixed batch size
   if (joiner_model->is_dynamic()) {
+    InitBatchJoiner(joiner_model->clone());
+
     auto inputs = joiner_model->inputs();
 
     std::map<size_t, ov::PartialShape> idx_to_shape;
@@ -320,8 +452,7 @@ void ZipformerModel::InitJoiner(const std::string& ir_path) {
   joiner_compile_model_ = std::make_shared<ov::CompiledModel>(
     std::move(core_->compile_model(joiner_model, device_)));
 
-  joiner_infer_ = std::make_shared<ov::InferRequest>(
-    std::move(joiner_compile_model_->create_infer_request()));
+  joiner_pool_ = CreatePool(joiner_compile_model_.get());
 
   auto inputs = joiner_compile_model_->inputs();
 #ifdef PRINT_MODEL_METADATA
@@ -350,6 +481,69 @@ void ZipformerModel::InitJoiner(const std::string& ir_path) {
   }
 }
 
+void ZipformerModel::InitBatchJoiner(std::shared_ptr<ov::Model> joiner_model) {
+  // Keep the batch axis dynamic so that greedy search can run the joiner
+  // on all the frames of an encoder chunk at once. Other dynamic axes are
+  // fixed to 1 as for the single frame joiner.
+  auto inputs = joiner_model->inputs();
+
+  std::map<size_t, ov::PartialShape> idx_to_shape;
+  for (size_t i=0; i<inputs.size(); ++i) {
+
+    auto pshape = inputs[i].get_partial_shape();
+    if (pshape.size() == 0 || pshape[0].is_static()) {
+      // the batch size is baked into the model
+      return;
+    }
+
+    for (size_t j=1; j<pshape.size(); ++j) {
+      if (pshape[j].is_dynamic()) {
+        pshape[j] = 1;
+      }
+    }
+    idx_to_shape[i] = pshape;
+  }
+
+  joiner_model->reshape(idx_to_shape);
+
+  joiner_batch_compile_model_ = std::make_shared<ov::CompiledModel>(
+    std::move(core_->compile_model(joiner_model, device_)));
+
+  joiner_batch_pool_ = CreatePool(joiner_batch_compile_model_.get());
+}
+
+void ZipformerModel::InitJoinerProjections(const ModelConfig &config) {
+  if (config.joiner_encoder_proj_xml.empty() !=
+      config.joiner_decoder_proj_xml.empty()) {
+    fprintf(stderr,
+            "Please provide both the joiner encoder and decoder projections "
+            "or neither of them\n");
+    exit(-1);
+  }
+
+  if (config.joiner_encoder_proj_xml.empty()) {
+    return;
+  }
+
+  // A projection is a single linear layer, so its dynamic axes are left
+  // as they are. The encoder projection takes a whole chunk at once and
+  // the decoder projection all active paths.
+  std::shared_ptr<ov::Model> encoder_proj_model =
+      core_->read_model(config.joiner_encoder_proj_xml);
+  std::shared_ptr<ov::Model> decoder_proj_model =
+      core_->read_model(config.joiner_decoder_proj_xml);
+
+  joiner_encoder_proj_compile_model_ = std::make_shared<ov::CompiledModel>(
+    std::move(core_->compile_model(encoder_proj_model, device_)));
+  joiner_decoder_proj_compile_model_ = std::make_shared<ov::CompiledModel>(
+    std::move(core_->compile_model(decoder_proj_model, device_)));
+
+  joiner_encoder_proj_pool_ =
+      CreatePool(joiner_encoder_proj_compile_model_.get());
+  joiner_decoder_proj_pool_ =
+      CreatePool(joiner_decoder_proj_compile_model_.get());
+}
+
 std::vector<ov::Tensor> ZipformerModel::GetEncoderInitStates() const {
   if (model_type_ == "zipformer") {
     return GetEncoderInitStates1();
@@ -5,10 +5,12 @@
 
 #ifndef SHERPA_DEPLOY_OPENVINO_ZIPFORMER_MODEL_H_
 #define SHERPA_DEPLOY_OPENVINO_ZIPFORMER_MODEL_H_
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "infer-request-pool.h"
 #include "model.h"
 
 namespace MNN {
@@ -34,8 +36,15 @@ class ZipformerModel : public Model {
   std::pair<ov::Tensor, std::vector<ov::Tensor>> RunEncoder(
       ov::Tensor features, const std::vector<ov::Tensor>& states) override;
 
+  std::unique_ptr<EncoderJob> StartEncoder(
+      ov::Tensor features, const std::vector<ov::Tensor>& states) override;
+
   ov::Tensor RunDecoder(ov::Tensor decoder_input) override;
 
+  ov::Tensor ProjectEncoderOut(ov::Tensor encoder_out) override;
+
+  ov::Tensor ProjectDecoderOut(ov::Tensor decoder_out) override;
+
   ov::Tensor RunJoiner(ov::Tensor encoder_out, ov::Tensor decoder_out) override;
 
   int32_t Segment() const override {
@@ -55,14 +64,30 @@ class ZipformerModel : public Model {
 
   int32_t ContextSize() const override { return context_size_; }
 
+  int32_t NumRequests() const override { return encoder_pool_->Size(); }
+
+  bool SupportsBatchJoiner() const override {
+    return joiner_batch_pool_ != nullptr;
+  }
+
  private:
   void InitEncoder(const std::string& ir_path);
   void InitDecoder(const std::string& ir_path);
   void InitJoiner(const std::string& ir_path);
+  void InitBatchJoiner(std::shared_ptr<ov::Model> joiner_model);
+  void InitJoinerProjections(const ModelConfig &config);
+
+  ov::Tensor RunBatchJoiner(ov::Tensor encoder_out, ov::Tensor decoder_out);
+
+  // Run a joiner projection, which has a single input and a single output,
+  // and copy the output out of the request
+  static ov::Tensor RunProjection(InferRequestPool *pool, ov::Tensor in);
 
   std::vector<ov::Tensor> GetEncoderInitStates1() const;
   std::vector<ov::Tensor> GetEncoderInitStates2() const;
 
+  std::unique_ptr<InferRequestPool> CreatePool(ov::CompiledModel *model) const;
+
 #if __ANDROID_API__ >= 9
   void InitEncoder(AAssetManager *mgr, const std::string &encoder_param,
                    const std::string &encoder_bin);
@@ -76,15 +101,32 @@ class ZipformerModel : public Model {
   // ov::AnyMap cpu_config_;
   std::shared_ptr<ov::Core> core_;
   std::string device_; // CPU | GPU | AUTO
+  bool throughput_ = false;
+  int32_t num_requests_ = 0;
   // ov::Core core_;
 
   std::shared_ptr<ov::CompiledModel> encoder_compile_model_;
   std::shared_ptr<ov::CompiledModel> decoder_compile_model_;
   std::shared_ptr<ov::CompiledModel> joiner_compile_model_;
 
-  std::shared_ptr<ov::InferRequest> encoder_infer_;
-  std::shared_ptr<ov::InferRequest> decoder_infer_;
-  std::shared_ptr<ov::InferRequest> joiner_infer_;
+  // A single request each in LATENCY mode
+  std::unique_ptr<InferRequestPool> encoder_pool_;
+  std::unique_ptr<InferRequestPool> decoder_pool_;
+  std::unique_ptr<InferRequestPool> joiner_pool_;
+
+  // The joiner with a dynamic batch axis. Only available if the exported
+  // joiner has a dynamic batch axis; nullptr otherwise.
+  std::shared_ptr<ov::CompiledModel> joiner_batch_compile_model_;
+  std::unique_ptr<InferRequestPool> joiner_batch_pool_;
+
+  // Only available if the joiner is exported as separate projections and
+  // output layer; nullptr otherwise. joiner_xml is then the output layer,
+  // i.e., tanh followed by a linear layer. The input shapes are kept
+  // dynamic.
+  std::shared_ptr<ov::CompiledModel> joiner_encoder_proj_compile_model_;
+  std::shared_ptr<ov::CompiledModel> joiner_decoder_proj_compile_model_;
+  std::unique_ptr<InferRequestPool> joiner_encoder_proj_pool_;
+  std::unique_ptr<InferRequestPool> joiner_decoder_proj_pool_;
 
   std::string model_type_ = "zipformer";
 
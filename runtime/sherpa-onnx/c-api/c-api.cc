@@ -27,6 +27,7 @@
 #include "sherpa-onnx/csrc/offline-speech-denoiser.h"
 #include "sherpa-onnx/csrc/online-punctuation.h"
 #include "sherpa-onnx/csrc/online-recognizer.h"
+#include "sherpa-onnx/csrc/online-speech-denoiser.h"
 #include "sherpa-onnx/csrc/resample.h"
 #include "sherpa-onnx/csrc/speaker-embedding-extractor.h"
 #include "sherpa-onnx/csrc/speaker-embedding-manager.h"
@@ -1557,6 +1558,20 @@ void SherpaOnnxSpeakerEmbeddingExtractorDestroyEmbedding(const float *v) {
   delete[] v;
 }
 
+const float *SherpaOnnxSpeakerEmbeddingExtractorComputeEmbeddingBatch(
+    const SherpaOnnxSpeakerEmbeddingExtractor *p,
+    const SherpaOnnxOnlineStream **streams, int32_t n) {
+  std::vector<sherpa_onnx::OnlineStream *> ss(n);
+  for (int32_t i = 0; i != n; ++i) {
+    ss[i] = streams[i]->impl.get();
+  }
+
+  std::vector<float> v = p->impl->ComputeBatch(ss.data(), n);
+  float *ans = new float[v.size()];
+  std::copy(v.begin(), v.end(), ans);
+  return ans;
+}
+
 struct SherpaOnnxSpeakerEmbeddingManager {
   std::unique_ptr<sherpa_onnx::SpeakerEmbeddingManager> impl;
 };
@@ -1981,13 +1996,22 @@ struct SherpaOnnxOfflineSpeechDenoiser {
   std::unique_ptr<sherpa_onnx::OfflineSpeechDenoiser> impl;
 };
 
+static sherpa_onnx::OfflineSpeechDenoiserModelConfig
+GetOfflineSpeechDenoiserModelConfig(
+    const SherpaOnnxOfflineSpeechDenoiserModelConfig *config) {
+  sherpa_onnx::OfflineSpeechDenoiserModelConfig c;
+  c.gtcrn.model = SHERPA_ONNX_OR(config->gtcrn.model, "");
+  c.num_threads = SHERPA_ONNX_OR(config->num_threads, 1);
+  c.debug = config->debug;
+  c.provider = SHERPA_ONNX_OR(config->provider, "cpu");
+
+  return c;
+}
+
 static sherpa_onnx::OfflineSpeechDenoiserConfig GetOfflineSpeechDenoiserConfig(
     const SherpaOnnxOfflineSpeechDenoiserConfig *config) {
   sherpa_onnx::OfflineSpeechDenoiserConfig c;
-  c.model.gtcrn.model = SHERPA_ONNX_OR(config->model.gtcrn.model, "");
-  c.model.num_threads = SHERPA_ONNX_OR(config->model.num_threads, 1);
-  c.model.debug = config->model.debug;
-  c.model.provider = SHERPA_ONNX_OR(config->model.provider, "cpu");
+  c.model = GetOfflineSpeechDenoiserModelConfig(&config->model);
 
   if (c.model.debug) {
 #if __OHOS__
@@ -2026,11 +2050,8 @@ int32_t SherpaOnnxOfflineSpeechDenoiserGetSampleRate(
   return sd->impl->GetSampleRate();
 }
 
-const SherpaOnnxDenoisedAudio *SherpaOnnxOfflineSpeechDenoiserRun(
-    const SherpaOnnxOfflineSpeechDenoiser *sd, const float *samples, int32_t n,
-    int32_t sample_rate) {
-  auto audio = sd->impl->Run(samples, n, sample_rate);
-
+static const SherpaOnnxDenoisedAudio *ToDenoisedAudio(
+    const sherpa_onnx::DenoisedAudio &audio) {
   auto ans = new SherpaOnnxDenoisedAudio;
 
   float *denoised_samples = new float[audio.samples.size()];
@@ -2043,11 +2064,77 @@ const SherpaOnnxDenoisedAudio *SherpaOnnxOfflineSpeechDenoiserRun(
   return ans;
 }
 
+const SherpaOnnxDenoisedAudio *SherpaOnnxOfflineSpeechDenoiserRun(
+    const SherpaOnnxOfflineSpeechDenoiser *sd, const float *samples, int32_t n,
+    int32_t sample_rate) {
+  return ToDenoisedAudio(sd->impl->Run(samples, n, sample_rate));
+}
+
 void SherpaOnnxDestroyDenoisedAudio(const SherpaOnnxDenoisedAudio *p) {
   delete[] p->samples;
   delete p;
 }
 
+struct SherpaOnnxOnlineSpeechDenoiser {
+  std::unique_ptr<sherpa_onnx::OnlineSpeechDenoiser> impl;
+};
+
+const SherpaOnnxOnlineSpeechDenoiser *SherpaOnnxCreateOnlineSpeechDenoiser(
+    const SherpaOnnxOnlineSpeechDenoiserConfig *config) {
+  sherpa_onnx::OnlineSpeechDenoiserConfig sd_config;
+  sd_config.model = GetOfflineSpeechDenoiserModelConfig(&config->model);
+
+  if (sd_config.model.debug) {
+#if __OHOS__
+    SHERPA_ONNX_LOGE("%{public}s\n", sd_config.ToString().c_str());
+#else
+    SHERPA_ONNX_LOGE("%s\n", sd_config.ToString().c_str());
+#endif
+  }
+
+  if (!sd_config.Validate()) {
+    SHERPA_ONNX_LOGE("Errors in config");
+    return nullptr;
+  }
+
+  SherpaOnnxOnlineSpeechDenoiser *sd = new SherpaOnnxOnlineSpeechDenoiser;
+
+  sd->impl = std::make_unique<sherpa_onnx::OnlineSpeechDenoiser>(sd_config);
+
+  return sd;
+}
+
+void SherpaOnnxDestroyOnlineSpeechDenoiser(
+    const SherpaOnnxOnlineSpeechDenoiser *sd) {
+  delete sd;
+}
+
+int32_t SherpaOnnxOnlineSpeechDenoiserGetSampleRate(
+    const SherpaOnnxOnlineSpeechDenoiser *sd) {
+  return sd->impl->GetSampleRate();
+}
+
+int32_t SherpaOnnxOnlineSpeechDenoiserGetFrameShiftInSamples(
+    const SherpaOnnxOnlineSpeechDenoiser *sd) {
+  return sd->impl->GetFrameShiftInSamples();
+}
+
+const SherpaOnnxDenoisedAudio *SherpaOnnxOnlineSpeechDenoiserRun(
+    const SherpaOnnxOnlineSpeechDenoiser *sd, const float *samples, int32_t n,
+    int32_t sample_rate) {
+  return ToDenoisedAudio(sd->impl->Run(samples, n, sample_rate));
+}
+
+const SherpaOnnxDenoisedAudio *SherpaOnnxOnlineSpeechDenoiserFlush(
+    const SherpaOnnxOnlineSpeechDenoiser *sd) {
+  return ToDenoisedAudio(sd->impl->Flush());
+}
+
+void SherpaOnnxOnlineSpeechDenoiserReset(
+    const SherpaOnnxOnlineSpeechDenoiser *sd) {
+  sd->impl->Reset();
+}
+
 #if SHERPA_ONNX_ENABLE_SPEAKER_DIARIZATION == 1
 
 struct SherpaOnnxOfflineSpeakerDiarization {
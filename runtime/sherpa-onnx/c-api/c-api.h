@@ -1199,6 +1199,20 @@ SherpaOnnxSpeakerEmbeddingExtractorComputeEmbedding(
 SHERPA_ONNX_API void SherpaOnnxSpeakerEmbeddingExtractorDestroyEmbedding(
     const float *v);
 
+// Compute the embeddings of n streams at once.
+//
+// @return Return a pointer pointing to an array of n * dim floats, where dim
+// is returned by SherpaOnnxSpeakerEmbeddingExtractorDim(p). The i-th
+// embedding starts at index i * dim. It is all zeros if streams[i]
+// is not ready.
+//
+// The user has to invoke SherpaOnnxSpeakerEmbeddingExtractorDestroyEmbedding()
+// to free the returned pointer to avoid memory leak.
+SHERPA_ONNX_API const float *
+SherpaOnnxSpeakerEmbeddingExtractorComputeEmbeddingBatch(
+    const SherpaOnnxSpeakerEmbeddingExtractor *p,
+    const SherpaOnnxOnlineStream **streams, int32_t n);
+
 SHERPA_ONNX_API typedef struct SherpaOnnxSpeakerEmbeddingManager
     SherpaOnnxSpeakerEmbeddingManager;
 
@@ -1701,6 +1715,64 @@ SherpaOnnxOfflineSpeechDenoiserRun(const SherpaOnnxOfflineSpeechDenoiser *sd,
 SHERPA_ONNX_API void SherpaOnnxDestroyDenoisedAudio(
     const SherpaOnnxDenoisedAudio *p);
 
+// =========================================================================
+// For online speech enhancement
+// =========================================================================
+SHERPA_ONNX_API typedef struct SherpaOnnxOnlineSpeechDenoiserConfig {
+  // The same models are used for offline and online speech enhancement
+  SherpaOnnxOfflineSpeechDenoiserModelConfig model;
+} SherpaOnnxOnlineSpeechDenoiserConfig;
+
+SHERPA_ONNX_API typedef struct SherpaOnnxOnlineSpeechDenoiser
+    SherpaOnnxOnlineSpeechDenoiser;
+
+// The users has to invoke SherpaOnnxDestroyOnlineSpeechDenoiser()
+// to free the returned pointer to avoid memory leak
+SHERPA_ONNX_API const SherpaOnnxOnlineSpeechDenoiser *
+SherpaOnnxCreateOnlineSpeechDenoiser(
+    const SherpaOnnxOnlineSpeechDenoiserConfig *config);
+
+// Free the pointer returned by SherpaOnnxCreateOnlineSpeechDenoiser()
+SHERPA_ONNX_API void SherpaOnnxDestroyOnlineSpeechDenoiser(
+    const SherpaOnnxOnlineSpeechDenoiser *sd);
+
+SHERPA_ONNX_API int32_t SherpaOnnxOnlineSpeechDenoiserGetSampleRate(
+    const SherpaOnnxOnlineSpeechDenoiser *sd);
+
+// For the lowest latency, pass a multiple of it to each call of
+// SherpaOnnxOnlineSpeechDenoiserRun()
+SHERPA_ONNX_API int32_t SherpaOnnxOnlineSpeechDenoiserGetFrameShiftInSamples(
+    const SherpaOnnxOnlineSpeechDenoiser *sd);
+
+// Run speech denosing on a chunk of input samples
+// @param samples  A 1-D array containing the input audio samples. Each sample
+//           should be in the range [-1, 1]. It can be of any length.
+// @param n  Number of samples
+// @param sample_rate Sample rate of the input samples
+//
+// @return Denoised samples that are ready. It may contain fewer samples than
+//         the input since samples are returned only after all frames
+//         overlapping them are processed.
+//
+// The user MUST use SherpaOnnxDestroyDenoisedAudio() to free the returned
+// pointer to avoid memory leak.
+SHERPA_ONNX_API const SherpaOnnxDenoisedAudio *
+SherpaOnnxOnlineSpeechDenoiserRun(const SherpaOnnxOnlineSpeechDenoiser *sd,
+                                  const float *samples, int32_t n,
+                                  int32_t sample_rate);
+
+// Return the denoised remaining samples at the end of a stream and reset
+// the denoiser.
+//
+// The user MUST use SherpaOnnxDestroyDenoisedAudio() to free the returned
+// pointer to avoid memory leak.
+SHERPA_ONNX_API const SherpaOnnxDenoisedAudio *
+SherpaOnnxOnlineSpeechDenoiserFlush(const SherpaOnnxOnlineSpeechDenoiser *sd);
+
+// Discard buffered samples and reset the denoiser for a new stream
+SHERPA_ONNX_API void SherpaOnnxOnlineSpeechDenoiserReset(
+    const SherpaOnnxOnlineSpeechDenoiser *sd);
+
 #ifdef __OHOS__
 
 // It is for HarmonyOS
@@ -6,6 +6,9 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <array>
+#include <map>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -55,6 +58,11 @@ class AudioTaggingCEDImpl : public AudioTaggingImpl {
 
   std::vector<AudioEvent> Compute(OfflineStream *s,
                                   int32_t top_k = -1) const override {
+    return Compute(&s, 1, top_k)[0];
+  }
+
+  std::vector<std::vector<AudioEvent>> Compute(
+      OfflineStream **ss, int32_t n, int32_t top_k = -1) const override {
     if (top_k < 0) {
       top_k = config_.top_k;
     }
@@ -65,26 +73,68 @@ class AudioTaggingCEDImpl : public AudioTaggingImpl {
       top_k = num_event_classes;
     }
 
+    // WARNING(fangjun): It is fixed to 64 for CED models
+    int32_t feat_dim = 64;
+
+    std::vector<std::vector<float>> features(n);
+
+    // The model has no input for the number of valid frames, so padding
+    // would change the result. Only streams of the same length are batched.
+    // num_frames -> indexes of streams
+    std::map<int32_t, std::vector<int32_t>> groups;
+    for (int32_t i = 0; i != n; ++i) {
+      features[i] = ss[i]->GetFrames();
+      int32_t num_frames = features[i].size() / feat_dim;
+      assert(feat_dim * num_frames == static_cast<int32_t>(features[i].size()));
+
+      groups[num_frames].push_back(i);
+    }
+
     auto memory_info =
         Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
 
-    // WARNING(fangjun): It is fixed to 64 for CED models
-    int32_t feat_dim = 64;
-    std::vector<float> f = s->GetFrames();
+    std::vector<std::vector<AudioEvent>> ans(n);
+
+    for (const auto &g : groups) {
+      int32_t num_frames = g.first;
+      const auto &indexes = g.second;
+
+      for (int32_t start = 0; start < static_cast<int32_t>(indexes.size());
+           start += kMaxBatchSize) {
+        int32_t batch_size = std::min<int32_t>(kMaxBatchSize,
+                                               indexes.size() - start);
 
-    int32_t num_frames = f.size() / feat_dim;
-    assert(feat_dim * num_frames == static_cast<int32_t>(f.size()));
+        std::vector<float> x_buf;
+        x_buf.reserve(batch_size * num_frames * feat_dim);
+        for (int32_t i = 0; i != batch_size; ++i) {
+          const auto &f = features[indexes[start + i]];
+          x_buf.insert(x_buf.end(), f.begin(), f.end());
+        }
 
-    std::array<int64_t, 3> shape = {1, num_frames, feat_dim};
+        std::array<int64_t, 3> shape = {batch_size, num_frames, feat_dim};
 
-    Ort::Value x = Ort::Value::CreateTensor(memory_info, f.data(), f.size(),
-                                            shape.data(), shape.size());
+        Ort::Value x =
+            Ort::Value::CreateTensor(memory_info, x_buf.data(), x_buf.size(),
+                                     shape.data(), shape.size());
 
-    Ort::Value probs = model_.Forward(std::move(x));
+        Ort::Value probs = model_.Forward(std::move(x));
+
+        const float *p = probs.GetTensorData<float>();
+        for (int32_t i = 0; i != batch_size; ++i) {
+          ans[indexes[start + i]] =
+              GetEvents(p + i * num_event_classes, top_k);
+        }
+      }
+    }
 
-    const float *p = probs.GetTensorData<float>();
+    return ans;
+  }
 
-    std::vector<int32_t> top_k_indexes = TopkIndex(p, num_event_classes, top_k);
+ private:
+  // @param p Probabilities of all event classes of a stream
+  std::vector<AudioEvent> GetEvents(const float *p, int32_t top_k) const {
+    std::vector<int32_t> top_k_indexes =
+        TopkIndex(p, model_.NumEventClasses(), top_k);
 
     std::vector<AudioEvent> ans(top_k);
 
@@ -100,7 +150,8 @@ class AudioTaggingCEDImpl : public AudioTaggingImpl {
     return ans;
   }
 
- private:
+  static constexpr int32_t kMaxBatchSize = 32;
+
   AudioTaggingConfig config_;
   OfflineCEDModel model_;
   AudioTaggingLabels labels_;
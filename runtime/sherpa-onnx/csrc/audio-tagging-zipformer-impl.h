@@ -6,6 +6,8 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -18,6 +20,7 @@
 #include "sherpa-onnx/csrc/audio-tagging-impl.h"
 #include "sherpa-onnx/csrc/audio-tagging-label-file.h"
 #include "sherpa-onnx/csrc/audio-tagging.h"
+#include "sherpa-onnx/csrc/length-batcher.h"
 #include "sherpa-onnx/csrc/macros.h"
 #include "sherpa-onnx/csrc/math.h"
 #include "sherpa-onnx/csrc/offline-zipformer-audio-tagging-model.h"
@@ -55,6 +58,11 @@ class AudioTaggingZipformerImpl : public AudioTaggingImpl {
 
   std::vector<AudioEvent> Compute(OfflineStream *s,
                                   int32_t top_k = -1) const override {
+    return Compute(&s, 1, top_k)[0];
+  }
+
+  std::vector<std::vector<AudioEvent>> Compute(
+      OfflineStream **ss, int32_t n, int32_t top_k = -1) const override {
     if (top_k < 0) {
       top_k = config_.top_k;
     }
@@ -65,33 +73,72 @@ class AudioTaggingZipformerImpl : public AudioTaggingImpl {
       top_k = num_event_classes;
     }
 
-    auto memory_info =
-        Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
-
     // WARNING(fangjun): It is fixed to 80 for all models from icefall
     int32_t feat_dim = 80;
-    std::vector<float> f = s->GetFrames();
 
-    int32_t num_frames = f.size() / feat_dim;
+    std::vector<std::vector<float>> features(n);
+    std::vector<int32_t> num_frames(n);
+    for (int32_t i = 0; i != n; ++i) {
+      features[i] = ss[i]->GetFrames();
+      num_frames[i] = features[i].size() / feat_dim;
 
-    assert(feat_dim * num_frames == static_cast<int32_t>(f.size()));
-
-    std::array<int64_t, 3> shape = {1, num_frames, feat_dim};
-
-    Ort::Value x = Ort::Value::CreateTensor(memory_info, f.data(), f.size(),
-                                            shape.data(), shape.size());
+      assert(feat_dim * num_frames[i] ==
+             static_cast<int32_t>(features[i].size()));
+    }
 
-    int64_t x_length_scalar = num_frames;
-    std::array<int64_t, 1> x_length_shape = {1};
-    Ort::Value x_length =
-        Ort::Value::CreateTensor(memory_info, &x_length_scalar, 1,
-                                 x_length_shape.data(), x_length_shape.size());
+    auto memory_info =
+        Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
 
-    Ort::Value probs = model_.Forward(std::move(x), std::move(x_length));
+    std::vector<std::vector<AudioEvent>> ans(n);
+
+    // The model takes the number of valid frames of each stream, so the
+    // padding does not change the result. Streams of similar lengths are
+    // batched together to reduce the padding.
+    LengthBatcher batcher(kMaxBatchSize, 0);
+    for (const auto &indexes : batcher.Split(num_frames)) {
+      int32_t batch_size = indexes.size();
+
+      int32_t max_num_frames = 0;
+      for (int32_t k : indexes) {
+        max_num_frames = std::max(max_num_frames, num_frames[k]);
+      }
+
+      std::vector<float> x_buf(batch_size * max_num_frames * feat_dim,
+                               kPaddingValue);
+      std::vector<int64_t> x_length_buf(batch_size);
+      for (int32_t i = 0; i != batch_size; ++i) {
+        int32_t k = indexes[i];
+        std::copy(features[k].begin(), features[k].end(),
+                  x_buf.begin() + i * max_num_frames * feat_dim);
+        x_length_buf[i] = num_frames[k];
+      }
+
+      std::array<int64_t, 3> shape = {batch_size, max_num_frames, feat_dim};
+
+      Ort::Value x = Ort::Value::CreateTensor(
+          memory_info, x_buf.data(), x_buf.size(), shape.data(), shape.size());
+
+      std::array<int64_t, 1> x_length_shape = {batch_size};
+      Ort::Value x_length = Ort::Value::CreateTensor(
+          memory_info, x_length_buf.data(), x_length_buf.size(),
+          x_length_shape.data(), x_length_shape.size());
+
+      Ort::Value probs = model_.Forward(std::move(x), std::move(x_length));
+
+      const float *p = probs.GetTensorData<float>();
+      for (int32_t i = 0; i != batch_size; ++i) {
+        ans[indexes[i]] = GetEvents(p + i * num_event_classes, top_k);
+      }
+    }
 
-    const float *p = probs.GetTensorData<float>();
+    return ans;
+  }
 
-    std::vector<int32_t> top_k_indexes = TopkIndex(p, num_event_classes, top_k);
+ private:
+  // @param p Probabilities of all event classes of a stream
+  std::vector<AudioEvent> GetEvents(const float *p, int32_t top_k) const {
+    std::vector<int32_t> top_k_indexes =
+        TopkIndex(p, model_.NumEventClasses(), top_k);
 
     std::vector<AudioEvent> ans(top_k);
 
@@ -107,7 +154,11 @@ class AudioTaggingZipformerImpl : public AudioTaggingImpl {
     return ans;
   }
 
- private:
+  static constexpr int32_t kMaxBatchSize = 32;
+
+  // log(1e-10), the same value used to pad features for ASR
+  static constexpr float kPaddingValue = -23.025850929940457f;
+
   AudioTaggingConfig config_;
   OfflineZipformerAudioTaggingModel model_;
   AudioTaggingLabels labels_;
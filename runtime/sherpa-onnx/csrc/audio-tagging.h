@@ -65,6 +65,11 @@ class AudioTagging {
   // Return top_k AudioEvent. ans[0].prob is the largest of all returned events.
   std::vector<AudioEvent> Compute(OfflineStream *s, int32_t top_k = -1) const;
 
+  // Compute the events of n streams with batched model runs.
+  // ans[i] contains the events of ss[i]. See the above Compute() for top_k.
+  std::vector<std::vector<AudioEvent>> Compute(OfflineStream **ss, int32_t n,
+                                               int32_t top_k = -1) const;
+
  private:
   std::unique_ptr<AudioTaggingImpl> impl_;
 };
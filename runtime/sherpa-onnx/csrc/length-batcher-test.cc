@@ -0,0 +1,64 @@
+// sherpa-onnx/csrc/length-batcher-test.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-onnx/csrc/length-batcher.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace sherpa_onnx {
+
+TEST(LengthBatcher, Split) {
+  std::vector<int32_t> lengths = {200, 3000, 250, 2900, 220, 100};
+
+  LengthBatcher batcher(3, 6000);
+  auto batches = batcher.Split(lengths);
+
+  std::vector<std::vector<int32_t>> expected = {{1, 3}, {2, 4, 0}, {5}};
+  EXPECT_EQ(batches, expected);
+
+  // Without a limit on the padded frames, only max_batch_size matters
+  batches = LengthBatcher(4, 0).Split(lengths);
+  expected = {{1, 3, 2, 4}, {0, 5}};
+  EXPECT_EQ(batches, expected);
+}
+
+TEST(LengthBatcher, SplitLongUtterance) {
+  // An utterance longer than max_padded_frames gets its own batch
+  auto batches = LengthBatcher(8, 100).Split({500, 10, 20});
+
+  std::vector<std::vector<int32_t>> expected = {{0}, {2, 1}};
+  EXPECT_EQ(batches, expected);
+}
+
+TEST(LengthBatcher, Select) {
+  std::vector<int32_t> lengths = {250, 3000, 200, 2900, 260, 100};
+
+  // The oldest one is always selected, together with the closest ones
+  LengthBatcher batcher(3, 6000);
+  std::vector<int32_t> expected = {0, 2, 4};
+  EXPECT_EQ(batcher.Select(lengths), expected);
+
+  lengths.erase(lengths.begin());
+  lengths.erase(lengths.begin() + 1);
+  lengths.erase(lengths.begin() + 2);
+  // lengths is {3000, 2900, 100}
+  expected = {0, 1};
+  EXPECT_EQ(batcher.Select(lengths), expected);
+
+  EXPECT_EQ(batcher.Select({100}), std::vector<int32_t>{0});
+}
+
+TEST(PaddingStats, Efficiency) {
+  PaddingStats stats;
+  EXPECT_EQ(stats.Efficiency(), 1);
+
+  stats.Add({100, 50});
+  EXPECT_EQ(stats.num_frames, 150);
+  EXPECT_EQ(stats.num_padded_frames, 200);
+  EXPECT_FLOAT_EQ(stats.Efficiency(), 0.75);
+}
+
+}  // namespace sherpa_onnx
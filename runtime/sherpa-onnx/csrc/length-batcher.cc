@@ -0,0 +1,124 @@
+// sherpa-onnx/csrc/length-batcher.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-onnx/csrc/length-batcher.h"
+
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace sherpa_onnx {
+
+bool LengthBatcher::Fits(int32_t batch_size, int32_t max_length) const {
+  if (batch_size > max_batch_size_) {
+    return false;
+  }
+
+  return max_padded_frames_ <= 0 ||
+         static_cast<int64_t>(batch_size) * max_length <= max_padded_frames_;
+}
+
+std::vector<std::vector<int32_t>> LengthBatcher::Split(
+    const std::vector<int32_t> &lengths) const {
+  std::vector<int32_t> indexes(lengths.size());
+  std::iota(indexes.begin(), indexes.end(), 0);
+
+  std::stable_sort(
+      indexes.begin(), indexes.end(),
+      [&lengths](int32_t a, int32_t b) { return lengths[a] > lengths[b]; });
+
+  std::vector<std::vector<int32_t>> ans;
+  std::vector<int32_t> batch;
+  int32_t max_length = 0;
+  for (int32_t i : indexes) {
+    // Utterances are sorted in descending order, so the first one of a
+    // batch is also the longest
+    if (!batch.empty() && !Fits(batch.size() + 1, max_length)) {
+      ans.push_back(std::move(batch));
+      batch.clear();
+    }
+
+    if (batch.empty()) {
+      max_length = lengths[i];
+    }
+    batch.push_back(i);
+  }
+
+  if (!batch.empty()) {
+    ans.push_back(std::move(batch));
+  }
+
+  return ans;
+}
+
+std::vector<int32_t> LengthBatcher::Select(
+    const std::vector<int32_t> &lengths) const {
+  std::vector<int32_t> indexes(lengths.size());
+  std::iota(indexes.begin(), indexes.end(), 0);
+
+  std::stable_sort(
+      indexes.begin(), indexes.end(),
+      [&lengths](int32_t a, int32_t b) { return lengths[a] < lengths[b]; });
+
+  int32_t n = static_cast<int32_t>(indexes.size());
+  int32_t pos =
+      std::find(indexes.begin(), indexes.end(), 0) - indexes.begin();
+
+  // The selected utterances are indexes[begin..end)
+  int32_t begin = pos;
+  int32_t end = pos + 1;
+  while (end - begin < max_batch_size_) {
+    int32_t batch_size = end - begin + 1;
+    int32_t max_length = lengths[indexes[end - 1]];
+
+    // Padding added by taking the next shorter or the next longer one
+    int64_t left_cost = -1;
+    if (begin > 0 && Fits(batch_size, max_length)) {
+      left_cost = max_length - lengths[indexes[begin - 1]];
+    }
+
+    int64_t right_cost = -1;
+    if (end < n && Fits(batch_size, lengths[indexes[end]])) {
+      right_cost = static_cast<int64_t>(lengths[indexes[end]] - max_length) *
+                   (batch_size - 1);
+    }
+
+    if (left_cost < 0 && right_cost < 0) {
+      break;
+    }
+
+    if (right_cost < 0 || (left_cost >= 0 && left_cost <= right_cost)) {
+      --begin;
+    } else {
+      ++end;
+    }
+  }
+
+  std::vector<int32_t> ans(indexes.begin() + begin, indexes.begin() + end);
+  std::sort(ans.begin(), ans.end());
+  return ans;
+}
+
+void PaddingStats::Add(const std::vector<int32_t> &lengths) {
+  if (lengths.empty()) {
+    return;
+  }
+
+  num_frames += std::accumulate(lengths.begin(), lengths.end(), int64_t{0});
+  num_padded_frames += static_cast<int64_t>(lengths.size()) *
+                       *std::max_element(lengths.begin(), lengths.end());
+}
+
+std::string PaddingStats::ToString() const {
+  std::ostringstream os;
+  os << "PaddingStats(";
+  os << "num_frames=" << num_frames << ", ";
+  os << "num_padded_frames=" << num_padded_frames << ", ";
+  os << "efficiency=" << Efficiency() << ")";
+  return os.str();
+}
+
+}  // namespace sherpa_onnx
@@ -0,0 +1,76 @@
+// sherpa-onnx/csrc/length-batcher.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+#ifndef SHERPA_ONNX_CSRC_LENGTH_BATCHER_H_
+#define SHERPA_ONNX_CSRC_LENGTH_BATCHER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sherpa_onnx {
+
+// Group utterances of similar lengths into batches.
+//
+// Non-streaming models pad every utterance in a batch to the longest one,
+// so a batch mixing a 2 s and a 30 s utterance spends most of its time on
+// padding. The cost of a batch is batch_size * max_length, which is capped
+// by max_padded_frames instead of using a fixed number of utterances.
+class LengthBatcher {
+ public:
+  /* @param max_batch_size Max number of utterances in a batch.
+   * @param max_padded_frames Max of batch_size * max_length of a batch.
+   *                          A batch always contains at least one
+   *                          utterance, even if it is longer than this
+   *                          value. Use 0 for no limit.
+   */
+  LengthBatcher(int32_t max_batch_size, int32_t max_padded_frames)
+      : max_batch_size_(max_batch_size),
+        max_padded_frames_(max_padded_frames) {}
+
+  /* Split all utterances into batches.
+   *
+   * @param lengths lengths[i] is the number of frames of the i-th utterance
+   * @return Indexes into lengths of each batch. Longer batches come first.
+   */
+  std::vector<std::vector<int32_t>> Split(
+      const std::vector<int32_t> &lengths) const;
+
+  /* Select one batch from pending utterances.
+   *
+   * The oldest utterance, lengths[0], is always selected so that no
+   * utterance waits forever. The others are those closest to it in length.
+   *
+   * @param lengths lengths[i] is the number of frames of the i-th pending
+   *                utterance, in arrival order. It must not be empty.
+   * @return Sorted indexes into lengths of the selected utterances.
+   */
+  std::vector<int32_t> Select(const std::vector<int32_t> &lengths) const;
+
+ private:
+  bool Fits(int32_t batch_size, int32_t max_length) const;
+
+ private:
+  int32_t max_batch_size_;
+  int32_t max_padded_frames_;
+};
+
+// Ratio of real frames to padded frames of the batches seen so far
+struct PaddingStats {
+  int64_t num_frames = 0;
+  int64_t num_padded_frames = 0;
+
+  // Add a batch containing utterances of the given lengths
+  void Add(const std::vector<int32_t> &lengths);
+
+  float Efficiency() const {
+    return num_padded_frames ? static_cast<float>(num_frames) / num_padded_frames
+                             : 1;
+  }
+
+  std::string ToString() const;
+};
+
+}  // namespace sherpa_onnx
+
+#endif  // SHERPA_ONNX_CSRC_LENGTH_BATCHER_H_
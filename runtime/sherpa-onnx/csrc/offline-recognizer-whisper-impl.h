@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <cmath>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
@@ -15,6 +16,7 @@
 #include "sherpa-onnx/csrc/offline-model-config.h"
 #include "sherpa-onnx/csrc/offline-recognizer-impl.h"
 #include "sherpa-onnx/csrc/offline-recognizer.h"
+#include "sherpa-onnx/csrc/offline-whisper-beam-search-decoder.h"
 #include "sherpa-onnx/csrc/offline-whisper-decoder.h"
 #include "sherpa-onnx/csrc/offline-whisper-greedy-search-decoder.h"
 #include "sherpa-onnx/csrc/offline-whisper-model.h"
@@ -51,9 +53,14 @@ class OfflineRecognizerWhisperImpl : public OfflineRecognizerImpl {
     if (config_.decoding_method == "greedy_search") {
       decoder_ = std::make_unique<OfflineWhisperGreedySearchDecoder>(
           config_.model_config.whisper, model_.get());
+    } else if (config_.decoding_method == "modified_beam_search") {
+      decoder_ = std::make_unique<OfflineWhisperBeamSearchDecoder>(
+          config_.model_config.whisper, model_.get(),
+          config_.max_active_paths);
     } else {
       SHERPA_ONNX_LOGE(
-          "Only greedy_search is supported at present for whisper. Given %s",
+          "Only greedy_search and modified_beam_search are supported for "
+          "whisper. Given %s",
           config_.decoding_method.c_str());
       exit(-1);
     }
@@ -66,9 +73,52 @@ class OfflineRecognizerWhisperImpl : public OfflineRecognizerImpl {
   }
 
   void DecodeStreams(OfflineStream **ss, int32_t n) const override {
-    // batch decoding is not implemented yet
+    decoder_->SetConfig(config_.model_config.whisper);
+
+    int32_t max_num_frames = 3000;
+
+    std::vector<std::vector<float>> features(n);
+    std::vector<int32_t> num_frames(n);
+
+    for (int32_t i = 0; i != n; ++i) {
+      int32_t feat_dim = ss[i]->FeatureDim();
+      features[i] = ss[i]->GetFrames();
+      num_frames[i] = features[i].size() / feat_dim;
+
+      // we use 50 here so that there will be some zero tail paddings
+      if (num_frames[i] >= max_num_frames - 50) {
+        SHERPA_ONNX_LOGE(
+            "Only waves less than 30 seconds are supported. We process only "
+            "the first 30 seconds and discard the remaining data");
+        num_frames[i] = max_num_frames - 50;
+      }
+
+      model_->NormalizeFeatures(features[i].data(), num_frames[i], feat_dim);
+    }
+
+    // Streams of similar lengths are decoded together, so that little
+    // padding is needed to give all streams of a batch the same length
+    std::vector<int32_t> indexes(n);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::stable_sort(indexes.begin(), indexes.end(),
+                     [&num_frames](int32_t a, int32_t b) {
+                       return num_frames[a] < num_frames[b];
+                     });
+
+    std::vector<OfflineStream *> sorted_ss(n);
+    std::vector<const float *> sorted_features(n);
+    std::vector<int32_t> sorted_num_frames(n);
     for (int32_t i = 0; i != n; ++i) {
-      DecodeStream(ss[i]);
+      sorted_ss[i] = ss[indexes[i]];
+      sorted_features[i] = features[indexes[i]].data();
+      sorted_num_frames[i] = num_frames[indexes[i]];
+    }
+
+    int32_t max_batch_size = MaxBatchSize();
+    for (int32_t i = 0; i < n; i += max_batch_size) {
+      DecodeBatch(sorted_ss.data() + i, sorted_features.data() + i,
+                  sorted_num_frames.data() + i,
+                  std::min(max_batch_size, n - i));
     }
   }
 
@@ -79,26 +129,38 @@ class OfflineRecognizerWhisperImpl : public OfflineRecognizerImpl {
   OfflineRecognizerConfig GetConfig() const override { return config_; }
 
  private:
-  void DecodeStream(OfflineStream *s) const {
-    decoder_->SetConfig(config_.model_config.whisper);
+  // Maximum number of streams passed to the encoder and the decoder at once.
+  // It is limited by max_batch_size and by the memory of the self kv cache,
+  // which holds 4 buffers of n_text_layer * num_rows * n_text_ctx *
+  // n_text_state floats, where num_rows = batch_size * beam_size.
+  int32_t MaxBatchSize() const {
+    const auto &whisper = config_.model_config.whisper;
 
-    int32_t max_num_frames = 3000;
-    auto memory_info =
-        Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
+    int32_t beam_size = config_.decoding_method == "modified_beam_search"
+                            ? config_.max_active_paths
+                            : 1;
 
-    int32_t feat_dim = s->FeatureDim();
-    std::vector<float> f = s->GetFrames();
-    int32_t num_frames = f.size() / feat_dim;
+    int64_t bytes_per_stream = 4 * sizeof(float) *
+                               static_cast<int64_t>(model_->TextLayer()) *
+                               std::max(beam_size, 1) * model_->TextCtx() *
+                               model_->TextState();
 
-    // we use 50 here so that there will be some zero tail paddings
-    if (num_frames >= max_num_frames - 50) {
-      SHERPA_ONNX_LOGE(
-          "Only waves less than 30 seconds are supported. We process only the "
-          "first 30 seconds and discard the remaining data");
-      num_frames = max_num_frames - 50;
-    }
+    int64_t max_bytes = static_cast<int64_t>(whisper.max_kv_cache_mb) << 20;
 
-    model_->NormalizeFeatures(f.data(), num_frames, feat_dim);
+    int64_t ans = std::min<int64_t>(whisper.max_batch_size,
+                                    max_bytes / bytes_per_stream);
+
+    return std::max<int64_t>(ans, 1);
+  }
+
+  // @param ss Streams to decode
+  // @param features features[i] contains the normalized features of ss[i]
+  // @param num_frames num_frames[i] is the number of frames in features[i]
+  // @param n Number of streams
+  void DecodeBatch(OfflineStream **ss, const float **features,
+                   const int32_t *num_frames, int32_t n) const {
+    int32_t max_num_frames = 3000;
+    int32_t feat_dim = ss[0]->FeatureDim();
 
     // note that 1000 is an experience-value.
     // You can replace 1000 by other values, say, 100.
@@ -111,37 +173,55 @@ class OfflineRecognizerWhisperImpl : public OfflineRecognizerImpl {
       tail_padding_frames = config_.model_config.whisper.tail_paddings;
     }
 
-    int32_t actual_frames =
-        std::min(num_frames + tail_padding_frames, max_num_frames);
+    int32_t actual_frames = 0;
+    for (int32_t i = 0; i != n; ++i) {
+      actual_frames = std::max(
+          actual_frames,
+          std::min(num_frames[i] + tail_padding_frames, max_num_frames));
+    }
 
-    std::array<int64_t, 3> shape{1, actual_frames, feat_dim};
+    std::array<int64_t, 3> shape{n, actual_frames, feat_dim};
 
     Ort::Value mel = Ort::Value::CreateTensor<float>(
         model_->Allocator(), shape.data(), shape.size());
 
     float *p_mel = mel.GetTensorMutableData<float>();
-    std::copy(f.data(), f.data() + num_frames * feat_dim, p_mel);
+    std::fill_n(p_mel, n * actual_frames * feat_dim, 0);
 
-    std::fill_n(p_mel + num_frames * feat_dim,
-                (actual_frames - num_frames) * feat_dim, 0);
+    for (int32_t i = 0; i != n; ++i) {
+      std::copy(features[i], features[i] + num_frames[i] * feat_dim,
+                p_mel + i * actual_frames * feat_dim);
+    }
 
     mel = Transpose12(model_->Allocator(), &mel);
 
     try {
       auto cross_kv = model_->ForwardEncoder(std::move(mel));
 
-      auto results = decoder_->Decode(std::move(cross_kv.first),
-                                      std::move(cross_kv.second), num_frames);
+      auto results = decoder_->Decode(
+          std::move(cross_kv.first), std::move(cross_kv.second),
+          std::vector<int32_t>(num_frames, num_frames + n));
 
-      auto r = Convert(results[0], symbol_table_);
-      s->SetResult(r);
+      for (int32_t i = 0; i != n; ++i) {
+        auto r = Convert(results[i], symbol_table_);
+        ss[i]->SetResult(r);
+      }
     } catch (const Ort::Exception &ex) {
+      if (n > 1) {
+        // Decode the streams one by one so that only the failing
+        // stream gets an empty result
+        for (int32_t i = 0; i != n; ++i) {
+          DecodeBatch(ss + i, features + i, num_frames + i, 1);
+        }
+        return;
+      }
+
       SHERPA_ONNX_LOGE(
           "\n\nCaught exception:\n\n%s\n\nReturn an empty result. Number of "
           "input frames: %d, Current tail "
           "paddings: %d. If you see a lot of such exceptions, please consider "
           "using a larger --whisper-tail-paddings",
-          ex.what(), num_frames, tail_padding_frames);
+          ex.what(), num_frames[0], tail_padding_frames);
       return;
     }
   }
@@ -176,6 +256,7 @@ class OfflineRecognizerWhisperImpl : public OfflineRecognizerImpl {
   SymbolTable symbol_table_;
   std::unique_ptr<OfflineWhisperModel> model_;
   std::unique_ptr<OfflineWhisperDecoder> decoder_;
+
 };
 
 }  // namespace sherpa_onnx
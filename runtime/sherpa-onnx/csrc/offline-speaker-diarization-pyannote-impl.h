@@ -17,6 +17,7 @@
 #include "sherpa-onnx/csrc/offline-speaker-diarization-impl.h"
 #include "sherpa-onnx/csrc/offline-speaker-segmentation-pyannote-model.h"
 #include "sherpa-onnx/csrc/speaker-embedding-extractor.h"
+#include "sherpa-onnx/csrc/thread-pool.h"
 
 namespace sherpa_onnx {
 
@@ -62,7 +63,8 @@ class OfflineSpeakerDiarizationPyannoteImpl
       : config_(config),
         segmentation_model_(config_.segmentation),
         embedding_extractor_(config_.embedding),
-        clustering_(std::make_unique<FastClustering>(config_.clustering)) {
+        clustering_(std::make_unique<FastClustering>(config_.clustering)),
+        embedding_pool_(config_.num_threads > 1 ? config_.num_threads : 0) {
     Init();
   }
 
@@ -72,7 +74,8 @@ class OfflineSpeakerDiarizationPyannoteImpl
       : config_(config),
         segmentation_model_(mgr, config_.segmentation),
         embedding_extractor_(mgr, config_.embedding),
-        clustering_(std::make_unique<FastClustering>(config_.clustering)) {
+        clustering_(std::make_unique<FastClustering>(config_.clustering)),
+        embedding_pool_(config_.num_threads > 1 ? config_.num_threads : 0) {
     Init();
   }
 
@@ -242,63 +245,63 @@ class OfflineSpeakerDiarizationPyannoteImpl
       return {};
     }
 
-    if (n <= window_size) {
-      std::vector<float> buf(window_size);
-      // NOTE: buf is zero initialized by default
-
-      std::copy(audio, audio + n, buf.data());
-
-      Matrix2D m = ProcessChunk(buf.data());
-
-      ans.push_back(std::move(m));
-
-      return ans;
-    }
-
-    int32_t num_chunks = (n - window_size) / window_shift + 1;
-    bool has_last_chunk = ((n - window_size) % window_shift) > 0;
-
-    ans.reserve(num_chunks + has_last_chunk);
-
-    const float *p = audio;
-
-    for (int32_t i = 0; i != num_chunks; ++i, p += window_shift) {
-      Matrix2D m = ProcessChunk(p);
-
-      ans.push_back(std::move(m));
+    int32_t num_chunks = 1;
+    if (n > window_size) {
+      num_chunks = (n - window_size) / window_shift + 1;
+      bool has_last_chunk = ((n - window_size) % window_shift) > 0;
+      num_chunks += has_last_chunk;
     }
 
-    if (has_last_chunk) {
-      std::vector<float> buf(window_size);
-      std::copy(p, audio + n, buf.data());
+    ans.reserve(num_chunks);
 
-      Matrix2D m = ProcessChunk(buf.data());
+    // Run the model on several windows at once. The last window is padded
+    // with zeros if it is shorter than window_size.
+    std::vector<float> batch;
+    for (int32_t start = 0; start < num_chunks;
+         start += kSegmentationBatchSize) {
+      int32_t batch_size = std::min(kSegmentationBatchSize, num_chunks - start);
+      batch.assign(static_cast<size_t>(batch_size) * window_size, 0);
+
+      for (int32_t b = 0; b != batch_size; ++b) {
+        int32_t offset = (start + b) * window_shift;
+        int32_t num_samples = std::min(window_size, n - offset);
+        std::copy(audio + offset, audio + offset + num_samples,
+                  batch.data() + static_cast<size_t>(b) * window_size);
+      }
 
-      ans.push_back(std::move(m));
+      ProcessChunks(batch.data(), batch_size, &ans);
     }
 
     return ans;
   }
 
-  Matrix2D ProcessChunk(const float *p) const {
+  // p contains batch_size windows of window_size samples each. The
+  // segmentation of each window is appended to ans.
+  void ProcessChunks(float *p, int32_t batch_size,
+                     std::vector<Matrix2D> *ans) const {
     const auto &meta_data = segmentation_model_.GetModelMetaData();
     int32_t window_size = meta_data.window_size;
 
     auto memory_info =
         Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
 
-    std::array<int64_t, 3> shape = {1, 1, window_size};
+    std::array<int64_t, 3> shape = {batch_size, 1, window_size};
 
-    Ort::Value x =
-        Ort::Value::CreateTensor(memory_info, const_cast<float *>(p),
-                                 window_size, shape.data(), shape.size());
+    Ort::Value x = Ort::Value::CreateTensor(
+        memory_info, p, static_cast<size_t>(batch_size) * window_size,
+        shape.data(), shape.size());
 
     Ort::Value out = segmentation_model_.Forward(std::move(x));
     std::vector<int64_t> out_shape = out.GetTensorTypeAndShapeInfo().GetShape();
-    Matrix2D m(out_shape[1], out_shape[2]);
-    std::copy(out.GetTensorData<float>(), out.GetTensorData<float>() + m.size(),
-              &m(0, 0));
-    return m;
+
+    const float *q = out.GetTensorData<float>();
+    for (int32_t b = 0; b != batch_size; ++b) {
+      Matrix2D m(out_shape[1], out_shape[2]);
+      std::copy(q, q + m.size(), &m(0, 0));
+      q += m.size();
+
+      ans->push_back(std::move(m));
+    }
   }
 
   Matrix2DInt32 ToMultiLabel(const Matrix2D &m) const {
@@ -466,48 +469,108 @@ class OfflineSpeakerDiarizationPyannoteImpl
       void *callback_arg) const {
     const auto &meta_data = segmentation_model_.GetModelMetaData();
     int32_t sample_rate = meta_data.sample_rate;
-    Matrix2D ans(sample_indexes.size(), embedding_extractor_.Dim());
+    int32_t num_pairs = sample_indexes.size();
+    Matrix2D ans(num_pairs, embedding_extractor_.Dim());
+
+    // The windows of the segmentation model overlap, so different
+    // (chunk, speaker) pairs share most of their audio. We compute the
+    // features of the whole recording only once and select the frames
+    // whose centers fall into the segments of each pair.
+    FeatureExtractorConfig feat_config =
+        embedding_extractor_.GetFeatureExtractorConfig();
+
+    std::vector<float> features;
+    int32_t num_frames = 0;
+    {
+      auto stream = embedding_extractor_.CreateStream();
+      stream->AcceptWaveform(sample_rate, audio, n);
+      stream->InputFinished();
+
+      num_frames = stream->NumFramesReady();
+      if (num_frames > 0) {
+        features = stream->GetFrames(0, num_frames);
+      }
+    }
+    int32_t feat_dim = num_frames > 0 ? features.size() / num_frames : 0;
+
+    // in milliseconds
+    float frame_shift = feat_config.frame_shift_ms;
+    float first_center = feat_config.snip_edges
+                             ? feat_config.frame_length_ms / 2
+                             : feat_config.frame_shift_ms / 2;
+
+    // Index of the first frame whose center is not before the given sample
+    auto FrameIndex = [=](int32_t sample) -> int32_t {
+      float ms = sample * 1000.0f / sample_rate;
+      int32_t i = static_cast<int32_t>(std::ceil((ms - first_center) /
+                                                 frame_shift));
+      return std::min(std::max(i, 0), num_frames);
+    };
 
     auto IsNaNWrapper = [](float f) -> bool { return std::isnan(f); };
 
-    int32_t k = 0;
-    int32_t cur_row_index = 0;
-    for (const auto &v : sample_indexes) {
-      auto stream = embedding_extractor_.CreateStream();
-      for (const auto &p : v) {
-        int32_t end = (p.second <= n) ? p.second : n;
-        int32_t num_samples = end - p.first;
+    // Pairs are processed in groups so that the features of only one group
+    // are kept at a time. Within a group, pairs with similar numbers of
+    // frames run in one batch and the batches run on embedding_pool_.
+    // Results are collected in the order of the pairs, so the returned
+    // embeddings and the progress callbacks do not depend on num_threads.
+    constexpr int32_t kNumPairsPerGroup = 256;
 
-        if (num_samples > 0) {
-          stream->AcceptWaveform(sample_rate, audio + p.first, num_samples);
+    int32_t dim = embedding_extractor_.Dim();
+    int32_t cur_row_index = 0;
+    for (int32_t start = 0; start < num_pairs; start += kNumPairsPerGroup) {
+      int32_t end = std::min(start + kNumPairsPerGroup, num_pairs);
+
+      std::vector<std::vector<float>> group_features;
+      std::vector<int32_t> group_num_frames;
+      std::vector<int32_t> group_indexes;
+      for (int32_t k = start; k != end; ++k) {
+        std::vector<float> f;
+        int32_t count = 0;
+        for (const auto &p : sample_indexes[k]) {
+          int32_t begin = FrameIndex(p.first);
+          int32_t last = FrameIndex(std::min(p.second, n));
+          if (begin < last) {
+            f.insert(f.end(), features.begin() + begin * feat_dim,
+                     features.begin() + last * feat_dim);
+            count += last - begin;
+          }
         }
-      }
 
-      stream->InputFinished();
-      if (!embedding_extractor_.IsReady(stream.get())) {
-        SHERPA_ONNX_LOGE(
-            "This segment is too short, which should not happen since we have "
-            "already filtered short segments");
-        SHERPA_ONNX_EXIT(-1);
+        // No frames are selected if the segments are too short to contain
+        // a whole frame, which should not happen since we have already
+        // filtered short segments. We skip it like a NaN embedding.
+        if (count > 0) {
+          group_features.push_back(std::move(f));
+          group_num_frames.push_back(count);
+          group_indexes.push_back(k);
+        }
       }
 
-      std::vector<float> embedding = embedding_extractor_.Compute(stream.get());
-
-      if (std::none_of(embedding.begin(), embedding.end(), IsNaNWrapper)) {
-        // a valid embedding
-        std::copy(embedding.begin(), embedding.end(), &ans(cur_row_index, 0));
-        cur_row_index += 1;
-        valid_indexes->push_back(k);
+      std::vector<float> embeddings =
+          embedding_extractor_.ComputeBatchFromFeatures(
+              std::move(group_features), group_num_frames, &embedding_pool_);
+
+      for (int32_t j = 0; j != static_cast<int32_t>(group_indexes.size());
+           ++j) {
+        auto begin = embeddings.begin() + j * dim;
+        auto last = begin + dim;
+        if (std::none_of(begin, last, IsNaNWrapper)) {
+          // a valid embedding
+          std::copy(begin, last, &ans(cur_row_index, 0));
+          cur_row_index += 1;
+          valid_indexes->push_back(group_indexes[j]);
+        }
       }
 
-      k += 1;
-
       if (callback) {
-        callback(k, ans.rows(), callback_arg);
+        for (int32_t k = start; k != end; ++k) {
+          callback(k + 1, num_pairs, callback_arg);
+        }
       }
     }
 
-    if (k != cur_row_index) {
+    if (num_pairs != cur_row_index) {
       auto seq = Eigen::seqN(0, cur_row_index);
       ans = ans(seq, Eigen::all);
     }
@@ -737,6 +800,13 @@ class OfflineSpeakerDiarizationPyannoteImpl
   SpeakerEmbeddingExtractor embedding_extractor_;
   std::unique_ptr<FastClustering> clustering_;
   Matrix2DInt32 powerset_mapping_;
+
+  // Runs the batches of ComputeEmbeddings(). It has no threads if
+  // config_.num_threads is 1.
+  mutable ThreadPool embedding_pool_;
+
+  // Number of windows passed to the segmentation model in one call
+  static constexpr int32_t kSegmentationBatchSize = 16;
 };
 
 }  // namespace sherpa_onnx
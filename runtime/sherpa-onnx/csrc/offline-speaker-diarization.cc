@@ -38,6 +38,10 @@ void OfflineSpeakerDiarizationConfig::Register(ParseOptions *po) {
                "if the gap between to segments of the same speaker is less "
                "than this value, then these two segments are merged into a "
                "single segment. We do it recursively.");
+
+  po->Register("num-threads", &num_threads,
+               "Number of threads for computing speaker embeddings in "
+               "parallel. The result does not depend on it.");
 }
 
 bool OfflineSpeakerDiarizationConfig::Validate() const {
@@ -63,6 +67,11 @@ bool OfflineSpeakerDiarizationConfig::Validate() const {
     return false;
   }
 
+  if (num_threads < 1) {
+    SHERPA_ONNX_LOGE("num_threads %d is less than 1", num_threads);
+    return false;
+  }
+
   return true;
 }
 
@@ -74,7 +83,8 @@ std::string OfflineSpeakerDiarizationConfig::ToString() const {
   os << "embedding=" << embedding.ToString() << ", ";
   os << "clustering=" << clustering.ToString() << ", ";
   os << "min_duration_on=" << min_duration_on << ", ";
-  os << "min_duration_off=" << min_duration_off << ")";
+  os << "min_duration_off=" << min_duration_off << ", ";
+  os << "num_threads=" << num_threads << ")";
 
   return os.str();
 }
@@ -29,6 +29,11 @@ struct OfflineSpeakerDiarizationConfig {
   // We do this recursively.
   float min_duration_off = 0.5;  // in seconds
 
+  // Number of threads for computing batches of embeddings of (chunk,
+  // speaker) pairs in parallel. Each thread additionally uses
+  // embedding.num_threads threads inside onnxruntime.
+  int32_t num_threads = 1;
+
   OfflineSpeakerDiarizationConfig() = default;
 
   OfflineSpeakerDiarizationConfig(
@@ -24,6 +24,10 @@ struct OfflineSpeechDenoiserGtcrnModelMetaData {
   std::vector<int64_t> conv_cache_shape;
   std::vector<int64_t> tra_cache_shape;
   std::vector<int64_t> inter_cache_shape;
+
+  // Number of STFT frames the model accepts per run. 0 means any number.
+  // It is read from the input shape of the model, not from the meta data.
+  int32_t frames_per_run = 1;
 };
 
 }  // namespace sherpa_onnx
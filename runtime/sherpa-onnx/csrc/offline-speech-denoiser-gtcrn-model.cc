@@ -157,6 +157,13 @@ class OfflineSpeechDenoiserGtcrnModel::Impl {
     SHERPA_ONNX_READ_META_DATA_VEC(meta_.tra_cache_shape, "tra_cache_shape");
     SHERPA_ONNX_READ_META_DATA_VEC(meta_.inter_cache_shape,
                                    "inter_cache_shape");
+
+    // x is of shape (1, n_fft/2+1, num_frames, 2)
+    std::vector<int64_t> x_shape =
+        sess_->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    if (x_shape.size() == 4) {
+      meta_.frames_per_run = x_shape[2] > 0 ? x_shape[2] : 0;
+    }
   }
 
  private:
@@ -22,8 +22,10 @@
 #include "sherpa-onnx/csrc/offline-tts-frontend.h"
 #include "sherpa-onnx/csrc/offline-tts-impl.h"
 #include "sherpa-onnx/csrc/offline-tts-kokoro-model.h"
+#include "sherpa-onnx/csrc/offline-tts-pipeline.h"
 #include "sherpa-onnx/csrc/piper-phonemize-lexicon.h"
 #include "sherpa-onnx/csrc/text-utils.h"
+#include "sherpa-onnx/csrc/thread-pool.h"
 
 namespace sherpa_onnx {
 
@@ -31,7 +33,8 @@ class OfflineTtsKokoroImpl : public OfflineTtsImpl {
  public:
   explicit OfflineTtsKokoroImpl(const OfflineTtsConfig &config)
       : config_(config),
-        model_(std::make_unique<OfflineTtsKokoroModel>(config.model)) {
+        model_(std::make_unique<OfflineTtsKokoroModel>(config.model)),
+        synthesis_pool_(config.num_synthesis_threads) {
     InitFrontend();
 
     if (!config.rule_fsts.empty()) {
@@ -87,7 +90,8 @@ class OfflineTtsKokoroImpl : public OfflineTtsImpl {
   template <typename Manager>
   OfflineTtsKokoroImpl(Manager *mgr, const OfflineTtsConfig &config)
       : config_(config),
-        model_(std::make_unique<OfflineTtsKokoroModel>(mgr, config.model)) {
+        model_(std::make_unique<OfflineTtsKokoroModel>(mgr, config.model)),
+        synthesis_pool_(config.num_synthesis_threads) {
     InitFrontend(mgr);
 
     if (!config.rule_fsts.empty()) {
@@ -220,6 +224,10 @@ class OfflineTtsKokoroImpl : public OfflineTtsImpl {
       }
     }
 
+    if (config_.num_synthesis_threads > 0) {
+      return GeneratePipelined(text, sid, speed, std::move(callback));
+    }
+
     std::vector<TokenIDs> token_ids =
         frontend_->ConvertTextToTokenIds(text, meta_data.voice);
 
@@ -328,6 +336,41 @@ class OfflineTtsKokoroImpl : public OfflineTtsImpl {
   }
 
  private:
+  // Kokoro models process one sentence at a time
+  GeneratedAudio GeneratePipelined(const std::string &text, int64_t sid,
+                                   float speed,
+                                   GeneratedAudioCallback callback) const {
+    const auto &meta_data = model_->GetMetaData();
+
+    auto frontend = [this, &meta_data](const std::string &s) {
+      return frontend_->ConvertTextToTokenIds(s, meta_data.voice);
+    };
+
+    auto synthesize = [this, sid, speed](const std::vector<TokenIDs> &batch) {
+      std::vector<std::vector<int64_t>> x;
+      x.reserve(batch.size());
+      for (const auto &ids : batch) {
+        x.push_back(ids.tokens);
+      }
+      return Process(x, sid, speed);
+    };
+
+    GeneratedAudio ans =
+        GenerateInPipeline(text, &synthesis_pool_, 1, frontend, synthesize,
+                           std::move(callback));
+
+    if (ans.samples.empty()) {
+#if __OHOS__
+      SHERPA_ONNX_LOGE("Failed to convert '%{public}s' to token IDs",
+                       text.c_str());
+#else
+      SHERPA_ONNX_LOGE("Failed to convert '%s' to token IDs", text.c_str());
+#endif
+    }
+
+    return ans;
+  }
+
   template <typename Manager>
   void InitFrontend(Manager *mgr) {
     const auto &meta_data = model_->GetMetaData();
@@ -434,6 +477,10 @@ class OfflineTtsKokoroImpl : public OfflineTtsImpl {
   std::unique_ptr<OfflineTtsKokoroModel> model_;
   std::vector<std::unique_ptr<kaldifst::TextNormalizer>> tn_list_;
   std::unique_ptr<OfflineTtsFrontend> frontend_;
+
+  // config_.num_synthesis_threads threads used by GeneratePipelined().
+  // It has no threads if the pipeline is disabled.
+  mutable ThreadPool synthesis_pool_;
 };
 
 }  // namespace sherpa_onnx
@@ -0,0 +1,128 @@
+// sherpa-onnx/csrc/offline-tts-pipeline-test.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-onnx/csrc/offline-tts-pipeline.h"
+
+#include <chrono>  // NOLINT
+#include <stdexcept>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace sherpa_onnx {
+
+TEST(SplitTextIntoSentences, Simple) {
+  std::vector<std::string> expected = {"Hello world.", "It is 3.14!",
+                                       "这是第一句。", "这是第二句？",
+                                       "No end"};
+  EXPECT_EQ(SplitTextIntoSentences(
+                "Hello world. It is 3.14!\n这是第一句。这是第二句？ No end"),
+            expected);
+
+  EXPECT_TRUE(SplitTextIntoSentences("  \n ").empty());
+}
+
+// Each sentence is a single token: its length. The synthesized audio of a
+// batch is the list of its tokens. Shorter sentences finish first.
+static OfflineTtsFrontendFunc kFrontend = [](const std::string &s) {
+  return std::vector<TokenIDs>{std::vector<int64_t>{
+      static_cast<int64_t>(s.size())}};
+};
+
+static OfflineTtsSynthesizeFunc kSynthesize =
+    [](const std::vector<TokenIDs> &batch) {
+      GeneratedAudio audio;
+      audio.sample_rate = 16000;
+      for (const auto &ids : batch) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ids.tokens[0]));
+        audio.samples.push_back(ids.tokens[0]);
+      }
+      return audio;
+    };
+
+TEST(GenerateInPipeline, Ordered) {
+  std::string text =
+      "A long first sentence with many words. Short. Medium one here. B.";
+
+  std::vector<float> samples;
+  std::vector<float> progress;
+  auto callback = [&](const float *p, int32_t n, float cur_progress) {
+    samples.insert(samples.end(), p, p + n);
+    progress.push_back(cur_progress);
+    return 1;
+  };
+
+  ThreadPool pool(3);
+  auto audio =
+      GenerateInPipeline(text, &pool, 1, kFrontend, kSynthesize, callback);
+
+  std::vector<float> expected = {38, 6, 16, 2};
+  EXPECT_EQ(audio.sample_rate, 16000);
+  EXPECT_EQ(audio.samples, expected);
+  EXPECT_EQ(samples, expected);
+
+  ASSERT_EQ(progress.size(), 4);
+  EXPECT_FLOAT_EQ(progress[0], 0.25);
+  EXPECT_FLOAT_EQ(progress[3], 1);
+
+  // Two sentences per batch
+  samples.clear();
+  progress.clear();
+  ThreadPool pool2(2);
+  audio =
+      GenerateInPipeline(text, &pool2, 2, kFrontend, kSynthesize, callback);
+  EXPECT_EQ(audio.samples, expected);
+  EXPECT_EQ(progress.size(), 2);
+}
+
+TEST(GenerateInPipeline, Stop) {
+  std::string text = "One. Two. Three. Four.";
+
+  int32_t num_calls = 0;
+  auto callback = [&](const float *p, int32_t n, float cur_progress) {
+    ++num_calls;
+    return 0;
+  };
+
+  ThreadPool pool(2);
+  auto audio =
+      GenerateInPipeline(text, &pool, 1, kFrontend, kSynthesize, callback);
+  EXPECT_EQ(num_calls, 1);
+  EXPECT_EQ(audio.samples.size(), 1);
+  EXPECT_EQ(audio.samples[0], 4);
+}
+
+TEST(GenerateInPipeline, Exception) {
+  std::string text = "One. Two. Three. Four. Five. Six.";
+
+  // The third sentence fails
+  auto synthesize = [](const std::vector<TokenIDs> &batch) {
+    if (batch[0].tokens[0] == 6) {
+      throw std::runtime_error("synthesis failed");
+    }
+    return kSynthesize(batch);
+  };
+
+  int32_t num_calls = 0;
+  auto callback = [&](const float *p, int32_t n, float cur_progress) {
+    ++num_calls;
+    return 1;
+  };
+
+  ThreadPool pool(2);
+  EXPECT_THROW(
+      GenerateInPipeline(text, &pool, 1, kFrontend, synthesize, callback),
+      std::runtime_error);
+  // Batches after the failed one are not delivered
+  EXPECT_LE(num_calls, 2);
+
+  // The pool can still be used
+  auto audio =
+      GenerateInPipeline(text, &pool, 1, kFrontend, kSynthesize, nullptr);
+  EXPECT_EQ(audio.samples.size(), 6);
+}
+
+}  // namespace sherpa_onnx
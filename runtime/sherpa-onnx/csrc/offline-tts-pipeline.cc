@@ -0,0 +1,258 @@
+// sherpa-onnx/csrc/offline-tts-pipeline.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-onnx/csrc/offline-tts-pipeline.h"
+
+#include <condition_variable>  // NOLINT
+#include <exception>
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sherpa_onnx {
+
+std::vector<std::string> SplitTextIntoSentences(const std::string &text) {
+  // UTF-8 encoded full-width punctuations that end a sentence
+  static const char *kFullWidthPunctuations[] = {"。", "！", "？", "；"};
+
+  std::vector<std::string> ans;
+  std::string cur;
+
+  auto flush = [&ans, &cur]() {
+    std::size_t begin = cur.find_first_not_of(" \t\r\n");
+    if (begin != std::string::npos) {
+      ans.push_back(cur.substr(begin));
+    }
+    cur.clear();
+  };
+
+  int32_t n = static_cast<int32_t>(text.size());
+  for (int32_t i = 0; i < n; ++i) {
+    char c = text[i];
+    cur.push_back(c);
+
+    if (c == '\n') {
+      flush();
+      continue;
+    }
+
+    if (c == '.' || c == '!' || c == '?' || c == ';') {
+      // It is not the end of a sentence in 3.14 or a.b
+      if (i + 1 == n || text[i + 1] == ' ' || text[i + 1] == '\t' ||
+          text[i + 1] == '\r' || text[i + 1] == '\n') {
+        flush();
+      }
+      continue;
+    }
+
+    if (static_cast<uint8_t>(c) < 0x80) {
+      continue;
+    }
+
+    for (const char *p : kFullWidthPunctuations) {
+      std::string punct = p;
+      // cur ends with the last byte of a multi-byte character only when
+      // all of its bytes have been appended
+      if (cur.size() >= punct.size() &&
+          cur.compare(cur.size() - punct.size(), punct.size(), punct) == 0) {
+        flush();
+        break;
+      }
+    }
+  }
+
+  flush();
+
+  return ans;
+}
+
+namespace {
+
+struct Pipeline {
+  std::mutex mutex;
+
+  // Signaled when a batch is done
+  std::condition_variable cond;
+
+  // batch index -> audio
+  std::map<int32_t, GeneratedAudio> results;
+
+  // Number of submitted batches that are not done
+  int32_t num_pending = 0;
+
+  // The first exception thrown by a batch
+  std::exception_ptr error;
+
+  // Set when a batch fails or the callback asks to stop. Batches that
+  // have not started are skipped.
+  bool stop = false;
+};
+
+// Batches refer to the pipeline, so wait for them before it is destroyed,
+// also when the frontend or the callback throws.
+class PipelineGuard {
+ public:
+  explicit PipelineGuard(Pipeline *p) : p_(p) {}
+
+  ~PipelineGuard() {
+    std::unique_lock<std::mutex> lock(p_->mutex);
+    p_->stop = true;
+    p_->cond.wait(lock, [this]() { return p_->num_pending == 0; });
+  }
+
+ private:
+  Pipeline *p_;
+};
+
+}  // namespace
+
+GeneratedAudio GenerateInPipeline(const std::string &text, ThreadPool *pool,
+                                  int32_t batch_size,
+                                  OfflineTtsFrontendFunc frontend,
+                                  OfflineTtsSynthesizeFunc synthesize,
+                                  GeneratedAudioCallback callback) {
+  Pipeline p;
+  PipelineGuard guard(&p);
+
+  std::vector<std::string> sentences = SplitTextIntoSentences(text);
+  int32_t num_sentences = static_cast<int32_t>(sentences.size());
+
+  GeneratedAudio ans{};
+
+  // progress[i] is passed to the callback for the i-th batch
+  std::vector<float> progress;
+  int32_t num_delivered = 0;
+  int32_t should_continue = 1;
+
+  // Pass ready audio to the callback in order. If wait is true, wait until
+  // all submitted batches are delivered.
+  auto deliver = [&](bool wait) {
+    std::unique_lock<std::mutex> lock(p.mutex);
+    while (should_continue && !p.error &&
+           num_delivered < static_cast<int32_t>(progress.size())) {
+      if (wait) {
+        p.cond.wait(lock, [&p, num_delivered]() {
+          return p.error || p.results.count(num_delivered);
+        });
+      } else if (!p.results.count(num_delivered)) {
+        break;
+      }
+
+      if (p.error) {
+        break;
+      }
+
+      auto it = p.results.find(num_delivered);
+      GeneratedAudio audio = std::move(it->second);
+      p.results.erase(it);
+      float cur_progress = progress[num_delivered];
+      ++num_delivered;
+      lock.unlock();
+
+      ans.sample_rate = audio.sample_rate;
+      ans.samples.insert(ans.samples.end(), audio.samples.begin(),
+                         audio.samples.end());
+      if (callback) {
+        should_continue =
+            callback(audio.samples.data(), audio.samples.size(), cur_progress);
+        // Caution(fangjun): audio is freed when the callback returns, so users
+        // should copy the data if they want to access the data after
+        // the callback returns to avoid segmentation fault.
+      }
+
+      lock.lock();
+    }
+
+    if (p.error) {
+      should_continue = 0;
+    }
+
+    if (!should_continue) {
+      p.stop = true;
+    }
+  };
+
+  std::vector<TokenIDs> batch;
+  auto submit = [&](float cur_progress) {
+    int32_t index = static_cast<int32_t>(progress.size());
+    progress.push_back(cur_progress);
+
+    {
+      std::lock_guard<std::mutex> lock(p.mutex);
+      ++p.num_pending;
+    }
+
+    pool->Submit([&p, &synthesize, index, batch = std::move(batch)]() {
+      {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        if (p.stop) {
+          --p.num_pending;
+          p.cond.notify_all();
+          return;
+        }
+      }
+
+      GeneratedAudio audio;
+      std::exception_ptr error;
+      try {
+        audio = synthesize(batch);
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(p.mutex);
+      if (error) {
+        if (!p.error) {
+          p.error = error;
+        }
+        p.stop = true;
+      } else {
+        p.results[index] = std::move(audio);
+      }
+      --p.num_pending;
+      p.cond.notify_all();
+    });
+
+    batch.clear();
+  };
+
+  for (int32_t i = 0; i != num_sentences && should_continue; ++i) {
+    for (auto &ids : frontend(sentences[i])) {
+      if (ids.tokens.empty()) {
+        continue;
+      }
+
+      batch.push_back(std::move(ids));
+      if (static_cast<int32_t>(batch.size()) == batch_size) {
+        submit(static_cast<float>(i + 1) / num_sentences);
+      }
+    }
+
+    deliver(false);
+  }
+
+  if (!batch.empty() && should_continue) {
+    submit(1.0);
+  }
+
+  if (!progress.empty()) {
+    progress.back() = 1.0;
+  }
+
+  deliver(true);
+
+  {
+    std::unique_lock<std::mutex> lock(p.mutex);
+    p.cond.wait(lock, [&p]() { return p.num_pending == 0; });
+    if (p.error) {
+      std::rethrow_exception(p.error);
+    }
+  }
+
+  return ans;
+}
+
+}  // namespace sherpa_onnx
@@ -0,0 +1,60 @@
+// sherpa-onnx/csrc/offline-tts-pipeline.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+#ifndef SHERPA_ONNX_CSRC_OFFLINE_TTS_PIPELINE_H_
+#define SHERPA_ONNX_CSRC_OFFLINE_TTS_PIPELINE_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "sherpa-onnx/csrc/offline-tts-frontend.h"
+#include "sherpa-onnx/csrc/offline-tts.h"
+#include "sherpa-onnx/csrc/thread-pool.h"
+
+namespace sherpa_onnx {
+
+/* Split text into sentences.
+ *
+ * A sentence ends after one of .!?; followed by a space or the end of the
+ * text, after a newline, or after one of the full-width punctuations
+ * 。！？；. The punctuation is kept in the sentence.
+ */
+std::vector<std::string> SplitTextIntoSentences(const std::string &text);
+
+// Convert one sentence of the text into token IDs
+using OfflineTtsFrontendFunc =
+    std::function<std::vector<TokenIDs>(const std::string & /*sentence*/)>;
+
+// Synthesize a batch of token IDs
+using OfflineTtsSynthesizeFunc =
+    std::function<GeneratedAudio(const std::vector<TokenIDs> & /*batch*/)>;
+
+/* Generate audio for a long text in a pipeline.
+ *
+ * The calling thread runs the frontend on one sentence at a time and hands
+ * every batch_size token sequences to the threads of pool, so the
+ * frontend of later sentences overlaps with the synthesis of earlier ones
+ * and several batches are synthesized at the same time.
+ *
+ * The callback is called in the calling thread, in the order of the text,
+ * as soon as a batch and all batches before it are ready. If it returns 0,
+ * no more batches are started.
+ *
+ * If synthesize throws, batches that have not started are skipped and the
+ * exception is rethrown in the calling thread once the running ones are
+ * done.
+ *
+ * @return The concatenated audio of all batches. It is empty if the
+ *         frontend produces no tokens.
+ */
+GeneratedAudio GenerateInPipeline(const std::string &text, ThreadPool *pool,
+                                  int32_t batch_size,
+                                  OfflineTtsFrontendFunc frontend,
+                                  OfflineTtsSynthesizeFunc synthesize,
+                                  GeneratedAudioCallback callback);
+
+}  // namespace sherpa_onnx
+
+#endif  // SHERPA_ONNX_CSRC_OFFLINE_TTS_PIPELINE_H_
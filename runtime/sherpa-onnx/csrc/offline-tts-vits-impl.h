@@ -21,9 +21,11 @@
 #include "sherpa-onnx/csrc/offline-tts-character-frontend.h"
 #include "sherpa-onnx/csrc/offline-tts-frontend.h"
 #include "sherpa-onnx/csrc/offline-tts-impl.h"
+#include "sherpa-onnx/csrc/offline-tts-pipeline.h"
 #include "sherpa-onnx/csrc/offline-tts-vits-model.h"
 #include "sherpa-onnx/csrc/piper-phonemize-lexicon.h"
 #include "sherpa-onnx/csrc/text-utils.h"
+#include "sherpa-onnx/csrc/thread-pool.h"
 
 namespace sherpa_onnx {
 
@@ -31,7 +33,8 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
  public:
   explicit OfflineTtsVitsImpl(const OfflineTtsConfig &config)
       : config_(config),
-        model_(std::make_unique<OfflineTtsVitsModel>(config.model)) {
+        model_(std::make_unique<OfflineTtsVitsModel>(config.model)),
+        synthesis_pool_(config.num_synthesis_threads) {
     InitFrontend();
 
     if (!config.rule_fsts.empty()) {
@@ -87,7 +90,8 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
   template <typename Manager>
   OfflineTtsVitsImpl(Manager *mgr, const OfflineTtsConfig &config)
       : config_(config),
-        model_(std::make_unique<OfflineTtsVitsModel>(mgr, config.model)) {
+        model_(std::make_unique<OfflineTtsVitsModel>(mgr, config.model)),
+        synthesis_pool_(config.num_synthesis_threads) {
     InitFrontend(mgr);
 
     if (!config.rule_fsts.empty()) {
@@ -206,6 +210,10 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
       }
     }
 
+    if (config_.num_synthesis_threads > 0) {
+      return GeneratePipelined(text, sid, speed, std::move(callback));
+    }
+
     std::vector<TokenIDs> token_ids =
         frontend_->ConvertTextToTokenIds(text, meta_data.voice);
 
@@ -335,6 +343,57 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
   }
 
  private:
+  GeneratedAudio GeneratePipelined(const std::string &text, int64_t sid,
+                                   float speed,
+                                   GeneratedAudioCallback callback) const {
+    const auto &meta_data = model_->GetMetaData();
+
+    // TODO(fangjun): add blank inside the frontend, not here
+    bool add_blank = meta_data.add_blank &&
+                     config_.model.vits.data_dir.empty() &&
+                     meta_data.frontend != "characters";
+
+    auto frontend = [this, &meta_data, add_blank](const std::string &s) {
+      std::vector<TokenIDs> token_ids =
+          frontend_->ConvertTextToTokenIds(s, meta_data.voice);
+      if (add_blank) {
+        for (auto &ids : token_ids) {
+          ids.tokens = AddBlank(ids.tokens);
+          if (!ids.tones.empty()) {
+            ids.tones = AddBlank(ids.tones);
+          }
+        }
+      }
+      return token_ids;
+    };
+
+    auto synthesize = [this, sid, speed](const std::vector<TokenIDs> &batch) {
+      std::vector<std::vector<int64_t>> x;
+      std::vector<std::vector<int64_t>> tones;
+      x.reserve(batch.size());
+      for (const auto &ids : batch) {
+        x.push_back(ids.tokens);
+        if (!ids.tones.empty()) {
+          tones.push_back(ids.tones);
+        }
+      }
+      return Process(x, tones, sid, speed);
+    };
+
+    int32_t batch_size =
+        config_.max_num_sentences > 0 ? config_.max_num_sentences : 1;
+
+    GeneratedAudio ans =
+        GenerateInPipeline(text, &synthesis_pool_, batch_size, frontend,
+                           synthesize, std::move(callback));
+
+    if (ans.samples.empty()) {
+      SHERPA_ONNX_LOGE("Failed to convert %s to token IDs", text.c_str());
+    }
+
+    return ans;
+  }
+
   template <typename Manager>
   void InitFrontend(Manager *mgr) {
     const auto &meta_data = model_->GetMetaData();
@@ -499,6 +558,10 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
   std::unique_ptr<OfflineTtsVitsModel> model_;
   std::vector<std::unique_ptr<kaldifst::TextNormalizer>> tn_list_;
   std::unique_ptr<OfflineTtsFrontend> frontend_;
+
+  // config_.num_synthesis_threads threads used by GeneratePipelined().
+  // It has no threads if the pipeline is disabled.
+  mutable ThreadPool synthesis_pool_;
 };
 
 }  // namespace sherpa_onnx
@@ -37,6 +37,13 @@ struct OfflineTtsConfig {
   // the duration of the new interval is old_duration * silence_scale.
   float silence_scale = 0.2;
 
+  // If it is greater than 0, long text is generated in a pipeline: the
+  // frontend runs one sentence at a time in the calling thread while this
+  // number of threads synthesize batches of sentences concurrently.
+  // Audio is still passed to the callback in order. Use 0 to process
+  // batches one after another.
+  int32_t num_synthesis_threads = 0;
+
   OfflineTtsConfig() = default;
   OfflineTtsConfig(const OfflineTtsModelConfig &model,
                    const std::string &rule_fsts, const std::string &rule_fars,
@@ -85,7 +92,8 @@ class OfflineTts {
   //            dataset.
   // @param speed The speed for the generated speech. E.g., 2 means 2x faster.
   // @param callback If not NULL, it is called whenever config.max_num_sentences
-  //                 sentences have been processed. Note that the passed
+  //                 sentences have been processed, in the order of the text
+  //                 even if config.num_synthesis_threads > 1. Note that the passed
   //                 pointer `samples` for the callback might be invalidated
   //                 after the callback is returned, so the caller should not
   //                 keep a reference to it. The caller can copy the data if
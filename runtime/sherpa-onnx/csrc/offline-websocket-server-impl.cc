@@ -16,6 +16,12 @@ void OfflineWebsocketDecoderConfig::Register(ParseOptions *po) {
   po->Register("max-batch-size", &max_batch_size,
                "Max batch size for decoding.");
 
+  po->Register("max-batch-frames", &max_batch_frames,
+               "Max number of padded feature frames in a batch, i.e., the "
+               "batch size times the number of frames of the longest "
+               "utterance in the batch. Utterances of similar lengths are "
+               "batched together. 0 means no limit.");
+
   po->Register(
       "max-utterance-length", &max_utterance_length,
       "Max utterance length in seconds. If we receive an utterance "
@@ -34,6 +40,12 @@ void OfflineWebsocketDecoderConfig::Validate() const {
     exit(-1);
   }
 
+  if (max_batch_frames < 0) {
+    SHERPA_ONNX_LOGE("Expect --max-batch-frames >= 0. Given: %d",
+                     max_batch_frames);
+    exit(-1);
+  }
+
   if (max_utterance_length <= 0) {
     SHERPA_ONNX_LOGE("Expect --max-utterance-length > 0. Given: %f",
                      max_utterance_length);
@@ -43,6 +55,7 @@ void OfflineWebsocketDecoderConfig::Validate() const {
 
 OfflineWebsocketDecoder::OfflineWebsocketDecoder(OfflineWebsocketServer *server)
     : config_(server->GetConfig().decoder_config),
+      batcher_(config_.max_batch_size, config_.max_batch_frames),
       server_(server),
       recognizer_(config_.recognizer_config) {}
 
@@ -51,15 +64,27 @@ void OfflineWebsocketDecoder::Push(connection_hdl hdl, ConnectionDataPtr d) {
   streams_.push_back({hdl, d});
 }
 
+int32_t OfflineWebsocketDecoder::NumFrames(const ConnectionData &d) const {
+  const auto &feat_config = config_.recognizer_config.feat_config;
+  float seconds =
+      d.expected_byte_size / sizeof(float) / static_cast<float>(d.sample_rate);
+  return seconds * 1000 / feat_config.frame_shift_ms;
+}
+
 void OfflineWebsocketDecoder::Decode() {
   std::unique_lock<std::mutex> lock(mutex_);
   if (streams_.empty()) {
     return;
   }
 
-  int32_t size =
-      std::min(static_cast<int32_t>(streams_.size()), config_.max_batch_size);
-  SHERPA_ONNX_LOGE("size: %d", size);
+  std::vector<int32_t> lengths;
+  lengths.reserve(streams_.size());
+  for (const auto &p : streams_) {
+    lengths.push_back(NumFrames(*p.second));
+  }
+
+  std::vector<int32_t> selected = batcher_.Select(lengths);
+  int32_t size = static_cast<int32_t>(selected.size());
 
   // We first lock the mutex for streams_, take items from it, and then
   // unlock the mutex; in doing so we don't need to lock the mutex to
@@ -70,17 +95,28 @@ void OfflineWebsocketDecoder::Decode() {
   // while we are still using it.
   std::vector<ConnectionDataPtr> connection_data(size);
 
-  std::vector<const float *> samples(size);
-  std::vector<int32_t> samples_length(size);
-  std::vector<std::unique_ptr<OfflineStream>> ss(size);
-  std::vector<OfflineStream *> p_ss(size);
-
+  std::vector<int32_t> batch_lengths(size);
   for (int32_t i = 0; i != size; ++i) {
-    auto &p = streams_.front();
+    const auto &p = streams_[selected[i]];
     handles[i] = p.first;
     connection_data[i] = p.second;
-    streams_.pop_front();
+    batch_lengths[i] = lengths[selected[i]];
+  }
 
+  // selected is sorted, so we erase from the back
+  for (auto it = selected.rbegin(); it != selected.rend(); ++it) {
+    streams_.erase(streams_.begin() + *it);
+  }
+
+  padding_stats_.Add(batch_lengths);
+  SHERPA_ONNX_LOGE("size: %d, %s", size, padding_stats_.ToString().c_str());
+
+  lock.unlock();
+
+  std::vector<std::unique_ptr<OfflineStream>> ss(size);
+  std::vector<OfflineStream *> p_ss(size);
+
+  for (int32_t i = 0; i != size; ++i) {
     auto sample_rate = connection_data[i]->sample_rate;
     auto samples =
         reinterpret_cast<const float *>(&connection_data[i]->data[0]);
@@ -92,8 +128,6 @@ void OfflineWebsocketDecoder::Decode() {
     p_ss[i] = ss[i].get();
   }
 
-  lock.unlock();
-
   // Note: DecodeStreams is thread-safe
   recognizer_.DecodeStreams(p_ss.data(), size);
 
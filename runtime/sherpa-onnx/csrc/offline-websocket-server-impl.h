@@ -13,6 +13,7 @@
 #include <utility>
 #include <vector>
 
+#include "sherpa-onnx/csrc/length-batcher.h"
 #include "sherpa-onnx/csrc/offline-recognizer.h"
 #include "sherpa-onnx/csrc/parse-options.h"
 #include "sherpa-onnx/csrc/tee-stream.h"
@@ -67,6 +68,10 @@ struct OfflineWebsocketDecoderConfig {
 
   int32_t max_batch_size = 5;
 
+  // Max of batch_size * num_frames of the longest utterance in a batch.
+  // 0 means no limit.
+  int32_t max_batch_frames = 20000;
+
   float max_utterance_length = 300;  // seconds
 
   void Register(ParseOptions *po);
@@ -97,20 +102,29 @@ class OfflineWebsocketDecoder {
 
   const OfflineWebsocketDecoderConfig &GetConfig() const { return config_; }
 
+ private:
+  // Number of feature frames of the received audio
+  int32_t NumFrames(const ConnectionData &d) const;
+
  private:
   OfflineWebsocketDecoderConfig config_;
+  LengthBatcher batcher_;
 
   /** When we have received all the data from the client, we put it into
    * this queue; the worker threads will get items from this queue for
    * decoding.
    *
-   * Number of items to take from this queue is determined by
-   * `--max-batch-size`. If there are not enough items in the queue, we won't
-   * wait and take whatever we have for decoding.
+   * Each batch contains the oldest item in the queue and the items closest
+   * to it in length, limited by `--max-batch-size` and `--max-batch-frames`.
+   * If there are not enough items in the queue, we won't wait and take
+   * whatever we have for decoding.
    */
   std::mutex mutex_;
   std::deque<std::pair<connection_hdl, ConnectionDataPtr>> streams_;
 
+  // Protected by mutex_
+  PaddingStats padding_stats_;
+
   OfflineWebsocketServer *server_;  // Not owned
   OfflineRecognizer recognizer_;
 };
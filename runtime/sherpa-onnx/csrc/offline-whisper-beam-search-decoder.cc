@@ -0,0 +1,424 @@
+// sherpa-onnx/csrc/offline-whisper-beam-search-decoder.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-onnx/csrc/offline-whisper-beam-search-decoder.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "sherpa-onnx/csrc/macros.h"
+#include "sherpa-onnx/csrc/math.h"
+
+namespace sherpa_onnx {
+
+namespace {
+
+struct Hypothesis {
+  std::vector<int32_t> tokens;
+  float log_prob = 0;
+};
+
+// Repeat each row of a tensor of shape (n_text_layer, N, n_audio_ctx,
+// n_text_state) num_repeats times
+Ort::Value RepeatRows(OrtAllocator *allocator, const Ort::Value &v,
+                      int32_t num_repeats) {
+  std::vector<int64_t> shape = v.GetTensorTypeAndShapeInfo().GetShape();
+  int64_t row_size = shape[2] * shape[3];
+
+  std::array<int64_t, 4> new_shape{shape[0], shape[1] * num_repeats, shape[2],
+                                   shape[3]};
+  Ort::Value ans = Ort::Value::CreateTensor<float>(allocator, new_shape.data(),
+                                                   new_shape.size());
+
+  const float *src = v.GetTensorData<float>();
+  float *dst = ans.GetTensorMutableData<float>();
+  for (int64_t i = 0; i != shape[0] * shape[1]; ++i, src += row_size) {
+    for (int32_t k = 0; k != num_repeats; ++k, dst += row_size) {
+      std::copy(src, src + row_size, dst);
+    }
+  }
+
+  return ans;
+}
+
+}  // namespace
+
+void OfflineWhisperBeamSearchDecoder::SetConfig(
+    const OfflineWhisperModelConfig &config) {
+  config_ = config;
+}
+
+std::vector<OfflineWhisperDecoderResult>
+OfflineWhisperBeamSearchDecoder::Decode(
+    Ort::Value cross_k, Ort::Value cross_v,
+    const std::vector<int32_t> &num_feature_frames) {
+  int32_t batch_size = cross_k.GetTensorTypeAndShapeInfo().GetShape()[1];
+  int32_t beam_size = beam_size_;
+  int32_t num_rows = batch_size * beam_size;
+  int32_t vocab_size = model_->VocabSize();
+  int32_t eot = model_->EOT();
+  int32_t n_text_ctx = model_->TextCtx();
+
+  // The workspace goes back to the pool when this call returns, including
+  // when the model throws
+  std::unique_ptr<Workspace> workspace = AcquireWorkspace();
+  struct WorkspaceGuard {
+    OfflineWhisperBeamSearchDecoder *decoder;
+    std::unique_ptr<Workspace> *ws;
+    ~WorkspaceGuard() { decoder->ReleaseWorkspace(std::move(*ws)); }
+  } guard{this, &workspace};
+
+  Workspace &ws = *workspace;
+  ws.cur = 0;
+
+  // 0: tokens, 1: self_k_cache, 2: self_v_cache, 3: cross_k, 4: cross_v,
+  // 5: offset
+
+  std::array<Ort::Value, 6> inputs = {
+      Ort::Value{nullptr}, Ort::Value{nullptr},  Ort::Value{nullptr},
+      std::move(cross_k),  std::move(cross_v), Ort::Value{nullptr}};
+
+  // For multilingual models, initial_tokens contains [sot, language, task]
+  //   - language is English by default
+  //   - task is transcribe by default
+  //
+  // For non-multilingual models, initial_tokens contains [sot]
+  std::vector<int64_t> initial_tokens = model_->GetInitialTokens();
+  std::vector<int32_t> languages;
+
+  if (model_->IsMultiLingual()) {
+    languages = GetLanguages(batch_size, &inputs);
+
+    if (config_.task == "translate") {
+      initial_tokens[2] = model_->Translate();
+    } else if (config_.task != "transcribe") {
+      // initial_tokens[2] is transcribe by default
+      SHERPA_ONNX_LOGE(
+          "Unsupported task: %s. Valid values are: transcribe, translate.",
+          config_.task.c_str());
+    }
+  }
+
+  initial_tokens.push_back(model_->NoTimeStampsToken());
+
+  if (beam_size > 1) {
+    inputs[3] = RepeatRows(model_->Allocator(), inputs[3], beam_size);
+    inputs[4] = RepeatRows(model_->Allocator(), inputs[4], beam_size);
+  }
+
+  int32_t num_initial_tokens = initial_tokens.size();
+  std::vector<int64_t> tokens;
+  tokens.reserve(num_rows * num_initial_tokens);
+  for (int32_t u = 0; u != batch_size; ++u) {
+    if (!languages.empty()) {
+      // 0: sot, 1: lang_id, 2: task, 3: no_timestamps
+      initial_tokens[1] = languages[u];
+    }
+
+    for (int32_t b = 0; b != beam_size; ++b) {
+      tokens.insert(tokens.end(), initial_tokens.begin(),
+                    initial_tokens.end());
+    }
+  }
+
+  const float *logits =
+      RunDecoder(tokens, num_rows, 0, &inputs, &ws) +
+      static_cast<size_t>(num_initial_tokens - 1) * vocab_size;
+  int32_t logits_stride = num_initial_tokens * vocab_size;
+  int32_t offset = num_initial_tokens;
+
+  // beams[u][b] is the hypothesis of row u * beam_size + b. At the start,
+  // all rows of an utterance are equal, so only the first one is used.
+  std::vector<std::vector<Hypothesis>> beams(batch_size,
+                                             std::vector<Hypothesis>(1));
+  std::vector<std::vector<Hypothesis>> finished(batch_size);
+  std::vector<char> done(batch_size, 0);
+
+  std::vector<int32_t> max_num_tokens(batch_size);
+  for (int32_t u = 0; u != batch_size; ++u) {
+    // assume at most 6 tokens per second
+    max_num_tokens[u] =
+        std::min<int32_t>(num_feature_frames[u] / 100 * 6, n_text_ctx / 2);
+  }
+
+  std::vector<int32_t> src_rows(num_rows);
+  std::vector<float> log_probs;
+
+  while (true) {
+    bool reorder = false;
+    std::fill(src_rows.begin(), src_rows.end(), -1);
+
+    for (int32_t u = 0; u != batch_size; ++u) {
+      if (done[u]) {
+        continue;
+      }
+
+      std::vector<Hypothesis> &cur = beams[u];
+      int32_t num_beams = cur.size();
+      int32_t row0 = u * beam_size;
+
+      if (static_cast<int32_t>(cur[0].tokens.size()) == max_num_tokens[u]) {
+        for (auto &h : cur) {
+          finished[u].push_back(std::move(h));
+        }
+        done[u] = 1;
+        continue;
+      }
+
+      if (beam_size == 1) {
+        const float *p = logits + static_cast<size_t>(row0) * logits_stride;
+        int32_t token = static_cast<int32_t>(
+            std::distance(p, std::max_element(p, p + vocab_size)));
+
+        if (token == eot) {
+          finished[u] = std::move(cur);
+          done[u] = 1;
+          continue;
+        }
+
+        cur[0].tokens.push_back(token);
+        src_rows[row0] = row0;
+        continue;
+      }
+
+      log_probs.resize(static_cast<size_t>(num_beams) * vocab_size);
+      for (int32_t b = 0; b != num_beams; ++b) {
+        const float *p =
+            logits + static_cast<size_t>(row0 + b) * logits_stride;
+        float *q = log_probs.data() + static_cast<size_t>(b) * vocab_size;
+        std::copy(p, p + vocab_size, q);
+        LogSoftmax(q, vocab_size);
+        for (int32_t i = 0; i != vocab_size; ++i) {
+          q[i] += cur[b].log_prob;
+        }
+      }
+
+      // We take 2 * beam_size candidates so that there are still beam_size
+      // of them left after removing the ones ending with EOT
+      std::vector<int32_t> topk =
+          TopkIndex(log_probs.data(), log_probs.size(), 2 * beam_size);
+
+      std::vector<Hypothesis> next;
+      for (int32_t k : topk) {
+        int32_t b = k / vocab_size;
+        int32_t token = k % vocab_size;
+
+        if (token == eot) {
+          if (static_cast<int32_t>(finished[u].size()) < beam_size) {
+            finished[u].push_back({cur[b].tokens, log_probs[k]});
+          }
+          continue;
+        }
+
+        if (static_cast<int32_t>(next.size()) < beam_size) {
+          src_rows[row0 + next.size()] = row0 + b;
+          reorder = reorder || (b != static_cast<int32_t>(next.size()));
+
+          next.push_back({cur[b].tokens, log_probs[k]});
+          next.back().tokens.push_back(token);
+        }
+      }
+
+      if (static_cast<int32_t>(finished[u].size()) >= beam_size) {
+        std::fill_n(src_rows.begin() + row0, beam_size, -1);
+        done[u] = 1;
+        continue;
+      }
+
+      cur = std::move(next);
+    }
+
+    if (std::all_of(done.begin(), done.end(), [](char d) { return d; })) {
+      break;
+    }
+
+    if (offset >= n_text_ctx - 1) {
+      for (int32_t u = 0; u != batch_size; ++u) {
+        if (!done[u]) {
+          for (auto &h : beams[u]) {
+            finished[u].push_back(std::move(h));
+          }
+        }
+      }
+      break;
+    }
+
+    if (reorder) {
+      ReorderCache(src_rows, num_rows, offset, &ws);
+    } else {
+      ws.cur = 1 - ws.cur;
+    }
+
+    tokens.resize(num_rows);
+    for (int32_t r = 0; r != num_rows; ++r) {
+      int32_t u = r / beam_size;
+      int32_t b = r % beam_size;
+      tokens[r] = src_rows[r] == -1 ? eot : beams[u][b].tokens.back();
+    }
+
+    logits = RunDecoder(tokens, num_rows, offset, &inputs, &ws);
+    logits_stride = vocab_size;
+    offset += 1;
+  }
+
+  const auto &id2lang = model_->GetID2Lang();
+
+  std::vector<OfflineWhisperDecoderResult> ans(batch_size);
+  for (int32_t u = 0; u != batch_size; ++u) {
+    std::vector<Hypothesis> &hyps = finished[u];
+
+    // Select the hypothesis with the largest average log prob per token
+    auto it = std::max_element(
+        hyps.begin(), hyps.end(),
+        [](const Hypothesis &a, const Hypothesis &b) {
+          return a.log_prob / std::max<size_t>(a.tokens.size(), 1) <
+                 b.log_prob / std::max<size_t>(b.tokens.size(), 1);
+        });
+
+    if (it != hyps.end()) {
+      ans[u].tokens = std::move(it->tokens);
+    }
+
+    if (!languages.empty() && id2lang.count(languages[u])) {
+      ans[u].lang = id2lang.at(languages[u]);
+    }
+  }
+
+  return ans;
+}
+
+std::unique_ptr<OfflineWhisperBeamSearchDecoder::Workspace>
+OfflineWhisperBeamSearchDecoder::AcquireWorkspace() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (free_workspaces_.empty()) {
+    return std::make_unique<Workspace>();
+  }
+
+  auto ans = std::move(free_workspaces_.back());
+  free_workspaces_.pop_back();
+  return ans;
+}
+
+void OfflineWhisperBeamSearchDecoder::ReleaseWorkspace(
+    std::unique_ptr<Workspace> ws) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_workspaces_.push_back(std::move(ws));
+}
+
+std::vector<int32_t> OfflineWhisperBeamSearchDecoder::GetLanguages(
+    int32_t batch_size, std::array<Ort::Value, 6> *inputs) const {
+  if (!config_.language.empty()) {
+    const auto &lang2id = model_->GetLang2ID();
+
+    if (!lang2id.count(config_.language)) {
+      SHERPA_ONNX_LOGE("Invalid language: %s", config_.language.c_str());
+      exit(-1);
+    }
+
+    return std::vector<int32_t>(batch_size, lang2id.at(config_.language));
+  }
+
+  return model_->DetectLanguage((*inputs)[3], (*inputs)[4]);
+}
+
+const float *OfflineWhisperBeamSearchDecoder::RunDecoder(
+    const std::vector<int64_t> &tokens, int32_t num_rows, int32_t offset,
+    std::array<Ort::Value, 6> *inputs, Workspace *ws) const {
+  int32_t num_tokens = tokens.size() / num_rows;
+  EnsureCapacity(num_rows, num_tokens, ws);
+
+  auto memory_info =
+      Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
+
+  std::array<int64_t, 2> token_shape{num_rows, num_tokens};
+  (*inputs)[0] = Ort::Value::CreateTensor(
+      memory_info, const_cast<int64_t *>(tokens.data()), tokens.size(),
+      token_shape.data(), token_shape.size());
+
+  std::array<int64_t, 4> cache_shape{model_->TextLayer(), num_rows,
+                                     model_->TextCtx(), model_->TextState()};
+  size_t cache_size = static_cast<size_t>(cache_shape[0]) * cache_shape[1] *
+                      cache_shape[2] * cache_shape[3];
+
+  auto CacheView = [&](std::vector<float> *buffer) {
+    return Ort::Value::CreateTensor(memory_info, buffer->data(), cache_size,
+                                    cache_shape.data(), cache_shape.size());
+  };
+
+  (*inputs)[1] = CacheView(&ws->self_k[ws->cur]);
+  (*inputs)[2] = CacheView(&ws->self_v[ws->cur]);
+
+  int64_t offset_value = offset;
+  std::array<int64_t, 1> offset_shape{1};
+  (*inputs)[5] =
+      Ort::Value::CreateTensor(memory_info, &offset_value, 1,
+                               offset_shape.data(), offset_shape.size());
+
+  std::array<int64_t, 3> logits_shape{num_rows, num_tokens,
+                                      model_->VocabSize()};
+  size_t logits_size =
+      static_cast<size_t>(num_rows) * num_tokens * model_->VocabSize();
+
+  std::array<Ort::Value, 3> outputs = {
+      Ort::Value::CreateTensor(memory_info, ws->logits.data(), logits_size,
+                               logits_shape.data(), logits_shape.size()),
+      CacheView(&ws->self_k[1 - ws->cur]),
+      CacheView(&ws->self_v[1 - ws->cur])};
+
+  model_->ForwardDecoder(inputs->data(), outputs.data());
+
+  return ws->logits.data();
+}
+
+void OfflineWhisperBeamSearchDecoder::ReorderCache(
+    const std::vector<int32_t> &src_rows, int32_t num_rows,
+    int32_t num_positions, Workspace *ws) const {
+  int32_t n_text_layer = model_->TextLayer();
+  int32_t n_text_ctx = model_->TextCtx();
+  int32_t n_text_state = model_->TextState();
+
+  size_t row_size = static_cast<size_t>(n_text_ctx) * n_text_state;
+  size_t copy_size = static_cast<size_t>(num_positions) * n_text_state;
+
+  for (auto *buffers : {&ws->self_k, &ws->self_v}) {
+    const float *src = (*buffers)[1 - ws->cur].data();
+    float *dst = (*buffers)[ws->cur].data();
+
+    for (int32_t l = 0; l != n_text_layer; ++l) {
+      size_t layer_offset = static_cast<size_t>(l) * num_rows * row_size;
+      for (int32_t r = 0; r != num_rows; ++r) {
+        if (src_rows[r] == -1) {
+          continue;
+        }
+
+        const float *p = src + layer_offset + src_rows[r] * row_size;
+        std::copy(p, p + copy_size, dst + layer_offset + r * row_size);
+      }
+    }
+  }
+}
+
+void OfflineWhisperBeamSearchDecoder::EnsureCapacity(int32_t num_rows,
+                                                     int32_t num_tokens,
+                                                     Workspace *ws) const {
+  size_t cache_size = static_cast<size_t>(model_->TextLayer()) * num_rows *
+                      model_->TextCtx() * model_->TextState();
+
+  for (auto *buffers : {&ws->self_k, &ws->self_v}) {
+    for (auto &b : *buffers) {
+      if (b.size() < cache_size) {
+        b.resize(cache_size);
+      }
+    }
+  }
+
+  size_t logits_size =
+      static_cast<size_t>(num_rows) * num_tokens * model_->VocabSize();
+  if (ws->logits.size() < logits_size) {
+    ws->logits.resize(logits_size);
+  }
+}
+
+}  // namespace sherpa_onnx
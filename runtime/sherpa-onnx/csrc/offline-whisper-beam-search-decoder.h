@@ -0,0 +1,105 @@
+// sherpa-onnx/csrc/offline-whisper-beam-search-decoder.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_ONNX_CSRC_OFFLINE_WHISPER_BEAM_SEARCH_DECODER_H_
+#define SHERPA_ONNX_CSRC_OFFLINE_WHISPER_BEAM_SEARCH_DECODER_H_
+
+#include <array>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "sherpa-onnx/csrc/offline-whisper-decoder.h"
+#include "sherpa-onnx/csrc/offline-whisper-model.h"
+
+namespace sherpa_onnx {
+
+/* Decode a batch of utterances together.
+ *
+ * All N * beam_size hypotheses are advanced by one token per decoder call.
+ * Hypotheses of finished utterances and unused beams are fed EOT and their
+ * outputs are ignored, since the decoder model uses a single offset for
+ * the whole batch.
+ *
+ * The self kv cache lives in two buffers of a workspace. Each decoder run
+ * reads one and writes the other, so no cache memory is allocated per
+ * step. Workspaces are kept in a pool and reused by later Decode() calls,
+ * which only grow them if they need more rows. Each running Decode() call
+ * takes its own workspace, so Decode() can be called from several threads
+ * at the same time and the pool holds one workspace per concurrent call.
+ *
+ * With beam_size == 1 it is greedy search.
+ */
+class OfflineWhisperBeamSearchDecoder : public OfflineWhisperDecoder {
+ public:
+  OfflineWhisperBeamSearchDecoder(const OfflineWhisperModelConfig &config,
+                                  OfflineWhisperModel *model,
+                                  int32_t beam_size)
+      : config_(config), model_(model), beam_size_(beam_size) {}
+
+  std::vector<OfflineWhisperDecoderResult> Decode(
+      Ort::Value cross_k, Ort::Value cross_v,
+      const std::vector<int32_t> &num_feature_frames) override;
+
+  void SetConfig(const OfflineWhisperModelConfig &config) override;
+
+ private:
+  // Buffers used by one Decode() call
+  struct Workspace {
+    // self_k[i] and self_v[i] are of shape
+    // (n_text_layer, num_rows, n_text_ctx, n_text_state)
+    std::array<std::vector<float>, 2> self_k;
+    std::array<std::vector<float>, 2> self_v;
+
+    // Index of the buffer holding the input kv cache of the next step
+    int32_t cur = 0;
+
+    std::vector<float> logits;
+  };
+
+  // Take a workspace from the pool, or create one if the pool is empty
+  std::unique_ptr<Workspace> AcquireWorkspace();
+
+  // Return a workspace to the pool
+  void ReleaseWorkspace(std::unique_ptr<Workspace> ws);
+
+  // Return the language token of each of the batch_size utterances.
+  // inputs[3] and inputs[4] contain the cross kv cache. If no language is
+  // given in the config, it is detected with
+  // OfflineWhisperModel::DetectLanguage().
+  std::vector<int32_t> GetLanguages(int32_t batch_size,
+                                    std::array<Ort::Value, 6> *inputs) const;
+
+  // Run the decoder on tokens of shape (num_rows, num_tokens) at the given
+  // offset. The self kv cache is read from buffer ws->cur and written to the
+  // other buffer. Return a pointer to the logits of shape
+  // (num_rows, num_tokens, vocab_size).
+  const float *RunDecoder(const std::vector<int64_t> &tokens,
+                          int32_t num_rows, int32_t offset,
+                          std::array<Ort::Value, 6> *inputs,
+                          Workspace *ws) const;
+
+  // Copy the first num_positions positions of the self kv cache of row
+  // src_rows[i] of the buffer written by the last RunDecoder() to row i of
+  // buffer ws->cur. Rows with src_rows[i] == -1 are not copied.
+  void ReorderCache(const std::vector<int32_t> &src_rows, int32_t num_rows,
+                    int32_t num_positions, Workspace *ws) const;
+
+  // Resize the kv cache buffers and the logits buffer if they are too small
+  void EnsureCapacity(int32_t num_rows, int32_t num_tokens,
+                      Workspace *ws) const;
+
+ private:
+  OfflineWhisperModelConfig config_;
+  OfflineWhisperModel *model_;  // not owned
+  int32_t beam_size_;
+
+  std::mutex mutex_;
+  // Workspaces not used by a running Decode() call
+  std::vector<std::unique_ptr<Workspace>> free_workspaces_;
+};
+
+}  // namespace sherpa_onnx
+
+#endif  // SHERPA_ONNX_CSRC_OFFLINE_WHISPER_BEAM_SEARCH_DECODER_H_
@@ -5,28 +5,17 @@
 #ifndef SHERPA_ONNX_CSRC_OFFLINE_WHISPER_GREEDY_SEARCH_DECODER_H_
 #define SHERPA_ONNX_CSRC_OFFLINE_WHISPER_GREEDY_SEARCH_DECODER_H_
 
-#include <vector>
-
-#include "sherpa-onnx/csrc/offline-whisper-decoder.h"
-#include "sherpa-onnx/csrc/offline-whisper-model.h"
+#include "sherpa-onnx/csrc/offline-whisper-beam-search-decoder.h"
 
 namespace sherpa_onnx {
 
-class OfflineWhisperGreedySearchDecoder : public OfflineWhisperDecoder {
+// Greedy search is beam search with a single hypothesis per utterance
+class OfflineWhisperGreedySearchDecoder
+    : public OfflineWhisperBeamSearchDecoder {
  public:
   OfflineWhisperGreedySearchDecoder(const OfflineWhisperModelConfig &config,
                                     OfflineWhisperModel *model)
-      : config_(config), model_(model) {}
-
-  std::vector<OfflineWhisperDecoderResult> Decode(
-      Ort::Value cross_k, Ort::Value cross_v,
-      int32_t num_feature_frames) override;
-
-  void SetConfig(const OfflineWhisperModelConfig &config) override;
-
- private:
-  OfflineWhisperModelConfig config_;
-  OfflineWhisperModel *model_;  // not owned
+      : OfflineWhisperBeamSearchDecoder(config, model, 1) {}
 };
 
 }  // namespace sherpa_onnx
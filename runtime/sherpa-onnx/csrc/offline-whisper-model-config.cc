@@ -39,6 +39,15 @@ void OfflineWhisperModelConfig::Register(ParseOptions *po) {
       "Since we have removed the 30-second constraint, we need to add some "
       "tail padding frames "
       "so that whisper can detect the eot token. Leave it to -1 to use 1000.");
+
+  po->Register("whisper-max-batch-size", &max_batch_size,
+               "Maximum number of utterances decoded at once.");
+
+  po->Register(
+      "whisper-max-kv-cache-mb", &max_kv_cache_mb,
+      "Maximum size in MB of the self kv cache of one batch. Larger models "
+      "and larger beam sizes decode fewer utterances at once to stay below "
+      "it. At least one utterance is always decoded.");
 }
 
 bool OfflineWhisperModelConfig::Validate() const {
@@ -72,6 +81,18 @@ bool OfflineWhisperModelConfig::Validate() const {
     return false;
   }
 
+  if (max_batch_size < 1) {
+    SHERPA_ONNX_LOGE("--whisper-max-batch-size should be positive. Given: %d",
+                     max_batch_size);
+    return false;
+  }
+
+  if (max_kv_cache_mb < 1) {
+    SHERPA_ONNX_LOGE("--whisper-max-kv-cache-mb should be positive. Given: %d",
+                     max_kv_cache_mb);
+    return false;
+  }
+
   return true;
 }
 
@@ -83,7 +104,9 @@ std::string OfflineWhisperModelConfig::ToString() const {
   os << "decoder=\"" << decoder << "\", ";
   os << "language=\"" << language << "\", ";
   os << "task=\"" << task << "\", ";
-  os << "tail_paddings=" << tail_paddings << ")";
+  os << "tail_paddings=" << tail_paddings << ", ";
+  os << "max_batch_size=" << max_batch_size << ", ";
+  os << "max_kv_cache_mb=" << max_kv_cache_mb << ")";
 
   return os.str();
 }
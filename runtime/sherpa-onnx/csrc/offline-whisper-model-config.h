@@ -38,6 +38,16 @@ struct OfflineWhisperModelConfig {
   //   - 300 for multilingual models
   int32_t tail_paddings = -1;
 
+  // Maximum number of utterances passed to the encoder and the decoder at
+  // once
+  int32_t max_batch_size = 8;
+
+  // Maximum size in MB of the self kv cache of one batch. The decoder
+  // keeps 4 buffers of n_text_layer * num_rows * n_text_ctx * n_text_state
+  // floats per batch, where num_rows is the batch size times the beam
+  // size. The batch size is reduced until the cache fits into this limit.
+  int32_t max_kv_cache_mb = 2048;
+
   OfflineWhisperModelConfig() = default;
   OfflineWhisperModelConfig(const std::string &encoder,
                             const std::string &decoder,
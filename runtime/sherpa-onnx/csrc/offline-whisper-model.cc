@@ -10,6 +10,7 @@
 #include <tuple>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #if __ANDROID_API__ >= 9
 #include "android/asset_manager.h"
@@ -128,18 +129,29 @@ class OfflineWhisperModel::Impl {
         std::move(decoder_input[4]), std::move(decoder_input[5])};
   }
 
-  int32_t DetectLanguage(Ort::Value &cross_k,    // NOLINT
-                         Ort::Value &cross_v) {  // NOLINT
-    int64_t token_val = SOT();
-    std::array<int64_t, 2> token_shape{1, 1};
+  void ForwardDecoder(const Ort::Value *inputs, Ort::Value *outputs) {
+    decoder_sess_->Run({}, decoder_input_names_ptr_.data(), inputs,
+                       decoder_input_names_ptr_.size(),
+                       decoder_output_names_ptr_.data(), outputs,
+                       decoder_output_names_ptr_.size());
+  }
+
+  std::vector<int32_t> DetectLanguage(Ort::Value &cross_k,    // NOLINT
+                                      Ort::Value &cross_v) {  // NOLINT
+    int32_t batch_size = cross_k.GetTensorTypeAndShapeInfo().GetShape()[1];
+
+    std::vector<int64_t> token_val(batch_size, SOT());
+    std::array<int64_t, 2> token_shape{batch_size, 1};
 
     auto memory_info =
         Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
 
-    Ort::Value tokens = Ort::Value::CreateTensor(
-        memory_info, &token_val, 1, token_shape.data(), token_shape.size());
+    Ort::Value tokens =
+        Ort::Value::CreateTensor(memory_info, token_val.data(),
+                                 token_val.size(), token_shape.data(),
+                                 token_shape.size());
 
-    auto self_kv_cache = GetInitialSelfKVCache();
+    auto self_kv_cache = GetInitialSelfKVCache(batch_size);
 
     std::array<int64_t, 1> offset_shape{1};
     Ort::Value offset = Ort::Value::CreateTensor<int64_t>(
@@ -154,32 +166,40 @@ class OfflineWhisperModel::Impl {
     cross_k = std::move(std::get<3>(decoder_out));
     cross_v = std::move(std::get<4>(decoder_out));
 
+    // logits is of shape (batch_size, 1, vocab_size)
     const float *p_logits = std::get<0>(decoder_out).GetTensorData<float>();
     const auto &all_language_ids = GetAllLanguageIDs();
 
-    int32_t lang_id = all_language_ids[0];
-    float this_logit = p_logits[lang_id];
+    std::vector<int32_t> ans(batch_size);
+    for (int32_t b = 0; b != batch_size; ++b) {
+      const float *p = p_logits + static_cast<size_t>(b) * n_vocab_;
+
+      int32_t lang_id = all_language_ids[0];
+      float this_logit = p[lang_id];
 
-    for (int32_t i = 1; i != all_language_ids.size(); ++i) {
-      int32_t id = all_language_ids[i];
-      float p = p_logits[id];
+      for (int32_t i = 1; i != all_language_ids.size(); ++i) {
+        int32_t id = all_language_ids[i];
 
-      if (p > this_logit) {
-        this_logit = p;
-        lang_id = id;
+        if (p[id] > this_logit) {
+          this_logit = p[id];
+          lang_id = id;
+        }
       }
-    }
 
-    if (config_.debug) {
-      SHERPA_ONNX_LOGE("Detected language: %s",
-                       GetID2Lang().at(lang_id).c_str());
+      if (config_.debug) {
+        SHERPA_ONNX_LOGE("Detected language: %s",
+                         GetID2Lang().at(lang_id).c_str());
+      }
+
+      ans[b] = lang_id;
     }
 
-    return lang_id;
+    return ans;
   }
 
-  std::pair<Ort::Value, Ort::Value> GetInitialSelfKVCache() {
-    std::array<int64_t, 4> shape{n_text_layer_, 1, n_text_ctx_, n_text_state_};
+  std::pair<Ort::Value, Ort::Value> GetInitialSelfKVCache(int32_t batch_size) {
+    std::array<int64_t, 4> shape{n_text_layer_, batch_size, n_text_ctx_,
+                                 n_text_state_};
 
     Ort::Value n_layer_self_k_cache = Ort::Value::CreateTensor<float>(
         Allocator(), shape.data(), shape.size());
@@ -222,6 +242,10 @@ class OfflineWhisperModel::Impl {
 
   int32_t TextCtx() const { return n_text_ctx_; }
 
+  int32_t TextLayer() const { return n_text_layer_; }
+
+  int32_t TextState() const { return n_text_state_; }
+
   int32_t VocabSize() const { return n_vocab_; }
 
   int32_t FeatureDim() const { return n_mels_; }
@@ -383,14 +407,20 @@ OfflineWhisperModel::ForwardDecoder(Ort::Value tokens,
       std::move(n_layer_cross_v), std::move(offset));
 }
 
-int32_t OfflineWhisperModel::DetectLanguage(Ort::Value &cross_k,    // NOLINT
-                                            Ort::Value &cross_v) {  // NOLINT
+void OfflineWhisperModel::ForwardDecoder(const Ort::Value *inputs,
+                                         Ort::Value *outputs) const {
+  impl_->ForwardDecoder(inputs, outputs);
+}
+
+std::vector<int32_t> OfflineWhisperModel::DetectLanguage(
+    Ort::Value &cross_k,    // NOLINT
+    Ort::Value &cross_v) {  // NOLINT
   return impl_->DetectLanguage(cross_k, cross_v);
 }
 
-std::pair<Ort::Value, Ort::Value> OfflineWhisperModel::GetInitialSelfKVCache()
-    const {
-  return impl_->GetInitialSelfKVCache();
+std::pair<Ort::Value, Ort::Value> OfflineWhisperModel::GetInitialSelfKVCache(
+    int32_t batch_size /*= 1*/) const {
+  return impl_->GetInitialSelfKVCache(batch_size);
 }
 
 OrtAllocator *OfflineWhisperModel::Allocator() const {
@@ -425,6 +455,10 @@ int32_t OfflineWhisperModel::SOT() const { return impl_->SOT(); }
 
 int32_t OfflineWhisperModel::TextCtx() const { return impl_->TextCtx(); }
 
+int32_t OfflineWhisperModel::TextLayer() const { return impl_->TextLayer(); }
+
+int32_t OfflineWhisperModel::TextState() const { return impl_->TextState(); }
+
 int32_t OfflineWhisperModel::VocabSize() const { return impl_->VocabSize(); }
 
 int32_t OfflineWhisperModel::FeatureDim() const { return impl_->FeatureDim(); }
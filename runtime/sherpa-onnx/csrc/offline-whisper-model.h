@@ -74,16 +74,39 @@ class OfflineWhisperModel {
                  Ort::Value n_layer_self_v_cache, Ort::Value n_layer_cross_k,
                  Ort::Value n_layer_cross_v, Ort::Value offset) const;
 
-  int32_t DetectLanguage(Ort::Value &cross_k,   // NOLINT
-                         Ort::Value &cross_v);  // NOLINT
+  /** Run the decoder model and write the outputs into pre-allocated
+   * tensors, so that the caller can reuse the memory of the self kv cache
+   * across steps.
+   *
+   * @param inputs An array of the 6 inputs of ForwardDecoder() above,
+   *               in the same order. They are not changed.
+   * @param outputs An array of 3 pre-allocated tensors for logits,
+   *                out_n_layer_self_k_cache and out_n_layer_self_v_cache.
+   *                They must not share memory with the inputs.
+   */
+  void ForwardDecoder(const Ort::Value *inputs, Ort::Value *outputs) const;
+
+  /** Detect the language of each utterance with one decoder run.
+   *
+   * @param cross_k The n_layer_cross_k output of ForwardEncoder(). It is
+   *                of shape (n_text_layer, N, n_audio_ctx, n_text_state).
+   * @param cross_v The n_layer_cross_v output of ForwardEncoder().
+   *
+   * @return Return the language token ID of each of the N utterances.
+   */
+  std::vector<int32_t> DetectLanguage(Ort::Value &cross_k,   // NOLINT
+                                      Ort::Value &cross_v);  // NOLINT
 
   /** Return the initial self kv cache in a pair
    *  - n_layer_self_k_cache A 4-D tensor of shape
    *                         (n_text_layer, N, n_audio_ctx, n_text_state).
    *  - n_layer_self_v_cache A 4-D tensor of shape
    *                         (n_text_layer, N, n_audio_ctx, n_text_state).
+   *
+   * where N is batch_size.
    */
-  std::pair<Ort::Value, Ort::Value> GetInitialSelfKVCache() const;
+  std::pair<Ort::Value, Ort::Value> GetInitialSelfKVCache(
+      int32_t batch_size = 1) const;
   const std::vector<int64_t> &GetInitialTokens() const;
   const std::vector<int32_t> &GetAllLanguageIDs() const;
   const std::unordered_map<std::string, int32_t> &GetLang2ID() const;
@@ -97,6 +120,8 @@ class OfflineWhisperModel {
   int32_t EOT() const;
   int32_t SOT() const;
   int32_t TextCtx() const;
+  int32_t TextLayer() const;
+  int32_t TextState() const;
   int32_t VocabSize() const;
   int32_t FeatureDim() const;
   int32_t Translate() const;
@@ -56,6 +56,22 @@ class OnlineLM {
    *
    */
   virtual void ComputeLMScoreSF(float scale, Hypothesis *hyp) = 0;
+
+  /** Batched version of ComputeLMScoreSF() (shallow fusion).
+   *
+   * It has the same effect as calling ComputeLMScoreSF() for each hyp.
+   * Implementations may run the LM once for all hyps.
+   *
+   * @param scale LM score
+   * @param hyps The hyps to update. They may come from different streams.
+   *             They are changed in-place.
+   */
+  virtual void ComputeLMScoreSF(float scale,
+                                const std::vector<Hypothesis *> &hyps) {
+    for (auto *hyp : hyps) {
+      ComputeLMScoreSF(scale, hyp);
+    }
+  }
 };
 
 }  // namespace sherpa_onnx
@@ -6,11 +6,14 @@
 #define SHERPA_ONNX_CSRC_ONLINE_RECOGNIZER_PARAFORMER_IMPL_H_
 
 #include <algorithm>
+#include <cstring>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "sherpa-onnx/csrc/cat.h"
 #include "sherpa-onnx/csrc/file-utils.h"
 #include "sherpa-onnx/csrc/macros.h"
 #include "sherpa-onnx/csrc/online-lm.h"
@@ -19,6 +22,7 @@
 #include "sherpa-onnx/csrc/online-recognizer-impl.h"
 #include "sherpa-onnx/csrc/online-recognizer.h"
 #include "sherpa-onnx/csrc/symbol-table.h"
+#include "sherpa-onnx/csrc/unbind.h"
 
 namespace sherpa_onnx {
 
@@ -159,9 +163,69 @@ class OnlineRecognizerParaformerImpl : public OnlineRecognizerImpl {
   }
 
   void DecodeStreams(OnlineStream **ss, int32_t n) const override {
-    // TODO(fangjun): Support batch size > 1
+    // All streams decode a chunk of the same size, so their features are
+    // stacked and the encoder runs once for the whole batch.
+    std::vector<std::vector<float>> frames_vec(n);
+    std::vector<int32_t> all_processed_frames(n);
     for (int32_t i = 0; i != n; ++i) {
-      DecodeStream(ss[i]);
+      all_processed_frames[i] = ss[i]->GetNumProcessedFrames();
+      frames_vec[i] = GetChunkFeatures(ss[i]);
+    }
+
+    int32_t feat_dim = model_.NegativeMean().size();
+    int32_t num_frames = frames_vec[0].size() / feat_dim;
+
+    std::array<int64_t, 3> x_shape{n, num_frames, feat_dim};
+    Ort::Value x = Ort::Value::CreateTensor<float>(
+        model_.Allocator(), x_shape.data(), x_shape.size());
+    float *p_x = x.GetTensorMutableData<float>();
+    for (const auto &frames : frames_vec) {
+      p_x = std::copy(frames.begin(), frames.end(), p_x);
+    }
+
+    int64_t x_len_shape = n;
+    Ort::Value x_length = Ort::Value::CreateTensor<int32_t>(
+        model_.Allocator(), &x_len_shape, 1);
+    std::fill(x_length.GetTensorMutableData<int32_t>(),
+              x_length.GetTensorMutableData<int32_t>() + n, num_frames);
+
+    auto encoder_out_vec =
+        model_.ForwardEncoder(std::move(x), std::move(x_length));
+
+    // CIF search, one stream at a time since each has its own caches
+    auto &encoder_out = encoder_out_vec[0];
+    auto &encoder_out_len = encoder_out_vec[1];
+    auto &alpha = encoder_out_vec[2];
+
+    std::vector<int64_t> encoder_out_shape =
+        encoder_out.GetTensorTypeAndShapeInfo().GetShape();
+    int32_t encoder_out_frames = encoder_out_shape[1];
+    int32_t encoder_out_dim = encoder_out_shape[2];
+
+    const float *p_encoder_out = encoder_out.GetTensorData<float>();
+    float *p_alpha = alpha.GetTensorMutableData<float>();
+
+    // num_tokens -> indexes of the streams that fire that many tokens
+    std::map<int32_t, std::vector<int32_t>> groups;
+    std::vector<std::vector<float>> acoustic_embedding_vec(n);
+    for (int32_t i = 0; i != n; ++i) {
+      acoustic_embedding_vec[i] =
+          Cif(p_encoder_out + i * encoder_out_frames * encoder_out_dim,
+              p_alpha + i * encoder_out_frames, encoder_out_frames,
+              encoder_out_dim, ss[i]);
+
+      int32_t num_tokens = acoustic_embedding_vec[i].size() / encoder_out_dim;
+      if (num_tokens > 0) {
+        groups[num_tokens].push_back(i);
+      }
+    }
+
+    // The decoder keeps the last frames of its input as the cache of the
+    // next chunk, so token sequences must not be padded. Streams are
+    // batched with others that fire the same number of tokens.
+    for (const auto &p : groups) {
+      RunDecoder(ss, p.second, p.first, all_processed_frames,
+                 acoustic_embedding_vec, &encoder_out, &encoder_out_len);
     }
   }
 
@@ -208,7 +272,9 @@ class OnlineRecognizerParaformerImpl : public OnlineRecognizerImpl {
   }
 
  private:
-  void DecodeStream(OnlineStream *s) const {
+  // Return the features of the next chunk of s, with the overlap of the
+  // previous chunk prepended. It is of shape (num_frames, feat_dim)
+  std::vector<float> GetChunkFeatures(OnlineStream *s) const {
     const auto num_processed_frames = s->GetNumProcessedFrames();
     std::vector<float> frames = s->GetFrames(num_processed_frames, chunk_size_);
     s->GetNumProcessedFrames() += chunk_size_ - 1;
@@ -234,47 +300,27 @@ class OnlineRecognizerParaformerImpl : public OnlineRecognizerImpl {
     std::copy(frames.end() - feat_cache.size(), frames.end(),
               feat_cache.begin());
 
-    int32_t num_frames = frames.size() / feat_dim;
-
-    auto memory_info =
-        Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
-
-    std::array<int64_t, 3> x_shape{1, num_frames, feat_dim};
-    Ort::Value x =
-        Ort::Value::CreateTensor(memory_info, frames.data(), frames.size(),
-                                 x_shape.data(), x_shape.size());
-
-    int64_t x_len_shape = 1;
-    int32_t x_len_val = num_frames;
-
-    Ort::Value x_length =
-        Ort::Value::CreateTensor(memory_info, &x_len_val, 1, &x_len_shape, 1);
-
-    auto encoder_out_vec =
-        model_.ForwardEncoder(std::move(x), std::move(x_length));
-
-    // CIF search
-    auto &encoder_out = encoder_out_vec[0];
-    auto &encoder_out_len = encoder_out_vec[1];
-    auto &alpha = encoder_out_vec[2];
-
-    float *p_alpha = alpha.GetTensorMutableData<float>();
-
-    std::vector<int64_t> alpha_shape =
-        alpha.GetTensorTypeAndShapeInfo().GetShape();
+    return frames;
+  }
 
+  // Run CIF on the encoder output of a single stream, using and updating
+  // its hidden and alpha caches.
+  //
+  // @param p_encoder_out Pointer to (num_frames, dim) floats
+  // @param p_alpha Pointer to num_frames floats. The overlap frames are
+  //                set to 0.
+  // @return Return the acoustic embeddings of the fired tokens. It is of
+  //         shape (num_tokens, dim) and may be empty.
+  std::vector<float> Cif(const float *p_encoder_out, float *p_alpha,
+                         int32_t num_frames, int32_t dim,
+                         OnlineStream *s) const {
     std::fill(p_alpha, p_alpha + left_chunk_size_, 0);
-    std::fill(p_alpha + alpha_shape[1] - right_chunk_size_,
-              p_alpha + alpha_shape[1], 0);
-
-    const float *p_encoder_out = encoder_out.GetTensorData<float>();
-
-    std::vector<int64_t> encoder_out_shape =
-        encoder_out.GetTensorTypeAndShapeInfo().GetShape();
+    std::fill(p_alpha + num_frames - right_chunk_size_, p_alpha + num_frames,
+              0);
 
     std::vector<float> &initial_hidden = s->GetParaformerEncoderOutCache();
     if (initial_hidden.empty()) {
-      initial_hidden.resize(encoder_out_shape[2]);
+      initial_hidden.resize(dim);
     }
 
     std::vector<float> &alpha_cache = s->GetParaformerAlphaCache();
@@ -283,40 +329,38 @@ class OnlineRecognizerParaformerImpl : public OnlineRecognizerImpl {
     }
 
     std::vector<float> acoustic_embedding;
-    acoustic_embedding.reserve(encoder_out_shape[1] * encoder_out_shape[2]);
+    acoustic_embedding.reserve(num_frames * dim);
 
     float threshold = 1.0;
 
     float integrate = alpha_cache[0];
 
-    for (int32_t i = 0; i != encoder_out_shape[1]; ++i) {
+    for (int32_t i = 0; i != num_frames; ++i) {
       float this_alpha = p_alpha[i];
       if (integrate + this_alpha < threshold) {
         integrate += this_alpha;
-        ScaleAddInPlace(p_encoder_out + i * encoder_out_shape[2],
-                        encoder_out_shape[2], this_alpha,
+        ScaleAddInPlace(p_encoder_out + i * dim, dim, this_alpha,
                         initial_hidden.data());
         continue;
       }
 
       // fire
-      ScaleAddInPlace(p_encoder_out + i * encoder_out_shape[2],
-                      encoder_out_shape[2], threshold - integrate,
+      ScaleAddInPlace(p_encoder_out + i * dim, dim, threshold - integrate,
                       initial_hidden.data());
       acoustic_embedding.insert(acoustic_embedding.end(),
                                 initial_hidden.begin(), initial_hidden.end());
       integrate += this_alpha - threshold;
 
-      Scale(p_encoder_out + i * encoder_out_shape[2], encoder_out_shape[2],
-            integrate, initial_hidden.data());
+      Scale(p_encoder_out + i * dim, dim, integrate, initial_hidden.data());
     }
 
     alpha_cache[0] = integrate;
 
-    if (acoustic_embedding.empty()) {
-      return;
-    }
+    return acoustic_embedding;
+  }
 
+  // Return the decoder states of s, initialized to zeros on first use
+  std::vector<Ort::Value> &GetDecoderStates(OnlineStream *s) const {
     auto &states = s->GetStates();
     if (states.empty()) {
       states.reserve(model_.DecoderNumBlocks());
@@ -336,50 +380,124 @@ class OnlineRecognizerParaformerImpl : public OnlineRecognizerImpl {
       }
     }
 
-    int32_t num_tokens = acoustic_embedding.size() / initial_hidden.size();
-    std::array<int64_t, 3> acoustic_embedding_shape{
-        1, num_tokens, static_cast<int32_t>(initial_hidden.size())};
+    return states;
+  }
+
+  // Run the decoder on the streams ss[indexes[i]], each of which fires
+  // num_tokens tokens. Their decoder states are stacked along the batch
+  // axis and unstacked after the run.
+  void RunDecoder(OnlineStream **ss, const std::vector<int32_t> &indexes,
+                  int32_t num_tokens,
+                  const std::vector<int32_t> &all_processed_frames,
+                  const std::vector<std::vector<float>> &acoustic_embedding_vec,
+                  const Ort::Value *encoder_out,
+                  const Ort::Value *encoder_out_len) const {
+    int32_t batch_size = indexes.size();
 
-    Ort::Value acoustic_embedding_tensor = Ort::Value::CreateTensor(
-        memory_info, acoustic_embedding.data(), acoustic_embedding.size(),
-        acoustic_embedding_shape.data(), acoustic_embedding_shape.size());
+    std::vector<int64_t> encoder_out_shape =
+        encoder_out->GetTensorTypeAndShapeInfo().GetShape();
+    int32_t encoder_out_size = encoder_out_shape[1] * encoder_out_shape[2];
+    int32_t dim = encoder_out_shape[2];
+
+    std::array<int64_t, 3> this_encoder_out_shape{
+        batch_size, encoder_out_shape[1], encoder_out_shape[2]};
+    Ort::Value this_encoder_out = Ort::Value::CreateTensor<float>(
+        model_.Allocator(), this_encoder_out_shape.data(),
+        this_encoder_out_shape.size());
+
+    std::array<int64_t, 3> acoustic_embedding_shape{batch_size, num_tokens,
+                                                    dim};
+    Ort::Value acoustic_embedding = Ort::Value::CreateTensor<float>(
+        model_.Allocator(), acoustic_embedding_shape.data(),
+        acoustic_embedding_shape.size());
+
+    const float *src = encoder_out->GetTensorData<float>();
+    float *p_encoder_out = this_encoder_out.GetTensorMutableData<float>();
+    float *p_acoustic_embedding =
+        acoustic_embedding.GetTensorMutableData<float>();
+    for (auto i : indexes) {
+      p_encoder_out = std::copy(src + i * encoder_out_size,
+                                src + (i + 1) * encoder_out_size,
+                                p_encoder_out);
+
+      const auto &e = acoustic_embedding_vec[i];
+      p_acoustic_embedding =
+          std::copy(e.begin(), e.end(), p_acoustic_embedding);
+    }
 
-    std::array<int64_t, 1> acoustic_embedding_length_shape{1};
-    Ort::Value acoustic_embedding_length_tensor = Ort::Value::CreateTensor(
-        memory_info, &num_tokens, 1, acoustic_embedding_length_shape.data(),
-        acoustic_embedding_length_shape.size());
+    // All streams have the same encoder output length
+    int64_t length_shape = batch_size;
+    Ort::Value this_encoder_out_len{nullptr};
+    if (encoder_out_len->GetTensorTypeAndShapeInfo().GetElementType() ==
+        ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64) {
+      this_encoder_out_len = Ort::Value::CreateTensor<int64_t>(
+          model_.Allocator(), &length_shape, 1);
+      int64_t *p = this_encoder_out_len.GetTensorMutableData<int64_t>();
+      std::fill(p, p + batch_size,
+                encoder_out_len->GetTensorData<int64_t>()[0]);
+    } else {
+      this_encoder_out_len = Ort::Value::CreateTensor<int32_t>(
+          model_.Allocator(), &length_shape, 1);
+      int32_t *p = this_encoder_out_len.GetTensorMutableData<int32_t>();
+      std::fill(p, p + batch_size,
+                encoder_out_len->GetTensorData<int32_t>()[0]);
+    }
+
+    Ort::Value acoustic_embedding_length = Ort::Value::CreateTensor<int32_t>(
+        model_.Allocator(), &length_shape, 1);
+    std::fill(acoustic_embedding_length.GetTensorMutableData<int32_t>(),
+              acoustic_embedding_length.GetTensorMutableData<int32_t>() +
+                  batch_size,
+              num_tokens);
+
+    // Each state is of shape (1, encoder_output_size, kernel_size - 1)
+    int32_t num_blocks = model_.DecoderNumBlocks();
+    std::vector<Ort::Value> states;
+    states.reserve(num_blocks);
+    for (int32_t b = 0; b != num_blocks; ++b) {
+      std::vector<const Ort::Value *> buf;
+      buf.reserve(batch_size);
+      for (auto i : indexes) {
+        buf.push_back(&GetDecoderStates(ss[i])[b]);
+      }
+      states.push_back(Cat(model_.Allocator(), buf, 0));
+    }
 
     auto decoder_out_vec = model_.ForwardDecoder(
-        std::move(encoder_out), std::move(encoder_out_len),
-        std::move(acoustic_embedding_tensor),
-        std::move(acoustic_embedding_length_tensor), std::move(states));
+        std::move(this_encoder_out), std::move(this_encoder_out_len),
+        std::move(acoustic_embedding), std::move(acoustic_embedding_length),
+        std::move(states));
 
-    states.reserve(model_.DecoderNumBlocks());
-    for (int32_t i = 2; i != decoder_out_vec.size(); ++i) {
+    for (int32_t b = 0; b != num_blocks; ++b) {
       // TODO(fangjun): When we change chunk_size_, we need to
-      // slice decoder_out_vec[i] accordingly.
-      states.push_back(std::move(decoder_out_vec[i]));
+      // slice decoder_out_vec[b + 2] accordingly.
+      std::vector<Ort::Value> unbound =
+          Unbind(model_.Allocator(), &decoder_out_vec[b + 2], 0);
+      for (int32_t k = 0; k != batch_size; ++k) {
+        ss[indexes[k]]->GetStates()[b] = std::move(unbound[k]);
+      }
     }
 
-    const auto &sample_ids = decoder_out_vec[1];
-    const int64_t *p_sample_ids = sample_ids.GetTensorData<int64_t>();
+    const int64_t *p_sample_ids = decoder_out_vec[1].GetTensorData<int64_t>();
 
-    bool non_blank_detected = false;
+    for (int32_t k = 0; k != batch_size; ++k) {
+      int32_t i = indexes[k];
+      auto &result = ss[i]->GetParaformerResult();
 
-    auto &result = s->GetParaformerResult();
+      bool non_blank_detected = false;
+      for (int32_t j = 0; j != num_tokens; ++j) {
+        int32_t t = p_sample_ids[k * num_tokens + j];
+        if (t == 0) {
+          continue;
+        }
 
-    for (int32_t i = 0; i != num_tokens; ++i) {
-      int32_t t = p_sample_ids[i];
-      if (t == 0) {
-        continue;
+        non_blank_detected = true;
+        result.tokens.push_back(t);
       }
 
-      non_blank_detected = true;
-      result.tokens.push_back(t);
-    }
-
-    if (non_blank_detected) {
-      result.last_non_blank_frame_index = num_processed_frames;
+      if (non_blank_detected) {
+        result.last_non_blank_frame_index = all_processed_frames[i];
+      }
     }
   }
 
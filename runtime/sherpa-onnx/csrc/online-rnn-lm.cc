@@ -6,16 +6,20 @@
 #include "sherpa-onnx/csrc/online-rnn-lm.h"
 
 #include <algorithm>
+#include <mutex>  // NOLINT
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "onnxruntime_cxx_api.h"  // NOLINT
+#include "sherpa-onnx/csrc/cat.h"
 #include "sherpa-onnx/csrc/file-utils.h"
 #include "sherpa-onnx/csrc/macros.h"
 #include "sherpa-onnx/csrc/onnx-utils.h"
 #include "sherpa-onnx/csrc/session.h"
 #include "sherpa-onnx/csrc/text-utils.h"
+#include "sherpa-onnx/csrc/unbind.h"
 
 namespace sherpa_onnx {
 
@@ -52,6 +56,109 @@ class OnlineRnnLM::Impl {
     hyp->nn_lm_states = Convert(std::move(lm_out.second));
   }
 
+  // batched shallow fusion scoring function
+  void ComputeLMScoreSF(float scale, const std::vector<Hypothesis *> &hyps) {
+    int32_t num_hyps = static_cast<int32_t>(hyps.size());
+
+    // Indexes of hyps whose token history is not in the cache
+    std::vector<int32_t> pending;
+    std::vector<std::string> keys(num_hyps);
+
+    {
+      std::lock_guard<std::mutex> lock(cache_mutex_);
+      for (int32_t i = 0; i != num_hyps; ++i) {
+        Hypothesis *hyp = hyps[i];
+        if (hyp->nn_lm_states.empty()) {
+          auto init_states = GetInitStatesSF();
+          hyp->nn_lm_scores.value = std::move(init_states.first);
+          hyp->nn_lm_states = Convert(std::move(init_states.second));
+        }
+
+        // get lm score for cur token given the hyp->ys[:-1]
+        const float *nn_lm_scores =
+            hyp->nn_lm_scores.value.GetTensorData<float>();
+        hyp->lm_log_prob += nn_lm_scores[hyp->ys.back()] * scale;
+
+        keys[i] = CacheKey(hyp->ys);
+        auto it = cache_.find(keys[i]);
+        if (it != cache_.end()) {
+          hyp->nn_lm_scores = it->second.scores;
+          hyp->nn_lm_states = it->second.states;
+          continue;
+        }
+
+        pending.push_back(i);
+      }
+    }
+
+    if (pending.empty()) {
+      return;
+    }
+
+    // Hyps in pending with the same history are scored once. miss[j] is
+    // the first of them and first_miss maps a key to j.
+    std::vector<int32_t> miss;
+    std::unordered_map<std::string, int32_t> first_miss;
+    for (auto i : pending) {
+      if (first_miss.emplace(keys[i], miss.size()).second) {
+        miss.push_back(i);
+      }
+    }
+
+    int32_t num_miss = static_cast<int32_t>(miss.size());
+
+    std::array<int64_t, 2> x_shape{num_miss, 1};
+    Ort::Value x = Ort::Value::CreateTensor<int64_t>(allocator_, x_shape.data(),
+                                                     x_shape.size());
+    int64_t *p_x = x.GetTensorMutableData<int64_t>();
+
+    // h and c are of shape (num_layers, 1, hidden_size) for each hyp and
+    // are stacked along axis 1
+    std::vector<const Ort::Value *> h_buf(num_miss);
+    std::vector<const Ort::Value *> c_buf(num_miss);
+    for (int32_t j = 0; j != num_miss; ++j) {
+      const Hypothesis *hyp = hyps[miss[j]];
+      p_x[j] = hyp->ys.back();
+      h_buf[j] = &hyp->nn_lm_states[0].value;
+      c_buf[j] = &hyp->nn_lm_states[1].value;
+    }
+
+    std::vector<Ort::Value> states;
+    states.reserve(2);
+    states.push_back(Cat(allocator_, h_buf, 1));
+    states.push_back(Cat(allocator_, c_buf, 1));
+
+    // get lm scores for next tokens given the hyp->ys[:] of all hyps
+    auto lm_out = ScoreToken(std::move(x), std::move(states));
+
+    std::vector<Ort::Value> scores_vec = Unbind(allocator_, &lm_out.first, 0);
+    std::vector<Ort::Value> h_vec = Unbind(allocator_, &lm_out.second[0], 1);
+    std::vector<Ort::Value> c_vec = Unbind(allocator_, &lm_out.second[1], 1);
+
+    std::vector<LMState> results(num_miss);
+    for (int32_t j = 0; j != num_miss; ++j) {
+      results[j].scores = std::move(scores_vec[j]);
+      results[j].states.reserve(2);
+      results[j].states.emplace_back(std::move(h_vec[j]));
+      results[j].states.emplace_back(std::move(c_vec[j]));
+    }
+
+    for (auto i : pending) {
+      const LMState &r = results[first_miss.at(keys[i])];
+      hyps[i]->nn_lm_scores = r.scores;
+      hyps[i]->nn_lm_states = r.states;
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (cache_.size() + num_miss > kMaxCacheSize) {
+      cache_.clear();
+    }
+
+    for (int32_t j = 0; j != num_miss; ++j) {
+      cache_[keys[miss[j]]] = std::move(results[j]);
+    }
+  }
+
   // classic rescore function
   void ComputeLMScore(float scale, int32_t context_size,
                       std::vector<Hypotheses> *hyps) {
@@ -138,6 +245,20 @@ class OnlineRnnLM::Impl {
   }
 
  private:
+  // LM outputs after a token history, used for shallow fusion
+  struct LMState {
+    CopyableOrtValue scores;
+    std::vector<CopyableOrtValue> states;
+  };
+
+  // Clear the cache once it holds this many histories
+  static constexpr std::size_t kMaxCacheSize = 1024;
+
+  static std::string CacheKey(const std::vector<int64_t> &ys) {
+    return std::string(reinterpret_cast<const char *>(ys.data()),
+                       ys.size() * sizeof(int64_t));
+  }
+
   void Init(const OnlineLMConfig &config) {
     auto buf = ReadFile(config_.model);
 
@@ -200,6 +321,10 @@ class OnlineRnnLM::Impl {
   CopyableOrtValue init_scores_;
   std::vector<Ort::Value> init_states_;
 
+  // Token history -> LM outputs. Decoding threads share it.
+  std::unordered_map<std::string, LMState> cache_;
+  std::mutex cache_mutex_;
+
   int32_t rnn_num_layers_ = 2;
   int32_t rnn_hidden_size_ = 512;
   int32_t sos_id_ = 1;
@@ -236,4 +361,10 @@ void OnlineRnnLM::ComputeLMScoreSF(float scale, Hypothesis *hyp) {
   return impl_->ComputeLMScoreSF(scale, hyp);
 }
 
+// batched shallow fusion scores
+void OnlineRnnLM::ComputeLMScoreSF(float scale,
+                                   const std::vector<Hypothesis *> &hyps) {
+  return impl_->ComputeLMScoreSF(scale, hyps);
+}
+
 }  // namespace sherpa_onnx
@@ -58,6 +58,19 @@ class OnlineRnnLM : public OnlineLM {
    */
   void ComputeLMScoreSF(float scale, Hypothesis *hyp) override;
 
+   /** Batched shallow fusion.
+   *
+   * The LM runs once for all hyps, with their (h, c) states stacked along
+   * the batch axis. Outputs are cached by token history, so hyps sharing
+   * the same tokens, in this call or in an earlier one, are scored once.
+   *
+   * @param scale LM score
+   * @param hyps It is changed in-place.
+   *
+   */
+  void ComputeLMScoreSF(float scale,
+                        const std::vector<Hypothesis *> &hyps) override;
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
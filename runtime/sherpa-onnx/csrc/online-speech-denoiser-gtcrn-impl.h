@@ -0,0 +1,316 @@
+// sherpa-onnx/csrc/online-speech-denoiser-gtcrn-impl.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_ONNX_CSRC_ONLINE_SPEECH_DENOISER_GTCRN_IMPL_H_
+#define SHERPA_ONNX_CSRC_ONLINE_SPEECH_DENOISER_GTCRN_IMPL_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "kaldi-native-fbank/csrc/feature-window.h"
+#include "kaldi-native-fbank/csrc/istft.h"
+#include "kaldi-native-fbank/csrc/stft.h"
+#include "sherpa-onnx/csrc/macros.h"
+#include "sherpa-onnx/csrc/offline-speech-denoiser-gtcrn-model.h"
+#include "sherpa-onnx/csrc/online-speech-denoiser-impl.h"
+#include "sherpa-onnx/csrc/online-speech-denoiser.h"
+#include "sherpa-onnx/csrc/resample.h"
+
+namespace sherpa_onnx {
+
+/* Streaming STFT -> GTCRN -> overlap-add.
+ *
+ * Input samples are buffered until a full STFT frame is available. The
+ * offline STFT centers frames by padding n_fft/2 samples at the start;
+ * here n_fft/2 zeros are padded instead and the corresponding output is
+ * dropped.
+ *
+ * The inverse STFT of a frame overlaps with the next
+ * ceil(n_fft / hop_length) - 1 frames. Those last frames are kept in
+ * history_ and prepended to the next batch of frames, and only samples
+ * covered by all of their frames are returned.
+ *
+ * Model is a template parameter so that tests can replace the network.
+ */
+template <typename Model = OfflineSpeechDenoiserGtcrnModel>
+class OnlineSpeechDenoiserGtcrnImpl : public OnlineSpeechDenoiserImpl {
+ public:
+  explicit OnlineSpeechDenoiserGtcrnImpl(
+      const OnlineSpeechDenoiserConfig &config)
+      : model_(config.model),
+        stft_config_(GetStftConfig(model_.GetMetaData())),
+        stft_(stft_config_),
+        istft_(stft_config_) {
+    Reset();
+  }
+
+  template <typename Manager>
+  OnlineSpeechDenoiserGtcrnImpl(Manager *mgr,
+                                const OnlineSpeechDenoiserConfig &config)
+      : model_(mgr, config.model),
+        stft_config_(GetStftConfig(model_.GetMetaData())),
+        stft_(stft_config_),
+        istft_(stft_config_) {
+    Reset();
+  }
+
+  DenoisedAudio Run(const float *samples, int32_t n,
+                    int32_t sample_rate) override {
+    const auto &meta = model_.GetMetaData();
+
+    if (sample_rate != meta.sample_rate) {
+      if (!resampler_) {
+        SHERPA_ONNX_LOGE(
+            "Creating a resampler:\n"
+            "   in_sample_rate: %d\n"
+            "   output_sample_rate: %d\n",
+            sample_rate, meta.sample_rate);
+
+        float min_freq = std::min<int32_t>(sample_rate, meta.sample_rate);
+        float lowpass_cutoff = 0.99 * 0.5 * min_freq;
+
+        int32_t lowpass_filter_width = 6;
+        resampler_ = std::make_unique<LinearResample>(
+            sample_rate, meta.sample_rate, lowpass_cutoff,
+            lowpass_filter_width);
+      }
+
+      std::vector<float> tmp;
+      resampler_->Resample(samples, n, false, &tmp);
+      AcceptSamples(tmp.data(), tmp.size());
+    } else {
+      AcceptSamples(samples, n);
+    }
+
+    return Process();
+  }
+
+  DenoisedAudio Flush() override {
+    if (resampler_) {
+      std::vector<float> tmp;
+      resampler_->Resample(nullptr, 0, true, &tmp);
+      AcceptSamples(tmp.data(), tmp.size());
+    }
+
+    // Pad zeros so that every remaining sample is covered by all of its
+    // frames
+    const auto &meta = model_.GetMetaData();
+    int32_t frames_per_run = std::max(meta.frames_per_run, 1);
+    buffer_.resize(
+        buffer_.size() + meta.n_fft + (frames_per_run - 1) * meta.hop_length,
+        0);
+
+    DenoisedAudio ans = Process();
+
+    // Drop the output of the padded zeros
+    int64_t num_extra = num_output_samples_ - num_input_samples_;
+    if (num_extra > 0) {
+      ans.samples.resize(ans.samples.size() -
+                         std::min<int64_t>(num_extra, ans.samples.size()));
+    }
+
+    Reset();
+
+    return ans;
+  }
+
+  void Reset() override {
+    const auto &meta = model_.GetMetaData();
+    int32_t num_bins = meta.n_fft / 2 + 1;
+
+    states_ = model_.GetInitStates();
+
+    buffer_.assign(meta.n_fft / 2, 0);
+
+    int32_t num_history_frames =
+        (meta.n_fft + meta.hop_length - 1) / meta.hop_length - 1;
+    history_.num_frames = num_history_frames;
+    history_.real.assign(num_history_frames * num_bins, 0);
+    history_.imag.assign(num_history_frames * num_bins, 0);
+
+    num_to_skip_ = meta.n_fft / 2;
+    num_input_samples_ = 0;
+    num_output_samples_ = 0;
+
+    resampler_.reset();
+  }
+
+  int32_t GetSampleRate() const override {
+    return model_.GetMetaData().sample_rate;
+  }
+
+  int32_t GetFrameShiftInSamples() const override {
+    return model_.GetMetaData().hop_length;
+  }
+
+ private:
+  static knf::StftConfig GetStftConfig(
+      const OfflineSpeechDenoiserGtcrnModelMetaData &meta) {
+    knf::StftConfig stft_config;
+    stft_config.n_fft = meta.n_fft;
+    stft_config.hop_length = meta.hop_length;
+    stft_config.win_length = meta.window_length;
+    stft_config.window_type = meta.window_type;
+    // Padding is done by us since frames arrive incrementally
+    stft_config.center = false;
+    if (stft_config.window_type == "hann_sqrt") {
+      auto window = knf::GetWindow("hann", stft_config.win_length);
+      for (auto &w : window) {
+        w = std::sqrt(w);
+      }
+      stft_config.window = std::move(window);
+    }
+
+    return stft_config;
+  }
+
+  void AcceptSamples(const float *samples, int32_t n) {
+    buffer_.insert(buffer_.end(), samples, samples + n);
+    num_input_samples_ += n;
+  }
+
+  // Denoise all complete frames in buffer_ and return the samples that
+  // are ready
+  DenoisedAudio Process() {
+    const auto &meta = model_.GetMetaData();
+    int32_t n_fft = meta.n_fft;
+    int32_t hop_length = meta.hop_length;
+    int32_t num_bins = n_fft / 2 + 1;
+
+    DenoisedAudio ans;
+    ans.sample_rate = meta.sample_rate;
+
+    if (static_cast<int32_t>(buffer_.size()) < n_fft) {
+      return ans;
+    }
+
+    int32_t num_frames =
+        1 + (static_cast<int32_t>(buffer_.size()) - n_fft) / hop_length;
+
+    // Run the model on as many frames at a time as it accepts. Since it is
+    // streaming, frames cannot be padded, so the remaining frames wait for
+    // more samples if it needs a fixed number of frames per run.
+    int32_t frames_per_run =
+        meta.frames_per_run > 0 ? meta.frames_per_run : num_frames;
+    num_frames -= num_frames % frames_per_run;
+    if (num_frames == 0) {
+      return ans;
+    }
+
+    knf::StftResult stft_result =
+        stft_.Compute(buffer_.data(), n_fft + (num_frames - 1) * hop_length);
+
+    buffer_.erase(buffer_.begin(), buffer_.begin() + num_frames * hop_length);
+
+    // frames = history_ + enhanced frames
+    knf::StftResult frames;
+    int32_t num_history_frames = history_.num_frames;
+    frames.num_frames = num_history_frames + num_frames;
+    frames.real = std::move(history_.real);
+    frames.imag = std::move(history_.imag);
+    frames.real.resize(frames.num_frames * num_bins);
+    frames.imag.resize(frames.num_frames * num_bins);
+
+    for (int32_t start = 0; start < num_frames; start += frames_per_run) {
+      Enhance(stft_result, start, frames_per_run, num_history_frames, &frames);
+    }
+
+    std::vector<float> samples = istft_.Compute(frames);
+
+    // samples in [begin, end) are covered by all of their frames
+    int32_t begin = num_history_frames * hop_length + num_to_skip_;
+    int32_t end = frames.num_frames * hop_length;
+    if (begin < end) {
+      ans.samples.assign(samples.begin() + begin, samples.begin() + end);
+      num_to_skip_ = 0;
+    } else {
+      num_to_skip_ = begin - end;
+    }
+
+    num_output_samples_ += ans.samples.size();
+
+    history_.num_frames = num_history_frames;
+    int32_t offset = num_frames * num_bins;
+    history_.real.assign(frames.real.begin() + offset, frames.real.end());
+    history_.imag.assign(frames.imag.begin() + offset, frames.imag.end());
+
+    return ans;
+  }
+
+  // Run the model on num_frames frames of stft_result starting at start
+  // and write the output to frames, after the first num_history_frames
+  // frames.
+  void Enhance(const knf::StftResult &stft_result, int32_t start,
+               int32_t num_frames, int32_t num_history_frames,
+               knf::StftResult *frames) {
+    int32_t num_bins = model_.GetMetaData().n_fft / 2 + 1;
+
+    // x is of shape (1, num_bins, num_frames, 2)
+    x_.resize(num_bins * num_frames * 2);
+    for (int32_t t = 0; t < num_frames; ++t) {
+      const float *p_real = stft_result.real.data() + (start + t) * num_bins;
+      const float *p_imag = stft_result.imag.data() + (start + t) * num_bins;
+      for (int32_t i = 0; i < num_bins; ++i) {
+        x_[(i * num_frames + t) * 2] = p_real[i];
+        x_[(i * num_frames + t) * 2 + 1] = p_imag[i];
+      }
+    }
+
+    auto memory_info =
+        Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
+
+    std::array<int64_t, 4> x_shape{1, num_bins, num_frames, 2};
+    Ort::Value x = Ort::Value::CreateTensor(memory_info, x_.data(), x_.size(),
+                                            x_shape.data(), x_shape.size());
+
+    Ort::Value output{nullptr};
+    std::tie(output, states_) = model_.Run(std::move(x), std::move(states_));
+
+    const float *p = output.GetTensorData<float>();
+    for (int32_t t = 0; t < num_frames; ++t) {
+      float *p_real =
+          frames->real.data() + (num_history_frames + start + t) * num_bins;
+      float *p_imag =
+          frames->imag.data() + (num_history_frames + start + t) * num_bins;
+      for (int32_t i = 0; i < num_bins; ++i) {
+        p_real[i] = p[(i * num_frames + t) * 2];
+        p_imag[i] = p[(i * num_frames + t) * 2 + 1];
+      }
+    }
+  }
+
+ private:
+  Model model_;
+  knf::StftConfig stft_config_;
+  knf::Stft stft_;
+  knf::IStft istft_;
+
+  typename Model::States states_;
+
+  // Samples not yet consumed by a frame
+  std::vector<float> buffer_;
+
+  // The last enhanced frames, which overlap with the next frames
+  knf::StftResult history_;
+
+  // Number of output samples still to drop for the padding at the start
+  int32_t num_to_skip_ = 0;
+
+  int64_t num_input_samples_ = 0;
+  int64_t num_output_samples_ = 0;
+
+  std::unique_ptr<LinearResample> resampler_;
+
+  // Model input buffer, reused across runs
+  std::vector<float> x_;
+};
+
+}  // namespace sherpa_onnx
+
+#endif  // SHERPA_ONNX_CSRC_ONLINE_SPEECH_DENOISER_GTCRN_IMPL_H_
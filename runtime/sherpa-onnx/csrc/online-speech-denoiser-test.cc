@@ -0,0 +1,134 @@
+// sherpa-onnx/csrc/online-speech-denoiser-test.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "kaldi-native-fbank/csrc/feature-window.h"
+#include "kaldi-native-fbank/csrc/istft.h"
+#include "kaldi-native-fbank/csrc/stft.h"
+#include "sherpa-onnx/csrc/online-speech-denoiser-gtcrn-impl.h"
+
+namespace sherpa_onnx {
+
+// A model that returns its input, so the streaming and the offline paths
+// only differ in how they split the audio into STFT frames.
+template <int32_t FramesPerRun>
+class IdentityDenoiserModel {
+ public:
+  using States = std::vector<Ort::Value>;
+
+  explicit IdentityDenoiserModel(
+      const OfflineSpeechDenoiserModelConfig & /*config*/) {
+    meta_.sample_rate = 16000;
+    meta_.n_fft = 512;
+    meta_.hop_length = 256;
+    meta_.window_length = 512;
+    meta_.window_type = "hann_sqrt";
+    meta_.frames_per_run = FramesPerRun;
+  }
+
+  States GetInitStates() const { return {}; }
+
+  std::pair<Ort::Value, States> Run(Ort::Value x, States states) const {
+    return {std::move(x), std::move(states)};
+  }
+
+  const OfflineSpeechDenoiserGtcrnModelMetaData &GetMetaData() const {
+    return meta_;
+  }
+
+ private:
+  OfflineSpeechDenoiserGtcrnModelMetaData meta_;
+};
+
+// The same steps as OfflineSpeechDenoiserGtcrnImpl::Run() with the
+// identity model
+static std::vector<float> RunOffline(
+    const std::vector<float> &samples,
+    const OfflineSpeechDenoiserGtcrnModelMetaData &meta) {
+  knf::StftConfig stft_config;
+  stft_config.n_fft = meta.n_fft;
+  stft_config.hop_length = meta.hop_length;
+  stft_config.win_length = meta.window_length;
+  stft_config.window_type = meta.window_type;
+  auto window = knf::GetWindow("hann", stft_config.win_length);
+  for (auto &w : window) {
+    w = std::sqrt(w);
+  }
+  stft_config.window = std::move(window);
+
+  knf::Stft stft(stft_config);
+  knf::StftResult stft_result = stft.Compute(samples.data(), samples.size());
+
+  knf::IStft istft(stft_config);
+  return istft.Compute(stft_result);
+}
+
+template <int32_t FramesPerRun>
+static void TestRandomChunks() {
+  const int32_t kNumSamples = 3 * 16000 + 123;
+
+  std::mt19937 gen(20250101 + FramesPerRun);
+  std::normal_distribution<float> normal(0, 0.3);
+  std::vector<float> samples(kNumSamples);
+  for (auto &s : samples) {
+    s = normal(gen);
+  }
+
+  OnlineSpeechDenoiserConfig config;
+  OnlineSpeechDenoiserGtcrnImpl<IdentityDenoiserModel<FramesPerRun>> denoiser(
+      config);
+  int32_t sample_rate = denoiser.GetSampleRate();
+  int32_t n_fft = 512;
+  int32_t hop_length = denoiser.GetFrameShiftInSamples();
+  int32_t max_lag = n_fft + std::max(FramesPerRun - 1, 0) * hop_length;
+
+  std::vector<float> expected = RunOffline(
+      samples, IdentityDenoiserModel<FramesPerRun>(config.model).GetMetaData());
+
+  // Feed the same audio twice since Flush() resets the denoiser
+  for (int32_t pass = 0; pass != 2; ++pass) {
+    std::uniform_int_distribution<int32_t> chunk_size(0, 2000);
+
+    std::vector<float> out;
+    for (int32_t offset = 0; offset < kNumSamples;) {
+      int32_t n = std::min(chunk_size(gen), kNumSamples - offset);
+      auto audio = denoiser.Run(samples.data() + offset, n, sample_rate);
+      EXPECT_EQ(audio.sample_rate, sample_rate);
+      out.insert(out.end(), audio.samples.begin(), audio.samples.end());
+      offset += n;
+
+      // See OnlineSpeechDenoiser::Run()
+      EXPECT_GT(static_cast<int32_t>(out.size()), offset - max_lag);
+      EXPECT_LE(static_cast<int32_t>(out.size()), offset);
+    }
+
+    auto audio = denoiser.Flush();
+    out.insert(out.end(), audio.samples.begin(), audio.samples.end());
+
+    ASSERT_EQ(static_cast<int32_t>(out.size()), kNumSamples) << FramesPerRun;
+
+    // The two paths pad the two ends differently
+    int32_t end = std::min<int32_t>(expected.size(), kNumSamples) - n_fft;
+    for (int32_t i = n_fft; i < end; ++i) {
+      ASSERT_NEAR(out[i], expected[i], 1e-4) << FramesPerRun << " " << i;
+    }
+  }
+}
+
+TEST(OnlineSpeechDenoiser, MatchesOffline) {
+  // Any number of frames per run
+  TestRandomChunks<0>();
+
+  // Models exported with a fixed number of frames per run
+  TestRandomChunks<1>();
+  TestRandomChunks<4>();
+}
+
+}  // namespace sherpa_onnx
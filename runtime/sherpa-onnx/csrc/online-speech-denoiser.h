@@ -0,0 +1,86 @@
+// sherpa-onnx/csrc/online-speech-denoiser.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+#ifndef SHERPA_ONNX_CSRC_ONLINE_SPEECH_DENOISER_H_
+#define SHERPA_ONNX_CSRC_ONLINE_SPEECH_DENOISER_H_
+
+#include <memory>
+#include <string>
+
+#include "sherpa-onnx/csrc/offline-speech-denoiser-model-config.h"
+#include "sherpa-onnx/csrc/offline-speech-denoiser.h"
+#include "sherpa-onnx/csrc/parse-options.h"
+
+namespace sherpa_onnx {
+
+struct OnlineSpeechDenoiserConfig {
+  // The same models are used for offline and online speech denoising
+  OfflineSpeechDenoiserModelConfig model;
+
+  void Register(ParseOptions *po);
+  bool Validate() const;
+
+  std::string ToString() const;
+};
+
+class OnlineSpeechDenoiserImpl;
+
+/* Denoise audio that arrives in chunks, e.g., from a microphone.
+ *
+ * The model caches and the overlap-add state are kept across calls to
+ * Run(), so the concatenated output of all calls followed by Flush()
+ * matches the output of OfflineSpeechDenoiser on the whole audio, except
+ * for the padding at the two ends.
+ *
+ * An object keeps the state of one audio stream. Use one object per stream.
+ */
+class OnlineSpeechDenoiser {
+ public:
+  explicit OnlineSpeechDenoiser(const OnlineSpeechDenoiserConfig &config);
+  ~OnlineSpeechDenoiser();
+
+  template <typename Manager>
+  OnlineSpeechDenoiser(Manager *mgr, const OnlineSpeechDenoiserConfig &config);
+
+  /*
+   * @param samples 1-D array of audio samples. Each sample is in the
+   *                range [-1, 1]. It can be of any length.
+   * @param n Number of samples
+   * @param sample_rate Sample rate of the input samples. It should be the
+   *                    same for all calls until Flush() or Reset().
+   *
+   * @return Denoised samples that are ready. Samples are returned once all
+   *         STFT frames overlapping them have been processed, so the output
+   *         lags the input by less than n_fft + (N - 1) * hop_length
+   *         samples, where N is the number of frames the model takes per
+   *         run, or 1 if it takes any number of frames.
+   */
+  DenoisedAudio Run(const float *samples, int32_t n, int32_t sample_rate);
+
+  /*
+   * Process the remaining samples and return their denoised output.
+   * The object is reset afterwards and can be used for a new stream.
+   */
+  DenoisedAudio Flush();
+
+  // Discard all buffered samples and reset the model caches
+  void Reset();
+
+  /*
+   * Return the sample rate of the denoised audio
+   */
+  int32_t GetSampleRate() const;
+
+  /*
+   * Return the frame shift of the model in samples. For the lowest
+   * latency, pass a multiple of it to each call of Run().
+   */
+  int32_t GetFrameShiftInSamples() const;
+
+ private:
+  std::unique_ptr<OnlineSpeechDenoiserImpl> impl_;
+};
+
+}  // namespace sherpa_onnx
+
+#endif  // SHERPA_ONNX_CSRC_ONLINE_SPEECH_DENOISER_H_
@@ -14,6 +14,22 @@
 
 namespace sherpa_onnx {
 
+namespace {
+
+// A hyp extended by one token (or blank) in a frame, before its score
+// is finalized
+struct ExpandedHyp {
+  Hypothesis hyp;
+  int32_t stream = 0;  // index of the stream in the batch
+  bool is_blank = false;
+  float log_prob = 0;  // from the joiner, including the path score
+  float prev_lm_log_prob = 0;
+  float context_score = 0;
+  float y_prob = 0;  // used only if is_blank is false
+};
+
+}  // namespace
+
 static void UseCachedDecoderOut(
     const std::vector<int32_t> &hyps_row_splits,
     const std::vector<OnlineTransducerDecoderResult> &results,
@@ -99,6 +115,7 @@ void OnlineTransducerModifiedBeamSearchDecoder::Decode(
     cur.push_back(std::move(r.hyps));
   }
   std::vector<Hypothesis> prev;
+  std::vector<ExpandedHyp> expanded;
 
   for (int32_t t = 0; t != num_frames; ++t) {
     // Due to merging paths with identical token sequences,
@@ -113,7 +130,6 @@ void OnlineTransducerModifiedBeamSearchDecoder::Decode(
       }
     }
     cur.clear();
-    cur.reserve(batch_size);
 
     Ort::Value decoder_input = model_->BuildDecoderInput(prev);
     Ort::Value decoder_out = model_->RunDecoder(std::move(decoder_input));
@@ -167,6 +183,9 @@ void OnlineTransducerModifiedBeamSearchDecoder::Decode(
     }
     p_logprob = p_logit;  // we changed p_logprob in the above for loop
 
+    // Expand the hyps of all streams first, so that shallow fusion can
+    // score all new tokens of this frame with a single LM run
+    expanded.clear();
     for (int32_t b = 0; b != batch_size; ++b) {
       int32_t frame_offset = (*result)[b].frame_offset;
       int32_t start = hyps_row_splits[b];
@@ -174,70 +193,88 @@ void OnlineTransducerModifiedBeamSearchDecoder::Decode(
       auto topk =
           TopkIndex(p_logprob, vocab_size * (end - start), max_active_paths_);
 
-      Hypotheses hyps;
       for (auto k : topk) {
         int32_t hyp_index = k / vocab_size + start;
         int32_t new_token = k % vocab_size;
 
-        Hypothesis new_hyp = prev[hyp_index];
-        const float prev_lm_log_prob = new_hyp.lm_log_prob;
-        float context_score = 0;
-        auto context_state = new_hyp.context_state;
+        ExpandedHyp e;
+        e.hyp = prev[hyp_index];
+        e.stream = b;
+        e.log_prob = p_logprob[k];
+        e.prev_lm_log_prob = e.hyp.lm_log_prob;
+        auto context_state = e.hyp.context_state;
 
         // blank is hardcoded to 0
         // also, it treats unk as blank
-        if (new_token != 0 && new_token != unk_id_) {
-          new_hyp.ys.push_back(new_token);
-          new_hyp.timestamps.push_back(t + frame_offset);
-          new_hyp.num_trailing_blanks = 0;
+        e.is_blank = new_token == 0 || new_token == unk_id_;
+        if (!e.is_blank) {
+          e.hyp.ys.push_back(new_token);
+          e.hyp.timestamps.push_back(t + frame_offset);
+          e.hyp.num_trailing_blanks = 0;
           if (ss != nullptr && ss[b]->GetContextGraph() != nullptr) {
             auto context_res = ss[b]->GetContextGraph()->ForwardOneStep(
                 context_state, new_token, false /*strict mode*/);
-            context_score = std::get<0>(context_res);
-            new_hyp.context_state = std::get<1>(context_res);
-          }
-          if (lm_ && shallow_fusion_) {
-            lm_->ComputeLMScoreSF(lm_scale_, &new_hyp);
+            e.context_score = std::get<0>(context_res);
+            e.hyp.context_state = std::get<1>(context_res);
           }
+          e.y_prob = logit_with_temperature[start * vocab_size + k];
         } else {
-          ++new_hyp.num_trailing_blanks;
+          ++e.hyp.num_trailing_blanks;
         }
-        if (lm_ && shallow_fusion_) {
-           new_hyp.log_prob = p_logprob[k] + context_score -
-                           prev_lm_log_prob;  // log_prob only includes the
-                                              // score of the transducer
-        } else {
-           new_hyp.log_prob = p_logprob[k] + context_score;  // rescore or no LM
-                                                             // previous token
-                                                             // score is ignored
+
+        expanded.push_back(std::move(e));
+      }  // for (auto k : topk)
+      p_logprob += (end - start) * vocab_size;
+    }  // for (int32_t b = 0; b != batch_size; ++b)
+
+    if (lm_ && shallow_fusion_) {
+      std::vector<Hypothesis *> lm_hyps;
+      for (auto &e : expanded) {
+        if (!e.is_blank) {
+          lm_hyps.push_back(&e.hyp);
         }
+      }
 
-        // export the per-token log scores
-        if (new_token != 0 && new_token != unk_id_) {
-          float y_prob = logit_with_temperature[start * vocab_size + k];
-          new_hyp.ys_probs.push_back(y_prob);
+      if (!lm_hyps.empty()) {
+        lm_->ComputeLMScoreSF(lm_scale_, lm_hyps);
+      }
+    }
 
-          if (lm_ && shallow_fusion_) {  // export only if
-                                         // LM shallow fusion is used
-            float lm_prob = new_hyp.lm_log_prob - prev_lm_log_prob;
+    cur.resize(batch_size);
+    for (auto &e : expanded) {
+      Hypothesis &new_hyp = e.hyp;
+      if (lm_ && shallow_fusion_) {
+         new_hyp.log_prob = e.log_prob + e.context_score -
+                         e.prev_lm_log_prob;  // log_prob only includes the
+                                              // score of the transducer
+      } else {
+         new_hyp.log_prob = e.log_prob + e.context_score;  // rescore or no LM
+                                                           // previous token
+                                                           // score is ignored
+      }
 
-            if (lm_scale_ != 0.0) {
-              lm_prob /= lm_scale_;  // remove lm-scale
-            }
-            new_hyp.lm_probs.push_back(lm_prob);
-          }
+      // export the per-token log scores
+      if (!e.is_blank) {
+        new_hyp.ys_probs.push_back(e.y_prob);
 
-          // export only when `ContextGraph` is used
-          if (ss != nullptr && ss[b]->GetContextGraph() != nullptr) {
-            new_hyp.context_scores.push_back(context_score);
+        if (lm_ && shallow_fusion_) {  // export only if
+                                       // LM shallow fusion is used
+          float lm_prob = new_hyp.lm_log_prob - e.prev_lm_log_prob;
+
+          if (lm_scale_ != 0.0) {
+            lm_prob /= lm_scale_;  // remove lm-scale
           }
+          new_hyp.lm_probs.push_back(lm_prob);
         }
 
-        hyps.Add(std::move(new_hyp));
-      }  // for (auto k : topk)
-      cur.push_back(std::move(hyps));
-      p_logprob += (end - start) * vocab_size;
-    }  // for (int32_t b = 0; b != batch_size; ++b)
+        // export only when `ContextGraph` is used
+        if (ss != nullptr && ss[e.stream]->GetContextGraph() != nullptr) {
+          new_hyp.context_scores.push_back(e.context_score);
+        }
+      }
+
+      cur[e.stream].Add(std::move(new_hyp));
+    }
   }    // for (int32_t t = 0; t != num_frames; ++t)
 
   // classic lm rescore
@@ -4,6 +4,10 @@
 
 #include "sherpa-onnx/csrc/online-websocket-server-impl.h"
 
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "sherpa-onnx/csrc/file-utils.h"
@@ -15,11 +19,21 @@ void OnlineWebsocketDecoderConfig::Register(ParseOptions *po) {
   recognizer_config.Register(po);
 
   po->Register("loop-interval-ms", &loop_interval_ms,
-               "It determines how often the decoder loop runs. ");
+               "Deprecated and ignored. Streams are scheduled as soon as "
+               "they become ready. Please use --max-wait-ms instead.");
 
   po->Register("max-batch-size", &max_batch_size,
                "Max batch size for recognition.");
 
+  po->Register("max-wait-ms", &max_wait_ms,
+               "The longest time in milliseconds a ready stream waits for "
+               "other streams to fill a batch. A smaller value reduces "
+               "latency and a larger value gives larger batches.");
+
+  po->Register("metrics-interval-s", &metrics_interval_s,
+               "How often in seconds to log the queue delay and batch fill "
+               "of the scheduler. 0 to disable it.");
+
   po->Register("end-tail-padding", &end_tail_padding,
                "It determines the length of tail_padding at the end of audio.");
 }
@@ -28,9 +42,24 @@ void OnlineWebsocketDecoderConfig::Validate() const {
   recognizer_config.Validate();
   SHERPA_ONNX_CHECK_GT(loop_interval_ms, 0);
   SHERPA_ONNX_CHECK_GT(max_batch_size, 0);
+  SHERPA_ONNX_CHECK_GE(max_wait_ms, 0);
+  SHERPA_ONNX_CHECK_GE(metrics_interval_s, 0);
   SHERPA_ONNX_CHECK_GT(end_tail_padding, 0);
 }
 
+std::string OnlineWebsocketDecoderMetrics::ToString() const {
+  std::ostringstream os;
+  os << "OnlineWebsocketDecoderMetrics(";
+  os << "num_batches=" << num_batches << ", ";
+  os << "num_streams=" << num_streams << ", ";
+  os << "avg_queue_delay_ms="
+     << (num_streams ? total_queue_delay_ms / num_streams : 0) << ", ";
+  os << "max_queue_delay_ms=" << max_queue_delay_ms << ", ";
+  os << "avg_batch_fill="
+     << (num_batches ? total_batch_fill / num_batches : 0) << ")";
+  return os.str();
+}
+
 void OnlineWebsocketServerConfig::Register(sherpa_onnx::ParseOptions *po) {
   decoder_config.Register(po);
 
@@ -46,7 +75,8 @@ void OnlineWebsocketServerConfig::Validate() const {
 OnlineWebsocketDecoder::OnlineWebsocketDecoder(OnlineWebsocketServer *server)
     : server_(server),
       config_(server->GetConfig().decoder_config),
-      timer_(server->GetWorkContext()) {
+      timer_(server->GetWorkContext()),
+      metrics_timer_(server->GetWorkContext()) {
   recognizer_ = std::make_unique<OnlineRecognizer>(config_.recognizer_config);
 }
 
@@ -66,33 +96,54 @@ std::shared_ptr<Connection> OnlineWebsocketDecoder::GetOrCreateConnection(
 }
 
 void OnlineWebsocketDecoder::AcceptWaveform(std::shared_ptr<Connection> c) {
-  std::lock_guard<std::mutex> lock(c->mutex);
-  float sample_rate = config_.recognizer_config.feat_config.sampling_rate;
-  while (!c->samples.empty()) {
-    const auto &s = c->samples.front();
-    c->s->AcceptWaveform(sample_rate, s.data(), s.size());
-    c->samples.pop_front();
+  {
+    std::lock_guard<std::mutex> lock(c->mutex);
+    float sample_rate = config_.recognizer_config.feat_config.sampling_rate;
+    while (!c->samples.empty()) {
+      const auto &s = c->samples.front();
+      c->s->AcceptWaveform(sample_rate, s.data(), s.size());
+      c->samples.pop_front();
+    }
   }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  EnqueueLocked(c);
+  ScheduleLocked();
 }
 
 void OnlineWebsocketDecoder::InputFinished(std::shared_ptr<Connection> c) {
-  std::lock_guard<std::mutex> lock(c->mutex);
+  {
+    std::lock_guard<std::mutex> lock(c->mutex);
 
-  float sample_rate = config_.recognizer_config.feat_config.sampling_rate;
+    float sample_rate = config_.recognizer_config.feat_config.sampling_rate;
 
-  while (!c->samples.empty()) {
-    const auto &s = c->samples.front();
-    c->s->AcceptWaveform(sample_rate, s.data(), s.size());
-    c->samples.pop_front();
-  }
+    while (!c->samples.empty()) {
+      const auto &s = c->samples.front();
+      c->s->AcceptWaveform(sample_rate, s.data(), s.size());
+      c->samples.pop_front();
+    }
 
-  std::vector<float> tail_padding(
-      static_cast<int64_t>(config_.end_tail_padding * sample_rate));
+    std::vector<float> tail_padding(
+        static_cast<int64_t>(config_.end_tail_padding * sample_rate));
 
-  c->s->AcceptWaveform(sample_rate, tail_padding.data(), tail_padding.size());
+    c->s->AcceptWaveform(sample_rate, tail_padding.data(),
+                         tail_padding.size());
+
+    c->s->InputFinished();
+  }
 
-  c->s->InputFinished();
+  std::lock_guard<std::mutex> lock(mutex_);
   c->eof = true;
+  EnqueueLocked(c);
+  ScheduleLocked();
+}
+
+void OnlineWebsocketDecoder::RemoveConnection(connection_hdl hdl) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // If the connection is in the ready queue, it is dropped when its batch
+  // is formed. If it is being decoded, it is dropped after decoding.
+  connections_.erase(hdl);
+  ScheduleLocked();
 }
 
 void OnlineWebsocketDecoder::Warmup() const {
@@ -101,105 +152,149 @@ void OnlineWebsocketDecoder::Warmup() const {
 }
 
 void OnlineWebsocketDecoder::Run() {
-  timer_.expires_after(std::chrono::milliseconds(config_.loop_interval_ms));
+  if (config_.metrics_interval_s > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    metrics_timer_.expires_after(
+        std::chrono::seconds(config_.metrics_interval_s));
+    metrics_timer_.async_wait(
+        [this](const asio::error_code &ec) { LogMetrics(ec); });
+  }
+}
 
-  timer_.async_wait(
-      [this](const asio::error_code &ec) { ProcessConnections(ec); });
+OnlineWebsocketDecoderMetrics OnlineWebsocketDecoder::GetMetrics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return metrics_;
 }
 
-void OnlineWebsocketDecoder::ProcessConnections(const asio::error_code &ec) {
-  if (ec) {
-    SHERPA_ONNX_LOG(FATAL) << "The decoder loop is aborted!";
+void OnlineWebsocketDecoder::EnqueueLocked(std::shared_ptr<Connection> c) {
+  if (c->busy) {
+    // It is either in the ready queue or being decoded. In the latter case,
+    // Decode() calls us again when it is done.
+    return;
   }
 
-  std::lock_guard<std::mutex> lock(mutex_);
-  std::vector<connection_hdl> to_remove;
-  for (auto &p : connections_) {
-    auto hdl = p.first;
-    auto c = p.second;
-
-    // The order of `if` below matters!
-    if (!server_->Contains(hdl)) {
-      // If the connection is disconnected, we stop processing it
-      to_remove.push_back(hdl);
-      continue;
-    }
+  auto it = connections_.find(c->hdl);
+  if (it == connections_.end() || it->second != c) {
+    // The client has disconnected
+    return;
+  }
 
-    if (active_.count(hdl)) {
-      // Another thread is decoding this stream, so skip it
-      continue;
-    }
+  if (recognizer_->IsReady(c->s.get())) {
+    c->busy = true;
+    c->ready_time = std::chrono::steady_clock::now();
+    ready_connections_.push_back(c);
+    return;
+  }
 
-    if (!recognizer_->IsReady(c->s.get()) && !c->eof) {
-      // this stream has not enough frames to decode, so skip it
-      continue;
+  if (c->eof) {
+    // We won't receive samples from the client, so send a Done! to client
+    asio::post(server_->GetConnectionContext(),
+               [this, hdl = c->hdl]() { server_->Send(hdl, "Done!"); });
+
+    connections_.erase(it);
+  }
+}
+
+void OnlineWebsocketDecoder::ScheduleLocked() {
+  auto now = std::chrono::steady_clock::now();
+  auto max_wait = std::chrono::milliseconds(config_.max_wait_ms);
+
+  while (!ready_connections_.empty()) {
+    // Waiting is pointless if every connection that could join the batch
+    // is already in the ready queue, so the target batch size shrinks
+    // with the load
+    int32_t num_idle =
+        static_cast<int32_t>(connections_.size()) - num_decoding_;
+    int32_t target = std::max(1, std::min(config_.max_batch_size, num_idle));
+
+    auto deadline = ready_connections_.front()->ready_time + max_wait;
+
+    if (static_cast<int32_t>(ready_connections_.size()) < target &&
+        now < deadline) {
+      if (!timer_armed_ || deadline < timer_deadline_) {
+        // It cancels the pending wait, if any
+        timer_.expires_at(deadline);
+        timer_.async_wait([this](const asio::error_code &ec) { OnTimer(ec); });
+        timer_armed_ = true;
+        timer_deadline_ = deadline;
+      }
+      return;
     }
 
-    if (!recognizer_->IsReady(c->s.get()) && c->eof) {
-      // We won't receive samples from the client, so send a Done! to client
+    // The oldest connections have the earliest deadlines
+    std::vector<std::shared_ptr<Connection>> c_vec;
+    while (!ready_connections_.empty() &&
+           static_cast<int32_t>(c_vec.size()) < config_.max_batch_size) {
+      auto c = ready_connections_.front();
+      ready_connections_.pop_front();
+
+      if (!connections_.count(c->hdl)) {
+        // The client has disconnected while waiting in the queue
+        c->busy = false;
+        continue;
+      }
 
-      asio::post(server_->GetWorkContext(),
-                 [this, hdl = c->hdl]() { server_->Send(hdl, "Done!"); });
+      c_vec.push_back(c);
+    }
 
-      to_remove.push_back(hdl);
+    if (c_vec.empty()) {
       continue;
     }
 
-    // TODO(fangun): If the connection is timed out, we need to also
-    // add it to `to_remove`
-
-    // this stream has enough frames and is currently not processed by any
-    // threads, so put it into the ready queue
-    ready_connections_.push_back(c);
+    for (const auto &c : c_vec) {
+      double delay_ms =
+          std::chrono::duration<double, std::milli>(now - c->ready_time)
+              .count();
+      metrics_.total_queue_delay_ms += delay_ms;
+      metrics_.max_queue_delay_ms =
+          std::max(metrics_.max_queue_delay_ms, delay_ms);
+    }
+    metrics_.num_batches += 1;
+    metrics_.num_streams += c_vec.size();
+    metrics_.total_batch_fill +=
+        static_cast<double>(c_vec.size()) / config_.max_batch_size;
 
-    // In `Decode()`, it will remove hdl from `active_`
-    active_.insert(c->hdl);
-  }
+    num_decoding_ += static_cast<int32_t>(c_vec.size());
 
-  for (auto hdl : to_remove) {
-    connections_.erase(hdl);
+    asio::post(server_->GetWorkContext(),
+               [this, c_vec = std::move(c_vec)]() { Decode(c_vec); });
   }
+}
 
-  if (!ready_connections_.empty()) {
-    asio::post(server_->GetWorkContext(), [this]() { Decode(); });
+void OnlineWebsocketDecoder::OnTimer(const asio::error_code &ec) {
+  if (ec == asio::error::operation_aborted) {
+    // The timer was re-armed for an earlier deadline
+    return;
   }
 
-  // Schedule another call
-  timer_.expires_after(std::chrono::milliseconds(config_.loop_interval_ms));
-
-  timer_.async_wait(
-      [this](const asio::error_code &ec) { ProcessConnections(ec); });
+  std::lock_guard<std::mutex> lock(mutex_);
+  timer_armed_ = false;
+  ScheduleLocked();
 }
 
-void OnlineWebsocketDecoder::Decode() {
-  std::unique_lock<std::mutex> lock(mutex_);
-  if (ready_connections_.empty()) {
-    // There are no connections that are ready for decoding,
-    // so we return directly
+void OnlineWebsocketDecoder::LogMetrics(const asio::error_code &ec) {
+  if (ec) {
     return;
   }
 
-  std::vector<std::shared_ptr<Connection>> c_vec;
-  std::vector<OnlineStream *> s_vec;
-  while (!ready_connections_.empty() &&
-         static_cast<int32_t>(s_vec.size()) < config_.max_batch_size) {
-    auto c = ready_connections_.front();
-    ready_connections_.pop_front();
+  std::lock_guard<std::mutex> lock(mutex_);
+  SHERPA_ONNX_LOG(INFO) << metrics_.ToString() << "\n";
 
-    c_vec.push_back(c);
-    s_vec.push_back(c->s.get());
-  }
+  metrics_timer_.expires_after(
+      std::chrono::seconds(config_.metrics_interval_s));
+  metrics_timer_.async_wait(
+      [this](const asio::error_code &ec) { LogMetrics(ec); });
+}
 
-  if (!ready_connections_.empty()) {
-    // there are too many ready connections but this thread can only handle
-    // max_batch_size connections at a time, so we schedule another call
-    // to Decode() and let other threads to process the ready connections
-    asio::post(server_->GetWorkContext(), [this]() { Decode(); });
+void OnlineWebsocketDecoder::Decode(
+    std::vector<std::shared_ptr<Connection>> c_vec) {
+  std::vector<OnlineStream *> s_vec;
+  s_vec.reserve(c_vec.size());
+  for (const auto &c : c_vec) {
+    s_vec.push_back(c->s.get());
   }
 
-  lock.unlock();
   recognizer_->DecodeStreams(s_vec.data(), s_vec.size());
-  lock.lock();
 
   for (auto c : c_vec) {
     auto result = recognizer_->GetResult(c->s.get());
@@ -216,8 +311,16 @@ void OnlineWebsocketDecoder::Decode() {
                [this, hdl = c->hdl, str = result.AsJsonString()]() {
                  server_->Send(hdl, str);
                });
-    active_.erase(c->hdl);
   }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  num_decoding_ -= static_cast<int32_t>(c_vec.size());
+  for (auto &c : c_vec) {
+    // More frames may have arrived while we were decoding
+    c->busy = false;
+    EnqueueLocked(c);
+  }
+  ScheduleLocked();
 }
 
 OnlineWebsocketServer::OnlineWebsocketServer(
@@ -307,6 +410,8 @@ void OnlineWebsocketServer::OnClose(connection_hdl hdl) {
 
   SHERPA_ONNX_LOG(INFO) << "Number of active connections: "
                         << connections_.size() << "\n";
+
+  decoder_.RemoveConnection(hdl);
 }
 
 bool OnlineWebsocketServer::Contains(connection_hdl hdl) const {
@@ -5,6 +5,7 @@
 #ifndef SHERPA_ONNX_CSRC_ONLINE_WEBSOCKET_SERVER_IMPL_H_
 #define SHERPA_ONNX_CSRC_ONLINE_WEBSOCKET_SERVER_IMPL_H_
 
+#include <chrono>  // NOLINT
 #include <deque>
 #include <fstream>
 #include <map>
@@ -41,6 +42,15 @@ struct Connection {
   // for a specified time.
   std::chrono::steady_clock::time_point last_active;
 
+  // The fields below are protected by the mutex of OnlineWebsocketDecoder.
+  //
+  // It is true while the connection is in the ready queue or while it is
+  // being decoded, so that only one thread can decode a stream at a time.
+  bool busy = false;
+
+  // The time the connection was put into the ready queue
+  std::chrono::steady_clock::time_point ready_time;
+
   std::mutex mutex;  // protect samples
 
   // Audio samples received from the client.
@@ -57,17 +67,40 @@ struct Connection {
 struct OnlineWebsocketDecoderConfig {
   OnlineRecognizerConfig recognizer_config;
 
-  // It determines how often the decoder loop runs.
+  // Deprecated and ignored. Streams are scheduled as soon as they become
+  // ready. See max_wait_ms.
   int32_t loop_interval_ms = 10;
 
   int32_t max_batch_size = 5;
 
+  // The longest time a ready stream waits for other streams to fill a batch.
+  // A batch is started earlier if it is full or if every connection that is
+  // not being decoded is already waiting in it.
+  int32_t max_wait_ms = 5;
+
+  // How often to log the scheduler metrics. 0 disables logging.
+  int32_t metrics_interval_s = 60;
+
   float end_tail_padding = 0.8;
 
   void Register(ParseOptions *po);
   void Validate() const;
 };
 
+struct OnlineWebsocketDecoderMetrics {
+  int64_t num_batches = 0;
+  int64_t num_streams = 0;
+
+  // Time from a stream becoming ready until its batch starts decoding
+  double total_queue_delay_ms = 0;
+  double max_queue_delay_ms = 0;
+
+  // Sum over batches of batch_size / max_batch_size
+  double total_batch_fill = 0;
+
+  std::string ToString() const;
+};
+
 class OnlineWebsocketServer;
 
 class OnlineWebsocketDecoder {
@@ -85,37 +118,61 @@ class OnlineWebsocketDecoder {
   // signal that there will be no more audio samples for a stream
   void InputFinished(std::shared_ptr<Connection> c);
 
+  // It is called when the client of a connection is disconnected
+  void RemoveConnection(connection_hdl hdl);
+
   void Warmup() const;
 
   void Run();
 
+  OnlineWebsocketDecoderMetrics GetMetrics() const;
+
  private:
-  void ProcessConnections(const asio::error_code &ec);
+  // Put the connection into the ready queue if its stream has enough
+  // frames for decoding. The caller must hold mutex_.
+  void EnqueueLocked(std::shared_ptr<Connection> c);
+
+  // Start decoding batches from the ready queue, or arm the timer for the
+  // deadline of the oldest ready connection. The caller must hold mutex_.
+  void ScheduleLocked();
+
+  void OnTimer(const asio::error_code &ec);
+
+  void LogMetrics(const asio::error_code &ec);
 
   /** It is called by one of the worker thread.
    */
-  void Decode();
+  void Decode(std::vector<std::shared_ptr<Connection>> c_vec);
 
  private:
   OnlineWebsocketServer *server_;  // not owned
   std::unique_ptr<OnlineRecognizer> recognizer_;
   OnlineWebsocketDecoderConfig config_;
+
+  // It expires at the deadline of the oldest ready connection
   asio::steady_timer timer_;
+  bool timer_armed_ = false;
+  std::chrono::steady_clock::time_point timer_deadline_;
+
+  asio::steady_timer metrics_timer_;
 
-  // It protects `connections_`, `ready_connections_`, and `active_`
-  std::mutex mutex_;
+  // It protects all of the fields below, the timers, and the scheduling
+  // fields of each Connection
+  mutable std::mutex mutex_;
 
   std::map<connection_hdl, std::shared_ptr<Connection>,
            std::owner_less<connection_hdl>>
       connections_;
 
   // Whenever a connection has enough feature frames for decoding, we put
-  // it in this queue
+  // it in this queue. It is sorted by ready_time, which is also the order
+  // of the deadlines.
   std::deque<std::shared_ptr<Connection>> ready_connections_;
 
-  // If we are decoding a stream, we put it in the active_ set so that
-  // only one thread can decode a stream at a time.
-  std::set<connection_hdl, std::owner_less<connection_hdl>> active_;
+  // Number of connections in batches that are being decoded
+  int32_t num_decoding_ = 0;
+
+  OnlineWebsocketDecoderMetrics metrics_;
 };
 
 struct OnlineWebsocketServerConfig {
@@ -12,6 +12,7 @@
 #include <thread>  // NOLINT
 #include <vector>
 
+#include "sherpa-onnx/csrc/length-batcher.h"
 #include "sherpa-onnx/csrc/offline-recognizer.h"
 #include "sherpa-onnx/csrc/parse-options.h"
 #include "sherpa-onnx/csrc/wave-reader.h"
@@ -19,20 +20,38 @@
 std::atomic<int> wav_index(0);
 std::mutex mtx;
 
+sherpa_onnx::PaddingStats padding_stats;  // protected by mtx
+
+// Estimate the number of 10 ms frames of a wave file from its size,
+// assuming 16-bit samples at 16 kHz. It is used only to group files of
+// similar lengths, so the header and the actual format don't matter much.
+int32_t EstimateNumFrames(const std::string &wav_filename) {
+  std::ifstream in(wav_filename, std::ios::binary | std::ios::ate);
+  if (!in.is_open()) {
+    return 0;
+  }
+  return static_cast<int64_t>(in.tellg()) / sizeof(int16_t) / 160;
+}
+
 std::vector<std::vector<std::string>> SplitToBatches(
-    const std::vector<std::string> &input, int32_t batch_size) {
-  std::vector<std::vector<std::string>> outputs;
-  auto itr = input.cbegin();
-  int32_t process_num = 0;
-
-  while (process_num + batch_size <= static_cast<int32_t>(input.size())) {
-    auto chunk_end = itr + batch_size;
-    outputs.emplace_back(itr, chunk_end);
-    itr = chunk_end;
-    process_num += batch_size;
+    const std::vector<std::string> &input, int32_t batch_size,
+    int32_t max_batch_frames) {
+  std::vector<int32_t> lengths;
+  lengths.reserve(input.size());
+  for (const auto &wav_filename : input) {
+    lengths.push_back(EstimateNumFrames(wav_filename));
   }
-  if (itr != input.cend()) {
-    outputs.emplace_back(itr, input.cend());
+
+  sherpa_onnx::LengthBatcher batcher(batch_size, max_batch_frames);
+
+  std::vector<std::vector<std::string>> outputs;
+  for (const auto &indexes : batcher.Split(lengths)) {
+    std::vector<std::string> batch;
+    batch.reserve(indexes.size());
+    for (int32_t i : indexes) {
+      batch.push_back(input[i]);
+    }
+    outputs.push_back(std::move(batch));
   }
   return outputs;
 }
@@ -61,6 +80,10 @@ void AsrInference(const std::vector<std::vector<std::string>> &chunk_wav_paths,
   std::vector<sherpa_onnx::OfflineStream *> ss_pointers;
   float duration = 0.0f;
   float elapsed_seconds_batch = 0.0f;
+  sherpa_onnx::PaddingStats stats;
+
+  // Number of samples of each utterance in the current batch
+  std::vector<int32_t> batch_lengths;
 
   // warm up
   for (const auto &wav_filename : chunk_wav_paths[0]) {
@@ -90,6 +113,7 @@ void AsrInference(const std::vector<std::vector<std::string>> &chunk_wav_paths,
     }
     const auto &wav_paths = chunk_wav_paths[chunk];
     const auto begin = std::chrono::steady_clock::now();
+    batch_lengths.clear();
     for (const auto &wav_filename : wav_paths) {
       int32_t sampling_rate = -1;
       bool is_ok = false;
@@ -100,6 +124,7 @@ void AsrInference(const std::vector<std::vector<std::string>> &chunk_wav_paths,
         continue;
       }
       duration += samples.size() / static_cast<float>(sampling_rate);
+      batch_lengths.push_back(samples.size());
       auto s = recognizer->CreateStream();
       s->AcceptWaveform(sampling_rate, samples.data(), samples.size());
 
@@ -107,6 +132,7 @@ void AsrInference(const std::vector<std::vector<std::string>> &chunk_wav_paths,
       ss_pointers.push_back(ss.back().get());
     }
     recognizer->DecodeStreams(ss_pointers.data(), ss_pointers.size());
+    stats.Add(batch_lengths);
     const auto end = std::chrono::steady_clock::now();
     float elapsed_seconds =
         std::chrono::duration_cast<std::chrono::milliseconds>(end - begin)
@@ -126,6 +152,8 @@ void AsrInference(const std::vector<std::vector<std::string>> &chunk_wav_paths,
   {
     std::lock_guard<std::mutex> guard(mtx);
     *total_length += duration;
+    padding_stats.num_frames += stats.num_frames;
+    padding_stats.num_padded_frames += stats.num_padded_frames;
     if (*total_time < elapsed_seconds_batch) {
       *total_time = elapsed_seconds_batch;
     }
@@ -224,6 +252,7 @@ for a list of pre-trained models to download.
   std::string wav_scp = "";  // file path, kaldi style wav list.
   int32_t nj = 1;            // thread number
   int32_t batch_size = 1;    // number of wav files processed at once.
+  int32_t max_batch_frames = 0;  // 0 means no limit
   sherpa_onnx::ParseOptions po(kUsageMessage);
   sherpa_onnx::OfflineRecognizerConfig config;
   config.Register(&po);
@@ -236,6 +265,11 @@ for a list of pre-trained models to download.
   po.Register("batch-size", &batch_size,
               "number of wav files processed at once during the decoding"
               "process. default=1");
+  po.Register("max-batch-frames", &max_batch_frames,
+              "Max number of padded 10 ms frames in a batch, i.e., the "
+              "number of files in a batch times the frames of the longest "
+              "one. Files are sorted by size so that files of similar "
+              "lengths are decoded together. 0 means no limit. default=0");
 
   po.Read(argc, argv);
   if (po.NumArgs() < 1 && wav_scp.empty()) {
@@ -278,7 +312,7 @@ for a list of pre-trained models to download.
   }
   std::vector<std::thread> threads;
   std::vector<std::vector<std::string>> batch_wav_paths =
-      SplitToBatches(wav_paths, batch_size);
+      SplitToBatches(wav_paths, batch_size, max_batch_frames);
   float total_length = 0.0f;
   float total_time = 0.0f;
   for (int i = 0; i < nj; i++) {
@@ -295,6 +329,7 @@ for a list of pre-trained models to download.
   if (config.decoding_method == "modified_beam_search") {
     fprintf(stderr, "max active paths: %d\n", config.max_active_paths);
   }
+  fprintf(stderr, "Padding efficiency: %.4f\n", padding_stats.Efficiency());
   fprintf(stderr, "Elapsed seconds: %.3f s\n", total_time);
   float rtf = total_time / total_length;
   fprintf(stderr, "Real time factor (RTF): %.6f / %.6f = %.4f\n", total_time,
@@ -4,6 +4,7 @@
 
 #include "sherpa-onnx/csrc/silero-vad-model.h"
 
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
@@ -90,6 +91,34 @@ class SileroVadModel::Impl {
 
     float prob = Run(samples, n);
 
+    return IsSpeech(prob);
+  }
+
+  void IsSpeechBatch(Impl **impls, const float **samples, int32_t batch_size,
+                     int32_t n, bool *is_speech) {
+    if (n != WindowSize()) {
+      SHERPA_ONNX_LOGE("n: %d != window_size: %d", n, WindowSize());
+      exit(-1);
+    }
+
+    for (int32_t i = 0; i != batch_size; ++i) {
+      if (impls[i]->is_v5_ != is_v5_ ||
+          impls[i]->WindowSize() != WindowSize()) {
+        SHERPA_ONNX_LOGE(
+            "All models in a batch must be created from the same config");
+        exit(-1);
+      }
+    }
+
+    std::vector<float> probs = RunBatch(impls, samples, batch_size, n);
+
+    for (int32_t i = 0; i != batch_size; ++i) {
+      is_speech[i] = impls[i]->IsSpeech(probs[i]);
+    }
+  }
+
+  // Update the speech state with the probability of the next window
+  bool IsSpeech(float prob) {
     float threshold = config_.silero_vad.threshold;
 
     current_sample_ += config_.silero_vad.window_size;
@@ -352,6 +381,101 @@ class SileroVadModel::Impl {
     }
   }
 
+  // Run the session once for one window of each model in `impls`.
+  // The states of each model are read from and written back to it.
+  //
+  // @return Return the speech probability of each window.
+  std::vector<float> RunBatch(Impl **impls, const float **samples,
+                              int32_t batch_size, int32_t n) {
+    auto memory_info =
+        Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
+
+    std::vector<float> x_buf(batch_size * n);
+    for (int32_t i = 0; i != batch_size; ++i) {
+      std::copy(samples[i], samples[i] + n, x_buf.data() + i * n);
+    }
+
+    std::array<int64_t, 2> x_shape = {batch_size, n};
+    Ort::Value x =
+        Ort::Value::CreateTensor(memory_info, x_buf.data(), x_buf.size(),
+                                 x_shape.data(), x_shape.size());
+
+    int64_t sr_shape = 1;
+    Ort::Value sr =
+        Ort::Value::CreateTensor(memory_info, &sample_rate_, 1, &sr_shape, 1);
+
+    // v4 has h and c. v5 has a single state.
+    int32_t num_states = static_cast<int32_t>(states_.size());
+
+    std::vector<Ort::Value> inputs;
+    inputs.reserve(2 + num_states);
+    inputs.push_back(std::move(x));
+    if (!is_v5_) {
+      inputs.push_back(std::move(sr));
+    }
+
+    for (int32_t k = 0; k != num_states; ++k) {
+      inputs.push_back(StackStates(impls, batch_size, k));
+    }
+
+    if (is_v5_) {
+      inputs.push_back(std::move(sr));
+    }
+
+    auto out =
+        sess_->Run({}, input_names_ptr_.data(), inputs.data(), inputs.size(),
+                   output_names_ptr_.data(), output_names_ptr_.size());
+
+    for (int32_t k = 0; k != num_states; ++k) {
+      UnstackStates(out[k + 1], impls, batch_size, k);
+    }
+
+    const float *p = out[0].GetTensorData<float>();
+    return std::vector<float>(p, p + batch_size);
+  }
+
+  // Stack the k-th state of each model. Each state has shape
+  // (num_layers, 1, hidden_dim) and the result has shape
+  // (num_layers, batch_size, hidden_dim).
+  Ort::Value StackStates(Impl **impls, int32_t batch_size, int32_t k) {
+    std::vector<int64_t> shape =
+        states_[k].GetTensorTypeAndShapeInfo().GetShape();
+    int64_t num_layers = shape[0];
+    int64_t hidden_dim = shape[2];
+    shape[1] = batch_size;
+
+    Ort::Value ans =
+        Ort::Value::CreateTensor<float>(allocator_, shape.data(), shape.size());
+    float *dst = ans.GetTensorMutableData<float>();
+
+    for (int32_t i = 0; i != batch_size; ++i) {
+      const float *src = impls[i]->states_[k].GetTensorData<float>();
+      for (int64_t layer = 0; layer != num_layers; ++layer) {
+        std::copy(src + layer * hidden_dim, src + (layer + 1) * hidden_dim,
+                  dst + (layer * batch_size + i) * hidden_dim);
+      }
+    }
+
+    return ans;
+  }
+
+  // The inverse of StackStates()
+  static void UnstackStates(const Ort::Value &v, Impl **impls,
+                            int32_t batch_size, int32_t k) {
+    std::vector<int64_t> shape = v.GetTensorTypeAndShapeInfo().GetShape();
+    int64_t num_layers = shape[0];
+    int64_t hidden_dim = shape[2];
+
+    const float *src = v.GetTensorData<float>();
+    for (int32_t i = 0; i != batch_size; ++i) {
+      float *dst = impls[i]->states_[k].GetTensorMutableData<float>();
+      for (int64_t layer = 0; layer != num_layers; ++layer) {
+        const float *p = src + (layer * batch_size + i) * hidden_dim;
+        std::copy(p, p + hidden_dim, dst + layer * hidden_dim);
+      }
+    }
+  }
+
   float RunV5(const float *samples, int32_t n) {
     auto memory_info =
         Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
@@ -453,6 +577,22 @@ bool SileroVadModel::IsSpeech(const float *samples, int32_t n) {
   return impl_->IsSpeech(samples, n);
 }
 
+void SileroVadModel::IsSpeechBatch(VadModel **models, const float **samples,
+                                   int32_t batch_size, int32_t n,
+                                   bool *is_speech) {
+  std::vector<Impl *> impls(batch_size);
+  for (int32_t i = 0; i != batch_size; ++i) {
+    auto model = dynamic_cast<SileroVadModel *>(models[i]);
+    if (!model) {
+      VadModel::IsSpeechBatch(models, samples, batch_size, n, is_speech);
+      return;
+    }
+    impls[i] = model->impl_.get();
+  }
+
+  impl_->IsSpeechBatch(impls.data(), samples, batch_size, n, is_speech);
+}
+
 int32_t SileroVadModel::WindowSize() const { return impl_->WindowSize(); }
 
 int32_t SileroVadModel::WindowShift() const { return impl_->WindowShift(); }
@@ -31,6 +31,11 @@ class SileroVadModel : public VadModel {
    */
   bool IsSpeech(const float *samples, int32_t n) override;
 
+  // Run the session of this model once for all windows. Models that are
+  // not SileroVadModel are run one by one.
+  void IsSpeechBatch(VadModel **models, const float **samples,
+                     int32_t batch_size, int32_t n, bool *is_speech) override;
+
   // For silero vad V4, it is WindowShift().
   // For silero vad V5, it is WindowShift()+64 for 16kHz and
   //                          WindowShift()+32 for 8kHz
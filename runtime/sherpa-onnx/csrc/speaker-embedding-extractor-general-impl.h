@@ -30,12 +30,16 @@ class SpeakerEmbeddingExtractorGeneralImpl
   int32_t Dim() const override { return model_.GetMetaData().output_dim; }
 
   std::unique_ptr<OnlineStream> CreateStream() const override {
+    return std::make_unique<OnlineStream>(GetFeatureExtractorConfig());
+  }
+
+  FeatureExtractorConfig GetFeatureExtractorConfig() const override {
     FeatureExtractorConfig feat_config;
     const auto &meta_data = model_.GetMetaData();
     feat_config.sampling_rate = meta_data.sample_rate;
     feat_config.normalize_samples = meta_data.normalize_samples;
 
-    return std::make_unique<OnlineStream>(feat_config);
+    return feat_config;
   }
 
   bool IsReady(OnlineStream *s) const override {
@@ -62,23 +66,14 @@ class SpeakerEmbeddingExtractorGeneralImpl
 
     s->GetNumProcessedFrames() += num_frames;
 
+    return ComputeFromFeatures(std::move(features), num_frames);
+  }
+
+  std::vector<float> ComputeFromFeatures(std::vector<float> features,
+                                         int32_t num_frames) const override {
     int32_t feat_dim = features.size() / num_frames;
 
-    const auto &meta_data = model_.GetMetaData();
-    if (!meta_data.feature_normalize_type.empty()) {
-      if (meta_data.feature_normalize_type == "global-mean") {
-        SubtractGlobalMean(features.data(), num_frames, feat_dim);
-      } else {
-#if __OHOS__
-        SHERPA_ONNX_LOGE("Unsupported feature_normalize_type: %{public}s",
-                         meta_data.feature_normalize_type.c_str());
-#else
-        SHERPA_ONNX_LOGE("Unsupported feature_normalize_type: %s",
-                         meta_data.feature_normalize_type.c_str());
-#endif
-        exit(-1);
-      }
-    }
+    NormalizeFeatures(features.data(), num_frames, feat_dim);
 
     auto memory_info =
         Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
@@ -98,7 +93,62 @@ class SpeakerEmbeddingExtractorGeneralImpl
     return ans;
   }
 
+ protected:
+  void ComputeBucket(std::vector<std::vector<float>> features,
+                     const std::vector<int32_t> &num_frames,
+                     float *out) const override {
+    // All utterances have the same number of frames. See HasLengthInput()
+    int32_t batch_size = num_frames.size();
+    int32_t frames_per_utt = num_frames[0];
+    int32_t feat_dim = features[0].size() / num_frames[0];
+
+    std::vector<float> x_buf(batch_size * frames_per_utt * feat_dim);
+    for (int32_t i = 0; i != batch_size; ++i) {
+      NormalizeFeatures(features[i].data(), num_frames[i], feat_dim);
+
+      std::copy(features[i].begin(), features[i].end(),
+                x_buf.begin() + i * frames_per_utt * feat_dim);
+    }
+
+    auto memory_info =
+        Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
+
+    std::array<int64_t, 3> x_shape{batch_size, frames_per_utt, feat_dim};
+    Ort::Value x =
+        Ort::Value::CreateTensor(memory_info, x_buf.data(), x_buf.size(),
+                                 x_shape.data(), x_shape.size());
+    Ort::Value embedding = model_.Compute(std::move(x));
+
+    const float *p = embedding.GetTensorData<float>();
+    std::copy(p, p + batch_size * Dim(), out);
+  }
+
+  // The model has no input for the number of frames. Padded frames would
+  // be part of the pooled statistics.
+  bool HasLengthInput() const override { return false; }
+
  private:
+  void NormalizeFeatures(float *p, int32_t num_frames,
+                         int32_t feat_dim) const {
+    const auto &meta_data = model_.GetMetaData();
+    if (meta_data.feature_normalize_type.empty()) {
+      return;
+    }
+
+    if (meta_data.feature_normalize_type == "global-mean") {
+      SubtractGlobalMean(p, num_frames, feat_dim);
+    } else {
+#if __OHOS__
+      SHERPA_ONNX_LOGE("Unsupported feature_normalize_type: %{public}s",
+                       meta_data.feature_normalize_type.c_str());
+#else
+      SHERPA_ONNX_LOGE("Unsupported feature_normalize_type: %s",
+                       meta_data.feature_normalize_type.c_str());
+#endif
+      exit(-1);
+    }
+  }
+
   void SubtractGlobalMean(float *p, int32_t num_frames,
                           int32_t feat_dim) const {
     auto m = Eigen::Map<
@@ -3,6 +3,12 @@
 // Copyright (c)  2024  Xiaomi Corporation
 #include "sherpa-onnx/csrc/speaker-embedding-extractor-impl.h"
 
+#include <algorithm>
+#include <future>  // NOLINT
+#include <numeric>
+#include <utility>
+#include <vector>
+
 #if __ANDROID_API__ >= 9
 #include "android/asset_manager.h"
 #include "android/asset_manager_jni.h"
@@ -29,8 +35,143 @@ enum class ModelType : std::uint8_t {
   kUnknown,
 };
 
+// Max number of utterances in a model run of ComputeBatch()
+constexpr int32_t kMaxBatchSize = 32;
+
+// For models with an input for the number of frames, the longest utterance
+// in a model run of ComputeBatch() has at most this many times the frames
+// of the shortest one
+constexpr float kMaxLengthRatio = 1.1;
+
 }  // namespace
 
+// Return indexes into lengths of each bucket. In each bucket, the longest
+// utterance has at most max_length_ratio times the frames of the shortest
+// one.
+static std::vector<std::vector<int32_t>> SplitIntoBuckets(
+    const std::vector<int32_t> &lengths, float max_length_ratio) {
+  std::vector<int32_t> indexes(lengths.size());
+  std::iota(indexes.begin(), indexes.end(), 0);
+  std::stable_sort(indexes.begin(), indexes.end(),
+                   [&lengths](int32_t a, int32_t b) {
+                     return lengths[a] < lengths[b];
+                   });
+
+  std::vector<std::vector<int32_t>> ans;
+  for (auto i : indexes) {
+    if (ans.empty() ||
+        static_cast<int32_t>(ans.back().size()) == kMaxBatchSize ||
+        lengths[i] > lengths[ans.back()[0]] * max_length_ratio) {
+      ans.emplace_back();
+    }
+    ans.back().push_back(i);
+  }
+
+  return ans;
+}
+
+std::vector<float> SpeakerEmbeddingExtractorImpl::ComputeBatch(
+    OnlineStream **ss, int32_t n) const {
+  int32_t dim = Dim();
+  std::vector<float> ans(n * dim);
+
+  // Indexes into ss of streams that are ready
+  std::vector<int32_t> ready;
+  std::vector<std::vector<float>> features;
+  std::vector<int32_t> lengths;
+
+  for (int32_t i = 0; i != n; ++i) {
+    OnlineStream *s = ss[i];
+    int32_t num_frames = s->NumFramesReady() - s->GetNumProcessedFrames();
+    if (num_frames <= 0) {
+#if __OHOS__
+      SHERPA_ONNX_LOGE(
+          "Stream %{public}d is not ready. num_frames: %{public}d", i,
+          num_frames);
+#else
+      SHERPA_ONNX_LOGE("Stream %d is not ready. num_frames: %d", i,
+                       num_frames);
+#endif
+      continue;
+    }
+
+    features.push_back(s->GetFrames(s->GetNumProcessedFrames(), num_frames));
+    s->GetNumProcessedFrames() += num_frames;
+
+    ready.push_back(i);
+    lengths.push_back(num_frames);
+  }
+
+  std::vector<float> out =
+      ComputeBatchFromFeatures(std::move(features), lengths, nullptr);
+
+  for (int32_t j = 0; j != static_cast<int32_t>(ready.size()); ++j) {
+    std::copy(out.begin() + j * dim, out.begin() + (j + 1) * dim,
+              ans.begin() + ready[j] * dim);
+  }
+
+  return ans;
+}
+
+std::vector<float> SpeakerEmbeddingExtractorImpl::ComputeBatchFromFeatures(
+    std::vector<std::vector<float>> features,
+    const std::vector<int32_t> &num_frames, ThreadPool *pool) const {
+  int32_t dim = Dim();
+  std::vector<float> ans(num_frames.size() * dim);
+
+  // Without an input for the number of frames, padded frames would change
+  // the embeddings, so only utterances of the same length share a run
+  auto buckets =
+      SplitIntoBuckets(num_frames, HasLengthInput() ? kMaxLengthRatio : 1);
+
+  auto RunBucket = [&](int32_t b) {
+    const auto &bucket = buckets[b];
+
+    std::vector<std::vector<float>> bucket_features;
+    std::vector<int32_t> bucket_lengths;
+    bucket_features.reserve(bucket.size());
+    bucket_lengths.reserve(bucket.size());
+
+    for (auto k : bucket) {
+      bucket_features.push_back(std::move(features[k]));
+      bucket_lengths.push_back(num_frames[k]);
+    }
+
+    std::vector<float> out(bucket.size() * dim);
+    ComputeBucket(std::move(bucket_features), bucket_lengths, out.data());
+
+    for (int32_t j = 0; j != static_cast<int32_t>(bucket.size()); ++j) {
+      std::copy(out.begin() + j * dim, out.begin() + (j + 1) * dim,
+                ans.begin() + bucket[j] * dim);
+    }
+  };
+
+  int32_t num_buckets = buckets.size();
+  if (!pool || pool->Size() == 0 || num_buckets == 1) {
+    for (int32_t b = 0; b != num_buckets; ++b) {
+      RunBucket(b);
+    }
+    return ans;
+  }
+
+  // Buckets write to disjoint rows of ans
+  std::vector<std::future<void>> results;
+  results.reserve(num_buckets);
+  for (int32_t b = 0; b != num_buckets; ++b) {
+    results.push_back(pool->Submit([&RunBucket, b]() { RunBucket(b); }));
+  }
+
+  // Wait for all of them before rethrowing, since they refer to locals
+  for (auto &r : results) {
+    r.wait();
+  }
+  for (auto &r : results) {
+    r.get();
+  }
+
+  return ans;
+}
+
 static ModelType GetModelType(char *model_data, size_t model_data_length,
                               bool debug) {
   Ort::Env env(ORT_LOGGING_LEVEL_ERROR);
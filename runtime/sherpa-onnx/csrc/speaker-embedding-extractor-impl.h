@@ -31,6 +31,38 @@ class SpeakerEmbeddingExtractorImpl {
   virtual bool IsReady(OnlineStream *s) const = 0;
 
   virtual std::vector<float> Compute(OnlineStream *s) const = 0;
+
+  // See SpeakerEmbeddingExtractor::ComputeBatch()
+  std::vector<float> ComputeBatch(OnlineStream **ss, int32_t n) const;
+
+  // See SpeakerEmbeddingExtractor::ComputeBatchFromFeatures()
+  std::vector<float> ComputeBatchFromFeatures(
+      std::vector<std::vector<float>> features,
+      const std::vector<int32_t> &num_frames, ThreadPool *pool) const;
+
+  virtual FeatureExtractorConfig GetFeatureExtractorConfig() const = 0;
+
+  virtual std::vector<float> ComputeFromFeatures(std::vector<float> features,
+                                                 int32_t num_frames) const = 0;
+
+ protected:
+  /* Compute the embeddings of a group of utterances with one model run.
+   *
+   * @param features features[i] is a row-major matrix of shape
+   *                 (num_frames[i], feature_dim)
+   * @param num_frames Number of frames of each utterance. Their lengths
+   *                   are close to each other if HasLengthInput() is true
+   *                   and are equal otherwise.
+   * @param out On return, it contains a row-major matrix of shape
+   *            (num_frames.size(), Dim())
+   */
+  virtual void ComputeBucket(std::vector<std::vector<float>> features,
+                             const std::vector<int32_t> &num_frames,
+                             float *out) const = 0;
+
+  // Return true if the model takes the number of frames of each utterance
+  // as input, so padded frames do not change the embeddings
+  virtual bool HasLengthInput() const = 0;
 };
 
 }  // namespace sherpa_onnx
@@ -30,6 +30,10 @@ class SpeakerEmbeddingExtractorNeMoImpl : public SpeakerEmbeddingExtractorImpl {
   int32_t Dim() const override { return model_.GetMetaData().output_dim; }
 
   std::unique_ptr<OnlineStream> CreateStream() const override {
+    return std::make_unique<OnlineStream>(GetFeatureExtractorConfig());
+  }
+
+  FeatureExtractorConfig GetFeatureExtractorConfig() const override {
     FeatureExtractorConfig feat_config;
     const auto &meta_data = model_.GetMetaData();
     feat_config.sampling_rate = meta_data.sample_rate;
@@ -43,7 +47,7 @@ class SpeakerEmbeddingExtractorNeMoImpl : public SpeakerEmbeddingExtractorImpl {
     feat_config.remove_dc_offset = false;
     feat_config.window_type = meta_data.window_type;
 
-    return std::make_unique<OnlineStream>(feat_config);
+    return feat_config;
   }
 
   bool IsReady(OnlineStream *s) const override {
@@ -70,58 +74,92 @@ class SpeakerEmbeddingExtractorNeMoImpl : public SpeakerEmbeddingExtractorImpl {
 
     s->GetNumProcessedFrames() += num_frames;
 
-    int32_t feat_dim = features.size() / num_frames;
+    return ComputeFromFeatures(std::move(features), num_frames);
+  }
 
-    const auto &meta_data = model_.GetMetaData();
-    if (!meta_data.feature_normalize_type.empty()) {
-      if (meta_data.feature_normalize_type == "per_feature") {
-        NormalizePerFeature(features.data(), num_frames, feat_dim);
-      } else {
-#if __OHOS__
-        SHERPA_ONNX_LOGE("Unsupported feature_normalize_type: %{public}s",
-                         meta_data.feature_normalize_type.c_str());
-#else
+  std::vector<float> ComputeFromFeatures(std::vector<float> features,
+                                         int32_t num_frames) const override {
+    // The same model input as an utterance of ComputeBatch(), so a batch
+    // of utterances with the same number of frames gives the same result
+    std::vector<std::vector<float>> batch;
+    batch.push_back(std::move(features));
 
-        SHERPA_ONNX_LOGE("Unsupported feature_normalize_type: %s",
-                         meta_data.feature_normalize_type.c_str());
-#endif
-        exit(-1);
-      }
+    std::vector<float> ans(Dim());
+    ComputeBucket(std::move(batch), {num_frames}, ans.data());
+
+    return ans;
+  }
+
+ protected:
+  void ComputeBucket(std::vector<std::vector<float>> features,
+                     const std::vector<int32_t> &num_frames,
+                     float *out) const override {
+    int32_t batch_size = num_frames.size();
+    int32_t max_num_frames =
+        *std::max_element(num_frames.begin(), num_frames.end());
+    int32_t feat_dim = features[0].size() / num_frames[0];
+
+    if (max_num_frames % 16 != 0) {
+      max_num_frames += 16 - max_num_frames % 16;
     }
 
-    if (num_frames % 16 != 0) {
-      int32_t pad = 16 - num_frames % 16;
-      features.resize((num_frames + pad) * feat_dim);
+    // Padded frames are zeros and are excluded by x_lens
+    std::vector<float> x_buf(batch_size * max_num_frames * feat_dim);
+    std::vector<int64_t> x_lens(batch_size);
+    for (int32_t i = 0; i != batch_size; ++i) {
+      NormalizeFeatures(features[i].data(), num_frames[i], feat_dim);
+
+      std::copy(features[i].begin(), features[i].end(),
+                x_buf.begin() + i * max_num_frames * feat_dim);
+      x_lens[i] = num_frames[i];
     }
 
     auto memory_info =
         Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
 
-    std::array<int64_t, 3> x_shape{1, num_frames, feat_dim};
+    std::array<int64_t, 3> x_shape{batch_size, max_num_frames, feat_dim};
     Ort::Value x =
-        Ort::Value::CreateTensor(memory_info, features.data(), features.size(),
+        Ort::Value::CreateTensor(memory_info, x_buf.data(), x_buf.size(),
                                  x_shape.data(), x_shape.size());
 
     x = Transpose12(model_.Allocator(), &x);
 
-    int64_t x_lens = num_frames;
-    std::array<int64_t, 1> x_lens_shape{1};
-    Ort::Value x_lens_tensor = Ort::Value::CreateTensor(
-        memory_info, &x_lens, 1, x_lens_shape.data(), x_lens_shape.size());
+    std::array<int64_t, 1> x_lens_shape{batch_size};
+    Ort::Value x_lens_tensor =
+        Ort::Value::CreateTensor(memory_info, x_lens.data(), x_lens.size(),
+                                 x_lens_shape.data(), x_lens_shape.size());
 
     Ort::Value embedding =
         model_.Compute(std::move(x), std::move(x_lens_tensor));
-    std::vector<int64_t> embedding_shape =
-        embedding.GetTensorTypeAndShapeInfo().GetShape();
 
-    std::vector<float> ans(embedding_shape[1]);
-    std::copy(embedding.GetTensorData<float>(),
-              embedding.GetTensorData<float>() + ans.size(), ans.begin());
-
-    return ans;
+    const float *p = embedding.GetTensorData<float>();
+    std::copy(p, p + batch_size * Dim(), out);
   }
 
+  bool HasLengthInput() const override { return true; }
+
  private:
+  void NormalizeFeatures(float *p, int32_t num_frames,
+                         int32_t feat_dim) const {
+    const auto &meta_data = model_.GetMetaData();
+    if (meta_data.feature_normalize_type.empty()) {
+      return;
+    }
+
+    if (meta_data.feature_normalize_type == "per_feature") {
+      NormalizePerFeature(p, num_frames, feat_dim);
+    } else {
+#if __OHOS__
+      SHERPA_ONNX_LOGE("Unsupported feature_normalize_type: %{public}s",
+                       meta_data.feature_normalize_type.c_str());
+#else
+      SHERPA_ONNX_LOGE("Unsupported feature_normalize_type: %s",
+                       meta_data.feature_normalize_type.c_str());
+#endif
+      exit(-1);
+    }
+  }
+
   void NormalizePerFeature(float *p, int32_t num_frames,
                            int32_t feat_dim) const {
     auto m = Eigen::Map<
@@ -0,0 +1,81 @@
+// sherpa-onnx/csrc/speaker-embedding-extractor-test.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-onnx/csrc/speaker-embedding-extractor.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sherpa-onnx/csrc/file-utils.h"
+#include "sherpa-onnx/csrc/macros.h"
+
+namespace sherpa_onnx {
+
+// Please download it from
+// https://github.com/k2-fsa/sherpa-onnx/releases/tag/speaker-recongition-models
+const char *const kNeMoModel = "./nemo_en_titanet_small.onnx";
+
+static std::vector<float> RandomFeatures(int32_t num_frames, int32_t feat_dim,
+                                         std::mt19937 *gen) {
+  std::normal_distribution<float> normal(0, 1);
+  std::vector<float> ans(num_frames * feat_dim);
+  for (auto &f : ans) {
+    f = normal(*gen);
+  }
+  return ans;
+}
+
+// NeMo models take the number of frames as input, so ComputeBatch() gives
+// the same embeddings as Compute()
+TEST(SpeakerEmbeddingExtractor, NeMoBatchMatchesSingle) {
+  if (!FileExists(kNeMoModel)) {
+    SHERPA_ONNX_LOGE("%s does not exist. Skipping test", kNeMoModel);
+    return;
+  }
+
+  SpeakerEmbeddingExtractorConfig config;
+  config.model = kNeMoModel;
+  SpeakerEmbeddingExtractor extractor(config);
+  int32_t dim = extractor.Dim();
+  int32_t feat_dim = extractor.GetFeatureExtractorConfig().feature_dim;
+
+  std::mt19937 gen(20250101);
+
+  // The first three have the same padded length, the others are padded
+  // within their batch
+  std::vector<int32_t> num_frames = {320, 320, 320, 300, 311, 500, 537};
+  std::vector<std::vector<float>> features;
+  std::vector<std::vector<float>> expected;
+  for (auto n : num_frames) {
+    features.push_back(RandomFeatures(n, feat_dim, &gen));
+    expected.push_back(extractor.ComputeFromFeatures(features.back(), n));
+  }
+
+  std::vector<float> batch =
+      extractor.ComputeBatchFromFeatures(features, num_frames);
+  ASSERT_EQ(batch.size(), num_frames.size() * dim);
+
+  // Same lengths: the model input of each row equals that of Compute()
+  std::vector<std::vector<float>> same(features.begin(), features.begin() + 3);
+  std::vector<float> same_batch = extractor.ComputeBatchFromFeatures(
+      same, {num_frames.begin(), num_frames.begin() + 3});
+  for (int32_t i = 0; i != 3; ++i) {
+    for (int32_t k = 0; k != dim; ++k) {
+      EXPECT_EQ(same_batch[i * dim + k], expected[i][k]) << i << " " << k;
+    }
+  }
+
+  // Different lengths: padded frames are excluded by the length input
+  for (int32_t i = 0; i != static_cast<int32_t>(num_frames.size()); ++i) {
+    for (int32_t k = 0; k != dim; ++k) {
+      EXPECT_NEAR(batch[i * dim + k], expected[i][k],
+                  1e-4 * (1 + std::abs(expected[i][k])))
+          << i << " " << k;
+    }
+  }
+}
+
+}  // namespace sherpa_onnx
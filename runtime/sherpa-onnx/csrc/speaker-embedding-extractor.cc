@@ -4,6 +4,7 @@
 
 #include "sherpa-onnx/csrc/speaker-embedding-extractor.h"
 
+#include <utility>
 #include <vector>
 
 #if __ANDROID_API__ >= 9
@@ -85,6 +86,28 @@ std::vector<float> SpeakerEmbeddingExtractor::Compute(OnlineStream *s) const {
   return impl_->Compute(s);
 }
 
+std::vector<float> SpeakerEmbeddingExtractor::ComputeBatch(OnlineStream **ss,
+                                                           int32_t n) const {
+  return impl_->ComputeBatch(ss, n);
+}
+
+FeatureExtractorConfig SpeakerEmbeddingExtractor::GetFeatureExtractorConfig()
+    const {
+  return impl_->GetFeatureExtractorConfig();
+}
+
+std::vector<float> SpeakerEmbeddingExtractor::ComputeFromFeatures(
+    std::vector<float> features, int32_t num_frames) const {
+  return impl_->ComputeFromFeatures(std::move(features), num_frames);
+}
+
+std::vector<float> SpeakerEmbeddingExtractor::ComputeBatchFromFeatures(
+    std::vector<std::vector<float>> features,
+    const std::vector<int32_t> &num_frames, ThreadPool *pool) const {
+  return impl_->ComputeBatchFromFeatures(std::move(features), num_frames,
+                                         pool);
+}
+
 #if __ANDROID_API__ >= 9
 template SpeakerEmbeddingExtractor::SpeakerEmbeddingExtractor(
     AAssetManager *mgr, const SpeakerEmbeddingExtractorConfig &config);
@@ -9,8 +9,10 @@
 #include <string>
 #include <vector>
 
+#include "sherpa-onnx/csrc/features.h"
 #include "sherpa-onnx/csrc/online-stream.h"
 #include "sherpa-onnx/csrc/parse-options.h"
+#include "sherpa-onnx/csrc/thread-pool.h"
 
 namespace sherpa_onnx {
 
@@ -62,6 +64,50 @@ class SpeakerEmbeddingExtractor {
   // You have to ensure IsReady(s) returns true before you call this method.
   std::vector<float> Compute(OnlineStream *s) const;
 
+  // Compute the speaker embeddings of n streams at once.
+  //
+  // The model runs once for each group of streams, so it is much faster
+  // than calling Compute() n times when there are many streams. For models
+  // with an input for the number of frames, e.g., NeMo models, streams of
+  // similar lengths are padded to the same length and grouped. For other
+  // models, only streams with the same number of frames are grouped, since
+  // padding would change their embeddings. The result matches Compute() up
+  // to floating point differences of batched model runs.
+  //
+  // @return A row-major matrix of shape (n, Dim()). Row i is the embedding
+  //         of ss[i]. It is all zeros if IsReady(ss[i]) is false.
+  std::vector<float> ComputeBatch(OnlineStream **ss, int32_t n) const;
+
+  // Return the feature config used by streams created with CreateStream()
+  FeatureExtractorConfig GetFeatureExtractorConfig() const;
+
+  // Compute the speaker embedding from already computed features, e.g.,
+  // frames selected from the features of a whole recording.
+  //
+  // @param features A row-major matrix of shape (num_frames, feature_dim)
+  //                 computed with GetFeatureExtractorConfig().
+  // @param num_frames Number of frames in features. Must be positive.
+  //
+  // It is safe to call it from several threads at the same time.
+  std::vector<float> ComputeFromFeatures(std::vector<float> features,
+                                         int32_t num_frames) const;
+
+  // Compute the speaker embeddings of several utterances from already
+  // computed features. Utterances are batched as in ComputeBatch().
+  //
+  // @param features features[i] is a row-major matrix of shape
+  //                 (num_frames[i], feature_dim) computed with
+  //                 GetFeatureExtractorConfig().
+  // @param num_frames Number of frames of each utterance. Each must be
+  //                   positive.
+  // @param pool If not null, the batches run concurrently on it.
+  //
+  // @return A row-major matrix of shape (num_frames.size(), Dim())
+  std::vector<float> ComputeBatchFromFeatures(
+      std::vector<std::vector<float>> features,
+      const std::vector<int32_t> &num_frames,
+      ThreadPool *pool = nullptr) const;
+
  private:
   std::unique_ptr<SpeakerEmbeddingExtractorImpl> impl_;
 };
@@ -0,0 +1,225 @@
+// sherpa-onnx/csrc/speaker-embedding-index-test.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-onnx/csrc/speaker-embedding-index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace sherpa_onnx {
+
+static std::vector<float> RandomEmbeddings(int32_t n, int32_t dim,
+                                           std::mt19937 *gen) {
+  std::normal_distribution<float> normal(0, 1);
+  std::vector<float> ans(n * dim);
+  for (int32_t i = 0; i != n; ++i) {
+    float *p = ans.data() + i * dim;
+    float sum = 0;
+    for (int32_t d = 0; d != dim; ++d) {
+      p[d] = normal(*gen);
+      sum += p[d] * p[d];
+    }
+    for (int32_t d = 0; d != dim; ++d) {
+      p[d] /= std::sqrt(sum);
+    }
+  }
+  return ans;
+}
+
+TEST(SpeakerEmbeddingIndex, FlatIsExact) {
+  int32_t dim = 16;
+  int32_t n = 5000;
+  std::mt19937 gen(0);
+  std::vector<float> data = RandomEmbeddings(n, dim, &gen);
+
+  auto index = SpeakerEmbeddingIndex::Create("flat", dim);
+  for (int32_t i = 0; i != n; ++i) {
+    EXPECT_EQ(index->Add(data.data() + i * dim), i);
+  }
+
+  // Each embedding is its own best match
+  auto matches = index->Search(data.data(), 100, 3, -1);
+  ASSERT_EQ(matches.size(), 100);
+  for (int32_t i = 0; i != 100; ++i) {
+    ASSERT_EQ(matches[i].size(), 3);
+    EXPECT_EQ(matches[i][0].id, i);
+    EXPECT_NEAR(matches[i][0].score, 1, 1e-5);
+    EXPECT_GE(matches[i][0].score, matches[i][1].score);
+    EXPECT_GE(matches[i][1].score, matches[i][2].score);
+  }
+
+  matches = index->Search(data.data(), 1, 3, 0.999);
+  ASSERT_EQ(matches[0].size(), 1);
+}
+
+TEST(SpeakerEmbeddingIndex, Remove) {
+  int32_t dim = 8;
+  std::mt19937 gen(0);
+  std::vector<float> data = RandomEmbeddings(3, dim, &gen);
+
+  for (const char *type : {"flat", "hnsw"}) {
+    auto index = SpeakerEmbeddingIndex::Create(type, dim);
+    for (int32_t i = 0; i != 2; ++i) {
+      index->Add(data.data() + i * dim);
+    }
+
+    index->Remove(0);
+    auto matches = index->Search(data.data(), 1, 2, -1);
+    ASSERT_EQ(matches[0].size(), 1) << type;
+    EXPECT_EQ(matches[0][0].id, 1) << type;
+
+    // The flat index reuses the slot of a removed embedding
+    int32_t id = index->Add(data.data() + 2 * dim);
+    EXPECT_EQ(id, index->Type() == "flat" ? 0 : 2);
+
+    matches = index->Search(data.data() + 2 * dim, 1, 1, -1);
+    ASSERT_EQ(matches[0].size(), 1) << type;
+    EXPECT_EQ(matches[0][0].id, id) << type;
+  }
+}
+
+TEST(SpeakerEmbeddingIndex, HnswRecall) {
+  int32_t dim = 32;
+  int32_t n = 10000;
+  int32_t num_queries = 200;
+  int32_t k = 10;
+  std::mt19937 gen(0);
+  std::vector<float> data = RandomEmbeddings(n, dim, &gen);
+  std::vector<float> queries = RandomEmbeddings(num_queries, dim, &gen);
+
+  auto flat = SpeakerEmbeddingIndex::Create("flat", dim);
+  auto hnsw = SpeakerEmbeddingIndex::Create("hnsw", dim);
+  for (int32_t i = 0; i != n; ++i) {
+    flat->Add(data.data() + i * dim);
+    hnsw->Add(data.data() + i * dim);
+  }
+
+  for (int32_t i = 0; i < n; i += 10) {
+    flat->Remove(i);
+    hnsw->Remove(i);
+  }
+
+  auto expected = flat->Search(queries.data(), num_queries, k, -1);
+  auto found = hnsw->Search(queries.data(), num_queries, k, -1);
+
+  int32_t num_correct = 0;
+  for (int32_t i = 0; i != num_queries; ++i) {
+    for (const auto &m : found[i]) {
+      EXPECT_NE(m.id % 10, 0);
+      for (const auto &e : expected[i]) {
+        num_correct += m.id == e.id;
+      }
+    }
+  }
+
+  float recall = static_cast<float>(num_correct) / (num_queries * k);
+  EXPECT_GT(recall, 0.9);
+}
+
+TEST(SpeakerEmbeddingIndex, SaveAndLoad) {
+  int32_t dim = 12;
+  int32_t n = 500;
+  std::mt19937 gen(0);
+  std::vector<float> data = RandomEmbeddings(n, dim, &gen);
+
+  for (const char *type : {"flat", "hnsw"}) {
+    auto index = SpeakerEmbeddingIndex::Create(type, dim);
+    for (int32_t i = 0; i != n; ++i) {
+      index->Add(data.data() + i * dim);
+    }
+    index->Remove(3);
+
+    std::stringstream ss;
+    index->Save(ss);
+
+    auto loaded = SpeakerEmbeddingIndex::Load(ss);
+    ASSERT_NE(loaded, nullptr) << type;
+    EXPECT_EQ(loaded->Type(), type);
+    EXPECT_EQ(loaded->Dim(), dim);
+
+    auto expected = index->Search(data.data(), 10, 5, -1);
+    auto found = loaded->Search(data.data(), 10, 5, -1);
+    for (int32_t i = 0; i != 10; ++i) {
+      ASSERT_EQ(expected[i].size(), found[i].size()) << type;
+      for (int32_t j = 0; j != static_cast<int32_t>(found[i].size()); ++j) {
+        EXPECT_EQ(expected[i][j].id, found[i][j].id) << type;
+        EXPECT_EQ(expected[i][j].score, found[i][j].score) << type;
+      }
+    }
+
+    std::stringstream bad("not an index");
+    EXPECT_EQ(SpeakerEmbeddingIndex::Load(bad), nullptr);
+  }
+}
+
+TEST(SpeakerEmbeddingIndex, LoadCorruptedHnsw) {
+  int32_t dim = 12;
+  int32_t n = 100;
+  std::mt19937 gen(0);
+  std::vector<float> data = RandomEmbeddings(n, dim, &gen);
+
+  auto index = SpeakerEmbeddingIndex::Create("hnsw", dim);
+  for (int32_t i = 0; i != n; ++i) {
+    index->Add(data.data() + i * dim);
+  }
+
+  std::stringstream ss;
+  index->Save(ss);
+  std::string saved = ss.str();
+
+  // The graph follows the embeddings: entry point, max level, then for
+  // each slot its number of levels and for each level its number of
+  // neighbors and their ids.
+  std::string embeddings(reinterpret_cast<const char *>(data.data()),
+                         data.size() * sizeof(float));
+  size_t pos = saved.find(embeddings);
+  ASSERT_NE(pos, std::string::npos);
+  size_t entry_point_offset = pos + embeddings.size();
+  size_t neighbor_offset = entry_point_offset + 4 * sizeof(int32_t);
+
+  auto patch = [&](size_t offset, int32_t value) {
+    std::string s = saved;
+    s.replace(offset, sizeof(value), reinterpret_cast<const char *>(&value),
+              sizeof(value));
+    std::stringstream is(s);
+    return SpeakerEmbeddingIndex::Load(is);
+  };
+
+  std::stringstream is(saved);
+  EXPECT_NE(SpeakerEmbeddingIndex::Load(is), nullptr);
+
+  for (int32_t id : {-2, n, 100000}) {
+    EXPECT_EQ(patch(entry_point_offset, id), nullptr) << id;
+    EXPECT_EQ(patch(neighbor_offset, id), nullptr) << id;
+  }
+
+  // Counts larger than the stream are rejected before anything is
+  // allocated: dim and num_slots follow the magic, the version and the
+  // type, then the number of levels of slot 0 follows the max level
+  for (size_t offset : {size_t(16), size_t(20), entry_point_offset + 8}) {
+    EXPECT_EQ(patch(offset, 1 << 30), nullptr) << offset;
+  }
+
+  // Slot 0 has a single level, so the entry point cannot be on top of it
+  // unless the graph has a single level
+  int32_t max_level = 0;
+  std::copy(saved.data() + entry_point_offset + sizeof(int32_t),
+            saved.data() + entry_point_offset + 2 * sizeof(int32_t),
+            reinterpret_cast<char *>(&max_level));
+  int32_t num_levels = 0;
+  std::copy(saved.data() + entry_point_offset + 2 * sizeof(int32_t),
+            saved.data() + entry_point_offset + 3 * sizeof(int32_t),
+            reinterpret_cast<char *>(&num_levels));
+  if (num_levels != max_level + 1) {
+    EXPECT_EQ(patch(entry_point_offset, 0), nullptr);
+  }
+}
+
+}  // namespace sherpa_onnx
@@ -0,0 +1,638 @@
+// sherpa-onnx/csrc/speaker-embedding-index.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-onnx/csrc/speaker-embedding-index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <unordered_set>
+#include <utility>
+
+#include "Eigen/Dense"
+#include "sherpa-onnx/csrc/macros.h"
+
+namespace sherpa_onnx {
+
+namespace {
+
+using FloatMatrix =
+    Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+using Match = SpeakerEmbeddingIndexMatch;
+
+constexpr char kMagic[4] = {'S', 'E', 'I', 'X'};
+constexpr int32_t kVersion = 1;
+
+template <typename T>
+void Write(std::ostream &os, const T &v) {
+  os.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template <typename T>
+bool Read(std::istream &is, T *v) {
+  is.read(reinterpret_cast<char *>(v), sizeof(T));
+  return static_cast<bool>(is);
+}
+
+// Limits of values read by Load(), checked before they size any buffer
+constexpr int32_t kMaxDim = 1 << 16;
+constexpr int32_t kMaxLevels = 64;
+
+// Return the number of bytes left in the stream, or the largest int64_t if
+// the stream cannot seek
+int64_t RemainingBytes(std::istream &is) {
+  std::streampos pos = is.tellg();
+  if (pos < 0) {
+    return std::numeric_limits<int64_t>::max();
+  }
+
+  is.seekg(0, std::ios::end);
+  std::streampos end = is.tellg();
+  is.seekg(pos);
+  if (end < pos) {
+    return std::numeric_limits<int64_t>::max();
+  }
+
+  return static_cast<int64_t>(end - pos);
+}
+
+// Keep the k best matches of a query in a min-heap
+class TopK {
+ public:
+  explicit TopK(int32_t k) : k_(k) { heap_.reserve(k); }
+
+  bool Accepts(float score) const {
+    return static_cast<int32_t>(heap_.size()) < k_ ||
+           score > heap_.front().score;
+  }
+
+  void Push(int32_t id, float score) {
+    if (static_cast<int32_t>(heap_.size()) == k_) {
+      std::pop_heap(heap_.begin(), heap_.end(), Compare);
+      heap_.pop_back();
+    }
+    heap_.push_back({id, score});
+    std::push_heap(heap_.begin(), heap_.end(), Compare);
+  }
+
+  // Return the matches best first
+  std::vector<Match> Get() {
+    std::sort_heap(heap_.begin(), heap_.end(), Compare);
+    return std::move(heap_);
+  }
+
+ private:
+  static bool Compare(const Match &a, const Match &b) {
+    return a.score > b.score;
+  }
+
+ private:
+  int32_t k_;
+  std::vector<Match> heap_;
+};
+
+// Exact search. The scores are computed block by block with a matrix
+// product so that all queries share each pass over the embeddings.
+class FlatSpeakerEmbeddingIndex : public SpeakerEmbeddingIndex {
+ public:
+  explicit FlatSpeakerEmbeddingIndex(int32_t dim)
+      : SpeakerEmbeddingIndex(dim) {}
+
+  std::string Type() const override { return "flat"; }
+
+  int32_t Add(const float *p) override {
+    if (free_ids_.empty()) {
+      return Append(p);
+    }
+
+    // Reuse the slot of a removed embedding
+    int32_t id = free_ids_.back();
+    free_ids_.pop_back();
+
+    std::copy(p, p + dim_, data_.begin() + static_cast<size_t>(id) * dim_);
+    removed_[id] = 0;
+
+    return id;
+  }
+
+  void Remove(int32_t id) override {
+    SpeakerEmbeddingIndex::Remove(id);
+    free_ids_.push_back(id);
+  }
+
+  std::vector<std::vector<Match>> Search(const float *queries,
+                                         int32_t num_queries, int32_t k,
+                                         float threshold) const override {
+    std::vector<std::vector<Match>> ans(num_queries);
+    int32_t num_slots = NumSlots();
+    if (num_slots == 0 || k <= 0) {
+      return ans;
+    }
+
+    std::vector<TopK> topk(num_queries, TopK(k));
+
+    Eigen::Map<const FloatMatrix> q(queries, num_queries, dim_);
+    FloatMatrix scores;
+
+    for (int32_t begin = 0; begin < num_slots; begin += kBlockSize) {
+      int32_t num_rows = std::min(kBlockSize, num_slots - begin);
+      Eigen::Map<const FloatMatrix> block(
+          data_.data() + static_cast<size_t>(begin) * dim_, num_rows, dim_);
+
+      // (num_queries, num_rows)
+      scores.noalias() = q * block.transpose();
+
+      for (int32_t i = 0; i != num_queries; ++i) {
+        const float *s = &scores(i, 0);
+        for (int32_t r = 0; r != num_rows; ++r) {
+          if (s[r] >= threshold && topk[i].Accepts(s[r]) &&
+              !IsRemoved(begin + r)) {
+            topk[i].Push(begin + r, s[r]);
+          }
+        }
+      }
+    }
+
+    for (int32_t i = 0; i != num_queries; ++i) {
+      ans[i] = topk[i].Get();
+    }
+
+    return ans;
+  }
+
+ protected:
+  bool LoadExtra(std::istream & /*is*/) override {
+    for (int32_t i = 0; i != NumSlots(); ++i) {
+      if (IsRemoved(i)) {
+        free_ids_.push_back(i);
+      }
+    }
+    return true;
+  }
+
+ private:
+  // Number of embeddings per matrix product. 4096 embeddings of dim 192
+  // take 3 MB, which fits into the L2/L3 cache of most CPUs.
+  static constexpr int32_t kBlockSize = 4096;
+
+  // Ids of removed embeddings whose slots can be reused
+  std::vector<int32_t> free_ids_;
+};
+
+// Approximate search with a hierarchical navigable small world graph.
+// See https://arxiv.org/abs/1603.09320
+//
+// Removed embeddings stay in the graph so that it remains connected, but
+// they are never returned as matches and their slots are not reused.
+class HnswSpeakerEmbeddingIndex : public SpeakerEmbeddingIndex {
+ public:
+  explicit HnswSpeakerEmbeddingIndex(int32_t dim)
+      : SpeakerEmbeddingIndex(dim), level_mult_(1 / std::log(1.0 * kM)) {}
+
+  std::string Type() const override { return "hnsw"; }
+
+  int32_t Add(const float *p) override {
+    int32_t id = Append(p);
+    int32_t level = RandomLevel();
+    links_.emplace_back(level + 1);
+
+    if (entry_point_ == -1) {
+      entry_point_ = id;
+      max_level_ = level;
+      return id;
+    }
+
+    const float *q = Get(id);
+
+    int32_t cur = entry_point_;
+    float cur_dist = Distance(q, cur);
+    for (int32_t l = max_level_; l > level; --l) {
+      cur = GreedySearch(q, cur, l, &cur_dist);
+    }
+
+    for (int32_t l = std::min(level, max_level_); l >= 0; --l) {
+      std::vector<DistId> candidates =
+          SearchLayer(q, cur, kEfConstruction, l, false);
+
+      links_[id][l] = SelectNeighbors(candidates, kM);
+      for (int32_t n : links_[id][l]) {
+        Connect(n, id, l);
+      }
+
+      cur = candidates[0].second;
+    }
+
+    if (level > max_level_) {
+      max_level_ = level;
+      entry_point_ = id;
+    }
+
+    return id;
+  }
+
+  std::vector<std::vector<Match>> Search(const float *queries,
+                                         int32_t num_queries, int32_t k,
+                                         float threshold) const override {
+    std::vector<std::vector<Match>> ans(num_queries);
+    if (entry_point_ == -1 || k <= 0) {
+      return ans;
+    }
+
+    for (int32_t i = 0; i != num_queries; ++i) {
+      const float *q = queries + static_cast<size_t>(i) * dim_;
+
+      int32_t cur = entry_point_;
+      float cur_dist = Distance(q, cur);
+      for (int32_t l = max_level_; l > 0; --l) {
+        cur = GreedySearch(q, cur, l, &cur_dist);
+      }
+
+      std::vector<DistId> found =
+          SearchLayer(q, cur, std::max(kEfSearch, k), 0, true);
+
+      for (const auto &d : found) {
+        float score = 1 - d.first;
+        if (static_cast<int32_t>(ans[i].size()) == k || score < threshold) {
+          break;
+        }
+        ans[i].push_back({d.second, score});
+      }
+    }
+
+    return ans;
+  }
+
+ protected:
+  void SaveExtra(std::ostream &os) const override {
+    Write(os, entry_point_);
+    Write(os, max_level_);
+    for (const auto &levels : links_) {
+      Write(os, static_cast<int32_t>(levels.size()));
+      for (const auto &neighbors : levels) {
+        Write(os, static_cast<int32_t>(neighbors.size()));
+        os.write(reinterpret_cast<const char *>(neighbors.data()),
+                 neighbors.size() * sizeof(int32_t));
+      }
+    }
+  }
+
+  bool LoadExtra(std::istream &is) override {
+    int32_t num_slots = NumSlots();
+    if (!Read(is, &entry_point_) || !Read(is, &max_level_)) {
+      return false;
+    }
+
+    // Each node has at least a level count and a neighbor count
+    int64_t remaining = RemainingBytes(is);
+    if (num_slots * int64_t{2 * sizeof(int32_t)} > remaining) {
+      return false;
+    }
+
+    links_.resize(num_slots);
+    for (auto &levels : links_) {
+      int32_t num_levels = 0;
+      if (!Read(is, &num_levels) || num_levels <= 0 ||
+          num_levels > kMaxLevels) {
+        return false;
+      }
+      remaining -= sizeof(int32_t);
+      if (num_levels * int64_t{sizeof(int32_t)} > remaining) {
+        return false;
+      }
+      levels.resize(num_levels);
+
+      for (auto &neighbors : levels) {
+        int32_t num_neighbors = 0;
+        if (!Read(is, &num_neighbors) || num_neighbors < 0 ||
+            num_neighbors > num_slots) {
+          return false;
+        }
+        remaining -= sizeof(int32_t);
+        if (num_neighbors * int64_t{sizeof(int32_t)} > remaining) {
+          return false;
+        }
+        remaining -= num_neighbors * sizeof(int32_t);
+        neighbors.resize(num_neighbors);
+        is.read(reinterpret_cast<char *>(neighbors.data()),
+                num_neighbors * sizeof(int32_t));
+      }
+    }
+
+    if (!is) {
+      return false;
+    }
+
+    // The search follows these ids without checking them
+    if (entry_point_ == -1) {
+      if (num_slots != 0 || max_level_ != -1) {
+        return false;
+      }
+    } else if (entry_point_ < 0 || entry_point_ >= num_slots ||
+               max_level_ + 1 !=
+                   static_cast<int32_t>(links_[entry_point_].size())) {
+      return false;
+    }
+
+    for (const auto &levels : links_) {
+      for (int32_t l = 0; l != static_cast<int32_t>(levels.size()); ++l) {
+        for (int32_t n : levels[l]) {
+          // A neighbor on level l must exist on level l
+          if (n < 0 || n >= num_slots ||
+              static_cast<int32_t>(links_[n].size()) <= l) {
+            return false;
+          }
+        }
+      }
+    }
+
+    return true;
+  }
+
+ private:
+  // (distance, id)
+  using DistId = std::pair<float, int32_t>;
+
+  float Distance(const float *q, int32_t id) const {
+    return 1 - Dot(q, Get(id));
+  }
+
+  int32_t RandomLevel() {
+    std::uniform_real_distribution<double> uniform(0, 1);
+    return static_cast<int32_t>(-std::log(1 - uniform(rng_)) * level_mult_);
+  }
+
+  int32_t MaxLinks(int32_t level) const { return level == 0 ? 2 * kM : kM; }
+
+  // Move to the closest neighbour until no neighbour is closer to q
+  int32_t GreedySearch(const float *q, int32_t cur, int32_t level,
+                       float *cur_dist) const {
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (int32_t n : links_[cur][level]) {
+        float d = Distance(q, n);
+        if (d < *cur_dist) {
+          *cur_dist = d;
+          cur = n;
+          changed = true;
+        }
+      }
+    }
+    return cur;
+  }
+
+  // Return up to ef nodes close to q, closest first.
+  // If skip_removed is true, removed nodes are visited but not returned.
+  std::vector<DistId> SearchLayer(const float *q, int32_t entry, int32_t ef,
+                                  int32_t level, bool skip_removed) const {
+    std::unordered_set<int32_t> visited;
+    visited.reserve(static_cast<size_t>(ef) * MaxLinks(level));
+    visited.insert(entry);
+
+    // closest first
+    std::priority_queue<DistId, std::vector<DistId>, std::greater<DistId>>
+        candidates;
+    // farthest first
+    std::priority_queue<DistId> found;
+
+    float d = Distance(q, entry);
+    candidates.emplace(d, entry);
+    if (!skip_removed || !IsRemoved(entry)) {
+      found.emplace(d, entry);
+    }
+
+    while (!candidates.empty()) {
+      DistId c = candidates.top();
+      if (static_cast<int32_t>(found.size()) >= ef &&
+          c.first > found.top().first) {
+        break;
+      }
+      candidates.pop();
+
+      for (int32_t n : links_[c.second][level]) {
+        if (!visited.insert(n).second) {
+          continue;
+        }
+
+        float dn = Distance(q, n);
+        if (static_cast<int32_t>(found.size()) < ef ||
+            dn < found.top().first) {
+          candidates.emplace(dn, n);
+
+          if (!skip_removed || !IsRemoved(n)) {
+            found.emplace(dn, n);
+            if (static_cast<int32_t>(found.size()) > ef) {
+              found.pop();
+            }
+          }
+        }
+      }
+    }
+
+    std::vector<DistId> ans(found.size());
+    for (auto it = ans.rbegin(); it != ans.rend(); ++it) {
+      *it = found.top();
+      found.pop();
+    }
+    return ans;
+  }
+
+  // The heuristic of the paper: a candidate is kept only if it is closer
+  // to q than to every neighbour selected so far, which keeps links to
+  // other clusters instead of only to the densest one.
+  //
+  // @param candidates Sorted by distance to q, closest first.
+  std::vector<int32_t> SelectNeighbors(const std::vector<DistId> &candidates,
+                                       int32_t m) const {
+    std::vector<int32_t> ans;
+    ans.reserve(m);
+
+    for (const auto &c : candidates) {
+      if (static_cast<int32_t>(ans.size()) == m) {
+        break;
+      }
+
+      const float *p = Get(c.second);
+      bool keep = true;
+      for (int32_t s : ans) {
+        if (Distance(p, s) < c.first) {
+          keep = false;
+          break;
+        }
+      }
+
+      if (keep) {
+        ans.push_back(c.second);
+      }
+    }
+
+    return ans;
+  }
+
+  // Add a link from node to new_neighbor, pruning the links of node if it
+  // has too many
+  void Connect(int32_t node, int32_t new_neighbor, int32_t level) {
+    auto &neighbors = links_[node][level];
+    neighbors.push_back(new_neighbor);
+
+    int32_t max_links = MaxLinks(level);
+    if (static_cast<int32_t>(neighbors.size()) <= max_links) {
+      return;
+    }
+
+    const float *p = Get(node);
+    std::vector<DistId> candidates;
+    candidates.reserve(neighbors.size());
+    for (int32_t n : neighbors) {
+      candidates.emplace_back(Distance(p, n), n);
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    neighbors = SelectNeighbors(candidates, max_links);
+  }
+
+ private:
+  // Number of links per node on levels > 0. Level 0 has 2 * kM links.
+  static constexpr int32_t kM = 16;
+  static constexpr int32_t kEfConstruction = 200;
+  static constexpr int32_t kEfSearch = 64;
+
+  double level_mult_;
+  std::mt19937 rng_{20250101};
+
+  int32_t entry_point_ = -1;
+  int32_t max_level_ = -1;
+
+  // links_[i][l] contains the neighbours of node i on level l
+  std::vector<std::vector<std::vector<int32_t>>> links_;
+};
+
+}  // namespace
+
+std::unique_ptr<SpeakerEmbeddingIndex> SpeakerEmbeddingIndex::Create(
+    const std::string &type, int32_t dim) {
+  if (type == "flat") {
+    return std::make_unique<FlatSpeakerEmbeddingIndex>(dim);
+  }
+
+  if (type == "hnsw") {
+    return std::make_unique<HnswSpeakerEmbeddingIndex>(dim);
+  }
+
+  return nullptr;
+}
+
+void SpeakerEmbeddingIndex::Remove(int32_t id) { removed_[id] = 1; }
+
+int32_t SpeakerEmbeddingIndex::Append(const float *p) {
+  data_.insert(data_.end(), p, p + dim_);
+  removed_.push_back(0);
+
+  return NumSlots() - 1;
+}
+
+float SpeakerEmbeddingIndex::Dot(const float *a, const float *b) const {
+  return Eigen::Map<const Eigen::VectorXf>(a, dim_).dot(
+      Eigen::Map<const Eigen::VectorXf>(b, dim_));
+}
+
+// File layout:
+//
+//  magic "SEIX", version, type length, type, dim, num_slots,
+//  removed flags (num_slots bytes), padding length, padding,
+//  embeddings (num_slots * dim floats), data of the subclass
+void SpeakerEmbeddingIndex::Save(std::ostream &os) const {
+  os.write(kMagic, sizeof(kMagic));
+  Write(os, kVersion);
+
+  std::string type = Type();
+  Write(os, static_cast<int32_t>(type.size()));
+  os.write(type.data(), type.size());
+
+  Write(os, dim_);
+  Write(os, NumSlots());
+  os.write(removed_.data(), removed_.size());
+
+  int32_t padding = 0;
+  std::streamoff pos = os.tellp();
+  if (pos >= 0) {
+    padding = (64 - (pos + sizeof(int32_t)) % 64) % 64;
+  }
+  Write(os, padding);
+  os.write(std::string(padding, '\0').data(), padding);
+
+  os.write(reinterpret_cast<const char *>(data_.data()),
+           data_.size() * sizeof(float));
+
+  SaveExtra(os);
+}
+
+std::unique_ptr<SpeakerEmbeddingIndex> SpeakerEmbeddingIndex::Load(
+    std::istream &is) {
+  char magic[sizeof(kMagic)];
+  is.read(magic, sizeof(magic));
+  if (!is || !std::equal(magic, magic + sizeof(magic), kMagic)) {
+    SHERPA_ONNX_LOGE("Not a speaker embedding index");
+    return nullptr;
+  }
+
+  int32_t version = 0;
+  if (!Read(is, &version) || version != kVersion) {
+    SHERPA_ONNX_LOGE("Unsupported speaker embedding index version: %d",
+                     version);
+    return nullptr;
+  }
+
+  int32_t type_length = 0;
+  if (!Read(is, &type_length) || type_length <= 0 || type_length > 64) {
+    SHERPA_ONNX_LOGE("Corrupted speaker embedding index");
+    return nullptr;
+  }
+  std::string type(type_length, '\0');
+  is.read(&type[0], type_length);
+
+  int32_t dim = 0;
+  int32_t num_slots = 0;
+  // Each slot takes a removed flag and an embedding of dim floats
+  if (!Read(is, &dim) || !Read(is, &num_slots) || dim <= 0 || dim > kMaxDim ||
+      num_slots < 0 ||
+      num_slots > RemainingBytes(is) / (1 + dim * int64_t{sizeof(float)})) {
+    SHERPA_ONNX_LOGE("Corrupted speaker embedding index");
+    return nullptr;
+  }
+
+  auto ans = Create(type, dim);
+  if (!ans) {
+    SHERPA_ONNX_LOGE("Unsupported speaker embedding index type: '%s'",
+                     type.c_str());
+    return nullptr;
+  }
+
+  ans->removed_.resize(num_slots);
+  is.read(ans->removed_.data(), num_slots);
+
+  int32_t padding = 0;
+  if (!Read(is, &padding) || padding < 0 || padding >= 64) {
+    SHERPA_ONNX_LOGE("Corrupted speaker embedding index");
+    return nullptr;
+  }
+  is.ignore(padding);
+
+  ans->data_.resize(static_cast<size_t>(num_slots) * dim);
+  is.read(reinterpret_cast<char *>(ans->data_.data()),
+          ans->data_.size() * sizeof(float));
+
+  if (!is || !ans->LoadExtra(is)) {
+    SHERPA_ONNX_LOGE("Corrupted speaker embedding index");
+    return nullptr;
+  }
+
+  return ans;
+}
+
+}  // namespace sherpa_onnx
@@ -0,0 +1,113 @@
+// sherpa-onnx/csrc/speaker-embedding-index.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_ONNX_CSRC_SPEAKER_EMBEDDING_INDEX_H_
+#define SHERPA_ONNX_CSRC_SPEAKER_EMBEDDING_INDEX_H_
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace sherpa_onnx {
+
+struct SpeakerEmbeddingIndexMatch {
+  int32_t id;
+  float score;  // cosine similarity
+};
+
+/* Storage and nearest neighbour search for unit-length speaker embeddings.
+ *
+ * Each added embedding gets an integer id. Removing an embedding only marks
+ * its id as removed, which takes O(1) time. Removed ids are never returned
+ * by Search().
+ */
+class SpeakerEmbeddingIndex {
+ public:
+  virtual ~SpeakerEmbeddingIndex() = default;
+
+  /* @param type Either "flat" or "hnsw".
+   *             "flat" compares a query with every embedding. The result is
+   *             exact.
+   *             "hnsw" walks a hierarchical navigable small world graph.
+   *             The result is approximate but the search time grows only
+   *             logarithmically with the number of embeddings.
+   * @param dim Embedding dimension.
+   * @return Return nullptr if the type is not supported.
+   */
+  static std::unique_ptr<SpeakerEmbeddingIndex> Create(const std::string &type,
+                                                       int32_t dim);
+
+  // Read an index written by Save(). Return nullptr on error.
+  static std::unique_ptr<SpeakerEmbeddingIndex> Load(std::istream &is);
+
+  /* Write the index to a binary stream.
+   *
+   * The embeddings are written as one row-major float matrix that starts
+   * at a 64-byte aligned offset of the stream, so the file can also be
+   * memory-mapped.
+   */
+  void Save(std::ostream &os) const;
+
+  virtual std::string Type() const = 0;
+
+  int32_t Dim() const { return dim_; }
+
+  // Add an embedding of size Dim() and return its id.
+  // The embedding must have unit length.
+  virtual int32_t Add(const float *p) = 0;
+
+  // Mark the embedding with the given id as removed
+  virtual void Remove(int32_t id);
+
+  // Return the embedding with the given id
+  const float *Get(int32_t id) const {
+    return data_.data() + static_cast<size_t>(id) * dim_;
+  }
+
+  // Ids are in the range [0, NumSlots()), including removed ones
+  int32_t NumSlots() const { return removed_.size(); }
+
+  bool IsRemoved(int32_t id) const { return removed_[id]; }
+
+  /* Find the k embeddings with the largest cosine similarity for each
+   * query. Only matches with a score >= threshold are returned.
+   *
+   * @param queries A row-major matrix of shape (num_queries, Dim()).
+   *                Each row must have unit length.
+   * @param num_queries Number of queries.
+   * @param k Maximum number of matches per query.
+   * @param threshold Minimum score of a match.
+   * @return ans[i] contains the matches for the i-th query, best first.
+   */
+  virtual std::vector<std::vector<SpeakerEmbeddingIndexMatch>> Search(
+      const float *queries, int32_t num_queries, int32_t k,
+      float threshold) const = 0;
+
+ protected:
+  explicit SpeakerEmbeddingIndex(int32_t dim) : dim_(dim) {}
+
+  // Append an embedding to data_ and return its id
+  int32_t Append(const float *p);
+
+  float Dot(const float *a, const float *b) const;
+
+  // For the data of subclasses that follows the embeddings in a file
+  virtual void SaveExtra(std::ostream & /*os*/) const {}
+  virtual bool LoadExtra(std::istream & /*is*/) { return true; }
+
+ protected:
+  int32_t dim_;
+
+  // Row-major matrix of shape (NumSlots(), dim_)
+  std::vector<float> data_;
+
+  // removed_[i] is 1 if the i-th embedding has been removed
+  std::vector<char> removed_;
+};
+
+}  // namespace sherpa_onnx
+
+#endif  // SHERPA_ONNX_CSRC_SPEAKER_EMBEDDING_INDEX_H_
@@ -4,6 +4,11 @@
 
 #include "sherpa-onnx/csrc/speaker-embedding-manager.h"
 
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 namespace sherpa_onnx {
@@ -144,4 +149,117 @@ TEST(SpeakerEmbeddingManager, Verify) {
   ASSERT_FALSE(status);
 }
 
+TEST(SpeakerEmbeddingManager, GetBestMatchesBatch) {
+  for (const char *index_type : {"flat", "hnsw"}) {
+    int32_t dim = 2;
+    SpeakerEmbeddingManager manager(dim, index_type);
+    std::vector<float> v1 = {0.1, 0.1};
+    std::vector<float> v2 = {0.1, 0.9};
+    std::vector<float> v3 = {0.9, 0.1};
+    ASSERT_TRUE(manager.Add("first", v1.data()));
+    ASSERT_TRUE(manager.Add("second", v2.data()));
+    ASSERT_TRUE(manager.Add("third", v3.data()));
+
+    std::vector<float> queries = {15, 16, 2, 17, 17, 2};
+    auto matches = manager.GetBestMatchesBatch(queries.data(), 3, 0.5, 2);
+    ASSERT_EQ(matches.size(), 3);
+    EXPECT_EQ(matches[0][0].name, "first");
+    EXPECT_EQ(matches[1][0].name, "second");
+    EXPECT_EQ(matches[2][0].name, "third");
+
+    for (int32_t i = 0; i != 3; ++i) {
+      auto m = manager.GetBestMatches(queries.data() + i * dim, 0.5, 2);
+      ASSERT_EQ(m.size(), matches[i].size());
+      EXPECT_EQ(m[0].name, matches[i][0].name);
+    }
+
+    ASSERT_TRUE(manager.Remove("second"));
+    matches = manager.GetBestMatchesBatch(queries.data(), 3, 0.9, 2);
+    EXPECT_TRUE(matches[1].empty());
+  }
+}
+
+TEST(SpeakerEmbeddingManager, SaveAndLoad) {
+  for (const char *index_type : {"flat", "hnsw"}) {
+    int32_t dim = 2;
+    SpeakerEmbeddingManager manager(dim, index_type);
+    std::vector<float> v1 = {0.1, 0.1};
+    std::vector<float> v2 = {0.1, 0.9};
+    std::vector<float> v3 = {0.9, 0.1};
+    ASSERT_TRUE(manager.Add("first", v1.data()));
+    ASSERT_TRUE(manager.Add("second", v2.data()));
+    ASSERT_TRUE(manager.Add("third", v3.data()));
+    ASSERT_TRUE(manager.Remove("first"));
+
+    std::string filename = "speaker-embedding-manager-test.bin";
+    ASSERT_TRUE(manager.Save(filename));
+
+    SpeakerEmbeddingManager loaded(dim);
+    ASSERT_TRUE(loaded.Load(filename));
+    EXPECT_EQ(loaded.NumSpeakers(), 2);
+    EXPECT_EQ(loaded.GetAllSpeakers(), manager.GetAllSpeakers());
+
+    std::vector<float> v = {2, 17};
+    EXPECT_EQ(loaded.Search(v.data(), 0.9), "second");
+    EXPECT_TRUE(loaded.Verify("third", v3.data(), 0.9));
+
+    // Speakers can still be added and removed after loading
+    ASSERT_TRUE(loaded.Add("first", v1.data()));
+    v = {15, 16};
+    EXPECT_EQ(loaded.Search(v.data(), 0.9), "first");
+
+    SpeakerEmbeddingManager other_dim(dim + 1);
+    EXPECT_FALSE(other_dim.Load(filename));
+
+    std::remove(filename.c_str());
+  }
+}
+
+// Overwrite the int32 at the given byte offset of a file
+static void Patch(const std::string &filename, int32_t offset, int32_t value) {
+  std::fstream f(filename, std::ios::in | std::ios::out | std::ios::binary);
+  f.seekp(offset);
+  f.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+TEST(SpeakerEmbeddingManager, LoadCorrupted) {
+  for (const char *index_type : {"flat", "hnsw"}) {
+    int32_t dim = 2;
+    SpeakerEmbeddingManager manager(dim, index_type);
+    std::vector<float> v1 = {0.1, 0.1};
+    std::vector<float> v2 = {0.1, 0.9};
+    std::vector<float> v3 = {0.9, 0.1};
+    ASSERT_TRUE(manager.Add("first", v1.data()));
+    ASSERT_TRUE(manager.Add("second", v2.data()));
+    ASSERT_TRUE(manager.Add("third", v3.data()));
+    ASSERT_TRUE(manager.Remove("first"));
+
+    std::string filename = "speaker-embedding-manager-test.bin";
+
+    // The id of the first saved speaker follows the magic, the version
+    // and the number of speakers. Slot 0 is removed and slot 3 does not
+    // exist.
+    for (int32_t id : {-1, 0, 3, 100000}) {
+      ASSERT_TRUE(manager.Save(filename));
+      Patch(filename, 12, id);
+
+      SpeakerEmbeddingManager loaded(dim);
+      EXPECT_FALSE(loaded.Load(filename)) << index_type << " " << id;
+      EXPECT_EQ(loaded.NumSpeakers(), 0);
+    }
+
+    // Counts larger than the file are rejected before anything is
+    // allocated: the number of speakers and the length of the first name
+    for (int32_t offset : {8, 16}) {
+      ASSERT_TRUE(manager.Save(filename));
+      Patch(filename, offset, 1 << 30);
+
+      SpeakerEmbeddingManager loaded(dim);
+      EXPECT_FALSE(loaded.Load(filename)) << index_type << " " << offset;
+    }
+
+    std::remove(filename.c_str());
+  }
+}
+
 }  // namespace sherpa_onnx
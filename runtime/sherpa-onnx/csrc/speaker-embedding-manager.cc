@@ -5,42 +5,54 @@
 #include "sherpa-onnx/csrc/speaker-embedding-manager.h"
 
 #include <algorithm>
+#include <fstream>
+#include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "Eigen/Dense"
 #include "sherpa-onnx/csrc/macros.h"
+#include "sherpa-onnx/csrc/speaker-embedding-index.h"
 
 namespace sherpa_onnx {
 
 using FloatMatrix =
     Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
 
+constexpr char kMagic[4] = {'S', 'E', 'M', 'G'};
+constexpr int32_t kVersion = 1;
+
 class SpeakerEmbeddingManager::Impl {
  public:
-  explicit Impl(int32_t dim) : dim_(dim) {}
+  Impl(int32_t dim, const std::string &index_type)
+      : dim_(dim), index_(SpeakerEmbeddingIndex::Create(index_type, dim)) {
+    if (!index_) {
+      SHERPA_ONNX_LOGE(
+          "Unsupported index type: '%s'. Supported values are: flat, hnsw",
+          index_type.c_str());
+      SHERPA_ONNX_EXIT(-1);
+    }
+  }
 
   bool Add(const std::string &name, const float *p) {
-    if (name2row_.count(name)) {
+    if (name2id_.count(name)) {
       // a speaker with the same name already exists
       return false;
     }
 
-    embedding_matrix_.conservativeResize(embedding_matrix_.rows() + 1, dim_);
-
-    std::copy(p, p + dim_, &embedding_matrix_.bottomRows(1)(0, 0));
-
-    embedding_matrix_.bottomRows(1).normalize();  // inplace
+    Eigen::RowVectorXf v =
+        Eigen::Map<Eigen::RowVectorXf>(const_cast<float *>(p), dim_);
+    v.normalize();
 
-    name2row_[name] = embedding_matrix_.rows() - 1;
-    row2name_[embedding_matrix_.rows() - 1] = name;
+    AddNormalized(name, v);
 
     return true;
   }
 
   bool Add(const std::string &name,
            const std::vector<std::vector<float>> &embedding_list) {
-    if (name2row_.count(name)) {
+    if (name2id_.count(name)) {
       // a speaker with the same name already exists
       return false;
     }
@@ -75,45 +87,28 @@ class SpeakerEmbeddingManager::Impl {
 
     v.normalize();
 
-    embedding_matrix_.conservativeResize(embedding_matrix_.rows() + 1, dim_);
-    embedding_matrix_.bottomRows(1) = v;
-
-    name2row_[name] = embedding_matrix_.rows() - 1;
-    row2name_[embedding_matrix_.rows() - 1] = name;
+    AddNormalized(name, v);
 
     return true;
   }
 
+  // The embedding is only marked as removed in the index, so it takes
+  // O(1) time
   bool Remove(const std::string &name) {
-    if (!name2row_.count(name)) {
+    auto it = name2id_.find(name);
+    if (it == name2id_.end()) {
       return false;
     }
 
-    int32_t row_idx = name2row_.at(name);
-
-    int32_t num_rows = embedding_matrix_.rows();
-
-    if (row_idx < num_rows - 1) {
-      embedding_matrix_.block(row_idx, 0, num_rows - 1 - row_idx, dim_) =
-          embedding_matrix_.bottomRows(num_rows - 1 - row_idx);
-    }
-
-    embedding_matrix_.conservativeResize(num_rows - 1, dim_);
-    for (auto &p : name2row_) {
-      if (p.second > row_idx) {
-        p.second -= 1;
-        row2name_[p.second] = p.first;
-      }
-    }
-
-    name2row_.erase(name);
-    row2name_.erase(num_rows - 1);
+    index_->Remove(it->second);
+    id2name_[it->second].clear();
+    name2id_.erase(it);
 
     return true;
   }
 
   std::string Search(const float *p, float threshold) {
-    if (embedding_matrix_.rows() == 0) {
+    if (name2id_.empty()) {
       return {};
     }
 
@@ -121,63 +116,49 @@ class SpeakerEmbeddingManager::Impl {
         Eigen::Map<Eigen::VectorXf>(const_cast<float *>(p), dim_);
     v.normalize();
 
-    Eigen::VectorXf scores = embedding_matrix_ * v;
-
-    Eigen::VectorXf::Index max_index = 0;
-    float max_score = scores.maxCoeff(&max_index);
-    if (max_score < threshold) {
+    auto matches = index_->Search(v.data(), 1, 1, threshold);
+    if (matches[0].empty()) {
       return {};
     }
 
-    return row2name_.at(max_index);
+    return id2name_[matches[0][0].id];
   }
 
   std::vector<SpeakerMatch> GetBestMatches(const float *p, float threshold,
                                            int32_t n) {
-    std::vector<SpeakerMatch> matches;
+    return GetBestMatchesBatch(p, 1, threshold, n)[0];
+  }
+
+  std::vector<std::vector<SpeakerMatch>> GetBestMatchesBatch(
+      const float *p, int32_t num_queries, float threshold, int32_t n) {
+    std::vector<std::vector<SpeakerMatch>> ans(num_queries);
 
-    if (embedding_matrix_.rows() == 0) {
-      return matches;
+    if (name2id_.empty() || num_queries <= 0) {
+      return ans;
     }
 
-    Eigen::VectorXf v =
-        Eigen::Map<Eigen::VectorXf>(const_cast<float *>(p), dim_);
-    v.normalize();
+    FloatMatrix queries = Eigen::Map<FloatMatrix>(const_cast<float *>(p),
+                                                  num_queries, dim_);
+    queries.rowwise().normalize();
 
-    Eigen::VectorXf scores = embedding_matrix_ * v;
+    auto matches = index_->Search(&queries(0, 0), num_queries, n, threshold);
 
-    std::vector<std::pair<float, int>> score_indices;
-    for (int i = 0; i < scores.size(); ++i) {
-      if (scores[i] >= threshold) {
-        score_indices.emplace_back(scores[i], i);
+    for (int32_t i = 0; i != num_queries; ++i) {
+      ans[i].reserve(matches[i].size());
+      for (const auto &m : matches[i]) {
+        ans[i].push_back({id2name_[m.id], m.score});
       }
     }
 
-    std::sort(score_indices.rbegin(), score_indices.rend(),
-              [](const auto &a, const auto &b) { return a.first < b.first; });
-
-    matches.reserve(score_indices.size());
-    for (int i = 0; i < std::min(n, static_cast<int32_t>(score_indices.size()));
-         ++i) {
-      const auto &pair = score_indices[i];
-      matches.push_back({row2name_.at(pair.second), pair.first});
-    }
-
-    return matches;
+    return ans;
   }
 
   bool Verify(const std::string &name, const float *p, float threshold) {
-    if (!name2row_.count(name)) {
+    if (!name2id_.count(name)) {
       return false;
     }
 
-    int32_t row_idx = name2row_.at(name);
-
-    Eigen::VectorXf v =
-        Eigen::Map<Eigen::VectorXf>(const_cast<float *>(p), dim_);
-    v.normalize();
-
-    float score = embedding_matrix_.row(row_idx) * v;
+    float score = Score(name, p);
 
     if (score < threshold) {
       return false;
@@ -187,34 +168,35 @@ class SpeakerEmbeddingManager::Impl {
   }
 
   float Score(const std::string &name, const float *p) {
-    if (!name2row_.count(name)) {
+    if (!name2id_.count(name)) {
       // Setting a default value if the name is not found
       return -2.0;
     }
 
-    int32_t row_idx = name2row_.at(name);
+    int32_t id = name2id_.at(name);
 
     Eigen::VectorXf v =
         Eigen::Map<Eigen::VectorXf>(const_cast<float *>(p), dim_);
     v.normalize();
 
-    float score = embedding_matrix_.row(row_idx) * v;
+    float score = Eigen::Map<const Eigen::VectorXf>(index_->Get(id), dim_)
+                      .dot(v);
 
     return score;
   }
 
   bool Contains(const std::string &name) const {
-    return name2row_.count(name) > 0;
+    return name2id_.count(name) > 0;
   }
 
-  int32_t NumSpeakers() const { return embedding_matrix_.rows(); }
+  int32_t NumSpeakers() const { return name2id_.size(); }
 
   int32_t Dim() const { return dim_; }
 
   std::vector<std::string> GetAllSpeakers() const {
     std::vector<std::string> all_speakers;
-    all_speakers.reserve(name2row_.size());
-    for (const auto &p : name2row_) {
+    all_speakers.reserve(name2id_.size());
+    for (const auto &p : name2id_) {
       all_speakers.push_back(p.first);
     }
 
@@ -222,15 +204,164 @@ class SpeakerEmbeddingManager::Impl {
     return all_speakers;
   }
 
+  // File layout:
+  //
+  //  magic "SEMG", version, num_speakers,
+  //  (id, name length, name) for each speaker,
+  //  the index, see SpeakerEmbeddingIndex::Save()
+  bool Save(const std::string &filename) const {
+    std::ofstream os(filename, std::ios::binary);
+    if (!os) {
+      SHERPA_ONNX_LOGE("Failed to open '%s' for writing", filename.c_str());
+      return false;
+    }
+
+    os.write(kMagic, sizeof(kMagic));
+    Write(os, kVersion);
+    Write(os, NumSpeakers());
+    for (const auto &p : name2id_) {
+      Write(os, p.second);
+      Write(os, static_cast<int32_t>(p.first.size()));
+      os.write(p.first.data(), p.first.size());
+    }
+
+    index_->Save(os);
+
+    if (!os) {
+      SHERPA_ONNX_LOGE("Failed to write to '%s'", filename.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  bool Load(const std::string &filename) {
+    std::ifstream is(filename, std::ios::binary);
+    if (!is) {
+      SHERPA_ONNX_LOGE("Failed to open '%s'", filename.c_str());
+      return false;
+    }
+
+    char magic[sizeof(kMagic)];
+    is.read(magic, sizeof(magic));
+    int32_t version = 0;
+    int32_t num_speakers = 0;
+    if (!is || !std::equal(magic, magic + sizeof(magic), kMagic) ||
+        !Read(is, &version) || version != kVersion ||
+        !Read(is, &num_speakers) || num_speakers < 0) {
+      SHERPA_ONNX_LOGE("'%s' is not a file written by Save()",
+                       filename.c_str());
+      return false;
+    }
+
+    // Each speaker takes at least an id and a name length, and a name
+    // cannot be longer than the rest of the file
+    int64_t remaining = RemainingBytes(is);
+    if (num_speakers * int64_t{2 * sizeof(int32_t)} > remaining) {
+      SHERPA_ONNX_LOGE("Corrupted file '%s'", filename.c_str());
+      return false;
+    }
+
+    std::vector<std::pair<int32_t, std::string>> speakers(num_speakers);
+    for (auto &speaker : speakers) {
+      int32_t length = 0;
+      if (!Read(is, &speaker.first) || !Read(is, &length) || length < 0 ||
+          length > RemainingBytes(is)) {
+        SHERPA_ONNX_LOGE("Corrupted file '%s'", filename.c_str());
+        return false;
+      }
+
+      speaker.second.resize(length);
+      is.read(&speaker.second[0], length);
+    }
+
+    auto index = SpeakerEmbeddingIndex::Load(is);
+    if (!index) {
+      SHERPA_ONNX_LOGE("Failed to load the index from '%s'", filename.c_str());
+      return false;
+    }
+
+    if (index->Dim() != dim_) {
+      SHERPA_ONNX_LOGE("Dim of '%s' is %d. Expected dim: %d", filename.c_str(),
+                       index->Dim(), dim_);
+      return false;
+    }
+
+    // Matches returned by the index are looked up in id2name, so each
+    // embedding that is not removed must belong to exactly one speaker
+    int32_t num_slots = index->NumSlots();
+    std::unordered_map<std::string, int32_t> name2id;
+    std::vector<std::string> id2name(num_slots);
+    std::vector<char> used(num_slots);
+    for (auto &speaker : speakers) {
+      int32_t id = speaker.first;
+      if (id < 0 || id >= num_slots || index->IsRemoved(id) || used[id] ||
+          name2id.count(speaker.second)) {
+        SHERPA_ONNX_LOGE("Corrupted file '%s'", filename.c_str());
+        return false;
+      }
+
+      used[id] = 1;
+      id2name[id] = speaker.second;
+      name2id[std::move(speaker.second)] = id;
+    }
+
+    for (int32_t i = 0; i != num_slots; ++i) {
+      if (!used[i] && !index->IsRemoved(i)) {
+        SHERPA_ONNX_LOGE("Corrupted file '%s'", filename.c_str());
+        return false;
+      }
+    }
+
+    index_ = std::move(index);
+    name2id_ = std::move(name2id);
+    id2name_ = std::move(id2name);
+
+    return true;
+  }
+
+ private:
+  template <typename T>
+  static void Write(std::ostream &os, const T &v) {
+    os.write(reinterpret_cast<const char *>(&v), sizeof(T));
+  }
+
+  template <typename T>
+  static bool Read(std::istream &is, T *v) {
+    is.read(reinterpret_cast<char *>(v), sizeof(T));
+    return static_cast<bool>(is);
+  }
+
+  static int64_t RemainingBytes(std::istream &is) {
+    std::streampos pos = is.tellg();
+    is.seekg(0, std::ios::end);
+    std::streampos end = is.tellg();
+    is.seekg(pos);
+    return static_cast<int64_t>(end - pos);
+  }
+
+  void AddNormalized(const std::string &name, const Eigen::RowVectorXf &v) {
+    int32_t id = index_->Add(v.data());
+
+    if (id >= static_cast<int32_t>(id2name_.size())) {
+      id2name_.resize(id + 1);
+    }
+    id2name_[id] = name;
+    name2id_[name] = id;
+  }
+
  private:
   int32_t dim_;
-  FloatMatrix embedding_matrix_;
-  std::unordered_map<std::string, int32_t> name2row_;
-  std::unordered_map<int32_t, std::string> row2name_;
+  std::unique_ptr<SpeakerEmbeddingIndex> index_;
+  std::unordered_map<std::string, int32_t> name2id_;
+
+  // Empty for removed speakers
+  std::vector<std::string> id2name_;
 };
 
-SpeakerEmbeddingManager::SpeakerEmbeddingManager(int32_t dim)
-    : impl_(std::make_unique<Impl>(dim)) {}
+SpeakerEmbeddingManager::SpeakerEmbeddingManager(
+    int32_t dim, const std::string &index_type /*= "flat"*/)
+    : impl_(std::make_unique<Impl>(dim, index_type)) {}
 
 SpeakerEmbeddingManager::~SpeakerEmbeddingManager() = default;
 
@@ -259,6 +390,14 @@ std::vector<SpeakerMatch> SpeakerEmbeddingManager::GetBestMatches(
   return impl_->GetBestMatches(p, threshold, n);
 }
 
+std::vector<std::vector<SpeakerMatch>>
+SpeakerEmbeddingManager::GetBestMatchesBatch(const float *p,
+                                             int32_t num_queries,
+                                             float threshold,
+                                             int32_t n) const {
+  return impl_->GetBestMatchesBatch(p, num_queries, threshold, n);
+}
+
 bool SpeakerEmbeddingManager::Verify(const std::string &name, const float *p,
                                      float threshold) const {
   return impl_->Verify(name, p, threshold);
@@ -283,4 +422,12 @@ std::vector<std::string> SpeakerEmbeddingManager::GetAllSpeakers() const {
   return impl_->GetAllSpeakers();
 }
 
+bool SpeakerEmbeddingManager::Save(const std::string &filename) const {
+  return impl_->Save(filename);
+}
+
+bool SpeakerEmbeddingManager::Load(const std::string &filename) {
+  return impl_->Load(filename);
+}
+
 }  // namespace sherpa_onnx
@@ -18,8 +18,15 @@ namespace sherpa_onnx {
 
 class SpeakerEmbeddingManager {
  public:
-  // @param dim Embedding dimension.
-  explicit SpeakerEmbeddingManager(int32_t dim);
+  /* @param dim Embedding dimension.
+   * @param index_type Either "flat" or "hnsw". "flat" compares a query
+   *                   with all speakers and gives exact results. "hnsw"
+   *                   gives approximate results but is much faster with
+   *                   hundreds of thousands of speakers.
+   *                   See also speaker-embedding-index.h
+   */
+  explicit SpeakerEmbeddingManager(int32_t dim,
+                                   const std::string &index_type = "flat");
   ~SpeakerEmbeddingManager();
 
   /* Add the embedding and name of a speaker to the manager.
@@ -86,6 +93,17 @@ class SpeakerEmbeddingManager {
   std::vector<SpeakerMatch> GetBestMatches(const float *p, float threshold,
                                            int32_t n) const;
 
+  /* Same as GetBestMatches() but for several input embeddings at once.
+   *
+   * @param p A row-major matrix of shape (num_queries, dim).
+   * @param num_queries Number of input embeddings.
+   * @param threshold A value between 0 and 1.
+   * @param n The number of top matches to return for each input embedding.
+   * @return ans[i] contains the matches for the i-th input embedding.
+   */
+  std::vector<std::vector<SpeakerMatch>> GetBestMatchesBatch(
+      const float *p, int32_t num_queries, float threshold, int32_t n) const;
+
   /* Check whether the input embedding matches the embedding of the input
    * speaker.
    *
@@ -110,6 +128,20 @@ class SpeakerEmbeddingManager {
   // Return a list of speaker names
   std::vector<std::string> GetAllSpeakers() const;
 
+  /* Save all speakers and the search index to a binary file.
+   *
+   * @return Return true if saved successfully.
+   */
+  bool Save(const std::string &filename) const;
+
+  /* Replace all speakers with the ones from a file written by Save().
+   * The index type is also taken from the file.
+   *
+   * @return Return true if loaded successfully. On failure, the
+   *         existing speakers are kept.
+   */
+  bool Load(const std::string &filename);
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
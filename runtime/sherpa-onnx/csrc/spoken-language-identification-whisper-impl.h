@@ -6,6 +6,7 @@
 #define SHERPA_ONNX_CSRC_SPOKEN_LANGUAGE_IDENTIFICATION_WHISPER_IMPL_H_
 
 #include <algorithm>
+#include <array>
 #include <memory>
 #include <string>
 #include <utility>
@@ -16,6 +17,7 @@
 #include "android/asset_manager_jni.h"
 #endif
 
+#include "sherpa-onnx/csrc/length-batcher.h"
 #include "sherpa-onnx/csrc/offline-whisper-model.h"
 #include "sherpa-onnx/csrc/spoken-language-identification-impl.h"
 #include "sherpa-onnx/csrc/transpose.h"
@@ -45,23 +47,54 @@ class SpokenLanguageIdentificationWhisperImpl
   }
 
   std::string Compute(OfflineStream *s) const override {
+    return Compute(&s, 1)[0];
+  }
+
+  std::vector<std::string> Compute(OfflineStream **ss,
+                                   int32_t n) const override {
     int32_t max_num_frames = 3000;
-    auto memory_info =
-        Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
 
-    int32_t feat_dim = s->FeatureDim();
-    std::vector<float> f = s->GetFrames();
-    int32_t num_frames = f.size() / feat_dim;
+    std::vector<std::vector<float>> features(n);
+    std::vector<int32_t> num_frames(n);
 
-    // we use 50 here so that there will be some zero tail paddings
-    if (num_frames >= max_num_frames - 50) {
-      SHERPA_ONNX_LOGE(
-          "Only waves less than 30 seconds are supported. We process only the "
-          "first 30 seconds and discard the remaining data");
-      num_frames = max_num_frames - 50;
+    for (int32_t i = 0; i != n; ++i) {
+      int32_t feat_dim = ss[i]->FeatureDim();
+      features[i] = ss[i]->GetFrames();
+      num_frames[i] = features[i].size() / feat_dim;
+
+      // we use 50 here so that there will be some zero tail paddings
+      if (num_frames[i] >= max_num_frames - 50) {
+        SHERPA_ONNX_LOGE(
+            "Only waves less than 30 seconds are supported. We process only "
+            "the first 30 seconds and discard the remaining data");
+        num_frames[i] = max_num_frames - 50;
+      }
+
+      model_->NormalizeFeatures(features[i].data(), num_frames[i], feat_dim);
     }
 
-    model_->NormalizeFeatures(f.data(), num_frames, feat_dim);
+    std::vector<std::string> ans(n);
+
+    // Streams of similar lengths are processed together, so that little
+    // padding is needed to give all streams of a batch the same length
+    LengthBatcher batcher(kMaxBatchSize, 0);
+    for (const auto &indexes : batcher.Split(num_frames)) {
+      ComputeBatch(features, num_frames, indexes, ss[0]->FeatureDim(), &ans);
+    }
+
+    return ans;
+  }
+
+ private:
+  // Identify the language of the streams in indexes with one encoder run
+  // and one decoder run. The result of stream indexes[i] is written to
+  // (*ans)[indexes[i]].
+  void ComputeBatch(const std::vector<std::vector<float>> &features,
+                    const std::vector<int32_t> &num_frames,
+                    const std::vector<int32_t> &indexes, int32_t feat_dim,
+                    std::vector<std::string> *ans) const {
+    int32_t max_num_frames = 3000;
+    int32_t n = indexes.size();
 
     // note that 1000 is an experience-value.
     // You can replace 1000 by other values, say, 100.
@@ -74,45 +107,63 @@ class SpokenLanguageIdentificationWhisperImpl
       tail_padding_frames = config_.whisper.tail_paddings;
     }
 
-    int32_t actual_frames =
-        std::min(num_frames + tail_padding_frames, max_num_frames);
+    int32_t actual_frames = 0;
+    for (int32_t k : indexes) {
+      actual_frames =
+          std::max(actual_frames, std::min(num_frames[k] + tail_padding_frames,
+                                           max_num_frames));
+    }
 
-    std::array<int64_t, 3> shape{1, actual_frames, feat_dim};
+    std::array<int64_t, 3> shape{n, actual_frames, feat_dim};
 
     Ort::Value mel = Ort::Value::CreateTensor<float>(
         model_->Allocator(), shape.data(), shape.size());
 
     float *p_mel = mel.GetTensorMutableData<float>();
-    std::copy(f.data(), f.data() + num_frames * feat_dim, p_mel);
+    std::fill_n(p_mel, n * actual_frames * feat_dim, 0);
 
-    std::fill_n(p_mel + num_frames * feat_dim,
-                (actual_frames - num_frames) * feat_dim, 0);
+    for (int32_t i = 0; i != n; ++i) {
+      int32_t k = indexes[i];
+      std::copy(features[k].data(),
+                features[k].data() + num_frames[k] * feat_dim,
+                p_mel + i * actual_frames * feat_dim);
+    }
 
     mel = Transpose12(model_->Allocator(), &mel);
 
     try {
       auto cross_kv = model_->ForwardEncoder(std::move(mel));
-      int32_t lang_id = model_->DetectLanguage(cross_kv.first, cross_kv.second);
+      std::vector<int32_t> lang_ids =
+          model_->DetectLanguage(cross_kv.first, cross_kv.second);
+
       const auto &id2lang = model_->GetID2Lang();
-      if (id2lang.count(lang_id)) {
-        return id2lang.at(lang_id);
-      } else {
-        SHERPA_ONNX_LOGE("Unknown language ID: %d. Return an empty string.",
-                         lang_id);
-        return "";
+      for (int32_t i = 0; i != n; ++i) {
+        if (id2lang.count(lang_ids[i])) {
+          (*ans)[indexes[i]] = id2lang.at(lang_ids[i]);
+        } else {
+          SHERPA_ONNX_LOGE("Unknown language ID: %d. Return an empty string.",
+                           lang_ids[i]);
+        }
       }
     } catch (const Ort::Exception &ex) {
+      if (n > 1) {
+        // Process the streams one by one so that only the failing
+        // stream gets an empty result
+        for (int32_t k : indexes) {
+          ComputeBatch(features, num_frames, {k}, feat_dim, ans);
+        }
+        return;
+      }
+
       SHERPA_ONNX_LOGE(
           "\n\nCaught exception:\n\n%s\n\nReturn an empty result. Number of "
           "input frames: %d, Current tail "
           "paddings: %d. If you see a lot of such exceptions, please consider "
           "using a larger --whisper-tail-paddings",
-          ex.what(), num_frames, tail_padding_frames);
-      return "";
+          ex.what(), num_frames[indexes[0]], tail_padding_frames);
     }
   }
 
- private:
   void Check() const {
     if (!model_->IsMultiLingual()) {
       SHERPA_ONNX_LOGE(
@@ -124,6 +175,8 @@ class SpokenLanguageIdentificationWhisperImpl
   }
 
  private:
+  static constexpr int32_t kMaxBatchSize = 8;
+
   SpokenLanguageIdentificationConfig config_;
   std::unique_ptr<OfflineWhisperModel> model_;
 };
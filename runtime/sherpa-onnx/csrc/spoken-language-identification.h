@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #if __ANDROID_API__ >= 9
 #include "android/asset_manager.h"
@@ -90,6 +91,10 @@ class SpokenLanguageIdentification {
   // Note: en is for English, zh is for Chinese, de is for German, etc.
   std::string Compute(OfflineStream *s) const;
 
+  // Identify the language of n streams with batched model runs.
+  // ans[i] is the language of ss[i].
+  std::vector<std::string> Compute(OfflineStream **ss, int32_t n) const;
+
  private:
   std::unique_ptr<SpokenLanguageIdentificationImpl> impl_;
 };
@@ -0,0 +1,16 @@
+// sherpa-onnx/csrc/thread-pool.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+#ifndef SHERPA_ONNX_CSRC_THREAD_POOL_H_
+#define SHERPA_ONNX_CSRC_THREAD_POOL_H_
+
+#include "runtime/core/thread-pool.h"
+
+namespace sherpa_onnx {
+
+// The thread pool of runtime/core, shared with the other runtimes
+using ThreadPool = SherpaDeploy::ThreadPool;
+
+}  // namespace sherpa_onnx
+
+#endif  // SHERPA_ONNX_CSRC_THREAD_POOL_H_
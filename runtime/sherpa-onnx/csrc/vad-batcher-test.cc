@@ -0,0 +1,176 @@
+// sherpa-onnx/csrc/vad-batcher-test.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-onnx/csrc/vad-batcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sherpa-onnx/csrc/vad-model.h"
+
+namespace sherpa_onnx {
+
+// The speech probability of a window is its mean absolute amplitude
+// smoothed with the previous windows, so the result depends on the order
+// in which the windows of a model are run.
+class FakeVadModel : public VadModel {
+ public:
+  FakeVadModel(const VadModelConfig &config, int32_t *num_batched_windows)
+      : config_(config.silero_vad),
+        sample_rate_(config.sample_rate),
+        num_batched_windows_(num_batched_windows) {}
+
+  void Reset() override { state_ = 0; }
+
+  bool IsSpeech(const float *samples, int32_t n) override {
+    float sum = 0;
+    for (int32_t i = 0; i != n; ++i) {
+      sum += std::abs(samples[i]);
+    }
+    state_ = 0.5f * state_ + sum / n;
+    return state_ > config_.threshold;
+  }
+
+  void IsSpeechBatch(VadModel **models, const float **samples,
+                     int32_t batch_size, int32_t n, bool *is_speech) override {
+    if (batch_size > 1) {
+      *num_batched_windows_ += batch_size;
+    }
+    VadModel::IsSpeechBatch(models, samples, batch_size, n, is_speech);
+  }
+
+  int32_t WindowSize() const override { return config_.window_size; }
+
+  int32_t WindowShift() const override { return config_.window_size; }
+
+  int32_t MinSilenceDurationSamples() const override {
+    return config_.min_silence_duration * sample_rate_;
+  }
+
+  int32_t MinSpeechDurationSamples() const override {
+    return config_.min_speech_duration * sample_rate_;
+  }
+
+  void SetMinSilenceDuration(float s) override {
+    config_.min_silence_duration = s;
+  }
+
+  void SetThreshold(float threshold) override {
+    config_.threshold = threshold;
+  }
+
+ private:
+  SileroVadModelConfig config_;
+  int32_t sample_rate_;
+  int32_t *num_batched_windows_;
+  float state_ = 0;
+};
+
+// Alternate between silence and loud bursts of random lengths
+static std::vector<float> RandomAudio(int32_t n, std::mt19937 *gen) {
+  std::uniform_real_distribution<float> noise(-1, 1);
+  std::uniform_int_distribution<int32_t> duration(1000, 20000);
+
+  std::vector<float> ans(n);
+  bool loud = false;
+  for (int32_t i = 0; i < n; loud = !loud) {
+    int32_t end = std::min(n, i + duration(*gen));
+    for (; i < end; ++i) {
+      ans[i] = (loud ? 0.9f : 0.01f) * noise(*gen);
+    }
+  }
+
+  return ans;
+}
+
+static std::vector<SpeechSegment> GetSegments(VoiceActivityDetector *vad) {
+  std::vector<SpeechSegment> ans;
+  while (!vad->Empty()) {
+    ans.push_back(vad->Front());
+    vad->Pop();
+  }
+  return ans;
+}
+
+TEST(VadBatcher, SameSegmentsAsVoiceActivityDetector) {
+  VadModelConfig config;
+  config.silero_vad.threshold = 0.5;
+  config.silero_vad.min_silence_duration = 0.1;
+  config.silero_vad.min_speech_duration = 0.05;
+  config.silero_vad.max_speech_duration = 1;
+
+  std::mt19937 gen(20250101);
+
+  // Streams of different lengths, so the batches shrink as streams end
+  std::vector<int32_t> lengths = {3 * 16000, 11 * 16000 + 123, 200,
+                                  7 * 16000 + 4567, 16000};
+  int32_t num_streams = lengths.size();
+
+  int32_t num_batched_windows = 0;
+  std::vector<std::vector<float>> audio;
+  std::vector<std::unique_ptr<VoiceActivityDetector>> expected;
+  std::vector<std::unique_ptr<VoiceActivityDetector>> batched;
+  for (auto n : lengths) {
+    audio.push_back(RandomAudio(n, &gen));
+    expected.push_back(std::make_unique<VoiceActivityDetector>(
+        std::make_unique<FakeVadModel>(config, &num_batched_windows), config));
+    batched.push_back(std::make_unique<VoiceActivityDetector>(
+        std::make_unique<FakeVadModel>(config, &num_batched_windows), config));
+  }
+
+  // In each round, every stream receives a chunk of a random size. Some
+  // streams receive two chunks so that the batcher has to run early.
+  std::uniform_int_distribution<int32_t> chunk_size(1, 3000);
+  std::uniform_int_distribution<int32_t> coin(0, 3);
+  std::vector<int32_t> offsets(num_streams, 0);
+
+  VadBatcher batcher;
+  bool done = false;
+  while (!done) {
+    done = true;
+    for (int32_t s = 0; s != num_streams; ++s) {
+      for (int32_t c = coin(gen) == 0 ? 2 : 1; c > 0; --c) {
+        int32_t n = std::min(chunk_size(gen), lengths[s] - offsets[s]);
+        if (n == 0) {
+          break;
+        }
+        const float *p = audio[s].data() + offsets[s];
+        offsets[s] += n;
+
+        expected[s]->AcceptWaveform(p, n);
+        batcher.AcceptWaveform(batched[s].get(), p, n);
+      }
+      done = done && offsets[s] == lengths[s];
+    }
+    batcher.Run();
+    EXPECT_EQ(batcher.NumPending(), 0);
+  }
+
+  EXPECT_GT(num_batched_windows, 0);
+
+  int32_t num_segments = 0;
+  for (int32_t s = 0; s != num_streams; ++s) {
+    expected[s]->Flush();
+    batched[s]->Flush();
+
+    auto expected_segments = GetSegments(expected[s].get());
+    auto batched_segments = GetSegments(batched[s].get());
+    ASSERT_EQ(expected_segments.size(), batched_segments.size()) << s;
+    for (int32_t i = 0; i != static_cast<int32_t>(batched_segments.size());
+         ++i) {
+      EXPECT_EQ(expected_segments[i].start, batched_segments[i].start) << s;
+      EXPECT_EQ(expected_segments[i].samples, batched_segments[i].samples)
+          << s;
+    }
+    num_segments += batched_segments.size();
+  }
+
+  EXPECT_GT(num_segments, num_streams);
+}
+
+}  // namespace sherpa_onnx
@@ -0,0 +1,83 @@
+// sherpa-onnx/csrc/vad-batcher.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-onnx/csrc/vad-batcher.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "sherpa-onnx/csrc/vad-model.h"
+
+namespace sherpa_onnx {
+
+void VadBatcher::AcceptWaveform(VoiceActivityDetector *vad,
+                                const float *samples, int32_t n) {
+  if (pending_set_.count(vad)) {
+    Run();
+  }
+
+  int32_t num_windows = vad->AddSamples(samples, n);
+  if (num_windows == 0) {
+    return;
+  }
+
+  pending_.push_back({vad, num_windows, false});
+  pending_set_.insert(vad);
+}
+
+void VadBatcher::Run() {
+  if (pending_.empty()) {
+    return;
+  }
+
+  int32_t max_num_windows = 0;
+  for (const auto &p : pending_) {
+    max_num_windows = std::max(max_num_windows, p.num_windows);
+  }
+
+  int32_t window_size = pending_[0].vad->GetModel()->WindowSize();
+
+  std::vector<VadModel *> models;
+  std::vector<const float *> windows;
+  std::vector<int32_t> indexes;
+  std::unique_ptr<bool[]> is_speech(new bool[pending_.size()]);
+
+  models.reserve(pending_.size());
+  windows.reserve(pending_.size());
+  indexes.reserve(pending_.size());
+
+  // Windows of the same detector depend on each other through the model
+  // states, so the i-th windows of all detectors form one batch.
+  for (int32_t i = 0; i != max_num_windows; ++i) {
+    models.clear();
+    windows.clear();
+    indexes.clear();
+
+    for (int32_t k = 0; k != static_cast<int32_t>(pending_.size()); ++k) {
+      const auto &p = pending_[k];
+      if (i < p.num_windows) {
+        models.push_back(p.vad->GetModel());
+        windows.push_back(p.vad->Window(i));
+        indexes.push_back(k);
+      }
+    }
+
+    int32_t batch_size = static_cast<int32_t>(models.size());
+    models[0]->IsSpeechBatch(models.data(), windows.data(), batch_size,
+                             window_size, is_speech.get());
+
+    for (int32_t k = 0; k != batch_size; ++k) {
+      pending_[indexes[k]].is_speech |= is_speech[k];
+    }
+  }
+
+  for (const auto &p : pending_) {
+    p.vad->ConsumeWindows(p.num_windows, p.is_speech);
+  }
+
+  pending_.clear();
+  pending_set_.clear();
+}
+
+}  // namespace sherpa_onnx
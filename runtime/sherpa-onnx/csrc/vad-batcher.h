@@ -0,0 +1,55 @@
+// sherpa-onnx/csrc/vad-batcher.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+#ifndef SHERPA_ONNX_CSRC_VAD_BATCHER_H_
+#define SHERPA_ONNX_CSRC_VAD_BATCHER_H_
+
+#include <unordered_set>
+#include <vector>
+
+#include "sherpa-onnx/csrc/voice-activity-detector.h"
+
+namespace sherpa_onnx {
+
+// Run the VAD model of many VoiceActivityDetectors in one batch.
+//
+// Calling AcceptWaveform() on the batcher and then Run() gives every
+// detector the same segments as calling
+// VoiceActivityDetector::AcceptWaveform() on it directly, but the model
+// runs once per window position instead of once per window and detector.
+//
+// All detectors must be created from the same VadModelConfig. The batcher
+// does not own them.
+class VadBatcher {
+ public:
+  /* Queue samples for a detector. The samples are copied, but the model
+   * does not run until Run() is called.
+   *
+   * If samples of this detector are already queued, Run() is called first
+   * so that each call is processed as a separate
+   * VoiceActivityDetector::AcceptWaveform().
+   */
+  void AcceptWaveform(VoiceActivityDetector *vad, const float *samples,
+                      int32_t n);
+
+  // Run the model on all queued windows and update the speech segments
+  // of the detectors.
+  void Run();
+
+  // Number of detectors with queued windows
+  int32_t NumPending() const { return static_cast<int32_t>(pending_.size()); }
+
+ private:
+  struct Pending {
+    VoiceActivityDetector *vad;
+    int32_t num_windows;
+    bool is_speech;
+  };
+
+  std::vector<Pending> pending_;
+  std::unordered_set<VoiceActivityDetector *> pending_set_;
+};
+
+}  // namespace sherpa_onnx
+
+#endif  // SHERPA_ONNX_CSRC_VAD_BATCHER_H_
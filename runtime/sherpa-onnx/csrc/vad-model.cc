@@ -54,6 +54,13 @@ std::unique_ptr<VadModel> VadModel::Create(Manager *mgr,
   return std::make_unique<SileroVadModel>(mgr, config);
 }
 
+void VadModel::IsSpeechBatch(VadModel **models, const float **samples,
+                             int32_t batch_size, int32_t n, bool *is_speech) {
+  for (int32_t i = 0; i != batch_size; ++i) {
+    is_speech[i] = models[i]->IsSpeech(samples[i], n);
+  }
+}
+
 #if __ANDROID_API__ >= 9
 template std::unique_ptr<VadModel> VadModel::Create(
     AAssetManager *mgr, const VadModelConfig &config);
@@ -32,6 +32,24 @@ class VadModel {
    */
   virtual bool IsSpeech(const float *samples, int32_t n) = 0;
 
+  /**
+   * Run IsSpeech() on the next window of several models.
+   *
+   * It is equivalent to calling models[i]->IsSpeech(samples[i], n) for
+   * each i. Models that support it run the network of this model once on
+   * the stacked windows, using the recurrent states of each model.
+   * All models must be created from the same config as this model.
+   *
+   * @param models The models to update. It may contain this model.
+   * @param samples samples[i] is the window of models[i].
+   * @param batch_size Number of models.
+   * @param n Number of samples of each window. Should be equal to
+   *          WindowSize()
+   * @param is_speech On return, is_speech[i] is the result of models[i].
+   */
+  virtual void IsSpeechBatch(VadModel **models, const float **samples,
+                             int32_t batch_size, int32_t n, bool *is_speech);
+
   virtual int32_t WindowSize() const = 0;
 
   virtual int32_t WindowShift() const = 0;
@@ -11,6 +11,8 @@
 
 namespace sherpa_onnx {
 
+class VadModel;
+
 struct SpeechSegment {
   int32_t start;  // in samples
   std::vector<float> samples;
@@ -25,6 +27,12 @@ class VoiceActivityDetector {
   VoiceActivityDetector(Manager *mgr, const VadModelConfig &config,
                         float buffer_size_in_seconds = 60);
 
+  // Use the given model instead of creating one from config, e.g., a fake
+  // model in tests. config is used for everything else.
+  VoiceActivityDetector(std::unique_ptr<VadModel> model,
+                        const VadModelConfig &config,
+                        float buffer_size_in_seconds = 60);
+
   ~VoiceActivityDetector();
 
   void AcceptWaveform(const float *samples, int32_t n);
@@ -44,6 +52,15 @@ class VoiceActivityDetector {
   const VadModelConfig &GetConfig() const;
 
  private:
+  friend class VadBatcher;
+
+  // AcceptWaveform() split into steps so that VadBatcher can run the model
+  // of many detectors at once. See VoiceActivityDetector::Impl.
+  int32_t AddSamples(const float *samples, int32_t n);
+  const float *Window(int32_t i) const;
+  VadModel *GetModel() const;
+  void ConsumeWindows(int32_t k, bool is_speech);
+
   class Impl;
   std::unique_ptr<Impl> impl_;
 };
@@ -56,6 +56,7 @@ static void PybindOfflineSpeakerDiarizationConfig(py::module *m) {
       .def_readwrite("clustering", &PyClass::clustering)
       .def_readwrite("min_duration_on", &PyClass::min_duration_on)
       .def_readwrite("min_duration_off", &PyClass::min_duration_off)
+      .def_readwrite("num_threads", &PyClass::num_threads)
       .def("__str__", &PyClass::ToString)
       .def("validate", &PyClass::Validate);
 }
@@ -41,6 +41,7 @@ static void PybindOfflineTtsConfig(py::module *m) {
       .def_readwrite("rule_fars", &PyClass::rule_fars)
       .def_readwrite("max_num_sentences", &PyClass::max_num_sentences)
       .def_readwrite("silence_scale", &PyClass::silence_scale)
+      .def_readwrite("num_synthesis_threads", &PyClass::num_synthesis_threads)
       .def("validate", &PyClass::Validate)
       .def("__str__", &PyClass::ToString);
 }
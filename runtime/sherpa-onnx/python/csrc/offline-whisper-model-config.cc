@@ -23,6 +23,8 @@ void PybindOfflineWhisperModelConfig(py::module *m) {
       .def_readwrite("language", &PyClass::language)
       .def_readwrite("task", &PyClass::task)
       .def_readwrite("tail_paddings", &PyClass::tail_paddings)
+      .def_readwrite("max_batch_size", &PyClass::max_batch_size)
+      .def_readwrite("max_kv_cache_mb", &PyClass::max_kv_cache_mb)
       .def("__str__", &PyClass::ToString);
 }
 
@@ -37,6 +37,20 @@ void PybindSpeakerEmbeddingExtractor(py::module *m) {
            py::call_guard<py::gil_scoped_release>())
       .def("compute", &PyClass::Compute,
            py::call_guard<py::gil_scoped_release>())
+      .def(
+          "compute_batch",
+          [](const PyClass &self, std::vector<OnlineStream *> &ss) {
+            int32_t n = ss.size();
+            int32_t dim = self.Dim();
+            std::vector<float> v = self.ComputeBatch(ss.data(), n);
+
+            std::vector<std::vector<float>> ans(n);
+            for (int32_t i = 0; i != n; ++i) {
+              ans[i].assign(v.begin() + i * dim, v.begin() + (i + 1) * dim);
+            }
+            return ans;
+          },
+          py::arg("streams"), py::call_guard<py::gil_scoped_release>())
       .def("is_ready", &PyClass::IsReady,
            py::call_guard<py::gil_scoped_release>());
 }
@@ -14,7 +14,8 @@ namespace sherpa_onnx {
 void PybindSpeakerEmbeddingManager(py::module *m) {
   using PyClass = SpeakerEmbeddingManager;
   py::class_<PyClass>(*m, "SpeakerEmbeddingManager")
-      .def(py::init<int32_t>(), py::arg("dim"),
+      .def(py::init<int32_t, const std::string &>(), py::arg("dim"),
+           py::arg("index_type") = "flat",
            py::call_guard<py::gil_scoped_release>())
       .def_property_readonly("num_speakers", &PyClass::NumSpeakers)
       .def_property_readonly("dim", &PyClass::Dim)
@@ -68,7 +69,11 @@ void PybindSpeakerEmbeddingManager(py::module *m) {
             return self.Score(name, v.data());
           },
           py::arg("name"), py::arg("v"),
-          py::call_guard<py::gil_scoped_release>());
+          py::call_guard<py::gil_scoped_release>())
+      .def("save", &PyClass::Save, py::arg("filename"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("load", &PyClass::Load, py::arg("filename"),
+           py::call_guard<py::gil_scoped_release>());
 }
 
 }  // namespace sherpa_onnx
@@ -5,6 +5,7 @@
 #include "sherpa-onnx/python/csrc/spoken-language-identification.h"
 
 #include <string>
+#include <vector>
 
 #include "sherpa-onnx/csrc/spoken-language-identification.h"
 
@@ -53,8 +54,15 @@ void PybindSpokenLanguageIdentification(py::module *m) {
            py::arg("config"), py::call_guard<py::gil_scoped_release>())
       .def("create_stream", &PyClass::CreateStream,
            py::call_guard<py::gil_scoped_release>())
-      .def("compute", &PyClass::Compute, py::arg("s"),
-           py::call_guard<py::gil_scoped_release>());
+      .def("compute",
+           py::overload_cast<OfflineStream *>(&PyClass::Compute, py::const_),
+           py::arg("s"), py::call_guard<py::gil_scoped_release>())
+      .def(
+          "compute_batch",
+          [](const PyClass &self, std::vector<OfflineStream *> &ss) {
+            return self.Compute(ss.data(), ss.size());
+          },
+          py::arg("streams"), py::call_guard<py::gil_scoped_release>());
 }
 
 }  // namespace sherpa_onnx
@@ -33,6 +33,8 @@ from _sherpa_onnx import (
     OnlinePunctuation,
     OnlinePunctuationConfig,
     OnlinePunctuationModelConfig,
+    OnlineSpeechDenoiser,
+    OnlineSpeechDenoiserConfig,
     OnlineStream,
     SileroVadModelConfig,
     SpeakerEmbeddingExtractor,